@@ -1,6 +1,6 @@
 #include "../../../Common/D3DApp.h"
 #include "../../../Common/MathHelper.h"
-#include "../../../Common/UploadBuffer.h"
+#include "../../../Common/UploadRing.h"
 #include "../../../Common/GeometryGenerator.h"
 #include "../../../Common/DDSTextureLoader.h"
 #include "FrameResource.h"
@@ -12,6 +12,9 @@ using namespace DirectX::PackedVector;
 
 const int g_NumFrameResources = 3;
 
+// Shared by the constants and the wave vertices of every frame in flight (about 0.5 MB per frame).
+const UINT64 g_UploadRingSize = 4 * 1024 * 1024;
+
 struct RenderItem {
 	RenderItem () = default;
 
@@ -19,8 +22,6 @@ struct RenderItem {
 
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4 ();
 
-	int NumFrameDirty = g_NumFrameResources;
-
 	UINT ObjCBIndex = -1;
 
 	Material* Mat = nullptr;
@@ -95,6 +96,8 @@ private:
 	FrameResource* m_CurrFrameResource = nullptr;
 	int m_CurrFrameResourceIndex = 0;
 
+	std::unique_ptr<UploadRing> m_UploadRing;
+
 	ComPtr<ID3D12RootSignature> m_RootSignature = nullptr;
 
 	ComPtr<ID3D12DescriptorHeap> m_SrvDescriptorHeap = nullptr;
@@ -114,6 +117,9 @@ private:
 	std::unique_ptr<Waves> m_Waves;
 	RenderItem* m_WavesRitem = nullptr;
 
+	// Wave vertices are built here in cached memory, then streamed to the ring in one copy.
+	std::vector<Vertex> m_WaveVertices;
+
 	bool m_IsWireFrame = false;
 
 	PassConstants m_MainPassCB;
@@ -880,8 +886,9 @@ void BlendDemoApp::BuildPSOs () {
 
 void BlendDemoApp::BuildFrameResources () {
 	for (int i = 0; i < g_NumFrameResources; i++)
-		m_FrameResources.push_back (std::make_unique<FrameResource> (m_Device.Get (), 1, (UINT)m_AllRitems.size (), 
-																	 (UINT)m_Materials.size (), m_Waves->VertexCount ()));
+		m_FrameResources.push_back (std::make_unique<FrameResource> (m_Device.Get ()));
+
+	m_UploadRing = std::make_unique<UploadRing> (m_Device.Get (), g_UploadRingSize);
 }
 
 void BlendDemoApp::OnKeyboardInput (const GameTimer& gt) {
@@ -918,6 +925,9 @@ void BlendDemoApp::Update (const GameTimer& gt) {
 		CloseHandle (eventHandle);
 	}
 
+	// Hand back the upload space of every frame the GPU has finished.
+	m_UploadRing->Retire (m_Fence->GetCompletedValue ());
+
 	UpdateWaves (gt);
 	AnimateMaterials (gt);
 	UpdateObjectCBs (gt);
@@ -942,9 +952,6 @@ void BlendDemoApp::AnimateMaterials (const GameTimer& gt) {
 
 	waterMat->MatTransform (3, 0) = tu;
 	waterMat->MatTransform (3, 1) = tv;
-
-	// Material has changed, so need to update cbuffer.
-	waterMat->NumFrameDirty = g_NumFrameResources;
 }
 
 void BlendDemoApp::UpdateWaves (const GameTimer& gt) {
@@ -965,9 +972,9 @@ void BlendDemoApp::UpdateWaves (const GameTimer& gt) {
 	m_Waves->Update (gt.DeltaTime ());
 
 	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = m_CurrFrameResource->WavesVB.get ();
+	m_WaveVertices.resize (m_Waves->VertexCount ());
 	for (int i = 0; i < m_Waves->VertexCount (); ++i) {
-		Vertex v;
+		Vertex& v = m_WaveVertices[i];
 
 		v.Pos = m_Waves->Position (i);
 		v.Normal = m_Waves->Normal (i);
@@ -976,30 +983,34 @@ void BlendDemoApp::UpdateWaves (const GameTimer& gt) {
 		// mapping [-w/2,w/2] --> [0,1]
 		v.TexC.x = 0.5f + v.Pos.x / m_Waves->Width ();
 		v.TexC.y = 0.5f - v.Pos.z / m_Waves->Depth ();
-
-		currWavesVB->CopyData (i, v);
 	}
 
+	auto currWavesVB = m_UploadRing->Allocate (m_WaveVertices.size () * sizeof (Vertex));
+	StreamCopy::Copy (currWavesVB.CPU, m_WaveVertices.data (), m_WaveVertices.size () * sizeof (Vertex));
+	StreamCopy::Fence ();
+
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
-	m_WavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource ();
+	m_WavesRitem->Geo->VertexBufferGPU = m_UploadRing->Resource ();
+	m_WavesRitem->Geo->VertexBufferOffset = currWavesVB.GPU - m_UploadRing->Resource ()->GetGPUVirtualAddress ();
 }
 
 void BlendDemoApp::UpdateObjectCBs (const GameTimer& gt) {
-	auto currObjectCB = m_CurrFrameResource->ObjectCB.get ();
-	for (auto& e : m_AllRitems) {
-		if (e->NumFrameDirty > 0) {
-			XMMATRIX world = XMLoadFloat4x4 (&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4 (&e->TexTransform);
+	// The ring gives out fresh memory every frame, so every object is written every frame.
+	UINT objCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (ObjectConstants));
+	auto currObjectCB = m_UploadRing->Allocate ((UINT64)objCBByteSize * m_AllRitems.size ());
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4 (&objConstants.World, XMMatrixTranspose (world));
-			XMStoreFloat4x4 (&objConstants.TexTransform, XMMatrixTranspose (texTransform));
+	for (auto& e : m_AllRitems) {
+		XMMATRIX world = XMLoadFloat4x4 (&e->World);
+		XMMATRIX texTransform = XMLoadFloat4x4 (&e->TexTransform);
 
-			currObjectCB->CopyData (e->ObjCBIndex, objConstants);
+		ObjectConstants objConstants;
+		XMStoreFloat4x4 (&objConstants.World, XMMatrixTranspose (world));
+		XMStoreFloat4x4 (&objConstants.TexTransform, XMMatrixTranspose (texTransform));
 
-			e->NumFrameDirty--;
-		}
+		memcpy (currObjectCB.CPU + e->ObjCBIndex * objCBByteSize, &objConstants, sizeof (ObjectConstants));
 	}
+
+	m_CurrFrameResource->ObjectCB = currObjectCB.GPU;
 }
 
 void BlendDemoApp::UpdateMainPassCB (const GameTimer& gt) {
@@ -1032,28 +1043,29 @@ void BlendDemoApp::UpdateMainPassCB (const GameTimer& gt) {
 	m_MainPassCB.Lights[2].Direction = {0.0f, -0.707f, -0.707f};
 	m_MainPassCB.Lights[2].Strength = {0.15f, 0.15f, 0.15f};
 
-	auto currPassCB = m_CurrFrameResource->PassCB.get ();
-	currPassCB->CopyData (0, m_MainPassCB);
+	auto currPassCB = m_UploadRing->Allocate (D3DUtil::CalcConstantBufferByteSize (sizeof (PassConstants)));
+	memcpy (currPassCB.CPU, &m_MainPassCB, sizeof (PassConstants));
+	m_CurrFrameResource->PassCB = currPassCB.GPU;
 }
 
 void BlendDemoApp::UpdateMaterialCBs (const GameTimer& gt) {
-	auto currMaterialCB = m_CurrFrameResource->MaterialCB.get ();
+	UINT matCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (MaterialConstants));
+	auto currMaterialCB = m_UploadRing->Allocate ((UINT64)matCBByteSize * m_Materials.size ());
+
 	for (auto& e : m_Materials) {
 		Material* mat = e.second.get ();
-		if (mat->NumFrameDirty > 0) {
-			XMMATRIX matTransform = XMLoadFloat4x4 (&mat->MatTransform);
-
-			MaterialConstants matConstnats;
-			matConstnats.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstnats.FresnelR0 = mat->FresnelR0;
-			matConstnats.Roughness = mat->Roughness;
-			XMStoreFloat4x4 (&matConstnats.MatTransform, XMMatrixTranspose (matTransform));
+		XMMATRIX matTransform = XMLoadFloat4x4 (&mat->MatTransform);
 
-			currMaterialCB->CopyData (mat->MatCBIndex, matConstnats);
+		MaterialConstants matConstnats;
+		matConstnats.DiffuseAlbedo = mat->DiffuseAlbedo;
+		matConstnats.FresnelR0 = mat->FresnelR0;
+		matConstnats.Roughness = mat->Roughness;
+		XMStoreFloat4x4 (&matConstnats.MatTransform, XMMatrixTranspose (matTransform));
 
-			mat->NumFrameDirty--;
-		}
+		memcpy (currMaterialCB.CPU + mat->MatCBIndex * matCBByteSize, &matConstnats, sizeof (MaterialConstants));
 	}
+
+	m_CurrFrameResource->MaterialCB = currMaterialCB.GPU;
 }
 
 void BlendDemoApp::Draw (const GameTimer& gt) {
@@ -1083,8 +1095,7 @@ void BlendDemoApp::Draw (const GameTimer& gt) {
 
 	m_CmdList->SetGraphicsRootSignature (m_RootSignature.Get ());
 
-	auto passCB = m_CurrFrameResource->PassCB->Resource ();
-	m_CmdList->SetGraphicsRootConstantBufferView (2, passCB->GetGPUVirtualAddress ());
+	m_CmdList->SetGraphicsRootConstantBufferView (2, m_CurrFrameResource->PassCB);
 
 	m_CmdList->SetPipelineState (m_PSOs["opaque"].Get ());
 	DrawRenderItems (m_CmdList.Get (), m_RitemLayer[(int)RenderLayer::Opaque]);
@@ -1109,14 +1120,13 @@ void BlendDemoApp::Draw (const GameTimer& gt) {
 	m_CurrFrameResource->Fence = ++m_CurrentFence;
 
 	m_CmdQueue->Signal (m_Fence.Get (), m_CurrentFence);
+	m_UploadRing->EndFrame (m_CurrentFence);
 }
 
 void BlendDemoApp::DrawRenderItems (ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems) {
 	UINT objCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (ObjectConstants));
 	UINT matCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (MaterialConstants));
 
-	auto objectCB = m_CurrFrameResource->ObjectCB->Resource ();
-	auto matCB = m_CurrFrameResource->MaterialCB->Resource ();
 
 	for (size_t i = 0; i < ritems.size (); i++) {
 		auto ri = ritems[i];
@@ -1125,10 +1135,10 @@ void BlendDemoApp::DrawRenderItems (ID3D12GraphicsCommandList* cmdList, const st
 		cmdList->IASetIndexBuffer (&ri->Geo->IndexBufferView ());
 		cmdList->IASetPrimitiveTopology (ri->PrimitiveType);
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress ();
+		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = m_CurrFrameResource->ObjectCB;
 		objCBAddress += ri->ObjCBIndex * objCBByteSize;
 
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress ();
+		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = m_CurrFrameResource->MaterialCB;
 		matCBAddress += ri->Mat->MatCBIndex * matCBByteSize;
 
 		CD3DX12_GPU_DESCRIPTOR_HANDLE tex (m_SrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart ());
@@ -2,7 +2,7 @@
 
 #include "../../../Common/D3DUtil.h"
 #include "../../../Common/MathHelper.h"
-#include "../../../Common/UploadBuffer.h"
+#include "../../../Common/UploadRing.h"
 
 struct ObjectConstants {
     DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4 ();
@@ -43,17 +43,18 @@ struct Vertex {
 
 struct FrameResource {
 public:
-    FrameResource (ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount);
+    FrameResource (ID3D12Device* device);
     FrameResource (const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource ();
 
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
-    std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
-    std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
-    std::unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
+    // This frame's constants, suballocated from the app's upload ring. The object and material
+    // buffers hold one 256-byte aligned element per ObjCBIndex / MatCBIndex.
+    D3D12_GPU_VIRTUAL_ADDRESS PassCB = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS MaterialCB = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS ObjectCB = 0;
 
     UINT64 Fence = 0;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource (ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount) {
+FrameResource::FrameResource (ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount,
+                              UINT indirectCommandCount) {
     ThrowIfFailed (device->CreateCommandAllocator (
         D3D12_COMMAND_LIST_TYPE_DIRECT,
         IID_PPV_ARGS (CmdListAlloc.GetAddressOf ())));
@@ -8,6 +9,25 @@ FrameResource::FrameResource (ID3D12Device* device, UINT passCount, UINT objectC
     PassCB = std::make_unique<UploadBuffer<PassConstants>> (device, passCount, true);
     MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>> (device, materialCount, true);
     ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>> (device, objectCount, true);
+    IndirectArgs = std::make_unique<UploadBuffer<IndirectArgumentBuilder::Command>> (device, indirectCommandCount, false);
 }
 
-FrameResource::~FrameResource () {}
\ No newline at end of file
+FrameResource::~FrameResource () {}
+
+ID3D12CommandAllocator* FrameResource::RecordAllocator (ID3D12Device* device, UINT index) {
+    while (RecordAllocs.size () <= index) {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> alloc;
+        ThrowIfFailed (device->CreateCommandAllocator (
+            D3D12_COMMAND_LIST_TYPE_DIRECT,
+            IID_PPV_ARGS (alloc.GetAddressOf ())));
+        RecordAllocs.push_back (alloc);
+    }
+    return RecordAllocs[index].Get ();
+}
+
+UploadBuffer<IndirectArgumentBuilder::Command>* FrameResource::IndirectArgsFor (ID3D12Device* device, UINT commandCount) {
+    if (commandCount > IndirectArgs->ElementCount ()) {
+        IndirectArgs = std::make_unique<UploadBuffer<IndirectArgumentBuilder::Command>> (device, commandCount, false);
+    }
+    return IndirectArgs.get ();
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "../../../Common/D3DUtil.h"
 #include "../../../Common/MathHelper.h"
 #include "../../../Common/UploadBuffer.h"
+#include "../../../Common/IndirectArgumentBuilder.h"
 
 struct ObjectConstants {
     DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4 ();
@@ -48,16 +49,27 @@ struct Vertex {
 
 struct FrameResource {
 public:
-    FrameResource (ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
+    FrameResource (ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT indirectCommandCount);
     FrameResource (const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource ();
 
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
+    // Allocators for the command lists passes are recorded into in parallel, one per list, created
+    // as more lists are needed. Not thread-safe: Draw gets them all before the workers start.
+    ID3D12CommandAllocator* RecordAllocator (ID3D12Device* device, UINT index);
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> RecordAllocs;
+
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
     std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
     std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
 
+    // ExecuteIndirect arguments, one command per item per pass it is drawn in. IndirectArgsFor
+    // replaces the buffer with a bigger one when a frame needs more commands than it holds; only call
+    // it once this frame resource's fence has passed.
+    UploadBuffer<IndirectArgumentBuilder::Command>* IndirectArgsFor (ID3D12Device* device, UINT commandCount);
+    std::unique_ptr<UploadBuffer<IndirectArgumentBuilder::Command>> IndirectArgs = nullptr;
+
     UINT64 Fence = 0;
 };
\ No newline at end of file
@@ -12,7 +12,12 @@
 
 #include "LightingUtil.hlsl"
 
+#ifdef FLIPBOOK
+// Every animation frame is one slice, selected by gDiffuseArraySlice.
+Texture2DArray gDiffuseMap : register(t0);
+#else
 Texture2D    gDiffuseMap : register(t0);
+#endif
 
 SamplerState gsamPointWrap        : register(s0);
 SamplerState gsamPointClamp       : register(s1);
@@ -31,6 +36,7 @@ cbuffer cbMaterial : register(b2) {
     float3 gFresnelR0;
     float  gRoughness;
     float4x4 gMatTransform;
+    uint gDiffuseArraySlice;
 };
 
 cbuffer cbPass : register(b1) {
@@ -101,7 +107,11 @@ float4 PS (VertexOut pin) : SV_Target {
     //
     //return float4(0.05f, 0.05f, 0.05f, 1.0f);
 
+#ifdef FLIPBOOK
+    float4 diffuseAlbedo = gDiffuseMap.Sample (gsamAnisotropicWrap, float3 (pin.TexC, gDiffuseArraySlice)) * gDiffuseAlbedo;
+#else
     float4 diffuseAlbedo = gDiffuseMap.Sample (gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+#endif
 
 #ifdef ALPHA_TEST
     clip (diffuseAlbedo.r - 0.1f);
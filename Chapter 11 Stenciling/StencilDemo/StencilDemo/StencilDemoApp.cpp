@@ -3,10 +3,24 @@
 #include "../../../Common/UploadBuffer.h"
 #include "../../../Common/GeometryGenerator.h"
 #include "../../../Common/DDSTextureLoader.h"
+#include "../../../Common/TextureStreamer.h"
+#include "../../../Common/GeometryUploader.h"
+#include "../../../Common/GpuHeapAllocator.h"
+#include "../../../Common/CopyUploadQueue.h"
+#include "../../../Common/ShaderCache.h"
+#include "../../../Common/JobGraph.h"
+#include "../../../Common/ShaderPermutations.h"
+#include "../../../Common/PipelineCache.h"
+#include "../../../Common/FrustumCuller.h"
+#include "../../../Common/DrawSorter.h"
+#include "../../../Common/StateFilter.h"
+#include "../../../Common/RecordPartitioner.h"
+#include "../../../Common/IndirectArgumentBuilder.h"
+#include "../../../Common/FrameDirtySet.h"
+#include "../../../Common/RenderItemStore.h"
+#include "../../../Common/ObjectConstantBuilder.h"
+#include "../../../Common/NameRegistry.h"
 #include "FrameResource.h"
-#include "DirectXTex.h"
-
-#pragma comment (lib,"DirectXTex.lib")
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -14,16 +28,29 @@ using namespace DirectX::PackedVector;
 
 const int g_NumFrameResources = 3;
 
-struct RenderItem {
-	RenderItem () = default;
+// Streamed textures start with only the mips no larger than this resident.
+const UINT g_StreamedBaseSize = 64;
+const UINT64 g_DefaultTextureBudget = 512 * 1024;
 
-	XMFLOAT4X4 World = MathHelper::Identity4x4 ();
+// Size of each heap the geometry and evicted textures are placed in.
+const UINT64 g_PlacedHeapSize = 8 * 1024 * 1024;
 
-	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4 ();
+// Fewest draws worth a command list of their own when recording in parallel.
+const UINT g_MinChunkDraws = 64;
 
-	int NumFrameDirty = g_NumFrameResources;
+// Fewest changed items worth building object constants on worker threads.
+const UINT g_MinParallelConstants = 4 * ObjectConstantBuilder::BlockSize;
 
-	UINT ObjCBIndex = -1;
+// Key of one light count variant of a PSO in m_PSOs.
+std::string VariantName (const std::string& name, const LightCounts& lights) {
+	return name + "/" + std::to_string (lights.Directional) + "." + std::to_string (lights.Point) + "." +
+		std::to_string (lights.Spot);
+}
+
+// What is drawn for a render item. Its transforms, bounds, dirty count and layers are kept next to
+// it in m_Ritems, an array each; its index there is also its slot in the object constants.
+struct RenderItem {
+	RenderItem () = default;
 
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
@@ -33,8 +60,19 @@ struct RenderItem {
 	UINT IndexCount = 0;
 	UINT StartIndexLocation = 0;
 	int BaseVertexLocation = 0;
+
+	// How many times the texture repeats across the item's bounds, used to pick the mip it needs.
+	float TexRepeat = 1.0f;
+
+	// Small number identifying Geo in draw sort keys.
+	UINT GeometryId = 0;
+
+	// Last upload the item needs. Tickets complete in order, so this covers its textures too.
+	UploadScheduler::Ticket UploadTicket = 0;
 };
 
+typedef RenderItemStore<RenderItem>::Handle RitemHandle;
+
 enum class RenderLayer : int {
 	Opaque = 0,
 	Mirrors,
@@ -45,6 +83,42 @@ enum class RenderLayer : int {
 	Count
 };
 
+// One pass of Draw: the visible items of Layer, drawn with PSO, StencilRef and the pass constants at
+// PassCB. Everything is resolved before recording starts, so passes can be recorded on any thread.
+struct LayerPass {
+	RenderLayer Layer;
+	ID3D12PipelineState* PSO;
+	UINT StencilRef;
+	D3D12_GPU_VIRTUAL_ADDRESS PassCB;
+};
+
+// The runs of the indirect argument buffer one chunk of a pass executes.
+struct RunRange {
+	UINT First = 0;
+	UINT Count = 0;
+};
+
+typedef NameRegistry<ComPtr<ID3DBlob>>::Handle ShaderHandle;
+typedef NameRegistry<ComPtr<ID3D12PipelineState>>::Handle PSOHandle;
+typedef NameRegistry<std::unique_ptr<Material>>::Handle MaterialHandle;
+
+// What a PSO is built from, so the variants for other light counts can be created when a pass
+// first needs them, and the variants built so far. A pass only ever sees a few light lists, so
+// GetPSO searches them in order rather than hashing a variant name.
+struct PSOSource {
+	struct Variant {
+		LightCounts Lights;
+		PSOHandle PSO;
+	};
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+	ShaderHandle VS;
+	ShaderPermutations* PS = nullptr;
+	std::vector<Variant> Variants;
+};
+
+typedef NameRegistry<PSOSource>::Handle PSOSourceHandle;
+
 class StencilDemoApp : public D3DApp {
 public:
 	StencilDemoApp (HINSTANCE hInstance);
@@ -62,25 +136,45 @@ private:
 	virtual void OnMouseDown (WPARAM btnState, int x, int y) override;
 	virtual void OnMouseUp (WPARAM btnState, int x, int y) override;
 	virtual void OnMouseMove (WPARAM btnState, int x, int y) override;
+	virtual std::wstring FrameStatsText (int frameCount) override;
 
 	void OnKeyboardInput (const GameTimer& gt);
 	void UpdateCamera (const GameTimer& gt);
 	void UpdateObjectCBs (const GameTimer& gt);
 	void UpdateMainPassCB (const GameTimer& gt);
 	void UpdateMaterialCBs (const GameTimer& gt);
+	void MarkMaterialDirty (const Material* mat);
 	void UpdateReflectedPassCB (const GameTimer& gt);
+	void CullRenderItems ();
 	void AnimateMaterials (const GameTimer& gt);
+	void UpdateTextureStreaming (const GameTimer& gt);
+	void ExecuteStreamCommands ();
+	void TransitionUploadedTextures ();
 
 	void LoadTextures ();
 	void BuildScene ();
 	void BuildSkullGeometry ();
+	void SubmitGeometry ();
 	void BuildMaterials ();
 	void BuildRenderItems ();
+	RitemHandle CreateRenderItem (MeshGeometry* geo, const std::string& submesh, Material* mat);
 	void BuildDescriptorHeaps ();
 	void BuildRootSignature ();
-	void BuildShadersAndInputLayout ();
-	void BuildPSOs ();
+	void BuildCommandSignature ();
+	void BuildLights ();
+	void BuildShadersAndPSOs ();
+	void BuildShadersAndInputLayout (JobGraph& jobs);
+	void BuildPSOs (JobGraph& jobs);
+	void AddShaderJob (JobGraph& jobs, const std::string& name, const std::wstring& filename,
+					   const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target);
+	void AddPixelShaderJob (JobGraph& jobs, const std::string& name, const std::wstring& filename,
+							const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target);
+	void AddPSOJob (JobGraph& jobs, const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+					const std::string& vs, const std::string& ps);
+	ComPtr<ID3D12PipelineState> CreatePSO (PSOSourceHandle source, const LightCounts& lights);
+	ID3D12PipelineState* GetPSO (PSOSourceHandle source, const LightCounts& lights);
 	void BuildFrameResources ();
+	void BuildTextureStreamer ();
 
 	void LoadDefultSceneTextures ();
 	void BuildDefaultScene ();
@@ -88,7 +182,18 @@ private:
 	void BuildDefaultSceneRenderItems ();
 	void BuildDefaultSceneDescriptorHeaps ();
 
-	void DrawRenderItems (ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void BuildLayerPasses ();
+	void PartitionPasses (uint32_t workerCount, uint32_t minChunkDraws);
+	void BuildIndirectArguments ();
+	void RecordPassesSerial ();
+	void RecordPassesParallel (JobGraph& jobs);
+	ID3D12GraphicsCommandList* ResetRecordList (UINT index, ID3D12PipelineState* pso);
+	void SetFrameState (StateFilter<ID3D12GraphicsCommandList>& cmdList);
+	void RecordChunk (StateFilter<ID3D12GraphicsCommandList>& cmdList, size_t chunkIndex);
+	void DrawRenderItems (StateFilter<ID3D12GraphicsCommandList>& cmdList, const std::vector<uint32_t>& ritems,
+						  size_t first, size_t count);
+	void ExecuteIndirectRuns (StateFilter<ID3D12GraphicsCommandList>& cmdList, const std::vector<uint32_t>& ritems,
+							  const RunRange& runs);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers ();
 
@@ -103,19 +208,28 @@ private:
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> m_InputLayout;
 
-	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> m_Geometries;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> m_Textures;
-	std::unordered_map<std::string, std::unique_ptr<Material>> m_Materials;
+	// Looked up by name while the scene and pipelines are built; per-frame code keeps handles.
+	NameRegistry<std::unique_ptr<MeshGeometry>> m_Geometries;
+	NameRegistry<std::unique_ptr<Texture>> m_Textures;
+	NameRegistry<std::unique_ptr<Material>> m_Materials;
+
+	NameRegistry<ComPtr<ID3DBlob>> m_Shaders;
+	NameRegistry<ComPtr<ID3D12PipelineState>> m_PSOs;	// Every PSO variant built so far, by VariantName().
 
-	std::unordered_map<std::string, ComPtr<ID3DBlob>> m_Shaders;
-	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> m_PSOs;
+	// Every render item, with a bit set of the items in each RenderLayer.
+	RenderItemStore<RenderItem> m_Ritems;
 
-	std::vector<std::unique_ptr<RenderItem>> m_AllRitems;
-	std::vector<RenderItem*> m_RitemLayer[(int)RenderLayer::Count];
+	// The materials by MatCBIndex, and the ones each frame resource's MaterialCB is behind on.
+	// Changes to a material go through MarkMaterialDirty.
+	std::vector<Material*> m_MaterialsByCB;
+	FrameDirtySet m_DirtyMaterials;
 
-	RenderItem* m_SkullRitem = nullptr;
-	RenderItem* m_ReflectedSkullRitem = nullptr;
-	RenderItem* m_ShadowedSkullRitem = nullptr;
+	// Items whose object constants UpdateObjectCBs rewrites this frame.
+	std::vector<uint32_t> m_DirtyObjects;
+
+	RitemHandle m_SkullRitem;
+	RitemHandle m_ReflectedSkullRitem;
+	RitemHandle m_ShadowedSkullRitem;
 
 	bool m_IsWireFrame = false;
 
@@ -137,23 +251,173 @@ private:
 	//
 	// Exercise 7
 	//
-	ComPtr<ID3D12DescriptorHeap> m_BoltSrvDescriptorHeap = nullptr;
-	std::vector<Texture> m_BoltTextures;
-	int m_BoltIndex = 0;
+	UINT m_BoltFrameCount = 1;
+	UINT m_BoltIndex = 0;
+	MaterialHandle m_BoltMat;
 
 	//
 	// Exercise 11
 	//
-	RenderItem* m_ReflectedFloorRitem = nullptr;
+	RitemHandle m_ReflectedFloorRitem;
+
+	//
+	// Texture streaming
+	//
+	struct StreamedTexture {
+		Texture* Tex = nullptr;
+		Material* Mat = nullptr;
+
+		// The material flips between two descriptors so the one in use by frames in flight is never rewritten.
+		UINT SrvHeapIndex[2] = {0, 0};
+		UINT ActiveSlot = 0;
+
+		UINT Width = 0;
+		UINT Height = 0;
+		UINT MipCount = 1;
+
+		// Where Tex->Resource lives when it was created by an eviction. Loads come from the DDS
+		// loader as committed resources.
+		GpuHeapAllocator::Allocation Placement;
+	};
+
+	// A replaced texture kept alive until the GPU has finished the frame that swapped it out.
+	struct RetiredTexture {
+		UINT Streamed = 0;
+		UINT64 Fence = 0;
+		ComPtr<ID3D12Resource> Resource = nullptr;
+		ComPtr<ID3D12Resource> UploadHeap = nullptr;
+		GpuHeapAllocator::Allocation Placement;
+	};
+
+	std::unique_ptr<GpuHeapAllocator> m_HeapAllocator;
+
+	// Static geometry is batched into shared default buffers, staged through one upload arena.
+	std::unique_ptr<GeometryUploader> m_GeometryUploader;
+
+	//
+	// Uploads on the copy queue
+	//
+	// Textures loaded on the copy queue are left in COMMON; they get an explicit transition to
+	// PIXEL_SHADER_RESOURCE on the direct queue once their ticket completes.
+	struct PendingTexture {
+		Texture* Tex = nullptr;
+		UploadScheduler::Ticket Ticket = 0;
+	};
+
+	std::unique_ptr<CopyUploadQueue> m_CopyQueue;
+	std::vector<PendingTexture> m_PendingTextures;
+	UploadScheduler::Ticket m_TextureTicket = 0;
+	std::unordered_map<std::string, UploadScheduler::Ticket> m_GeometryTickets;
+
+	// The one job graph: shader and PSO builds at startup, then object constants and parallel
+	// recording every frame. Its worker threads live as long as the app, and each use clears it first.
+	JobGraph m_Jobs;
+	std::unordered_map<std::string, JobGraph::JobId> m_ShaderJobs;
+
+	//
+	// Light count permutations
+	//
+	// The scene's lights by kind. Each pass packs them into its constants and draws with the pixel
+	// shader variant that loops over just those slots, so no light slot is evaluated for nothing.
+	std::vector<Light> m_DirLights;
+	std::vector<Light> m_PointLights;
+	std::vector<Light> m_SpotLights;
+	bool m_LightKeyDown = false;
+
+	LightCounts m_MainPassLights;
+	LightCounts m_ReflectedPassLights;
+
+	std::unordered_map<std::string, std::unique_ptr<ShaderPermutations>> m_PixelShaders;
+	NameRegistry<PSOSource> m_PSOSources;
+
+	// The PSOs of Draw's passes, found by name once BuildPSOs has added them.
+	PSOSourceHandle m_OpaquePSO;
+	PSOSourceHandle m_WireframePSO;
+	PSOSourceHandle m_MarkMirrorsPSO;
+	PSOSourceHandle m_ReflectionsPSO;
+	PSOSourceHandle m_TransparentPSO;
+	PSOSourceHandle m_ShadowPSO;
+	PSOSourceHandle m_AlphaTestPSO;
+	PSOSourceHandle m_ZTestPSO;
+
+	// Driver compiled PSOs from earlier runs.
+	std::unique_ptr<PipelineCache> m_PipelineCache;
+
+	//
+	// Frustum culling
+	//
+	// The items of each layer that may be on screen this frame, as indices into m_Ritems, in layer
+	// order. Draw only records these.
+	FrustumCuller m_FrustumCuller;
+	std::vector<uint32_t> m_VisibleRitems[(int)RenderLayer::Count];
+	std::vector<uint32_t> m_LayerRitems;
+	std::vector<BoundingBox> m_CullBounds;
+	std::vector<uint32_t> m_CullIndices;
+	UINT m_VisibleRitemCount = 0;
+	UINT m_LayerRitemCount = 0;
+
+	// Visible items are sorted by state, and Draw records state through m_StateFilter, which drops
+	// whatever is already bound.
+	DrawSorter m_DrawSorter;
+	StateFilter<ID3D12GraphicsCommandList> m_StateFilter;
+
+	//
+	// Parallel recording
+	//
+	// 'P' switches between recording every pass whole into m_CmdList and splitting the passes into
+	// chunks recorded on worker threads, each into its own command list and allocator. The lists are
+	// submitted after m_CmdList in chunk order, followed by one for the transition to present.
+	// Serial by default: it has not yet been measured to win on a scene this size.
+	std::vector<LayerPass> m_LayerPasses;
+	std::vector<RecordPartitioner::Chunk> m_RecordChunks;
+	std::vector<ComPtr<ID3D12GraphicsCommandList>> m_RecordCmdLists;
+	std::vector<StateFilter<ID3D12GraphicsCommandList>> m_RecordFilters;
+	std::vector<ID3D12CommandList*> m_SubmitLists;
+	bool m_ParallelRecording = false;
+	bool m_ParallelKeyDown = false;
+
+	//
+	// Indirect draws
+	//
+	// 'X' switches the passes to ExecuteIndirect. The visible items are turned into an argument
+	// buffer of object CBV, material CBV and draw arguments, executed one run of items sharing
+	// geometry, topology and texture at a time.
+	ComPtr<ID3D12CommandSignature> m_CommandSignature;
+	IndirectArgumentBuilder m_IndirectBuilder;
+	std::vector<RunRange> m_ChunkRuns;
+	bool m_IndirectDraws = false;
+	bool m_IndirectKeyDown = false;
+
+	// State calls issued and filtered, and command lists submitted, in the last frame.
+	UINT m_StateCallsIssued = 0;
+	UINT m_StateCallsFiltered = 0;
+	UINT m_SubmittedListCount = 0;
+
+	std::unique_ptr<TextureStreamer> m_TextureStreamer;
+	std::vector<StreamedTexture> m_StreamedTextures;
+	std::vector<RetiredTexture> m_RetiredTextures;
+	std::vector<TextureStreamer::Command> m_StreamCommands;
+	UINT64 m_StreamFrame = 0;
+	bool m_BudgetKeyDown = false;
 };
 
-StencilDemoApp::StencilDemoApp (HINSTANCE hInstance) : D3DApp (hInstance) {
+StencilDemoApp::StencilDemoApp (HINSTANCE hInstance) :
+	D3DApp (hInstance),
+	m_Ritems ((uint32_t)RenderLayer::Count, g_NumFrameResources),
+	m_DirtyMaterials (g_NumFrameResources) {
 	m_MainWndCaption = L"Chapter 11 - StencilDemo";
 }
 
 StencilDemoApp::~StencilDemoApp () {
 	if (m_Device != nullptr)
 		FlushCommandQueue ();
+
+	if (m_CopyQueue != nullptr)
+		m_CopyQueue->Flush ();
+
+	// Keeps the variants first built during this run.
+	if (m_PipelineCache != nullptr)
+		m_PipelineCache->Save ();
 }
 
 void StencilDemoApp::OnResize () {
@@ -168,6 +432,11 @@ bool StencilDemoApp::Initialize () {
 		return false;
 
 	ThrowIfFailed (m_CmdList->Reset (m_CmdAllocator.Get (), nullptr));
+
+	m_HeapAllocator = std::make_unique<GpuHeapAllocator> (m_Device.Get (), g_PlacedHeapSize);
+	m_GeometryUploader = std::make_unique<GeometryUploader> (m_Device.Get (), m_HeapAllocator.get ());
+	m_CopyQueue = std::make_unique<CopyUploadQueue> (m_Device.Get ());
+	m_PipelineCache = std::make_unique<PipelineCache> (m_Device.Get (), ShaderCache::Directory () + L"/StencilDemo.plib");
 	
 	//LoadDefultSceneTextures ();
 	//BuildDefaultScene ();
@@ -175,26 +444,35 @@ bool StencilDemoApp::Initialize () {
 	//BuildDefaultSceneRenderItems ();
 	//BuildDefaultSceneDescriptorHeaps ();
 
+	// Textures, the room and the skull go to the copy queue as three batches and appear on screen as
+	// each one lands, while the frame loop keeps running.
 	LoadTextures ();
 	BuildScene ();
+	SubmitGeometry ();
 	BuildSkullGeometry ();
+	SubmitGeometry ();
 	BuildMaterials ();
 	BuildRenderItems ();
 	BuildDescriptorHeaps ();
+	BuildTextureStreamer ();
 	BuildRootSignature ();
-	BuildShadersAndInputLayout ();
+	BuildCommandSignature ();
 	BuildFrameResources ();
-	BuildPSOs ();
+	BuildLights ();
+	BuildShadersAndPSOs ();
 
 	ThrowIfFailed (m_CmdList->Close ());
 	ID3D12CommandList* cmdsLists[] = {m_CmdList.Get ()};
 	m_CmdQueue->ExecuteCommandLists (_countof (cmdsLists), cmdsLists);
 
+	// Only waits for the direct queue, which no longer carries any uploads.
 	FlushCommandQueue ();
 
-	for (auto& geo : m_Geometries) {
-		geo.second->DisposeUploaders ();
-	}
+	char message[256];
+	GeometryUploader::Stats stats = m_GeometryUploader->GetStats ();
+	sprintf_s (message, "GeometryUploader: %u meshes, %llu bytes in %u resources, %llu staging bytes\n",
+			   stats.Meshes, stats.DataBytes, stats.DefaultBuffers + stats.UploadBuffers, stats.StagingBytes);
+	OutputDebugStringA (message);
 
 	return true;
 }
@@ -226,9 +504,9 @@ void StencilDemoApp::LoadDefultSceneTextures () {
 														tileTex->Resource, tileTex->UploadHeap)
 	);
 
-	m_Textures[bricksTex->Name] = std::move (bricksTex);
-	m_Textures[stoneTex->Name] = std::move (stoneTex);
-	m_Textures[tileTex->Name] = std::move (tileTex);
+	m_Textures.Add (bricksTex->Name, std::move (bricksTex));
+	m_Textures.Add (stoneTex->Name, std::move (stoneTex));
+	m_Textures.Add (tileTex->Name, std::move (tileTex));
 }
 
 void StencilDemoApp::BuildDefaultScene () {
@@ -330,7 +608,7 @@ void StencilDemoApp::BuildDefaultScene () {
 	geo->DrawArgs["sphere"] = sphereSubmesh;
 	geo->DrawArgs["cylinder"] = cylinderSubmesh;
 
-	m_Geometries[geo->Name] = std::move (geo);
+	m_Geometries.Add (geo->Name, std::move (geo));
 }
 
 void StencilDemoApp::BuildDefaultSceneMaterials () {
@@ -358,43 +636,34 @@ void StencilDemoApp::BuildDefaultSceneMaterials () {
 	tile0->FresnelR0 = XMFLOAT3 (0.02f, 0.02f, 0.02f);
 	tile0->Roughness = 0.3f;
 
-	m_Materials["bricks0"] = std::move (bricks0);
-	m_Materials["stone0"] = std::move (stone0);
-	m_Materials["tile0"] = std::move (tile0);
+	m_Materials.Add ("bricks0", std::move (bricks0));
+	m_Materials.Add ("stone0", std::move (stone0));
+	m_Materials.Add ("tile0", std::move (tile0));
 }
 
 void StencilDemoApp::BuildDefaultSceneRenderItems () {
-	auto boxRitem = std::make_unique<RenderItem> ();
-	XMStoreFloat4x4 (&boxRitem->World, XMMatrixScaling (2.0f, 2.0f, 2.0f) * XMMatrixTranslation (0.0f, 1.0f, 0.0f));
-	XMStoreFloat4x4 (&boxRitem->TexTransform, XMMatrixScaling (1.0f, 1.0f, 1.0f));
-	boxRitem->ObjCBIndex = 0;
-	boxRitem->Mat = m_Materials["stone0"].get ();
-	boxRitem->Geo = m_Geometries["shape"].get ();
-	boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem->IndexCount = boxRitem->Geo->DrawArgs["box"].IndexCount;
-	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs["box"].StartIndexLocation;
-	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs["box"].BaseVertexLocation;
-	m_AllRitems.push_back (std::move (boxRitem));
-
-	auto gridRitem = std::make_unique<RenderItem> ();
-	gridRitem->World = MathHelper::Identity4x4 ();
-	XMStoreFloat4x4 (&gridRitem->TexTransform, XMMatrixScaling (8.0f, 8.0f, 1.0f));
-	gridRitem->ObjCBIndex = 1;
-	gridRitem->Mat = m_Materials["tile0"].get ();
-	gridRitem->Geo = m_Geometries["shape"].get ();
-	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
-	gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-	gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
-	m_AllRitems.push_back (std::move (gridRitem));
+	auto shapeGeo = m_Geometries.Get ("shape").get ();
+
+	XMFLOAT4X4 world;
+	XMFLOAT4X4 texTransform;
+
+	RitemHandle boxRitem = CreateRenderItem (shapeGeo, "box", m_Materials.Get ("stone0").get ());
+	XMStoreFloat4x4 (&world, XMMatrixScaling (2.0f, 2.0f, 2.0f) * XMMatrixTranslation (0.0f, 1.0f, 0.0f));
+	XMStoreFloat4x4 (&texTransform, XMMatrixScaling (1.0f, 1.0f, 1.0f));
+	m_Ritems.SetWorld (boxRitem, world);
+	m_Ritems.SetTexTransform (boxRitem, texTransform);
+
+	RitemHandle gridRitem = CreateRenderItem (shapeGeo, "grid", m_Materials.Get ("tile0").get ());
+	XMStoreFloat4x4 (&texTransform, XMMatrixScaling (8.0f, 8.0f, 1.0f));
+	m_Ritems.SetTexTransform (gridRitem, texTransform);
 
 	XMMATRIX brickTexTransform = XMMatrixScaling (1.0f, 1.0f, 1.0f);
-	UINT objCBIndex = 2;
+	XMStoreFloat4x4 (&texTransform, brickTexTransform);
 	for (int i = 0; i < 5; ++i) {
-		auto leftCylRitem = std::make_unique<RenderItem> ();
-		auto rightCylRitem = std::make_unique<RenderItem> ();
-		auto leftSphereRitem = std::make_unique<RenderItem> ();
-		auto rightSphereRitem = std::make_unique<RenderItem> ();
+		RitemHandle leftCylRitem = CreateRenderItem (shapeGeo, "cylinder", m_Materials.Get ("bricks0").get ());
+		RitemHandle rightCylRitem = CreateRenderItem (shapeGeo, "cylinder", m_Materials.Get ("bricks0").get ());
+		RitemHandle leftSphereRitem = CreateRenderItem (shapeGeo, "sphere", m_Materials.Get ("stone0").get ());
+		RitemHandle rightSphereRitem = CreateRenderItem (shapeGeo, "sphere", m_Materials.Get ("stone0").get ());
 
 		XMMATRIX leftCylWorld = XMMatrixTranslation (-5.0f, 1.5f, -10.0f + i * 5.0f);
 		XMMATRIX rightCylWorld = XMMatrixTranslation (+5.0f, 1.5f, -10.0f + i * 5.0f);
@@ -402,54 +671,23 @@ void StencilDemoApp::BuildDefaultSceneRenderItems () {
 		XMMATRIX leftSphereWorld = XMMatrixTranslation (-5.0f, 3.5f, -10.0f + i * 5.0f);
 		XMMATRIX rightSphereWorld = XMMatrixTranslation (+5.0f, 3.5f, -10.0f + i * 5.0f);
 
-		XMStoreFloat4x4 (&leftCylRitem->World, rightCylWorld);
-		XMStoreFloat4x4 (&leftCylRitem->TexTransform, brickTexTransform);
-		leftCylRitem->ObjCBIndex = objCBIndex++;
-		leftCylRitem->Mat = m_Materials["bricks0"].get ();
-		leftCylRitem->Geo = m_Geometries["shape"].get ();
-		leftCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
-		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
-		leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-
-		XMStoreFloat4x4 (&rightCylRitem->World, leftCylWorld);
-		XMStoreFloat4x4 (&rightCylRitem->TexTransform, brickTexTransform);
-		rightCylRitem->ObjCBIndex = objCBIndex++;
-		rightCylRitem->Mat = m_Materials["bricks0"].get ();
-		rightCylRitem->Geo = m_Geometries["shape"].get ();
-		rightCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
-		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
-		rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-
-		XMStoreFloat4x4 (&leftSphereRitem->World, leftSphereWorld);
-		leftSphereRitem->TexTransform = MathHelper::Identity4x4 ();
-		leftSphereRitem->ObjCBIndex = objCBIndex++;
-		leftSphereRitem->Mat = m_Materials["stone0"].get ();
-		leftSphereRitem->Geo = m_Geometries["shape"].get ();
-		leftSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
-		leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
-		leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
-
-		XMStoreFloat4x4 (&rightSphereRitem->World, rightSphereWorld);
-		rightSphereRitem->TexTransform = MathHelper::Identity4x4 ();
-		rightSphereRitem->ObjCBIndex = objCBIndex++;
-		rightSphereRitem->Mat = m_Materials["stone0"].get ();
-		rightSphereRitem->Geo = m_Geometries["shape"].get ();
-		rightSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
-		rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
-		rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
-
-		m_AllRitems.push_back (std::move (leftCylRitem));
-		m_AllRitems.push_back (std::move (rightCylRitem));
-		m_AllRitems.push_back (std::move (leftSphereRitem));
-		m_AllRitems.push_back (std::move (rightSphereRitem));
+		XMStoreFloat4x4 (&world, rightCylWorld);
+		m_Ritems.SetWorld (leftCylRitem, world);
+		m_Ritems.SetTexTransform (leftCylRitem, texTransform);
+
+		XMStoreFloat4x4 (&world, leftCylWorld);
+		m_Ritems.SetWorld (rightCylRitem, world);
+		m_Ritems.SetTexTransform (rightCylRitem, texTransform);
+
+		XMStoreFloat4x4 (&world, leftSphereWorld);
+		m_Ritems.SetWorld (leftSphereRitem, world);
+
+		XMStoreFloat4x4 (&world, rightSphereWorld);
+		m_Ritems.SetWorld (rightSphereRitem, world);
 	}
 
-	for (auto& e : m_AllRitems)
-		m_RitemLayer[(int)RenderLayer::Opaque].push_back (e.get ());
+	for (uint32_t i = 0; i < m_Ritems.Count (); i++)
+		m_Ritems.AddToLayer (m_Ritems.HandleAt (i), (uint32_t)RenderLayer::Opaque);
 }
 
 void StencilDemoApp::BuildDefaultSceneDescriptorHeaps () {
@@ -467,7 +705,7 @@ void StencilDemoApp::BuildDefaultSceneDescriptorHeaps () {
 	//
 	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor (m_SrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart ());
 
-	auto bricksTex = m_Textures["bricksTex"]->Resource;
+	auto bricksTex = m_Textures.Get ("bricksTex")->Resource;
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -481,14 +719,14 @@ void StencilDemoApp::BuildDefaultSceneDescriptorHeaps () {
 
 	hDescriptor.Offset (1, m_CbvSrvUavDescriptorSize);
 
-	auto stoneTex = m_Textures["stoneTex"]->Resource;
+	auto stoneTex = m_Textures.Get ("stoneTex")->Resource;
 	srvDesc.Format = stoneTex->GetDesc ().Format;
 	srvDesc.Texture2D.MipLevels = stoneTex->GetDesc ().MipLevels;
 	m_Device->CreateShaderResourceView (stoneTex.Get (), &srvDesc, hDescriptor);
 
 	hDescriptor.Offset (1, m_CbvSrvUavDescriptorSize);
 
-	auto tileTex = m_Textures["tileTex"]->Resource;
+	auto tileTex = m_Textures.Get ("tileTex")->Resource;
 	srvDesc.Format = tileTex->GetDesc ().Format;
 	srvDesc.Texture2D.MipLevels = tileTex->GetDesc ().MipLevels;
 	m_Device->CreateShaderResourceView (tileTex.Get (), &srvDesc, hDescriptor);
@@ -497,89 +735,75 @@ void StencilDemoApp::BuildDefaultSceneDescriptorHeaps () {
 #pragma endregion
 
 void StencilDemoApp::LoadTextures () {
+	// The room textures are streamed: only their small mips are loaded here and BuildTextureStreamer
+	// hands them to the streamer, which brings in finer mips as the camera gets close.
 	auto bricksTex = std::make_unique<Texture> ();
 	bricksTex->Name = "bricksTex";
 	bricksTex->Filename = L"../../../Textures/bricks3.dds";
 	ThrowIfFailed (DirectX::CreateDDSTextureFromFile12 (m_Device.Get (),
-		m_CmdList.Get (), bricksTex->Filename.c_str (),
-		bricksTex->Resource, bricksTex->UploadHeap));
+		m_CopyQueue->CommandList (), bricksTex->Filename.c_str (),
+		bricksTex->Resource, bricksTex->UploadHeap, g_StreamedBaseSize));
 
 	auto checkboradTex = std::make_unique<Texture> ();
 	checkboradTex->Name = "checkboardTex";
 	checkboradTex->Filename = L"../../../Textures/checkboard.dds";
 	ThrowIfFailed (DirectX::CreateDDSTextureFromFile12 (m_Device.Get (),
-		m_CmdList.Get (), checkboradTex->Filename.c_str (),
-		checkboradTex->Resource, checkboradTex->UploadHeap));
+		m_CopyQueue->CommandList (), checkboradTex->Filename.c_str (),
+		checkboradTex->Resource, checkboradTex->UploadHeap, g_StreamedBaseSize));
 
 	auto iceTex = std::make_unique<Texture> ();
 	iceTex->Name = "iceTex";
 	iceTex->Filename = L"../../../Textures/ice.dds";
 	ThrowIfFailed (DirectX::CreateDDSTextureFromFile12 (m_Device.Get (),
-		m_CmdList.Get (), iceTex->Filename.c_str (),
-		iceTex->Resource, iceTex->UploadHeap));
+		m_CopyQueue->CommandList (), iceTex->Filename.c_str (),
+		iceTex->Resource, iceTex->UploadHeap, g_StreamedBaseSize));
 
 	auto white1x1Tex = std::make_unique<Texture> ();
 	white1x1Tex->Name = "white1x1Tex";
 	white1x1Tex->Filename = L"../../../Textures/white1x1.dds";
 	ThrowIfFailed (DirectX::CreateDDSTextureFromFile12 (m_Device.Get (),
-		m_CmdList.Get (), white1x1Tex->Filename.c_str (),
+		m_CopyQueue->CommandList (), white1x1Tex->Filename.c_str (),
 		white1x1Tex->Resource, white1x1Tex->UploadHeap));
 
-	m_Textures[bricksTex->Name] = std::move (bricksTex);
-	m_Textures[checkboradTex->Name] = std::move (checkboradTex);
-	m_Textures[iceTex->Name] = std::move (iceTex);
-	m_Textures[white1x1Tex->Name] = std::move (white1x1Tex);
+	m_Textures.Add (bricksTex->Name, std::move (bricksTex));
+	m_Textures.Add (checkboradTex->Name, std::move (checkboradTex));
+	m_Textures.Add (iceTex->Name, std::move (iceTex));
+	m_Textures.Add (white1x1Tex->Name, std::move (white1x1Tex));
 
 	//
 	// Exercise 7
 	//
-	for (int i = 1; i <= 60; i++) {
-		Texture boltTex = {};
-		boltTex.Name = "boltTex" + (i < 10 ? "0" + std::to_string (i) : std::to_string(i));
-		boltTex.Filename = L"BoltAnim/Bolt" + (i < 10 ? L"00" + std::to_wstring (i) : L"0" + std::to_wstring (i)) + L".bmp";
-
-		TexMetadata metadata = {};
-		ScratchImage scratchImg = {};
-		LoadFromWICFile (boltTex.Filename.c_str (), WIC_FLAGS_NONE, &metadata, scratchImg);
-		auto img = scratchImg.GetImage (0, 0, 0);
-
-		D3D12_HEAP_PROPERTIES texHeapProp = {};
-		texHeapProp.Type = D3D12_HEAP_TYPE_CUSTOM;
-		texHeapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_BACK;
-		texHeapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
-		texHeapProp.CreationNodeMask = 0;
-		texHeapProp.VisibleNodeMask = 0;
-
-		D3D12_RESOURCE_DESC resDesc = {};
-		resDesc.Format = metadata.format;
-		resDesc.Width = metadata.width;
-		resDesc.Height = metadata.height;
-		resDesc.DepthOrArraySize = metadata.arraySize;
-		resDesc.SampleDesc.Count = 1;
-		resDesc.SampleDesc.Quality = 0;
-		resDesc.MipLevels = metadata.mipLevels;
-		resDesc.Dimension = static_cast<D3D12_RESOURCE_DIMENSION>(metadata.dimension);
-		resDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		resDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		ThrowIfFailed (m_Device->CreateCommittedResource (
-			&texHeapProp,
-			D3D12_HEAP_FLAG_NONE,
-			&resDesc,
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			nullptr,
-			IID_PPV_ARGS (&boltTex.Resource)
-		));
-
-		boltTex.Resource->WriteToSubresource (
-			0,
-			nullptr,
-			img->pixels,
-			img->rowPitch,
-			img->slicePitch
-		);
-
-		m_BoltTextures.push_back(boltTex);
+	// All 60 bolt frames are packed offline into one BC1 texture array (with mips) by
+	// Tools/TextureCooker; re-run it after changing the frames:
+	//   TextureCooker flipbook BoltAnim.dds BoltAnim/Bolt%03d.bmp --first 1 --count 60 --format bc1
+	auto boltAnimTex = std::make_unique<Texture> ();
+	boltAnimTex->Name = "boltAnimTex";
+	boltAnimTex->Filename = L"BoltAnim.dds";
+	ThrowIfFailed (DirectX::CreateDDSTextureFromFile12 (m_Device.Get (),
+		m_CopyQueue->CommandList (), boltAnimTex->Filename.c_str (),
+		boltAnimTex->Resource, boltAnimTex->UploadHeap));
+
+	m_BoltFrameCount = boltAnimTex->Resource->GetDesc ().DepthOrArraySize;
+	m_Textures.Add (boltAnimTex->Name, std::move (boltAnimTex));
+
+	// The copy queue keeps the upload heaps until the copies are done.
+	for (auto& tex : m_Textures) {
+		m_TextureTicket = m_CopyQueue->Enqueue (tex->UploadHeap);
+		m_PendingTextures.push_back ({tex.get (), m_TextureTicket});
+		tex->UploadHeap = nullptr;
+	}
+	m_CopyQueue->Submit ();
+}
+
+void StencilDemoApp::SubmitGeometry () {
+	m_GeometryUploader->Flush (m_CopyQueue->CommandList (), m_CopyQueue->NextFence ());
+
+	UploadScheduler::Ticket ticket = m_CopyQueue->Enqueue ();
+	m_CopyQueue->Submit ();
+
+	for (auto& geo : m_Geometries) {
+		if (m_GeometryTickets.find (geo->Name) == m_GeometryTickets.end ())
+			m_GeometryTickets[geo->Name] = ticket;
 	}
 }
 
@@ -662,21 +886,22 @@ void StencilDemoApp::BuildScene () {
 	ThrowIfFailed (D3DCreateBlob (ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory (geo->IndexBufferCPU->GetBufferPointer (), indices.data (), ibByteSize);
 
-	geo->VertexBufferGPU = D3DUtil::CreateDefaultBuffer (m_Device.Get (), m_CmdList.Get (),
-														 vertices.data (), vbByteSize, geo->VertexBufferUploader);
-	geo->IndexBufferGPU = D3DUtil::CreateDefaultBuffer (m_Device.Get (), m_CmdList.Get (),
-														 indices.data (), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof (Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
 
+	m_GeometryUploader->Add (geo.get ());
+
+	BoundingBox::CreateFromPoints (floorSubmesh.Bounds, 4, &vertices[0].Pos, sizeof (Vertex));
+	BoundingBox::CreateFromPoints (wallSubmesh.Bounds, 12, &vertices[4].Pos, sizeof (Vertex));
+	BoundingBox::CreateFromPoints (mirrorSubmesh.Bounds, 4, &vertices[16].Pos, sizeof (Vertex));
+
 	geo->DrawArgs["floor"] = floorSubmesh;
 	geo->DrawArgs["wall"] = wallSubmesh;
 	geo->DrawArgs["mirror"] = mirrorSubmesh;
 
-	m_Geometries[geo->Name] = std::move (geo);
+	m_Geometries.Add (geo->Name, std::move (geo));
 
 	//
 	// Exerise 7
@@ -714,25 +939,22 @@ void StencilDemoApp::BuildScene () {
 	ThrowIfFailed (D3DCreateBlob (cylinderIBSize, &cylinderGeo->IndexBufferCPU));
 	CopyMemory (cylinderGeo->IndexBufferCPU->GetBufferPointer (), cylinderIndices.data (), cylinderIBSize);
 
-	cylinderGeo->VertexBufferGPU = D3DUtil::CreateDefaultBuffer (m_Device.Get (),
-		m_CmdList.Get (), cylinderVertices.data (), cylinderVBSize, cylinderGeo->VertexBufferUploader);
-
-	cylinderGeo->IndexBufferGPU = D3DUtil::CreateDefaultBuffer (m_Device.Get (),
-		m_CmdList.Get (), cylinderIndices.data (), cylinderIBSize, cylinderGeo->IndexBufferUploader);
-
 	SubmeshGeometry cylinderSubmesh;
 	cylinderSubmesh.IndexCount = indexCount;
 	cylinderSubmesh.StartIndexLocation = 0;
 	cylinderSubmesh.BaseVertexLocation = 0;
+	BoundingBox::CreateFromPoints (cylinderSubmesh.Bounds, vertexCount, &cylinderVertices[0].Pos, sizeof (Vertex));
 
 	cylinderGeo->VertexByteStride = sizeof (Vertex);
 	cylinderGeo->VertexBufferByteSize = cylinderVBSize;
 	cylinderGeo->IndexFormat = DXGI_FORMAT_R16_UINT;
 	cylinderGeo->IndexBufferByteSize = cylinderIBSize;
 
+	m_GeometryUploader->Add (cylinderGeo.get ());
+
 	cylinderGeo->DrawArgs["cylinder"] = cylinderSubmesh;
 
-	m_Geometries[cylinderGeo->Name] = std::move (cylinderGeo);
+	m_Geometries.Add (cylinderGeo->Name, std::move (cylinderGeo));
 }
 
 void StencilDemoApp::BuildSkullGeometry () {
@@ -788,25 +1010,22 @@ void StencilDemoApp::BuildSkullGeometry () {
 	ThrowIfFailed (D3DCreateBlob (ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory (geo->IndexBufferCPU->GetBufferPointer (), indices.data (), ibByteSize);
 
-	geo->VertexBufferGPU = D3DUtil::CreateDefaultBuffer (m_Device.Get (),
-														 m_CmdList.Get (), vertices.data (), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = D3DUtil::CreateDefaultBuffer (m_Device.Get (),
-														m_CmdList.Get (), indices.data (), ibByteSize, geo->IndexBufferUploader);
-
 	geo->VertexByteStride = sizeof (Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
 
+	m_GeometryUploader->Add (geo.get ());
+
 	SubmeshGeometry submesh;
 	submesh.IndexCount = (UINT)indices.size ();
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
+	BoundingBox::CreateFromPoints (submesh.Bounds, vcount, &vertices[0].Pos, sizeof (Vertex));
 
 	geo->DrawArgs["skull"] = submesh;
 
-	m_Geometries[geo->Name] = std::move (geo);
+	m_Geometries.Add (geo->Name, std::move (geo));
 }
 
 void StencilDemoApp::BuildMaterials () {
@@ -850,11 +1069,11 @@ void StencilDemoApp::BuildMaterials () {
 	shadowMat->FresnelR0 = XMFLOAT3 (0.001f, 0.001f, 0.001f);
 	shadowMat->Roughness = 0.0f;
 
-	m_Materials["bricks"] = std::move (bricks);
-	m_Materials["checkertile"] = std::move (checkertile);
-	m_Materials["icemirror"] = std::move (icemirror);
-	m_Materials["skullMat"] = std::move (skullMat);
-	m_Materials["shadowMat"] = std::move (shadowMat);
+	m_Materials.Add ("bricks", std::move (bricks));
+	m_Materials.Add ("checkertile", std::move (checkertile));
+	m_Materials.Add ("icemirror", std::move (icemirror));
+	m_Materials.Add ("skullMat", std::move (skullMat));
+	m_Materials.Add ("shadowMat", std::move (shadowMat));
 
 	//
 	// Exercise 7
@@ -862,133 +1081,103 @@ void StencilDemoApp::BuildMaterials () {
 	auto boltMat = std::make_unique<Material> ();
 	boltMat->Name = "boltMat";
 	boltMat->MatCBIndex = 5;
-	boltMat->DiffuseSrvHeapIndex = 0;
+	boltMat->DiffuseSrvHeapIndex = 4;
+	boltMat->DiffuseArraySlice = 0;
 	boltMat->DiffuseAlbedo = XMFLOAT4 (1.0f, 1.0f, 1.0f, 1.0f);
 	boltMat->FresnelR0 = XMFLOAT3 (0.001f, 0.001f, 0.001f);
 	boltMat->Roughness = 0.99f;
-	m_Materials["boltMat"] = std::move (boltMat);
+	m_BoltMat = m_Materials.Add ("boltMat", std::move (boltMat));
 }
 
 void StencilDemoApp::BuildRenderItems () {
-	auto floorRitem = std::make_unique<RenderItem> ();
-	floorRitem->World = MathHelper::Identity4x4 ();
-	floorRitem->TexTransform = MathHelper::Identity4x4 ();
-	floorRitem->ObjCBIndex = 0;
-	floorRitem->Mat = m_Materials["checkertile"].get ();
-	floorRitem->Geo = m_Geometries["roomGeo"].get ();
-	floorRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	floorRitem->IndexCount = floorRitem->Geo->DrawArgs["floor"].IndexCount;
-	floorRitem->StartIndexLocation = floorRitem->Geo->DrawArgs["floor"].StartIndexLocation;
-	floorRitem->BaseVertexLocation = floorRitem->Geo->DrawArgs["floor"].BaseVertexLocation;
-	m_RitemLayer[(int)RenderLayer::Opaque].push_back (floorRitem.get ());
-
-	auto wallsRitem = std::make_unique<RenderItem> ();
-	wallsRitem->World = MathHelper::Identity4x4 ();
-	wallsRitem->TexTransform = MathHelper::Identity4x4 ();
-	wallsRitem->ObjCBIndex = 1;
-	wallsRitem->Mat = m_Materials["bricks"].get ();
-	wallsRitem->Geo = m_Geometries["roomGeo"].get ();
-	wallsRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	wallsRitem->IndexCount = wallsRitem->Geo->DrawArgs["wall"].IndexCount;
-	wallsRitem->StartIndexLocation = wallsRitem->Geo->DrawArgs["wall"].StartIndexLocation;
-	wallsRitem->BaseVertexLocation = wallsRitem->Geo->DrawArgs["wall"].BaseVertexLocation;
-	m_RitemLayer[(int)RenderLayer::Opaque].push_back (wallsRitem.get ());
-
-	auto skullRitem = std::make_unique<RenderItem> ();
-	skullRitem->World = MathHelper::Identity4x4 ();
-	skullRitem->TexTransform = MathHelper::Identity4x4 ();
-	skullRitem->ObjCBIndex = 2;
-	skullRitem->Mat = m_Materials["skullMat"].get ();
-	skullRitem->Geo = m_Geometries["skullGeo"].get ();
-	skullRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
-	skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
-	skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
-	m_SkullRitem = skullRitem.get ();
-	m_RitemLayer[(int)RenderLayer::Opaque].push_back (skullRitem.get ());
+	auto roomGeo = m_Geometries.Get ("roomGeo").get ();
+
+	RitemHandle floorRitem = CreateRenderItem (roomGeo, "floor", m_Materials.Get ("checkertile").get ());
+	m_Ritems.Get (floorRitem).TexRepeat = 4.0f;
+	m_Ritems.AddToLayer (floorRitem, (uint32_t)RenderLayer::Opaque);
+
+	RitemHandle wallsRitem = CreateRenderItem (roomGeo, "wall", m_Materials.Get ("bricks").get ());
+	m_Ritems.Get (wallsRitem).TexRepeat = 6.0f;
+	m_Ritems.AddToLayer (wallsRitem, (uint32_t)RenderLayer::Opaque);
+
+	m_SkullRitem = CreateRenderItem (m_Geometries.Get ("skullGeo").get (), "skull", m_Materials.Get ("skullMat").get ());
+	m_Ritems.AddToLayer (m_SkullRitem, (uint32_t)RenderLayer::Opaque);
 
 	// Reflected skull will have different world matrix, so it needs to be its own render item.
-	auto reflectedSkullRitem = std::make_unique<RenderItem> ();
-	*reflectedSkullRitem = *skullRitem;
-	reflectedSkullRitem->ObjCBIndex = 3;
-	m_ReflectedSkullRitem = reflectedSkullRitem.get ();
-	m_RitemLayer[(int)RenderLayer::Reflected].push_back (reflectedSkullRitem.get ());
+	m_ReflectedSkullRitem = m_Ritems.Clone (m_SkullRitem);
+	m_Ritems.AddToLayer (m_ReflectedSkullRitem, (uint32_t)RenderLayer::Reflected);
 
 	// Shadowed skull will have different world matrix, so it needs to be its own render item.
-	auto shadowedSkullRitem = std::make_unique<RenderItem> ();
-	*shadowedSkullRitem = *skullRitem;
-	shadowedSkullRitem->ObjCBIndex = 4;
-	shadowedSkullRitem->Mat = m_Materials["shadowMat"].get ();
-	m_ShadowedSkullRitem = shadowedSkullRitem.get ();
-	m_RitemLayer[(int)RenderLayer::Shadow].push_back (shadowedSkullRitem.get ());
-
-	auto mirrorRitem = std::make_unique<RenderItem> ();
-	mirrorRitem->World = MathHelper::Identity4x4 ();
-	mirrorRitem->TexTransform = MathHelper::Identity4x4 ();
-	mirrorRitem->ObjCBIndex = 5;
-	mirrorRitem->Mat = m_Materials["icemirror"].get ();
-	mirrorRitem->Geo = m_Geometries["roomGeo"].get ();
-	mirrorRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	mirrorRitem->IndexCount = mirrorRitem->Geo->DrawArgs["mirror"].IndexCount;
-	mirrorRitem->StartIndexLocation = mirrorRitem->Geo->DrawArgs["mirror"].StartIndexLocation;
-	mirrorRitem->BaseVertexLocation = mirrorRitem->Geo->DrawArgs["mirror"].BaseVertexLocation;
-	m_RitemLayer[(int)RenderLayer::Mirrors].push_back (mirrorRitem.get ());
-	m_RitemLayer[(int)RenderLayer::Transparent].push_back (mirrorRitem.get ());
-
-	m_AllRitems.push_back (std::move (floorRitem));
-	m_AllRitems.push_back (std::move (wallsRitem));
-	m_AllRitems.push_back (std::move (skullRitem));
-	m_AllRitems.push_back (std::move (reflectedSkullRitem));
-	m_AllRitems.push_back (std::move (shadowedSkullRitem));
-	m_AllRitems.push_back (std::move (mirrorRitem));
+	m_ShadowedSkullRitem = m_Ritems.Clone (m_SkullRitem);
+	m_Ritems.Get (m_ShadowedSkullRitem).Mat = m_Materials.Get ("shadowMat").get ();
+	m_Ritems.AddToLayer (m_ShadowedSkullRitem, (uint32_t)RenderLayer::Shadow);
+
+	RitemHandle mirrorRitem = CreateRenderItem (roomGeo, "mirror", m_Materials.Get ("icemirror").get ());
+	m_Ritems.AddToLayer (mirrorRitem, (uint32_t)RenderLayer::Mirrors);
+	m_Ritems.AddToLayer (mirrorRitem, (uint32_t)RenderLayer::Transparent);
 
 	//
 	// Exercise 7
 	//
-	auto cylinderRitem = std::make_unique<RenderItem> ();
-	//XMStoreFloat4x4(&cylinderRitem->World, XMMatrixTranslation (5.0f, 2.0f, -5.0f));
-	cylinderRitem->World = MathHelper::Identity4x4 ();
-	cylinderRitem->TexTransform = MathHelper::Identity4x4 ();
-	cylinderRitem->ObjCBIndex = 6;
-	cylinderRitem->Mat = m_Materials["boltMat"].get ();
-	cylinderRitem->Geo = m_Geometries["cylinderGeo"].get ();
-	cylinderRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	cylinderRitem->IndexCount = cylinderRitem->Geo->DrawArgs["cylinder"].IndexCount;
-	cylinderRitem->StartIndexLocation = cylinderRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
-	cylinderRitem->BaseVertexLocation = cylinderRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-	m_RitemLayer[(int)RenderLayer::AlphaTested].push_back (cylinderRitem.get ());
-	m_AllRitems.push_back (std::move (cylinderRitem));
+	RitemHandle cylinderRitem = CreateRenderItem (m_Geometries.Get ("cylinderGeo").get (), "cylinder", m_Materials[m_BoltMat].get ());
+	//XMStoreFloat4x4(&cylinderWorld, XMMatrixTranslation (5.0f, 2.0f, -5.0f));
+	m_Ritems.AddToLayer (cylinderRitem, (uint32_t)RenderLayer::AlphaTested);
 
 	//
 	// Exercise 11
 	//
-	auto reflectedFloorRitem = std::make_unique<RenderItem> ();
-	*reflectedFloorRitem = *m_AllRitems[0];
-	reflectedFloorRitem->ObjCBIndex = 7;
-	m_ReflectedFloorRitem = reflectedFloorRitem.get ();
-	m_RitemLayer[(int)RenderLayer::Reflected].push_back (reflectedFloorRitem.get ());
-	m_AllRitems.push_back (std::move (reflectedFloorRitem));
+	m_ReflectedFloorRitem = m_Ritems.Clone (floorRitem);
+	m_Ritems.AddToLayer (m_ReflectedFloorRitem, (uint32_t)RenderLayer::Reflected);
 
 	XMVECTOR mirrorPlane = XMVectorSet (0.0f, 0.0f, 1.0f, 0.0f); // xy plane
 	XMMATRIX R = XMMatrixReflect (mirrorPlane);
-	XMMATRIX floorWorld = XMLoadFloat4x4 (&m_ReflectedFloorRitem->World);
-	XMStoreFloat4x4 (&m_ReflectedFloorRitem->World, floorWorld * R);
-	m_ReflectedFloorRitem->NumFrameDirty = g_NumFrameResources;
+	XMMATRIX floorWorld = XMLoadFloat4x4 (&m_Ritems.World ()[m_Ritems.Index (m_ReflectedFloorRitem)]);
+	XMFLOAT4X4 reflectedFloorWorld;
+	XMStoreFloat4x4 (&reflectedFloorWorld, floorWorld * R);
+	m_Ritems.SetWorld (m_ReflectedFloorRitem, reflectedFloorWorld);
+
+	std::unordered_map<const MeshGeometry*, UINT> geometryIds;
+	RenderItem* ritems = m_Ritems.Items ();
+	for (uint32_t i = 0; i < m_Ritems.Count (); i++) {
+		RenderItem& ri = ritems[i];
+		ri.UploadTicket = MathHelper::Max (m_TextureTicket, m_GeometryTickets[ri.Geo->Name]);
+
+		auto id = geometryIds.insert ({ri.Geo, (UINT)geometryIds.size ()});
+		ri.GeometryId = id.first->second;
+	}
+}
+
+RitemHandle StencilDemoApp::CreateRenderItem (MeshGeometry* geo, const std::string& submesh, Material* mat) {
+	const SubmeshGeometry& args = geo->DrawArgs[submesh];
+
+	RenderItem ritem;
+	ritem.Mat = mat;
+	ritem.Geo = geo;
+	ritem.PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	ritem.IndexCount = args.IndexCount;
+	ritem.StartIndexLocation = args.StartIndexLocation;
+	ritem.BaseVertexLocation = args.BaseVertexLocation;
+
+	// Identity world and texture transforms.
+	RitemHandle handle = m_Ritems.Create (ritem);
+	m_Ritems.SetLocalBounds (handle, args.Bounds);
+	return handle;
 }
 
 void StencilDemoApp::BuildDescriptorHeaps () {
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 4;
+	// 5 textures plus a second descriptor for each of the 3 streamed ones (see BuildTextureStreamer).
+	srvHeapDesc.NumDescriptors = 8;
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed (m_Device->CreateDescriptorHeap (&srvHeapDesc, IID_PPV_ARGS (&m_SrvDescriptorHeap)));
 
 	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor (m_SrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart ());
 
-	auto bricksTex = m_Textures["bricksTex"]->Resource;
-	auto checkboardTex = m_Textures["checkboardTex"]->Resource;
-	auto iceTex = m_Textures["iceTex"]->Resource;
-	auto white1x1Tex = m_Textures["white1x1Tex"]->Resource;
+	auto bricksTex = m_Textures.Get ("bricksTex")->Resource;
+	auto checkboardTex = m_Textures.Get ("checkboardTex")->Resource;
+	auto iceTex = m_Textures.Get ("iceTex")->Resource;
+	auto white1x1Tex = m_Textures.Get ("white1x1Tex")->Resource;
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -1013,21 +1202,22 @@ void StencilDemoApp::BuildDescriptorHeaps () {
 	srvDesc.Format = white1x1Tex->GetDesc ().Format;
 	m_Device->CreateShaderResourceView (white1x1Tex.Get (), &srvDesc, hDescriptor);
 
+	hDescriptor.Offset (1, m_CbvSrvUavDescriptorSize);
+
 	//
 	// Exercise 7
 	//
-	srvHeapDesc.NumDescriptors = 60;
-	ThrowIfFailed (m_Device->CreateDescriptorHeap (&srvHeapDesc, IID_PPV_ARGS (&m_BoltSrvDescriptorHeap)));
-
-	hDescriptor = m_BoltSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart ();
-	for (int i = 0; i < 60; i++) {
-		auto boltTex = m_BoltTextures[i].Resource;
-
-		srvDesc.Format = boltTex->GetDesc ().Format;
-		m_Device->CreateShaderResourceView (boltTex.Get (), &srvDesc, hDescriptor);
-
-		hDescriptor.Offset (1, m_CbvSrvUavDescriptorSize);
-	}
+	auto boltAnimTex = m_Textures.Get ("boltAnimTex")->Resource;
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC arraySrvDesc = {};
+	arraySrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	arraySrvDesc.Format = boltAnimTex->GetDesc ().Format;
+	arraySrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	arraySrvDesc.Texture2DArray.MostDetailedMip = 0;
+	arraySrvDesc.Texture2DArray.MipLevels = -1;
+	arraySrvDesc.Texture2DArray.FirstArraySlice = 0;
+	arraySrvDesc.Texture2DArray.ArraySize = boltAnimTex->GetDesc ().DepthOrArraySize;
+	m_Device->CreateShaderResourceView (boltAnimTex.Get (), &arraySrvDesc, hDescriptor);
 }
 
 void StencilDemoApp::BuildRootSignature () {
@@ -1065,21 +1255,174 @@ void StencilDemoApp::BuildRootSignature () {
 	);
 }
 
-void StencilDemoApp::BuildShadersAndInputLayout () {
+void StencilDemoApp::BuildCommandSignature () {
+	static_assert (sizeof (D3D12_DRAW_INDEXED_ARGUMENTS) == IndirectArgumentBuilder::DrawArgumentsSize,
+				   "IndirectArgumentBuilder::Command does not match the draw arguments");
+
+	// Laid out as IndirectArgumentBuilder::Command: object CBV, material CBV, then the draw.
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[3] = {};
+	arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+	arguments[0].ConstantBufferView.RootParameterIndex = 1;
+	arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+	arguments[1].ConstantBufferView.RootParameterIndex = 3;
+	arguments[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+	signatureDesc.ByteStride = IndirectArgumentBuilder::CommandStride;
+	signatureDesc.NumArgumentDescs = _countof (arguments);
+	signatureDesc.pArgumentDescs = arguments;
+
+	// Signatures that change root arguments are tied to the root signature.
+	ThrowIfFailed (m_Device->CreateCommandSignature (&signatureDesc, m_RootSignature.Get (),
+													 IID_PPV_ARGS (m_CommandSignature.GetAddressOf ())));
+}
+
+void StencilDemoApp::BuildShadersAndPSOs () {
+	// Shaders compile in parallel and each PSO is created as soon as its two shaders are ready.
+	JobGraph& jobs = m_Jobs;
+	jobs.Clear ();
+	BuildShadersAndInputLayout (jobs);
+	BuildPSOs (jobs);
+	jobs.Run ();
+
+	char message[256];
+	double busySeconds = 0.0;
+	for (const JobGraph::Timing& timing : jobs.Timings ()) {
+		sprintf_s (message, "JobGraph: %-24s %7.2f ms (thread %u, %.2f - %.2f ms)\n", timing.Name.c_str (),
+				   (timing.End - timing.Start) * 1000.0, timing.Thread, timing.Start * 1000.0, timing.End * 1000.0);
+		OutputDebugStringA (message);
+		busySeconds += timing.End - timing.Start;
+	}
+
+	sprintf_s (message, "JobGraph: %u jobs on %u threads, %.2f ms wall, %.2f ms serial\n",
+			   (UINT)jobs.Timings ().size (), jobs.ThreadCount (), jobs.Seconds () * 1000.0, busySeconds * 1000.0);
+	OutputDebugStringA (message);
+	ShaderCache::LogStats ();
+
+	m_PipelineCache->Save ();
+	m_PipelineCache->LogStats ();
+}
+
+void StencilDemoApp::BuildLights () {
+	Light keyLight;
+	keyLight.Direction = {0.57735f, -0.57735f, 0.57735f};
+	keyLight.Strength = {0.6f, 0.6f, 0.6f};
+
+	Light fillLight;
+	fillLight.Direction = {-0.57735f, -0.57735f, 0.57735f};
+	fillLight.Strength = {0.3f, 0.3f, 0.3f};
+
+	Light backLight;
+	backLight.Direction = {0.0f, -0.707f, -0.707f};
+	backLight.Strength = {0.15f, 0.15f, 0.15f};
+
+	m_DirLights = {keyLight, fillLight, backLight};
+
+	// The startup PSOs are built for the light list the first frame draws with.
+	LightCounts lights;
+	lights.Directional = (UINT)m_DirLights.size ();
+	lights.Point = (UINT)m_PointLights.size ();
+	lights.Spot = (UINT)m_SpotLights.size ();
+	m_MainPassLights = ShaderPermutations::Tightest (lights);
+	m_ReflectedPassLights = m_MainPassLights;
+}
+
+// m_Shaders and m_PSOs get their entries here, before any job runs, so the jobs only write through
+// handles to values that already exist and never grow the registries.
+void StencilDemoApp::AddShaderJob (JobGraph& jobs, const std::string& name, const std::wstring& filename,
+								   const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target) {
+	ShaderHandle shader = m_Shaders.Add (name, nullptr);
+
+	// The macro arrays are locals of the caller, so the job keeps its own copy.
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const D3D_SHADER_MACRO* define = defines; define != nullptr && define->Name != nullptr; define++)
+		macros.push_back (*define);
+	macros.push_back ({NULL, NULL});
+
+	m_ShaderJobs[name] = jobs.Add (name, [this, shader, filename, macros, entrypoint, target] () {
+		m_Shaders[shader] = D3DUtil::CompileShader (filename, macros.data (), entrypoint, target);
+	});
+}
+
+// Pixel shaders are light count permutations; the job compiles the variant the first frame needs
+// and the others are compiled by GetPSO() when a pass asks for them.
+void StencilDemoApp::AddPixelShaderJob (JobGraph& jobs, const std::string& name, const std::wstring& filename,
+										const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target) {
+	m_PixelShaders[name] = std::make_unique<ShaderPermutations> (filename, defines, entrypoint, target);
+
+	ShaderPermutations* shaders = m_PixelShaders[name].get ();
+	LightCounts lights = m_MainPassLights;
+
+	m_ShaderJobs[name] = jobs.Add (name, [shaders, lights] () {
+		shaders->Get (lights);
+	});
+}
+
+void StencilDemoApp::AddPSOJob (JobGraph& jobs, const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+								const std::string& vs, const std::string& ps) {
+	LightCounts lights = m_MainPassLights;
+	PSOHandle pso = m_PSOs.Add (VariantName (name, lights), nullptr);
+
+	PSOSource source;
+	source.Desc = desc;
+	source.VS = m_Shaders.Find (vs);
+	source.PS = m_PixelShaders[ps].get ();
+	source.Variants.push_back ({lights, pso});
+	PSOSourceHandle handle = m_PSOSources.Add (name, std::move (source));
+
+	jobs.Add (name, [this, handle, lights, pso] () {
+		m_PSOs[pso] = CreatePSO (handle, lights);
+	}, {m_ShaderJobs[vs], m_ShaderJobs[ps]});
+}
+
+// Only reads the registries, so the PSO jobs can call it concurrently.
+ComPtr<ID3D12PipelineState> StencilDemoApp::CreatePSO (PSOSourceHandle handle, const LightCounts& lights) {
+	const PSOSource& source = m_PSOSources[handle];
+	ID3DBlob* vsShader = m_Shaders[source.VS].Get ();
+	ID3DBlob* psShader = source.PS->Get (lights);
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = source.Desc;
+	psoDesc.VS = {vsShader->GetBufferPointer (), vsShader->GetBufferSize ()};
+	psoDesc.PS = {psShader->GetBufferPointer (), psShader->GetBufferSize ()};
+
+	return m_PipelineCache->CreateGraphicsPipelineState (psoDesc);
+}
+
+ID3D12PipelineState* StencilDemoApp::GetPSO (PSOSourceHandle handle, const LightCounts& lights) {
+	PSOSource& source = m_PSOSources[handle];
+	for (const PSOSource::Variant& variant : source.Variants) {
+		if (variant.Lights == lights)
+			return m_PSOs[variant.PSO].Get ();
+	}
+
+	// First draw with this light list. The shader comes from the disk cache after the first run.
+	PSOHandle pso = m_PSOs.Add (VariantName (m_PSOSources.Name (handle), lights), CreatePSO (handle, lights));
+	source.Variants.push_back ({lights, pso});
+
+	char message[256];
+	sprintf_s (message, "ShaderPermutations: built %s, %u PSO variants\n", m_PSOs.Name (pso).c_str (), m_PSOs.Count ());
+	OutputDebugStringA (message);
+
+	return m_PSOs[pso].Get ();
+}
+
+void StencilDemoApp::BuildShadersAndInputLayout (JobGraph& jobs) {
 	const D3D_SHADER_MACRO defines[] = {
 		"FOG", "1",
 		NULL, NULL
 	};
 
+	// The bolt is the only alpha tested item, and it samples the flipbook array.
 	const D3D_SHADER_MACRO alphaTestDefines[] = {
 		"FOG", "1",
 		"ALPHA_TEST", "1",
+		"FLIPBOOK", "1",
 		NULL, NULL
 	};
 
-	m_Shaders["standardVS"] = D3DUtil::CompileShader (L"Shaders/Default.hlsl", nullptr, "VS", "vs_5_0");
-	m_Shaders["opaquePS"] = D3DUtil::CompileShader (L"Shaders/Default.hlsl", defines, "PS", "ps_5_0");
-	m_Shaders["alphaTestedPS"] = D3DUtil::CompileShader (L"Shaders/Default.hlsl", alphaTestDefines, "PS", "ps_5_0");
+	AddShaderJob (jobs, "standardVS", L"Shaders/Default.hlsl", nullptr, "VS", "vs_5_0");
+	AddPixelShaderJob (jobs, "opaquePS", L"Shaders/Default.hlsl", defines, "PS", "ps_5_0");
+	AddPixelShaderJob (jobs, "alphaTestedPS", L"Shaders/Default.hlsl", alphaTestDefines, "PS", "ps_5_0");
 
 	m_InputLayout = {
 		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
@@ -1088,7 +1431,7 @@ void StencilDemoApp::BuildShadersAndInputLayout () {
 	};
 }
 
-void StencilDemoApp::BuildPSOs () {
+void StencilDemoApp::BuildPSOs (JobGraph& jobs) {
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc;
 	ZeroMemory (&opaquePsoDesc, sizeof (D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 
@@ -1097,14 +1440,6 @@ void StencilDemoApp::BuildPSOs () {
 	//
 	opaquePsoDesc.InputLayout = {m_InputLayout.data (), (UINT)m_InputLayout.size ()};
 	opaquePsoDesc.pRootSignature = m_RootSignature.Get ();
-	opaquePsoDesc.VS = {
-		m_Shaders["standardVS"]->GetBufferPointer (),
-		m_Shaders["standardVS"]->GetBufferSize ()
-	};
-	opaquePsoDesc.PS = {
-		m_Shaders["opaquePS"]->GetBufferPointer (),
-		m_Shaders["opaquePS"]->GetBufferSize ()
-	};
 	opaquePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC (D3D12_DEFAULT);
 	opaquePsoDesc.BlendState = CD3DX12_BLEND_DESC (D3D12_DEFAULT);
 	opaquePsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC (D3D12_DEFAULT);
@@ -1115,14 +1450,14 @@ void StencilDemoApp::BuildPSOs () {
 	opaquePsoDesc.SampleDesc.Count = m_4xMsaaState ? 4 : 1;
 	opaquePsoDesc.SampleDesc.Quality = m_4xMsaaState ? (m_4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = m_DepthStencilFormat;
-	ThrowIfFailed (m_Device->CreateGraphicsPipelineState (&opaquePsoDesc, IID_PPV_ARGS (&m_PSOs["opaque"])));
+	AddPSOJob (jobs, "opaque", opaquePsoDesc, "standardVS", "opaquePS");
 
 	//
 	// PSO for opaque wireframe objects.
 	//
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaqueWireframePsoDesc = opaquePsoDesc;
 	opaqueWireframePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-	ThrowIfFailed (m_Device->CreateGraphicsPipelineState (&opaqueWireframePsoDesc, IID_PPV_ARGS (&m_PSOs["opaque_wireframe"])));
+	AddPSOJob (jobs, "opaque_wireframe", opaqueWireframePsoDesc, "standardVS", "opaquePS");
 
 	//
 	// PSO for transparent objects;
@@ -1142,7 +1477,7 @@ void StencilDemoApp::BuildPSOs () {
 	transparencyBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
 
 	transparentPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
-	ThrowIfFailed (m_Device->CreateGraphicsPipelineState (&transparentPsoDesc, IID_PPV_ARGS (&m_PSOs["transparent"])));
+	AddPSOJob (jobs, "transparent", transparentPsoDesc, "standardVS", "opaquePS");
 
 	//
 	// PSO for marking stencil mirrors.
@@ -1172,7 +1507,7 @@ void StencilDemoApp::BuildPSOs () {
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC markMirrorsPsoDesc = opaquePsoDesc;
 	markMirrorsPsoDesc.BlendState = mirrorBlendState;
 	markMirrorsPsoDesc.DepthStencilState = mirrorDSS;
-	ThrowIfFailed (m_Device->CreateGraphicsPipelineState (&markMirrorsPsoDesc, IID_PPV_ARGS (&m_PSOs["markStencilMirrors"])));
+	AddPSOJob (jobs, "markStencilMirrors", markMirrorsPsoDesc, "standardVS", "opaquePS");
 
 	//
 	// PSO for stencil reflections.
@@ -1210,17 +1545,13 @@ void StencilDemoApp::BuildPSOs () {
 
 	drawReflectionsPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
 	drawReflectionsPsoDesc.RasterizerState.FrontCounterClockwise = true;
-	ThrowIfFailed (m_Device->CreateGraphicsPipelineState (&drawReflectionsPsoDesc, IID_PPV_ARGS (&m_PSOs["drawStencilReflections"])));
+	AddPSOJob (jobs, "drawStencilReflections", drawReflectionsPsoDesc, "standardVS", "opaquePS");
 
 	//
 	// Exerise 7
 	// PSO for alphaTest objects
 	//
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC alphaTestDesc = opaquePsoDesc;
-	alphaTestDesc.PS = {
-		m_Shaders["alphaTestedPS"]->GetBufferPointer (),
-		m_Shaders["alphaTestedPS"]->GetBufferSize ()
-	};
 	alphaTestDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 	
 	D3D12_RENDER_TARGET_BLEND_DESC additiveBlendDesc;
@@ -1236,7 +1567,7 @@ void StencilDemoApp::BuildPSOs () {
 	additiveBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
 
 	alphaTestDesc.BlendState.RenderTarget[0] = additiveBlendDesc;
-	ThrowIfFailed (m_Device->CreateGraphicsPipelineState (&alphaTestDesc, IID_PPV_ARGS (&m_PSOs["alphaTest"])));
+	AddPSOJob (jobs, "alphaTest", alphaTestDesc, "standardVS", "alphaTestedPS");
 
 	//
 	// PSO for shadow objects
@@ -1268,7 +1599,7 @@ void StencilDemoApp::BuildPSOs () {
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowPsoDesc = transparentPsoDesc;
 	shadowPsoDesc.DepthStencilState = shadowDSS;
-	ThrowIfFailed (m_Device->CreateGraphicsPipelineState (&shadowPsoDesc, IID_PPV_ARGS (&m_PSOs["shadow"])));
+	AddPSOJob (jobs, "shadow", shadowPsoDesc, "standardVS", "opaquePS");
 
 	//
 	// Exercise 9
@@ -1289,12 +1620,79 @@ void StencilDemoApp::BuildPSOs () {
 
 	zTestPsoDesc.BlendState.RenderTarget[0] = zTestBlendDesc;
 	zTestPsoDesc.DepthStencilState.DepthEnable = false;
-	ThrowIfFailed (m_Device->CreateGraphicsPipelineState (&zTestPsoDesc, IID_PPV_ARGS (&m_PSOs["zTest"])));
+	AddPSOJob (jobs, "zTest", zTestPsoDesc, "standardVS", "opaquePS");
+
+	m_OpaquePSO = m_PSOSources.Find ("opaque");
+	m_WireframePSO = m_PSOSources.Find ("opaque_wireframe");
+	m_MarkMirrorsPSO = m_PSOSources.Find ("markStencilMirrors");
+	m_ReflectionsPSO = m_PSOSources.Find ("drawStencilReflections");
+	m_TransparentPSO = m_PSOSources.Find ("transparent");
+	m_ShadowPSO = m_PSOSources.Find ("shadow");
+	m_AlphaTestPSO = m_PSOSources.Find ("alphaTest");
+	m_ZTestPSO = m_PSOSources.Find ("zTest");
 }
 
 void StencilDemoApp::BuildFrameResources () {
+	// An item gets an indirect command in every pass it is drawn in; the mirror alone is in two.
+	UINT indirectCommandCount = 0;
+	for (uint32_t layer = 0; layer < (uint32_t)RenderLayer::Count; layer++)
+		m_Ritems.Layer (layer).ForEach ([&indirectCommandCount] (uint32_t) { indirectCommandCount++; });
+
 	for (int i = 0; i < g_NumFrameResources; i++)
-		m_FrameResources.push_back (std::make_unique<FrameResource> (m_Device.Get (), 2, (UINT)m_AllRitems.size (), (UINT)m_Materials.size ()));
+		m_FrameResources.push_back (std::make_unique<FrameResource> (m_Device.Get (), 2, m_Ritems.Count (), m_Materials.Count (),
+																	 indirectCommandCount));
+
+	// Every material starts out dirty in every frame resource, as the render items do.
+	m_MaterialsByCB.resize (m_Materials.Count ());
+	for (auto& mat : m_Materials)
+		m_MaterialsByCB[mat->MatCBIndex] = mat.get ();
+	m_DirtyMaterials.Resize ((uint32_t)m_MaterialsByCB.size ());
+}
+
+// Full size of a DDS file from its header, as the resource loaded with a maxsize only has the small mips.
+static void ReadDDSSize (const std::wstring& filename, UINT& width, UINT& height, UINT& mipCount) {
+	std::ifstream fin (filename, std::ios::binary);
+	std::uint32_t header[8] = {};
+	fin.read (reinterpret_cast<char*>(header), sizeof (header));
+
+	// Magic, dwSize, dwFlags, dwHeight, dwWidth, dwPitchOrLinearSize, dwDepth, dwMipMapCount
+	height = header[3];
+	width = header[4];
+	mipCount = header[7] == 0 ? 1 : header[7];
+}
+
+void StencilDemoApp::BuildTextureStreamer () {
+	m_TextureStreamer = std::make_unique<TextureStreamer> (g_DefaultTextureBudget);
+
+	const char* textureNames[] = {"bricksTex", "checkboardTex", "iceTex"};
+	const char* materialNames[] = {"bricks", "checkertile", "icemirror"};
+
+	for (UINT i = 0; i < _countof (textureNames); i++) {
+		StreamedTexture streamed;
+		streamed.Tex = m_Textures.Get (textureNames[i]).get ();
+		streamed.Mat = m_Materials.Get (materialNames[i]).get ();
+		streamed.SrvHeapIndex[0] = streamed.Mat->DiffuseSrvHeapIndex;
+		streamed.SrvHeapIndex[1] = 5 + i;
+		ReadDDSSize (streamed.Tex->Filename, streamed.Width, streamed.Height, streamed.MipCount);
+
+		// Cost of each mip, taken from its copyable footprint.
+		D3D12_RESOURCE_DESC desc = streamed.Tex->Resource->GetDesc ();
+		UINT baseMip = streamed.MipCount - desc.MipLevels;
+		desc.Width = streamed.Width;
+		desc.Height = streamed.Height;
+		desc.MipLevels = (UINT16)streamed.MipCount;
+
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts (streamed.MipCount);
+		std::vector<UINT> numRows (streamed.MipCount);
+		m_Device->GetCopyableFootprints (&desc, 0, streamed.MipCount, 0, layouts.data (), numRows.data (), nullptr, nullptr);
+
+		std::vector<std::uint64_t> mipBytes (streamed.MipCount);
+		for (UINT mip = 0; mip < streamed.MipCount; mip++)
+			mipBytes[mip] = (std::uint64_t)layouts[mip].Footprint.RowPitch * numRows[mip];
+
+		m_TextureStreamer->Register (textureNames[i], mipBytes, baseMip);
+		m_StreamedTextures.push_back (streamed);
+	}
 }
 
 void StencilDemoApp::OnKeyboardInput (const GameTimer& gt) {
@@ -1317,35 +1715,75 @@ void StencilDemoApp::OnKeyboardInput (const GameTimer& gt) {
 	if (GetAsyncKeyState ('S') & 0x8000)
 		m_SkullTranslation.y -= 1.0f * dt;
 
+	// '[' and ']' halve and double the texture budget.
+	bool budgetDown = (GetAsyncKeyState (VK_OEM_4) & 0x8000) != 0;
+	bool budgetUp = (GetAsyncKeyState (VK_OEM_6) & 0x8000) != 0;
+	if ((budgetDown || budgetUp) && !m_BudgetKeyDown) {
+		UINT64 budget = m_TextureStreamer->Budget ();
+		m_TextureStreamer->SetBudget (budgetDown ? MathHelper::Max (budget / 2, 16ull * 1024) : budget * 2);
+	}
+	m_BudgetKeyDown = budgetDown || budgetUp;
+
+	// 'L' switches a point light above the skull on and off, which switches the passes to another
+	// shader variant.
+	bool lightKey = (GetAsyncKeyState ('L') & 0x8000) != 0;
+	if (lightKey && !m_LightKeyDown) {
+		if (m_PointLights.empty ()) {
+			Light skullLight;
+			skullLight.Strength = {0.9f, 0.6f, 0.3f};
+			skullLight.FalloffStart = 1.0f;
+			skullLight.FalloffEnd = 6.0f;
+			m_PointLights.push_back (skullLight);
+		} else {
+			m_PointLights.clear ();
+		}
+	}
+	m_LightKeyDown = lightKey;
+
+	bool parallelKey = (GetAsyncKeyState ('P') & 0x8000) != 0;
+	if (parallelKey && !m_ParallelKeyDown) {
+		m_ParallelRecording = !m_ParallelRecording;
+	}
+	m_ParallelKeyDown = parallelKey;
+
+	bool indirectKey = (GetAsyncKeyState ('X') & 0x8000) != 0;
+	if (indirectKey && !m_IndirectKeyDown) {
+		m_IndirectDraws = !m_IndirectDraws;
+	}
+	m_IndirectKeyDown = indirectKey;
+
 	// Don't let user move below ground plane.
 	m_SkullTranslation.y = MathHelper::Max (m_SkullTranslation.y, 0.0f);
 
+	if (!m_PointLights.empty ())
+		m_PointLights[0].Position = {m_SkullTranslation.x, m_SkullTranslation.y + 1.5f, m_SkullTranslation.z};
+
 	// Update the new world matrix.
 	XMMATRIX skullRotate = XMMatrixRotationY (0.5f * MathHelper::PI);
 	XMMATRIX skullScale = XMMatrixScaling (0.45f, 0.45f, 0.45f);
 	XMMATRIX skullOffset = XMMatrixTranslation (m_SkullTranslation.x, m_SkullTranslation.y, m_SkullTranslation.z);
 	XMMATRIX skullWorld = skullRotate * skullScale * skullOffset;
-	XMStoreFloat4x4 (&m_SkullRitem->World, skullWorld);
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4 (&world, skullWorld);
+	m_Ritems.SetWorld (m_SkullRitem, world);
 
 	// Update reflection world matrix.
 	XMVECTOR mirrorPlane = XMVectorSet (0.0f, 0.0f, 1.0f, 0.0f); // xy plane
 	XMMATRIX R = XMMatrixReflect (mirrorPlane);
-	XMStoreFloat4x4 (&m_ReflectedSkullRitem->World, skullWorld * R);
+	XMStoreFloat4x4 (&world, skullWorld * R);
+	m_Ritems.SetWorld (m_ReflectedSkullRitem, world);
 
 	// Update shadow world matrix.
 	XMVECTOR shadowPlane = XMVectorSet (0.0f, 1.0f, 0.0f, 0.0f); // xz plane
-	XMVECTOR toMainLight = -XMLoadFloat3 (&m_MainPassCB.Lights[0].Direction);
+	XMVECTOR toMainLight = -XMLoadFloat3 (&m_DirLights[0].Direction);
 	XMMATRIX S = XMMatrixShadow (shadowPlane, toMainLight);
 	//
 	// Exercise 12
 	//
 	XMMATRIX shadowOffsetY = XMMatrixTranslation (0.0f, 0.001f, 0.0f);
-	//XMStoreFloat4x4 (&m_ShadowedSkullRitem->World, skullWorld * S);
-	XMStoreFloat4x4 (&m_ShadowedSkullRitem->World, skullWorld * S * shadowOffsetY);
-
-	m_SkullRitem->NumFrameDirty = g_NumFrameResources;
-	m_ReflectedSkullRitem->NumFrameDirty = g_NumFrameResources;
-	m_ShadowedSkullRitem->NumFrameDirty = g_NumFrameResources;
+	//XMStoreFloat4x4 (&world, skullWorld * S);
+	XMStoreFloat4x4 (&world, skullWorld * S * shadowOffsetY);
+	m_Ritems.SetWorld (m_ShadowedSkullRitem, world);
 }
 
 void StencilDemoApp::UpdateCamera (const GameTimer& gt) {
@@ -1375,11 +1813,17 @@ void StencilDemoApp::Update (const GameTimer& gt) {
 		CloseHandle (eventHandle);
 	}
 
+	// Poll the copy queue once; whatever has landed by now is drawn this frame.
+	m_CopyQueue->Update ();
+	m_GeometryUploader->Reclaim (m_CopyQueue->CompletedFence ());
+
+	UpdateTextureStreaming (gt);
 	AnimateMaterials (gt);
 	UpdateObjectCBs (gt);
 	UpdateMainPassCB (gt);
 	UpdateMaterialCBs (gt);
 	UpdateReflectedPassCB (gt);
+	CullRenderItems ();
 }
 
 void StencilDemoApp::AnimateMaterials (const GameTimer& gt) {
@@ -1389,29 +1833,209 @@ void StencilDemoApp::AnimateMaterials (const GameTimer& gt) {
 	elapsedTime += gt.DeltaTime ();
 	if (elapsedTime >= nextTexPerSecond) {
 		elapsedTime = 0.0f;
-		m_BoltIndex = (m_BoltIndex + 1) % 60;
+		m_BoltIndex = (m_BoltIndex + 1) % m_BoltFrameCount;
 	}
 
-	auto boltMat = m_Materials["boltMat"].get ();
-	boltMat->DiffuseSrvHeapIndex = m_BoltIndex;
-	boltMat->NumFrameDirty = g_NumFrameResources;
+	// Only the array slice changes, so the bolt keeps using the same descriptor.
+	auto boltMat = m_Materials[m_BoltMat].get ();
+	if (boltMat->DiffuseArraySlice != m_BoltIndex) {
+		boltMat->DiffuseArraySlice = m_BoltIndex;
+		MarkMaterialDirty (boltMat);
+	}
+}
+
+void StencilDemoApp::UpdateTextureStreaming (const GameTimer& gt) {
+	// Textures swapped out by earlier commands can go once the GPU has finished with them, which is
+	// also when the streamer may count the command as done.
+	UINT64 completedFence = m_Fence->GetCompletedValue ();
+	for (auto it = m_RetiredTextures.begin (); it != m_RetiredTextures.end ();) {
+		if (it->Fence <= completedFence) {
+			m_TextureStreamer->Complete (it->Streamed);
+			it->Resource = nullptr;
+			m_HeapAllocator->Free (it->Placement);
+			it = m_RetiredTextures.erase (it);
+		} else {
+			++it;
+		}
+	}
+
+	m_TextureStreamer->BeginFrame (++m_StreamFrame);
+
+	// Request the mip that puts about one texel on each pixel across the item's bounding sphere.
+	XMVECTOR eye = XMLoadFloat3 (&m_Eye);
+	const RenderItem* ritems = m_Ritems.Items ();
+	for (uint32_t r = 0; r < m_Ritems.Count (); r++) {
+		const RenderItem* ri = &ritems[r];
+
+		// Nothing is streamed for an item before its initial upload has landed.
+		if (!m_CopyQueue->IsComplete (ri->UploadTicket))
+			continue;
+
+		for (UINT i = 0; i < (UINT)m_StreamedTextures.size (); i++) {
+			const StreamedTexture& streamed = m_StreamedTextures[i];
+			if (ri->Mat != streamed.Mat)
+				continue;
+
+			BoundingBox bounds;
+			m_Ritems.LocalBounds ()[r].Transform (bounds, XMLoadFloat4x4 (&m_Ritems.World ()[r]));
+
+			float radius = XMVectorGetX (XMVector3Length (XMLoadFloat3 (&bounds.Extents)));
+			float distance = XMVectorGetX (XMVector3Length (XMLoadFloat3 (&bounds.Center) - eye));
+			float pixels = distance > radius ? radius * m_Proj (1, 1) * m_ClientHeight / distance : (float)m_ClientHeight;
+			float texels = ri->TexRepeat * MathHelper::Max (streamed.Width, streamed.Height);
+
+			m_TextureStreamer->RequestMip (i, TextureStreamer::MipForScreenSize (texels, pixels));
+		}
+	}
+
+	m_StreamCommands = m_TextureStreamer->Update (1);
+}
+
+void StencilDemoApp::ExecuteStreamCommands () {
+	for (const auto& command : m_StreamCommands) {
+		StreamedTexture& streamed = m_StreamedTextures[command.Texture];
+		Texture* tex = streamed.Tex;
+
+		RetiredTexture retired;
+		retired.Streamed = command.Texture;
+		retired.Fence = m_CurrentFence + 1;
+		retired.Resource = tex->Resource;
+		retired.Placement = streamed.Placement;
+		streamed.Placement = GpuHeapAllocator::Allocation ();
+
+		if (command.Type == TextureStreamer::CommandType::Load) {
+			// Reload the file keeping every mip from command.Mip down. The old resource is not reused:
+			// the new one has more mips, so it cannot be copied into.
+			UINT maxSize = MathHelper::Max (streamed.Width >> command.Mip, streamed.Height >> command.Mip);
+			ThrowIfFailed (DirectX::CreateDDSTextureFromFile12 (m_Device.Get (),
+				m_CmdList.Get (), tex->Filename.c_str (),
+				tex->Resource, tex->UploadHeap, maxSize));
+
+			retired.UploadHeap = tex->UploadHeap;
+			tex->UploadHeap = nullptr;
+		} else {
+			// Evictions only need the coarse mips that are already on the GPU.
+			UINT skipMip = command.Mip - m_TextureStreamer->ResidentMip (command.Texture);
+
+			D3D12_RESOURCE_DESC desc = retired.Resource->GetDesc ();
+			desc.Width = MathHelper::Max (desc.Width >> skipMip, 1ull);
+			desc.Height = MathHelper::Max (desc.Height >> skipMip, 1u);
+			desc.MipLevels -= skipMip;
+
+			tex->Resource = m_HeapAllocator->CreateResource (desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, streamed.Placement);
+
+			m_CmdList->ResourceBarrier (1, &CD3DX12_RESOURCE_BARRIER::Transition (retired.Resource.Get (),
+																				  D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+
+			for (UINT mip = 0; mip < desc.MipLevels; mip++) {
+				CD3DX12_TEXTURE_COPY_LOCATION dst (tex->Resource.Get (), mip);
+				CD3DX12_TEXTURE_COPY_LOCATION src (retired.Resource.Get (), mip + skipMip);
+				m_CmdList->CopyTextureRegion (&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			m_CmdList->ResourceBarrier (1, &CD3DX12_RESOURCE_BARRIER::Transition (tex->Resource.Get (),
+																				  D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+		}
+
+		// Point the material at the other descriptor. Frames in flight keep sampling the old one.
+		UINT slot = 1 - streamed.ActiveSlot;
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = tex->Resource->GetDesc ().Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = -1;
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor (m_SrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart ());
+		hDescriptor.Offset (streamed.SrvHeapIndex[slot], m_CbvSrvUavDescriptorSize);
+		m_Device->CreateShaderResourceView (tex->Resource.Get (), &srvDesc, hDescriptor);
+
+		streamed.Mat->DiffuseSrvHeapIndex = streamed.SrvHeapIndex[slot];
+		streamed.ActiveSlot = slot;
+
+		m_RetiredTextures.push_back (retired);
+
+		char message[256];
+		TextureStreamer::Stats stats = m_TextureStreamer->GetStats ();
+		TlsfAllocator::Stats heapStats = m_HeapAllocator->GetStats ();
+		sprintf_s (message, "TextureStreamer: %s %s mip %u (%llu / %llu KiB), heaps %u: %llu / %llu KiB, %u free blocks, fragmentation %.2f\n",
+				   command.Type == TextureStreamer::CommandType::Load ? "load" : "evict",
+				   m_TextureStreamer->Name (command.Texture).c_str (), command.Mip,
+				   stats.Committed / 1024, stats.Budget / 1024,
+				   m_HeapAllocator->HeapCount (), heapStats.UsedBytes / 1024, heapStats.Capacity / 1024,
+				   heapStats.FreeBlocks, heapStats.Fragmentation ());
+		OutputDebugStringA (message);
+	}
+
+	m_StreamCommands.clear ();
+}
+
+void StencilDemoApp::TransitionUploadedTextures () {
+	for (auto it = m_PendingTextures.begin (); it != m_PendingTextures.end ();) {
+		if (m_CopyQueue->IsComplete (it->Ticket)) {
+			m_CmdList->ResourceBarrier (1, &CD3DX12_RESOURCE_BARRIER::Transition (it->Tex->Resource.Get (),
+																				  D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+			it = m_PendingTextures.erase (it);
+		} else {
+			++it;
+		}
+	}
 }
 
 void StencilDemoApp::UpdateObjectCBs (const GameTimer& gt) {
+	static_assert (sizeof (ObjectConstants) == ObjectConstantBuilder::ConstantsSize &&
+				   offsetof (ObjectConstants, TexTransform) == sizeof (XMFLOAT4X4),
+				   "ObjectConstantBuilder writes the world transform, then the texture transform");
+
 	auto currObjectCB = m_CurrFrameResource->ObjectCB.get ();
-	for (auto& e : m_AllRitems) {
-		if (e->NumFrameDirty > 0) {
-			XMMATRIX world = XMLoadFloat4x4 (&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4 (&e->TexTransform);
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4 (&objConstants.World, XMMatrixTranspose (world));
-			XMStoreFloat4x4 (&objConstants.TexTransform, XMMatrixTranspose (texTransform));
+	// Static items are skipped a word of 64 at a time.
+	m_DirtyObjects.clear ();
+	m_Ritems.UpdateDirty (m_CurrFrameResourceIndex, [this] (uint32_t i) {
+		m_DirtyObjects.push_back (i);
+	});
 
-			currObjectCB->CopyData (e->ObjCBIndex, objConstants);
+	// Only the transform and bounds arrays are read; the draw data stays out of the cache.
+	const uint32_t* dirty = m_DirtyObjects.data ();
+	const XMFLOAT4X4* worlds = m_Ritems.World ();
+	const XMFLOAT4X4* texTransforms = m_Ritems.TexTransform ();
+	const BoundingBox* localBounds = m_Ritems.LocalBounds ();
+	BoundingBox* worldBounds = m_Ritems.WorldBounds ();
 
-			e->NumFrameDirty--;
+	BYTE* mapped = currObjectCB->MappedElement (0);
+	UINT stride = currObjectCB->ElementByteSize ();
+
+	// Blocks write disjoint constants and bounds, so they can go to any thread.
+	auto buildBlock = [&] (UINT first, UINT count) {
+		ObjectConstantBuilder::Build (dirty + first, count, worlds, texTransforms, mapped, stride);
+
+		for (UINT i = first; i < first + count; i++)
+			FrustumCuller::TransformBounds (localBounds[dirty[i]], XMLoadFloat4x4 (&worlds[dirty[i]]), worldBounds[dirty[i]]);
+	};
+
+	UINT dirtyCount = (UINT)m_DirtyObjects.size ();
+	if (dirtyCount < g_MinParallelConstants) {
+		buildBlock (0, dirtyCount);
+	} else {
+		m_Jobs.Clear ();
+		for (UINT first = 0; first < dirtyCount; first += ObjectConstantBuilder::BlockSize) {
+			UINT count = dirtyCount - first;
+			if (count > ObjectConstantBuilder::BlockSize)
+				count = ObjectConstantBuilder::BlockSize;
+			m_Jobs.Add ("object constants", [&buildBlock, first, count] () {
+				buildBlock (first, count);
+			});
 		}
+		m_Jobs.Run ();
+	}
+
+	// The upload bookkeeping is not thread-safe, so it is done here, once per run of neighbours.
+	for (UINT i = 0; i < dirtyCount;) {
+		UINT first = i++;
+		while (i < dirtyCount && dirty[i] == dirty[i - 1] + 1)
+			i++;
+		currObjectCB->MarkElementsWritten (dirty[first], i - first);
 	}
 }
 
@@ -1438,35 +2062,40 @@ void StencilDemoApp::UpdateMainPassCB (const GameTimer& gt) {
 	m_MainPassCB.TotalTime = gt.TotalTime ();
 	m_MainPassCB.DeltaTime = gt.DeltaTime ();
 	m_MainPassCB.AmbientLight = {0.25f, 0.25f, 0.35f, 1.0f};
-	m_MainPassCB.Lights[0].Direction = {0.57735f, -0.57735f, 0.57735f};
-	m_MainPassCB.Lights[0].Strength = {0.6f, 0.6f, 0.6f};
-	m_MainPassCB.Lights[1].Direction = {-0.57735f, -0.57735f, 0.57735f};
-	m_MainPassCB.Lights[1].Strength = {0.3f, 0.3f, 0.3f};
-	m_MainPassCB.Lights[2].Direction = {0.0f, -0.707f, -0.707f};
-	m_MainPassCB.Lights[2].Strength = {0.15f, 0.15f, 0.15f};
 
+	// Pick the tightest shader variant for this frame's lights and lay them out the way it reads them.
+	LightCounts lights;
+	lights.Directional = (UINT)m_DirLights.size ();
+	lights.Point = (UINT)m_PointLights.size ();
+	lights.Spot = (UINT)m_SpotLights.size ();
+	m_MainPassLights = ShaderPermutations::Tightest (lights);
+	UINT lightSlots = ShaderPermutations::PackLights (m_MainPassLights, m_DirLights, m_PointLights, m_SpotLights,
+													  m_MainPassCB.Lights);
+
+	// Lights are last in the constants, and the slots past the variant's are never read.
 	auto currPassCB = m_CurrFrameResource->PassCB.get ();
-	currPassCB->CopyData (0, m_MainPassCB);
+	currPassCB->CopyPrefix (0, m_MainPassCB, (UINT)(offsetof (PassConstants, Lights) + lightSlots * sizeof (Light)));
 }
 
 void StencilDemoApp::UpdateMaterialCBs (const GameTimer& gt) {
 	auto currMaterialCB = m_CurrFrameResource->MaterialCB.get ();
-	for (auto& e : m_Materials) {
-		Material* mat = e.second.get ();
-		if (mat->NumFrameDirty > 0) {
-			XMMATRIX matTransform = XMLoadFloat4x4 (&mat->MatTransform);
-
-			MaterialConstants matConstnats;
-			matConstnats.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstnats.FresnelR0 = mat->FresnelR0;
-			matConstnats.Roughness = mat->Roughness;
-			XMStoreFloat4x4 (&matConstnats.MatTransform, XMMatrixTranspose (matTransform));
-
-			currMaterialCB->CopyData (mat->MatCBIndex, matConstnats);
+	m_DirtyMaterials.ForEachDirty (m_CurrFrameResourceIndex, [&] (uint32_t index) {
+		const Material* mat = m_MaterialsByCB[index];
+		XMMATRIX matTransform = XMLoadFloat4x4 (&mat->MatTransform);
+
+		MaterialConstants matConstnats;
+		matConstnats.DiffuseAlbedo = mat->DiffuseAlbedo;
+		matConstnats.FresnelR0 = mat->FresnelR0;
+		matConstnats.Roughness = mat->Roughness;
+		XMStoreFloat4x4 (&matConstnats.MatTransform, XMMatrixTranspose (matTransform));
+		matConstnats.DiffuseArraySlice = mat->DiffuseArraySlice;
+
+		currMaterialCB->CopyData (mat->MatCBIndex, matConstnats);
+	});
+}
 
-			mat->NumFrameDirty--;
-		}
-	}
+void StencilDemoApp::MarkMaterialDirty (const Material* mat) {
+	m_DirtyMaterials.Mark (mat->MatCBIndex);
 }
 
 void StencilDemoApp::UpdateReflectedPassCB (const GameTimer& gt) {
@@ -1475,16 +2104,66 @@ void StencilDemoApp::UpdateReflectedPassCB (const GameTimer& gt) {
 	XMVECTOR mirrorPlane = XMVectorSet (0.0f, 0.0f, 1.0f, 0.0f); // xy plane
 	XMMATRIX R = XMMatrixReflect (mirrorPlane);
 
-	// Reflect the lighting.
-	for (int i = 0; i < 3; ++i) {
+	// Reflect the lighting. The reflected lights are the same list, so they share the main pass variant.
+	m_ReflectedPassLights = m_MainPassLights;
+	UINT lightSlots = m_ReflectedPassLights.Total ();
+	for (UINT i = 0; i < lightSlots; ++i) {
 		XMVECTOR lightDir = XMLoadFloat3 (&m_MainPassCB.Lights[i].Direction);
 		XMVECTOR reflectedLightDir = XMVector3TransformNormal (lightDir, R);
 		XMStoreFloat3 (&m_ReflectedPassCB.Lights[i].Direction, reflectedLightDir);
+
+		XMVECTOR lightPos = XMLoadFloat3 (&m_MainPassCB.Lights[i].Position);
+		XMVECTOR reflectedLightPos = XMVector3TransformCoord (lightPos, R);
+		XMStoreFloat3 (&m_ReflectedPassCB.Lights[i].Position, reflectedLightPos);
 	}
 
 	// Reflected pass stored in index 1
 	auto currPassCB = m_CurrFrameResource->PassCB.get ();
-	currPassCB->CopyData (1, m_ReflectedPassCB);
+	currPassCB->CopyPrefix (1, m_ReflectedPassCB, (UINT)(offsetof (PassConstants, Lights) + lightSlots * sizeof (Light)));
+}
+
+void StencilDemoApp::CullRenderItems () {
+	XMMATRIX view = XMLoadFloat4x4 (&m_View);
+	m_FrustumCuller.SetCamera (view, XMLoadFloat4x4 (&m_Proj));
+
+	m_VisibleRitemCount = 0;
+	m_LayerRitemCount = 0;
+	const RenderItem* allRitems = m_Ritems.Items ();
+	const BoundingBox* worldBounds = m_Ritems.WorldBounds ();
+	for (int layer = 0; layer < (int)RenderLayer::Count; layer++) {
+		// The culler reads the boxes packed, four at a time.
+		m_LayerRitems.clear ();
+		m_CullBounds.clear ();
+		m_Ritems.Layer (layer).ForEach ([&] (uint32_t index) {
+			m_LayerRitems.push_back (index);
+			m_CullBounds.push_back (worldBounds[index]);
+		});
+
+		m_CullIndices.clear ();
+		m_FrustumCuller.Cull (m_CullBounds.data (), (uint32_t)m_CullBounds.size (), m_CullIndices);
+
+		// Each layer draws with one PSO, so within a layer the order comes down to texture, geometry
+		// and depth. The mirror is blended and goes back to front.
+		m_DrawSorter.Clear ();
+		for (uint32_t index : m_CullIndices) {
+			const RenderItem* ri = &allRitems[m_LayerRitems[index]];
+			float viewZ = XMVectorGetZ (XMVector3TransformCoord (XMLoadFloat3 (&m_CullBounds[index].Center), view));
+			float depth = DrawSorter::NormalizedDepth (viewZ, m_MainPassCB.NearZ, m_MainPassCB.FarZ);
+
+			if (layer == (int)RenderLayer::Transparent)
+				m_DrawSorter.Add (DrawSorter::BlendedKey (layer, layer, ri->Mat->DiffuseSrvHeapIndex, ri->GeometryId, depth), index);
+			else
+				m_DrawSorter.Add (DrawSorter::OpaqueKey (layer, layer, ri->Mat->DiffuseSrvHeapIndex, ri->GeometryId, depth), index);
+		}
+		m_DrawSorter.Sort ();
+
+		m_VisibleRitems[layer].clear ();
+		for (const DrawSorter::Entry& entry : m_DrawSorter.Entries ())
+			m_VisibleRitems[layer].push_back (m_LayerRitems[entry.Item]);
+
+		m_VisibleRitemCount += (UINT)m_CullIndices.size ();
+		m_LayerRitemCount += (UINT)m_LayerRitems.size ();
+	}
 }
 
 void StencilDemoApp::Draw (const GameTimer& gt) {
@@ -1492,14 +2171,26 @@ void StencilDemoApp::Draw (const GameTimer& gt) {
 
 	ThrowIfFailed (cmdListAlloc->Reset ());
 
-	if (m_IsWireFrame) {
-		m_CmdList->Reset (cmdListAlloc.Get (), m_PSOs["opaque_wireframe"].Get ());
+	// GetPSO may still have to create a variant, so the passes are resolved here, on this thread.
+	BuildLayerPasses ();
+
+	// Serial recording takes the passes whole.
+	if (m_ParallelRecording) {
+		PartitionPasses (m_Jobs.ThreadCount (), g_MinChunkDraws);
 	} else {
-		m_CmdList->Reset (cmdListAlloc.Get (), m_PSOs["opaque"].Get ());
+		PartitionPasses (1, UINT_MAX);
 	}
 
-	m_CmdList->RSSetViewports (1, &m_Viewport);
-	m_CmdList->RSSetScissorRects (1, &m_ScissorRect);
+	if (m_IndirectDraws) {
+		BuildIndirectArguments ();
+	}
+
+	// The opaque pass comes first; the list starts out with its PSO.
+	m_CmdList->Reset (cmdListAlloc.Get (), m_LayerPasses.front ().PSO);
+
+	// Texture uploads and copies go first so they are done before anything samples them.
+	TransitionUploadedTextures ();
+	ExecuteStreamCommands ();
 
 	m_CmdList->ResourceBarrier (1, &CD3DX12_RESOURCE_BARRIER::Transition (CurrentBackBuffer (),
 																		  D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
@@ -1507,49 +2198,124 @@ void StencilDemoApp::Draw (const GameTimer& gt) {
 	m_CmdList->ClearRenderTargetView (CurrentBackBufferView (), (float*)&m_MainPassCB.FogColor, 0, nullptr);
 	m_CmdList->ClearDepthStencilView (DepthStencilView (), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-	m_CmdList->OMSetRenderTargets (1, &CurrentBackBufferView (), true, &DepthStencilView ());
+	if (m_ParallelRecording) {
+		RecordPassesParallel (m_Jobs);
+	} else {
+		RecordPassesSerial ();
+	}
+
+	ThrowIfFailed (m_SwapChain->Present (0, 0));
+	m_CurrentBackBuffer = (m_CurrentBackBuffer + 1) % m_SwapChainBufferCount;
 
-	m_CmdList->SetGraphicsRootSignature (m_RootSignature.Get ());
+	m_CurrFrameResource->Fence = ++m_CurrentFence;
+
+	m_CmdQueue->Signal (m_Fence.Get (), m_CurrentFence);
+}
 
+void StencilDemoApp::BuildLayerPasses () {
 	UINT passCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (PassConstants));
-	auto passCB = m_CurrFrameResource->PassCB->Resource ();
-	m_CmdList->SetGraphicsRootConstantBufferView (2, passCB->GetGPUVirtualAddress ());
+	D3D12_GPU_VIRTUAL_ADDRESS mainPassCB = m_CurrFrameResource->PassCB->Resource ()->GetGPUVirtualAddress ();
+
+	m_LayerPasses.clear ();
 
 	//
 	// Exercise 9
 	//
-	//m_CmdList->SetPipelineState (m_PSOs["zTest"].Get ());
+	//m_LayerPasses.push_back ({RenderLayer::Opaque, GetPSO (m_ZTestPSO, m_MainPassLights), 0, mainPassCB});
 
-	DrawRenderItems (m_CmdList.Get (), m_RitemLayer[(int)RenderLayer::Opaque]);
+	m_LayerPasses.push_back ({RenderLayer::Opaque, GetPSO (m_IsWireFrame ? m_WireframePSO : m_OpaquePSO, m_MainPassLights),
+							 0, mainPassCB});
 
 	//
 	// Exercise 7
 	//
 	// Draw alphaTest
-	//m_CmdList->SetPipelineState (m_PSOs["alphaTest"].Get ());
-	//DrawRenderItems (m_CmdList.Get (), m_RitemLayer[(int)RenderLayer::AlphaTested]);
+	//m_LayerPasses.push_back ({RenderLayer::AlphaTested, GetPSO (m_AlphaTestPSO, m_MainPassLights), 0, mainPassCB});
 
 	// Mark the visible mirror pixels in the stencil buffer with the value 1
-	m_CmdList->OMSetStencilRef (1);
-	m_CmdList->SetPipelineState (m_PSOs["markStencilMirrors"].Get ());
-	DrawRenderItems (m_CmdList.Get (), m_RitemLayer[(int)RenderLayer::Mirrors]);
+	m_LayerPasses.push_back ({RenderLayer::Mirrors, GetPSO (m_MarkMirrorsPSO, m_MainPassLights), 1, mainPassCB});
 
 	// Draw the reflection into the mirror only (only for pixels where the stencil buffer is 1)
 	// Note that we must supply a different per-pass constant buffer--one with the lights reflected.
-	m_CmdList->SetGraphicsRootConstantBufferView (2, passCB->GetGPUVirtualAddress () + 1 * passCBByteSize);
-	m_CmdList->SetPipelineState (m_PSOs["drawStencilReflections"].Get ());
-	DrawRenderItems (m_CmdList.Get (), m_RitemLayer[(int)RenderLayer::Reflected]);
-
-	m_CmdList->SetGraphicsRootConstantBufferView (2, passCB->GetGPUVirtualAddress ());
-	m_CmdList->OMSetStencilRef (0);
+	m_LayerPasses.push_back ({RenderLayer::Reflected, GetPSO (m_ReflectionsPSO, m_ReflectedPassLights),
+							 1, mainPassCB + 1 * passCBByteSize});
 
 	//// Draw mirror with transparency so reflection blends through.
-	m_CmdList->SetPipelineState (m_PSOs["transparent"].Get ());
-	DrawRenderItems (m_CmdList.Get (), m_RitemLayer[(int)RenderLayer::Transparent]);
+	m_LayerPasses.push_back ({RenderLayer::Transparent, GetPSO (m_TransparentPSO, m_MainPassLights), 0, mainPassCB});
 
 	// Draw shadows
-	m_CmdList->SetPipelineState (m_PSOs["shadow"].Get ());
-	DrawRenderItems (m_CmdList.Get (), m_RitemLayer[(int)RenderLayer::Shadow]);
+	m_LayerPasses.push_back ({RenderLayer::Shadow, GetPSO (m_ShadowPSO, m_MainPassLights), 0, mainPassCB});
+}
+
+void StencilDemoApp::PartitionPasses (uint32_t workerCount, uint32_t minChunkDraws) {
+	uint32_t drawCounts[(int)RenderLayer::Count];
+	for (size_t i = 0; i < m_LayerPasses.size (); i++) {
+		drawCounts[i] = (uint32_t)m_VisibleRitems[(int)m_LayerPasses[i].Layer].size ();
+	}
+
+	RecordPartitioner::Partition (drawCounts, (uint32_t)m_LayerPasses.size (), workerCount, minChunkDraws, m_RecordChunks);
+}
+
+void StencilDemoApp::BuildIndirectArguments () {
+	UINT objCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (ObjectConstants));
+	UINT matCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (MaterialConstants));
+
+	D3D12_GPU_VIRTUAL_ADDRESS objectCB = m_CurrFrameResource->ObjectCB->Resource ()->GetGPUVirtualAddress ();
+	D3D12_GPU_VIRTUAL_ADDRESS matCB = m_CurrFrameResource->MaterialCB->Resource ()->GetGPUVirtualAddress ();
+
+	m_IndirectBuilder.Clear ();
+	m_ChunkRuns.resize (m_RecordChunks.size ());
+
+	for (size_t c = 0; c < m_RecordChunks.size (); c++) {
+		const RecordPartitioner::Chunk& chunk = m_RecordChunks[c];
+		const auto& ritems = m_VisibleRitems[(int)m_LayerPasses[chunk.Pass].Layer];
+
+		// Each chunk is recorded on its own, so it gets runs of its own.
+		m_IndirectBuilder.Split ();
+		m_ChunkRuns[c].First = (UINT)m_IndirectBuilder.Runs ().size ();
+
+		for (uint32_t i = chunk.First; i < chunk.First + chunk.Count; i++) {
+			uint32_t index = ritems[i];
+			auto ri = &m_Ritems.Items ()[index];
+
+			// Still on its way through the copy queue.
+			if (!m_CopyQueue->IsComplete (ri->UploadTicket))
+				continue;
+
+			IndirectArgumentBuilder::Command command = {};
+			command.ObjectCB = objectCB + index * objCBByteSize;
+			command.MaterialCB = matCB + ri->Mat->MatCBIndex * matCBByteSize;
+			command.IndexCountPerInstance = ri->IndexCount;
+			command.InstanceCount = 1;
+			command.StartIndexLocation = ri->StartIndexLocation;
+			command.BaseVertexLocation = ri->BaseVertexLocation;
+
+			// What the command signature cannot change: geometry, topology and texture.
+			uint64_t stateKey = ((uint64_t)ri->GeometryId << 48) | ((uint64_t)ri->PrimitiveType << 32) |
+				(uint32_t)ri->Mat->DiffuseSrvHeapIndex;
+			m_IndirectBuilder.Add (stateKey, i, command);
+		}
+
+		m_ChunkRuns[c].Count = (UINT)m_IndirectBuilder.Runs ().size () - m_ChunkRuns[c].First;
+	}
+
+	// Layers can gain items after the frame resources were built, so the buffer grows to fit.
+	const auto& commands = m_IndirectBuilder.Commands ();
+	if (!commands.empty ()) {
+		auto indirectArgs = m_CurrFrameResource->IndirectArgsFor (m_Device.Get (), (UINT)commands.size ());
+		indirectArgs->CopyRange (0, commands.data (), (UINT)commands.size ());
+	}
+}
+
+void StencilDemoApp::RecordPassesSerial () {
+	// All bound state goes through the filter, which starts out knowing only the PSO.
+	m_StateFilter.Reset (m_CmdList.Get (), m_LayerPasses.front ().PSO);
+	m_StateFilter.ResetStats ();
+	SetFrameState (m_StateFilter);
+
+	for (size_t i = 0; i < m_RecordChunks.size (); i++) {
+		RecordChunk (m_StateFilter, i);
+	}
 
 	m_CmdList->ResourceBarrier (1, &CD3DX12_RESOURCE_BARRIER::Transition (CurrentBackBuffer (),
 																		  D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
@@ -1559,51 +2325,161 @@ void StencilDemoApp::Draw (const GameTimer& gt) {
 	ID3D12CommandList* cmdsLists[] = {m_CmdList.Get ()};
 	m_CmdQueue->ExecuteCommandLists (_countof (cmdsLists), cmdsLists);
 
-	ThrowIfFailed (m_SwapChain->Present (0, 0));
-	m_CurrentBackBuffer = (m_CurrentBackBuffer + 1) % m_SwapChainBufferCount;
+	m_StateCallsIssued = m_StateFilter.GetStats ().Issued;
+	m_StateCallsFiltered = m_StateFilter.GetStats ().Filtered;
+	m_SubmittedListCount = 1;
+}
 
-	m_CurrFrameResource->Fence = ++m_CurrentFence;
+void StencilDemoApp::RecordPassesParallel (JobGraph& jobs) {
+	// m_CmdList keeps the uploads, the barrier and the clears, and goes first.
+	ThrowIfFailed (m_CmdList->Close ());
 
-	m_CmdQueue->Signal (m_Fence.Get (), m_CurrentFence);
+	// Lists are created and reset here; each worker only records into and closes its own.
+	jobs.Clear ();
+	m_RecordFilters.resize (m_RecordChunks.size ());
+	for (size_t i = 0; i < m_RecordChunks.size (); i++) {
+		const LayerPass& pass = m_LayerPasses[m_RecordChunks[i].Pass];
+		ID3D12GraphicsCommandList* cmdList = ResetRecordList ((UINT)i, pass.PSO);
+
+		ID3D12PipelineState* pso = pass.PSO;
+		jobs.Add ("record chunk", [this, i, cmdList, pso] () {
+			auto& filter = m_RecordFilters[i];
+			filter.Reset (cmdList, pso);
+			filter.ResetStats ();
+			SetFrameState (filter);
+			RecordChunk (filter, i);
+
+			ThrowIfFailed (cmdList->Close ());
+		});
+	}
+
+	ID3D12GraphicsCommandList* presentList = ResetRecordList ((UINT)m_RecordChunks.size (), nullptr);
+	presentList->ResourceBarrier (1, &CD3DX12_RESOURCE_BARRIER::Transition (CurrentBackBuffer (),
+																			D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	ThrowIfFailed (presentList->Close ());
+
+	jobs.Run ();
+
+	m_SubmitLists.clear ();
+	m_SubmitLists.push_back (m_CmdList.Get ());
+	for (size_t i = 0; i <= m_RecordChunks.size (); i++) {
+		m_SubmitLists.push_back (m_RecordCmdLists[i].Get ());
+	}
+	m_CmdQueue->ExecuteCommandLists ((UINT)m_SubmitLists.size (), m_SubmitLists.data ());
+
+	m_StateCallsIssued = 0;
+	m_StateCallsFiltered = 0;
+	for (const auto& filter : m_RecordFilters) {
+		m_StateCallsIssued += filter.GetStats ().Issued;
+		m_StateCallsFiltered += filter.GetStats ().Filtered;
+	}
+	m_SubmittedListCount = (UINT)m_SubmitLists.size ();
+}
+
+ID3D12GraphicsCommandList* StencilDemoApp::ResetRecordList (UINT index, ID3D12PipelineState* pso) {
+	// The frame resource's fence has passed, so its allocators are free to reset.
+	ID3D12CommandAllocator* alloc = m_CurrFrameResource->RecordAllocator (m_Device.Get (), index);
+	ThrowIfFailed (alloc->Reset ());
+
+	if (index < m_RecordCmdLists.size ()) {
+		ThrowIfFailed (m_RecordCmdLists[index]->Reset (alloc, pso));
+	} else {
+		// Created open, as if just reset.
+		ComPtr<ID3D12GraphicsCommandList> cmdList;
+		ThrowIfFailed (m_Device->CreateCommandList (0, D3D12_COMMAND_LIST_TYPE_DIRECT, alloc, pso,
+													  IID_PPV_ARGS (cmdList.GetAddressOf ())));
+		m_RecordCmdLists.push_back (cmdList);
+	}
+
+	return m_RecordCmdLists[index].Get ();
+}
+
+void StencilDemoApp::SetFrameState (StateFilter<ID3D12GraphicsCommandList>& cmdList) {
+	cmdList.Get ()->RSSetViewports (1, &m_Viewport);
+	cmdList.Get ()->RSSetScissorRects (1, &m_ScissorRect);
+	cmdList.Get ()->OMSetRenderTargets (1, &CurrentBackBufferView (), true, &DepthStencilView ());
+
+	// Every texture, including the bolt flipbook, lives in this heap, so it is bound once per list.
+	ID3D12DescriptorHeap* descriptorHeaps[] = {m_SrvDescriptorHeap.Get ()};
+	cmdList.SetDescriptorHeaps (_countof (descriptorHeaps), descriptorHeaps);
+
+	cmdList.SetGraphicsRootSignature (m_RootSignature.Get ());
+}
+
+void StencilDemoApp::RecordChunk (StateFilter<ID3D12GraphicsCommandList>& cmdList, size_t chunkIndex) {
+	const RecordPartitioner::Chunk& chunk = m_RecordChunks[chunkIndex];
+	const LayerPass& pass = m_LayerPasses[chunk.Pass];
+
+	cmdList.SetGraphicsRootConstantBufferView (2, pass.PassCB);
+	cmdList.OMSetStencilRef (pass.StencilRef);
+	cmdList.SetPipelineState (pass.PSO);
+
+	const auto& ritems = m_VisibleRitems[(int)pass.Layer];
+	if (m_IndirectDraws) {
+		ExecuteIndirectRuns (cmdList, ritems, m_ChunkRuns[chunkIndex]);
+	} else {
+		DrawRenderItems (cmdList, ritems, chunk.First, chunk.Count);
+	}
 }
 
-void StencilDemoApp::DrawRenderItems (ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems) {
+void StencilDemoApp::DrawRenderItems (StateFilter<ID3D12GraphicsCommandList>& cmdList, const std::vector<uint32_t>& ritems,
+									  size_t first, size_t count) {
 	UINT objCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (ObjectConstants));
 	UINT matCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (MaterialConstants));
 
 	auto objectCB = m_CurrFrameResource->ObjectCB->Resource ();
 	auto matCB = m_CurrFrameResource->MaterialCB->Resource ();
 
-	for (size_t i = 0; i < ritems.size (); i++) {
-		auto ri = ritems[i];
+	// The items come sorted by texture and geometry, so runs of them share state and the filter
+	// drops most of these calls.
+	for (size_t i = first; i < first + count; i++) {
+		uint32_t index = ritems[i];
+		auto ri = &m_Ritems.Items ()[index];
 
-		cmdList->IASetVertexBuffers (0, 1, &ri->Geo->VertexBufferView ());
-		cmdList->IASetIndexBuffer (&ri->Geo->IndexBufferView ());
-		cmdList->IASetPrimitiveTopology (ri->PrimitiveType);
+		// Still on its way through the copy queue.
+		if (!m_CopyQueue->IsComplete (ri->UploadTicket))
+			continue;
+
+		cmdList.IASetVertexBuffers (0, 1, &ri->Geo->VertexBufferView ());
+		cmdList.IASetIndexBuffer (&ri->Geo->IndexBufferView ());
+		cmdList.IASetPrimitiveTopology (ri->PrimitiveType);
 
 		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress ();
-		objCBAddress += ri->ObjCBIndex * objCBByteSize;
+		objCBAddress += index * objCBByteSize;
 
 		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress ();
 		matCBAddress += ri->Mat->MatCBIndex * matCBByteSize;
 
-		ID3D12DescriptorHeap* descriptorHeaps[] = {m_SrvDescriptorHeap.Get ()};
-		m_CmdList->SetDescriptorHeaps (_countof (descriptorHeaps), descriptorHeaps);
 		CD3DX12_GPU_DESCRIPTOR_HANDLE tex (m_SrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart ());
 		tex.Offset (ri->Mat->DiffuseSrvHeapIndex, m_CbvSrvUavDescriptorSize);
 
-		if (ri->Geo->Name == "cylinderGeo") {
-			ID3D12DescriptorHeap* descriptorHeaps[] = {m_BoltSrvDescriptorHeap.Get ()};
-			cmdList->SetDescriptorHeaps (_countof (descriptorHeaps), descriptorHeaps);
-			tex = m_BoltSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart ();
-			tex.Offset (ri->Mat->DiffuseSrvHeapIndex, m_CbvSrvUavDescriptorSize);
-		}
+		cmdList.SetGraphicsRootDescriptorTable (0, tex);
+		cmdList.SetGraphicsRootConstantBufferView (1, objCBAddress);
+		cmdList.SetGraphicsRootConstantBufferView (3, matCBAddress);
 
-		cmdList->SetGraphicsRootDescriptorTable (0, tex);
-		cmdList->SetGraphicsRootConstantBufferView (1, objCBAddress);
-		cmdList->SetGraphicsRootConstantBufferView (3, matCBAddress);
+		cmdList.DrawIndexedInstanced (ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+	}
+}
 
-		cmdList->DrawIndexedInstanced (ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+void StencilDemoApp::ExecuteIndirectRuns (StateFilter<ID3D12GraphicsCommandList>& cmdList, const std::vector<uint32_t>& ritems,
+										  const RunRange& runs) {
+	auto argumentBuffer = m_CurrFrameResource->IndirectArgs->Resource ();
+
+	for (UINT r = runs.First; r < runs.First + runs.Count; r++) {
+		const IndirectArgumentBuilder::Run& run = m_IndirectBuilder.Runs ()[r];
+		auto ri = &m_Ritems.Items ()[ritems[run.Item]];
+
+		// Set once for the run; the commands only change the object and material CBVs.
+		cmdList.IASetVertexBuffers (0, 1, &ri->Geo->VertexBufferView ());
+		cmdList.IASetIndexBuffer (&ri->Geo->IndexBufferView ());
+		cmdList.IASetPrimitiveTopology (ri->PrimitiveType);
+
+		CD3DX12_GPU_DESCRIPTOR_HANDLE tex (m_SrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart ());
+		tex.Offset (ri->Mat->DiffuseSrvHeapIndex, m_CbvSrvUavDescriptorSize);
+		cmdList.SetGraphicsRootDescriptorTable (0, tex);
+
+		cmdList.ExecuteIndirect (m_CommandSignature.Get (), run.CommandCount, argumentBuffer,
+								 (UINT64)run.FirstCommand * IndirectArgumentBuilder::CommandStride, nullptr, 0);
 	}
 }
 
@@ -1640,6 +2516,17 @@ void StencilDemoApp::OnMouseUp (WPARAM btnState, int x, int y) {
 	ReleaseCapture ();
 }
 
+std::wstring StencilDemoApp::FrameStatsText (int frameCount) {
+	// Items that survived frustum culling in the last frame, over all layers, the state calls the
+	// filters recorded out of all they were given, and the command lists the frame was recorded into.
+	return L"   visible: " + std::to_wstring (m_VisibleRitemCount) + L" / " + std::to_wstring (m_LayerRitemCount) +
+		L"   state calls: " + std::to_wstring (m_StateCallsIssued) + L" / " +
+		std::to_wstring (m_StateCallsIssued + m_StateCallsFiltered) +
+		L"   lists: " + std::to_wstring (m_SubmittedListCount) +
+		(m_IndirectDraws ? L"   indirect runs: " + std::to_wstring (m_IndirectBuilder.Runs ().size ()) + L" / " +
+		 std::to_wstring (m_IndirectBuilder.Commands ().size ()) : L"");
+}
+
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> StencilDemoApp::GetStaticSamplers () {
 	// 應用程序一般只會用到這些采樣器中的一部分
 	// 所以就將它們全部提前定義好,並作為根簽名的一部分保留下來
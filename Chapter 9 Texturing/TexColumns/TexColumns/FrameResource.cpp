@@ -1,13 +1,13 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource (ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount) {
+FrameResource::FrameResource (ID3D12Device* device, UINT passCount, UINT instanceCount, UINT materialCount) {
     ThrowIfFailed (device->CreateCommandAllocator (
         D3D12_COMMAND_LIST_TYPE_DIRECT,
         IID_PPV_ARGS (CmdListAlloc.GetAddressOf ())));
 
     PassCB = std::make_unique<UploadBuffer<PassConstants>> (device, passCount, true);
     MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>> (device, materialCount, true);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>> (device, objectCount, true);
+    InstanceBuffer = std::make_unique<UploadBuffer<InstanceData>> (device, instanceCount, false);
 }
 
 FrameResource::~FrameResource () {}
\ No newline at end of file
@@ -4,7 +4,8 @@
 #include "../../../Common/MathHelper.h"
 #include "../../../Common/UploadBuffer.h"
 
-struct ObjectConstants {
+// One per drawn item, read by the vertex shader through SV_InstanceID.
+struct InstanceData {
     DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4 ();
     DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4 ();
 };
@@ -38,7 +39,7 @@ struct Vertex {
 
 struct FrameResource {
 public:
-    FrameResource (ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
+    FrameResource (ID3D12Device* device, UINT passCount, UINT instanceCount, UINT materialCount);
     FrameResource (const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource ();
@@ -47,7 +48,7 @@ public:
 
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
     std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+    std::unique_ptr<UploadBuffer<InstanceData>> InstanceBuffer = nullptr;
 
     UINT64 Fence = 0;
 };
\ No newline at end of file
@@ -15,11 +15,14 @@
 Texture2D    gDiffuseMap : register(t0);
 SamplerState gsamLinear  : register(s0);
 
-cbuffer cbPerObject : register(b0) {
-    float4x4 gWorld;
-    float4x4 gTexTransform;
+struct InstanceData {
+    float4x4 World;
+    float4x4 TexTransform;
 };
 
+// Bound at the first instance of the draw, so SV_InstanceID indexes it directly.
+StructuredBuffer<InstanceData> gInstanceData : register(t0, space1);
+
 cbuffer cbMaterial : register(b2) {
     float4 gDiffuseAlbedo;
     float3 gFresnelR0;
@@ -65,20 +68,22 @@ struct VertexOut {
     float2 TexC : TEXCOORD;
 };
 
-VertexOut VS (VertexIn vin) {
+VertexOut VS (VertexIn vin, uint instanceID : SV_InstanceID) {
     VertexOut vout = (VertexOut)0.0f;
 
+    InstanceData inst = gInstanceData[instanceID];
+
     // c׃Qg
-    float4 posW = mul (float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul (float4(vin.PosL, 1.0f), inst.World);
     vout.PosW = posW.xyz;
 
     // O@YMеǵȱȿs,t@YҪʹꇵDþ
-    vout.NormalW = mul (vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul (vin.NormalL, (float3x3)inst.World);
 
     // c׃QRνؼg
     vout.PosH = mul (posW, gViewProj);
 
-    float4 texC = mul (float4 (vin.TexC, 0.0f, 1.0f), gTexTransform);
+    float4 texC = mul (float4 (vin.TexC, 0.0f, 1.0f), inst.TexTransform);
     vout.TexC = mul (texC, gMatTransform).xy;
 
     return vout;
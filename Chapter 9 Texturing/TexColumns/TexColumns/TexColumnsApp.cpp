@@ -3,6 +3,7 @@
 #include "../../../Common/UploadBuffer.h"
 #include "../../../Common/GeometryGenerator.h"
 #include "../../../Common/DDSTextureLoader.h"
+#include "../../../Common/InstanceBatcher.h"
 #include "FrameResource.h"
 
 using Microsoft::WRL::ComPtr;
@@ -11,6 +12,9 @@ using namespace DirectX::PackedVector;
 
 const int g_NumFrameResources = 3;
 
+// Columns per side of the stress scene.
+const int g_StressGridSize = 40;
+
 struct RenderItem {
 	RenderItem () = default;
 
@@ -20,7 +24,8 @@ struct RenderItem {
 
 	int NumFrameDirty = g_NumFrameResources;
 
-	UINT ObjCBIndex = -1;
+	// Slot of this item's InstanceData. BuildBatches gives the items of a batch consecutive slots.
+	UINT InstanceIndex = -1;
 
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
@@ -32,6 +37,13 @@ struct RenderItem {
 	int BaseVertexLocation = 0;
 };
 
+// One instanced draw of InstanceCount items that share First's geometry, submesh and material. Their
+// instance data starts at First's slot.
+struct DrawBatch {
+	RenderItem* First = nullptr;
+	UINT InstanceCount = 0;
+};
+
 enum class RenderLayer : int {
 	Opaque = 0,
 	Count
@@ -54,10 +66,11 @@ private:
 	virtual void OnMouseDown (WPARAM btnState, int x, int y) override;
 	virtual void OnMouseUp (WPARAM btnState, int x, int y) override;
 	virtual void OnMouseMove (WPARAM btnState, int x, int y) override;
+	virtual std::wstring FrameStatsText (int frameCount) override;
 
 	void OnKeyboardInput (const GameTimer& gt);
 	void UpdateCamera (const GameTimer& gt);
-	void UpdateObjectCBs (const GameTimer& gt);
+	void UpdateInstanceData (const GameTimer& gt);
 	void UpdateMainPassCB (const GameTimer& gt);
 	void UpdateMaterialCBs (const GameTimer& gt);
 	void AnimateMaterials (const GameTimer& gt);
@@ -69,11 +82,13 @@ private:
 	void BuildPSOs ();
 	void BuildMaterials ();
 	void BuildRenderItems ();
+	void BuildStressRenderItems ();
+	void BuildBatches (const std::vector<RenderItem*>& ritems, UINT firstInstance, std::vector<DrawBatch>& batches);
 	void BuildFrameResources ();
 
 	void BuildDefaultScene ();
 
-	void DrawRenderItems (ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void DrawBatches (ID3D12GraphicsCommandList* cmdList, const std::vector<DrawBatch>& batches);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers ();
 
@@ -98,6 +113,22 @@ private:
 	std::vector<std::unique_ptr<RenderItem>> m_AllRitems;
 	std::vector<RenderItem*> m_RitemLayer[(int)RenderLayer::Count];
 
+	// The default scene's items and the stress scene's, grouped into instanced draws. 'S' switches
+	// between the scenes; 'I' switches between one draw per batch and one draw per item.
+	std::vector<RenderItem*> m_StressRitems;
+	std::vector<DrawBatch> m_Batches;
+	std::vector<DrawBatch> m_StressBatches;
+	InstanceBatcher m_InstanceBatcher;
+
+	bool m_ShowStressScene = false;
+	bool m_StressKeyDown = false;
+	bool m_UseInstancing = true;
+	bool m_InstancingKeyDown = false;
+
+	// Draw calls and items drawn in the last frame.
+	UINT m_DrawCount = 0;
+	UINT m_DrawnItemCount = 0;
+
 	bool m_IsWireFrame = false;
 
 	PassConstants m_MainPassCB;
@@ -142,6 +173,9 @@ bool TexColumnsApp::Initialize () {
 	BuildDefaultScene ();
 	BuildMaterials ();
 	BuildRenderItems ();
+	BuildStressRenderItems ();
+	BuildBatches (m_RitemLayer[(int)RenderLayer::Opaque], 0, m_Batches);
+	BuildBatches (m_StressRitems, (UINT)m_RitemLayer[(int)RenderLayer::Opaque].size (), m_StressBatches);
 	BuildFrameResources ();
 	BuildPSOs ();
 
@@ -237,7 +271,7 @@ void TexColumnsApp::BuildRootSignature () {
 	CD3DX12_ROOT_PARAMETER slotRootParameter[4];
 
 	slotRootParameter[0].InitAsDescriptorTable (1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
-	slotRootParameter[1].InitAsConstantBufferView (0);
+	slotRootParameter[1].InitAsShaderResourceView (0, 1);
 	slotRootParameter[2].InitAsConstantBufferView (1);
 	slotRootParameter[3].InitAsConstantBufferView (2);
 
@@ -449,7 +483,6 @@ void TexColumnsApp::BuildRenderItems () {
 	auto boxRitem = std::make_unique<RenderItem> ();
 	XMStoreFloat4x4 (&boxRitem->World, XMMatrixScaling (2.0f, 2.0f, 2.0f) * XMMatrixTranslation (0.0f, 1.0f, 0.0f));
 	XMStoreFloat4x4 (&boxRitem->TexTransform, XMMatrixScaling (1.0f, 1.0f, 1.0f));
-	boxRitem->ObjCBIndex = 0;
 	boxRitem->Mat = m_Materials["stone0"].get ();
 	boxRitem->Geo = m_Geometries["shape"].get ();
 	boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -461,7 +494,6 @@ void TexColumnsApp::BuildRenderItems () {
 	auto gridRitem = std::make_unique<RenderItem> ();
 	gridRitem->World = MathHelper::Identity4x4 ();
 	XMStoreFloat4x4 (&gridRitem->TexTransform, XMMatrixScaling (8.0f, 8.0f, 1.0f));
-	gridRitem->ObjCBIndex = 1;
 	gridRitem->Mat = m_Materials["tile0"].get ();
 	gridRitem->Geo = m_Geometries["shape"].get ();
 	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -471,7 +503,6 @@ void TexColumnsApp::BuildRenderItems () {
 	m_AllRitems.push_back (std::move (gridRitem));
 
 	XMMATRIX brickTexTransform = XMMatrixScaling (1.0f, 1.0f, 1.0f);
-	UINT objCBIndex = 2;
 	for (int i = 0; i < 5; ++i) {
 		auto leftCylRitem = std::make_unique<RenderItem> ();
 		auto rightCylRitem = std::make_unique<RenderItem> ();
@@ -486,7 +517,6 @@ void TexColumnsApp::BuildRenderItems () {
 
 		XMStoreFloat4x4 (&leftCylRitem->World, rightCylWorld);
 		XMStoreFloat4x4 (&leftCylRitem->TexTransform, brickTexTransform);
-		leftCylRitem->ObjCBIndex = objCBIndex++;
 		leftCylRitem->Mat = m_Materials["bricks0"].get ();
 		leftCylRitem->Geo = m_Geometries["shape"].get ();
 		leftCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -496,7 +526,6 @@ void TexColumnsApp::BuildRenderItems () {
 
 		XMStoreFloat4x4 (&rightCylRitem->World, leftCylWorld);
 		XMStoreFloat4x4 (&rightCylRitem->TexTransform, brickTexTransform);
-		rightCylRitem->ObjCBIndex = objCBIndex++;
 		rightCylRitem->Mat = m_Materials["bricks0"].get ();
 		rightCylRitem->Geo = m_Geometries["shape"].get ();
 		rightCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -506,7 +535,6 @@ void TexColumnsApp::BuildRenderItems () {
 
 		XMStoreFloat4x4 (&leftSphereRitem->World, leftSphereWorld);
 		leftSphereRitem->TexTransform = MathHelper::Identity4x4 ();
-		leftSphereRitem->ObjCBIndex = objCBIndex++;
 		leftSphereRitem->Mat = m_Materials["stone0"].get ();
 		leftSphereRitem->Geo = m_Geometries["shape"].get ();
 		leftSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -516,7 +544,6 @@ void TexColumnsApp::BuildRenderItems () {
 
 		XMStoreFloat4x4 (&rightSphereRitem->World, rightSphereWorld);
 		rightSphereRitem->TexTransform = MathHelper::Identity4x4 ();
-		rightSphereRitem->ObjCBIndex = objCBIndex++;
 		rightSphereRitem->Mat = m_Materials["stone0"].get ();
 		rightSphereRitem->Geo = m_Geometries["shape"].get ();
 		rightSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -534,6 +561,72 @@ void TexColumnsApp::BuildRenderItems () {
 		m_RitemLayer[(int)RenderLayer::Opaque].push_back (e.get ());
 }
 
+void TexColumnsApp::BuildStressRenderItems () {
+	// A field of columns with a sphere on each, materials in a checker pattern: thousands of items,
+	// but only four geometry and material pairs among them.
+	auto geo = m_Geometries["shape"].get ();
+	const SubmeshGeometry& cylinder = geo->DrawArgs["cylinder"];
+	const SubmeshGeometry& sphere = geo->DrawArgs["sphere"];
+
+	Material* bricks = m_Materials["bricks0"].get ();
+	Material* stone = m_Materials["stone0"].get ();
+	Material* tile = m_Materials["tile0"].get ();
+
+	const float spacing = 3.0f;
+	const float origin = -0.5f * spacing * (g_StressGridSize - 1);
+	for (int z = 0; z < g_StressGridSize; ++z) {
+		for (int x = 0; x < g_StressGridSize; ++x) {
+			bool checker = ((x + z) & 1) != 0;
+			float posX = origin + x * spacing;
+			float posZ = origin + z * spacing;
+
+			auto cylRitem = std::make_unique<RenderItem> ();
+			XMStoreFloat4x4 (&cylRitem->World, XMMatrixTranslation (posX, 1.5f, posZ));
+			cylRitem->Mat = checker ? stone : bricks;
+			cylRitem->Geo = geo;
+			cylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			cylRitem->IndexCount = cylinder.IndexCount;
+			cylRitem->StartIndexLocation = cylinder.StartIndexLocation;
+			cylRitem->BaseVertexLocation = cylinder.BaseVertexLocation;
+
+			auto sphereRitem = std::make_unique<RenderItem> ();
+			XMStoreFloat4x4 (&sphereRitem->World, XMMatrixTranslation (posX, 3.5f, posZ));
+			sphereRitem->Mat = checker ? tile : stone;
+			sphereRitem->Geo = geo;
+			sphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			sphereRitem->IndexCount = sphere.IndexCount;
+			sphereRitem->StartIndexLocation = sphere.StartIndexLocation;
+			sphereRitem->BaseVertexLocation = sphere.BaseVertexLocation;
+
+			m_StressRitems.push_back (cylRitem.get ());
+			m_StressRitems.push_back (sphereRitem.get ());
+			m_AllRitems.push_back (std::move (cylRitem));
+			m_AllRitems.push_back (std::move (sphereRitem));
+		}
+	}
+}
+
+void TexColumnsApp::BuildBatches (const std::vector<RenderItem*>& ritems, UINT firstInstance, std::vector<DrawBatch>& batches) {
+	// Everything here is drawn with the opaque PSO, so the PSO does not split batches.
+	m_InstanceBatcher.Clear ();
+	for (size_t i = 0; i < ritems.size (); i++) {
+		auto ri = ritems[i];
+		m_InstanceBatcher.Add ({ri->Geo, ri->StartIndexLocation, (uint32_t)ri->Mat->MatCBIndex, 0}, (uint32_t)i);
+	}
+	m_InstanceBatcher.Build ();
+
+	// Instance slots follow the batch order, so each batch's instance data is one contiguous run.
+	const auto& instances = m_InstanceBatcher.Instances ();
+	for (size_t i = 0; i < instances.size (); i++) {
+		ritems[instances[i]]->InstanceIndex = firstInstance + (UINT)i;
+	}
+
+	batches.clear ();
+	for (const auto& batch : m_InstanceBatcher.Batches ()) {
+		batches.push_back ({ritems[instances[batch.FirstInstance]], batch.InstanceCount});
+	}
+}
+
 void TexColumnsApp::BuildFrameResources () {
 	for (int i = 0; i < g_NumFrameResources; i++)
 		m_FrameResources.push_back (std::make_unique<FrameResource> (m_Device.Get (), 1, (UINT)m_AllRitems.size (), (UINT)m_Materials.size ()));
@@ -544,6 +637,16 @@ void TexColumnsApp::OnKeyboardInput (const GameTimer& gt) {
 		m_IsWireFrame = true;
 	else
 		m_IsWireFrame = false;
+
+	bool stressKey = (GetAsyncKeyState ('S') & 0x8000) != 0;
+	if (stressKey && !m_StressKeyDown)
+		m_ShowStressScene = !m_ShowStressScene;
+	m_StressKeyDown = stressKey;
+
+	bool instancingKey = (GetAsyncKeyState ('I') & 0x8000) != 0;
+	if (instancingKey && !m_InstancingKeyDown)
+		m_UseInstancing = !m_UseInstancing;
+	m_InstancingKeyDown = instancingKey;
 }
 
 void TexColumnsApp::UpdateCamera (const GameTimer& gt) {
@@ -574,25 +677,25 @@ void TexColumnsApp::Update (const GameTimer& gt) {
 	}
 
 	AnimateMaterials (gt);
-	UpdateObjectCBs (gt);
+	UpdateInstanceData (gt);
 	UpdateMainPassCB (gt);
 	UpdateMaterialCBs (gt);
 }
 
 void TexColumnsApp::AnimateMaterials (const GameTimer& gt) {}
 
-void TexColumnsApp::UpdateObjectCBs (const GameTimer& gt) {
-	auto currObjectCB = m_CurrFrameResource->ObjectCB.get ();
+void TexColumnsApp::UpdateInstanceData (const GameTimer& gt) {
+	auto currInstanceBuffer = m_CurrFrameResource->InstanceBuffer.get ();
 	for (auto& e : m_AllRitems) {
 		if (e->NumFrameDirty > 0) {
 			XMMATRIX world = XMLoadFloat4x4 (&e->World);
 			XMMATRIX texTransform = XMLoadFloat4x4 (&e->TexTransform);
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4 (&objConstants.World, XMMatrixTranspose (world));
-			XMStoreFloat4x4 (&objConstants.TexTransform, XMMatrixTranspose (texTransform));
+			InstanceData instanceData;
+			XMStoreFloat4x4 (&instanceData.World, XMMatrixTranspose (world));
+			XMStoreFloat4x4 (&instanceData.TexTransform, XMMatrixTranspose (texTransform));
 
-			currObjectCB->CopyData (e->ObjCBIndex, objConstants);
+			currInstanceBuffer->CopyData (e->InstanceIndex, instanceData);
 
 			e->NumFrameDirty--;
 		}
@@ -683,7 +786,9 @@ void TexColumnsApp::Draw (const GameTimer& gt) {
 	auto passCB = m_CurrFrameResource->PassCB->Resource ();
 	m_CmdList->SetGraphicsRootConstantBufferView (2, passCB->GetGPUVirtualAddress ());
 
-	DrawRenderItems (m_CmdList.Get (), m_RitemLayer[(int)RenderLayer::Opaque]);
+	m_DrawCount = 0;
+	m_DrawnItemCount = 0;
+	DrawBatches (m_CmdList.Get (), m_ShowStressScene ? m_StressBatches : m_Batches);
 
 	m_CmdList->ResourceBarrier (1, &CD3DX12_RESOURCE_BARRIER::Transition (CurrentBackBuffer (),
 																		  D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
@@ -701,23 +806,19 @@ void TexColumnsApp::Draw (const GameTimer& gt) {
 	m_CmdQueue->Signal (m_Fence.Get (), m_CurrentFence);
 }
 
-void TexColumnsApp::DrawRenderItems (ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems) {
-	UINT objCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (ObjectConstants));
+void TexColumnsApp::DrawBatches (ID3D12GraphicsCommandList* cmdList, const std::vector<DrawBatch>& batches) {
 	UINT matCBByteSize = D3DUtil::CalcConstantBufferByteSize (sizeof (MaterialConstants));
 
-	auto objectCB = m_CurrFrameResource->ObjectCB->Resource ();
+	auto instanceBuffer = m_CurrFrameResource->InstanceBuffer->Resource ();
 	auto matCB = m_CurrFrameResource->MaterialCB->Resource ();
 
-	for (size_t i = 0; i < ritems.size (); i++) {
-		auto ri = ritems[i];
+	for (size_t i = 0; i < batches.size (); i++) {
+		auto ri = batches[i].First;
 
 		cmdList->IASetVertexBuffers (0, 1, &ri->Geo->VertexBufferView ());
 		cmdList->IASetIndexBuffer (&ri->Geo->IndexBufferView ());
 		cmdList->IASetPrimitiveTopology (ri->PrimitiveType);
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress ();
-		objCBAddress += ri->ObjCBIndex * objCBByteSize;
-
 		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress ();
 		matCBAddress += ri->Mat->MatCBIndex * matCBByteSize;
 
@@ -725,10 +826,25 @@ void TexColumnsApp::DrawRenderItems (ID3D12GraphicsCommandList* cmdList, const s
 		tex.Offset (ri->Mat->DiffuseSrvHeapIndex, m_CbvSrvUavDescriptorSize);
 
 		cmdList->SetGraphicsRootDescriptorTable (0, tex);
-		cmdList->SetGraphicsRootConstantBufferView (1, objCBAddress);
 		cmdList->SetGraphicsRootConstantBufferView (3, matCBAddress);
 
-		cmdList->DrawIndexedInstanced (ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+		// The instance data is bound from the batch's first slot, so SV_InstanceID indexes it from 0.
+		D3D12_GPU_VIRTUAL_ADDRESS instanceAddress = instanceBuffer->GetGPUVirtualAddress ();
+		instanceAddress += ri->InstanceIndex * sizeof (InstanceData);
+
+		if (m_UseInstancing) {
+			cmdList->SetGraphicsRootShaderResourceView (1, instanceAddress);
+			cmdList->DrawIndexedInstanced (ri->IndexCount, batches[i].InstanceCount, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+			m_DrawCount++;
+		} else {
+			for (UINT j = 0; j < batches[i].InstanceCount; j++) {
+				cmdList->SetGraphicsRootShaderResourceView (1, instanceAddress + j * sizeof (InstanceData));
+				cmdList->DrawIndexedInstanced (ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+				m_DrawCount++;
+			}
+		}
+
+		m_DrawnItemCount += batches[i].InstanceCount;
 	}
 }
 
@@ -765,6 +881,11 @@ void TexColumnsApp::OnMouseUp (WPARAM btnState, int x, int y) {
 	ReleaseCapture ();
 }
 
+std::wstring TexColumnsApp::FrameStatsText (int frameCount) {
+	return L"   items: " + std::to_wstring (m_DrawnItemCount) + L"   draws: " + std::to_wstring (m_DrawCount) +
+		(m_UseInstancing ? L" (instanced)" : L" (one per item)");
+}
+
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> TexColumnsApp::GetStaticSamplers () {
 	// óһֻõ@Щɘеһ
 	// Ծ͌ȫǰx,Kһֱ
@@ -56,6 +56,8 @@ private:
 	virtual void OnMouseUp (WPARAM btnState, int x, int y) override;
 	virtual void OnMouseMove (WPARAM btnState, int x, int y) override;
 
+	virtual std::wstring FrameStatsText (int frameCount) override;
+
 	void OnKeyboardInput (const GameTimer& gt);
 	void UpdateCamera (const GameTimer& gt);
 	void UpdateObjectCBs (const GameTimer& gt);
@@ -107,6 +109,9 @@ private:
 	std::unique_ptr<Waves> m_Waves;
 	RenderItem* m_WavesRitem = nullptr;
 
+	// Wave vertices are built here in cached memory, then streamed to the frame's VB in one copy.
+	std::vector<Vertex> m_WaveVertices;
+
 	bool m_IsWireFrame = false;
 
 	PassConstants m_MainPassCB;
@@ -598,6 +603,12 @@ void TexWavesApp::Update (const GameTimer& gt) {
 		CloseHandle (eventHandle);
 	}
 
+	// The GPU is done with this frame resource, so start recording what this frame writes to it.
+	m_CurrFrameResource->PassCB->ClearDirtyRanges ();
+	m_CurrFrameResource->MaterialCB->ClearDirtyRanges ();
+	m_CurrFrameResource->ObjectCB->ClearDirtyRanges ();
+	m_CurrFrameResource->WavesVB->ClearDirtyRanges ();
+
 	AnimateMaterials (gt);
 	UpdateObjectCBs (gt);
 	UpdateMainPassCB (gt);
@@ -719,19 +730,20 @@ void TexWavesApp::UpdateWaves (const GameTimer& gt) {
 	m_Waves->Update (gt.DeltaTime ());
 
 	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = m_CurrFrameResource->WavesVB.get ();
+	m_WaveVertices.resize (m_Waves->VertexCount ());
 	for (int i = 0; i < m_Waves->VertexCount (); ++i) {
-		Vertex v;
+		Vertex& v = m_WaveVertices[i];
 
 		v.Pos = m_Waves->Position (i);
 		v.Normal = m_Waves->Normal (i);
 		// cλ(wһ)ӳ䵽UV[0, 1]
 		v.TexC.x = 0.5f + v.Pos.x / m_Waves->Width ();
 		v.TexC.y = 0.5f - v.Pos.z / m_Waves->Depth ();
-
-		currWavesVB->CopyData (i, v);
 	}
 
+	auto currWavesVB = m_CurrFrameResource->WavesVB.get ();
+	currWavesVB->CopyRange (0, m_WaveVertices.data (), (UINT)m_WaveVertices.size ());
+
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
 	m_WavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource ();
 }
@@ -848,6 +860,26 @@ void TexWavesApp::OnMouseUp (WPARAM btnState, int x, int y) {
 	ReleaseCapture ();
 }
 
+std::wstring TexWavesApp::FrameStatsText (int frameCount) {
+	// Average KB written per frame for each upload type, and how many ranges the last frame's
+	// object constants took.
+	std::wstring text = L"   upload KB/frame:";
+	for (const auto& counter : UploadStats::Counters ()) {
+		std::string name = counter.Name;
+		if (name.compare (0, 7, "struct ") == 0)
+			name = name.substr (7);
+
+		wchar_t value[32];
+		swprintf_s (value, L" %.1f", counter.Bytes / 1024.0 / frameCount);
+		text += L" " + AnsiToWString (name) + value;
+	}
+
+	text += L"   object ranges: " + std::to_wstring (m_CurrFrameResource->ObjectCB->DirtyRanges ().Ranges ().size ());
+
+	UploadStats::Reset ();
+	return text;
+}
+
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> TexWavesApp::GetStaticSamplers () {
 	// óһֻõ@Щɘһ
 	// Ծ͌ȫǰx,Kһֱ
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// A resizable set of indices, one bit each in 64-bit words. ForEach() visits the set bits word by
+// word with a trailing zero count, so sparse sets cost one test per 64 indices.
+class BitSet {
+public:
+	// Index of the lowest set bit. value must not be 0.
+	static uint32_t LowestBit(uint64_t value) {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+public:
+	// Bits added by growing start out clear.
+	void Resize(uint32_t size) {
+		_words.resize((size + 63) / 64, 0);
+		_size = size;
+
+		// Bits past the end stay clear, so ForEach() never has to check against the size.
+		if (size % 64 != 0) {
+			_words.back() &= (1ull << (size % 64)) - 1;
+		}
+	}
+
+	uint32_t Size() const {
+		return _size;
+	}
+
+	void Set(uint32_t index) {
+		_words[index / 64] |= 1ull << (index % 64);
+	}
+
+	void Reset(uint32_t index) {
+		_words[index / 64] &= ~(1ull << (index % 64));
+	}
+
+	void Assign(uint32_t index, bool value) {
+		if (value) {
+			Set(index);
+		} else {
+			Reset(index);
+		}
+	}
+
+	bool Test(uint32_t index) const {
+		return (_words[index / 64] >> (index % 64)) & 1;
+	}
+
+	// Clears every bit, keeping the size.
+	void ClearAll() {
+		for (uint64_t& word : _words) {
+			word = 0;
+		}
+	}
+
+	// Sets every bit below Size().
+	void SetAll() {
+		for (uint64_t& word : _words) {
+			word = ~0ull;
+		}
+		Resize(_size);
+	}
+
+	bool Any() const {
+		for (uint64_t word : _words) {
+			if (word != 0)
+				return true;
+		}
+		return false;
+	}
+
+	// Calls fn(index) for every set bit, in increasing order. fn must not resize the set.
+	template<typename Fn>
+	void ForEach(Fn fn) const {
+		for (uint32_t w = 0; w < (uint32_t)_words.size(); ++w) {
+			uint64_t word = _words[w];
+			while (word != 0) {
+				fn(w * 64 + LowestBit(word));
+				word &= word - 1;
+			}
+		}
+	}
+
+	// Same as ForEach(), clearing the bits as it goes. fn must not resize the set.
+	template<typename Fn>
+	void ForEachClear(Fn fn) {
+		for (uint32_t w = 0; w < (uint32_t)_words.size(); ++w) {
+			uint64_t word = _words[w];
+			if (word == 0)
+				continue;
+
+			_words[w] = 0;
+			while (word != 0) {
+				fn(w * 64 + LowestBit(word));
+				word &= word - 1;
+			}
+		}
+	}
+
+	const uint64_t* Words() const {
+		return _words.data();
+	}
+
+	uint32_t WordCount() const {
+		return (uint32_t)_words.size();
+	}
+
+private:
+	std::vector<uint64_t> _words;
+	uint32_t _size = 0;
+};
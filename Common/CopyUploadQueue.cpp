@@ -0,0 +1,112 @@
+#include "CopyUploadQueue.h"
+
+#include <cassert>
+
+using Microsoft::WRL::ComPtr;
+
+CopyUploadQueue::CopyUploadQueue(ID3D12Device* device) : _device(device) {
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(_queue.GetAddressOf())));
+
+	ThrowIfFailed(_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(_fence.GetAddressOf())));
+}
+
+CopyUploadQueue::~CopyUploadQueue() {
+	// Recorded but never submitted work is dropped; only wait for what the GPU may still be reading.
+	if (_fence != nullptr && _fence->GetCompletedValue() < _fenceValue) {
+		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
+		if (SUCCEEDED(_fence->SetEventOnCompletion(_fenceValue, eventHandle))) {
+			WaitForSingleObject(eventHandle, INFINITE);
+		}
+		CloseHandle(eventHandle);
+	}
+}
+
+ID3D12GraphicsCommandList* CopyUploadQueue::CommandList() {
+	if (_open)
+		return _cmdList.Get();
+
+	if (!_freeAllocators.empty()) {
+		_openBatch.Allocator = _freeAllocators.back();
+		_freeAllocators.pop_back();
+		ThrowIfFailed(_openBatch.Allocator->Reset());
+	} else {
+		ThrowIfFailed(_device->CreateCommandAllocator(
+			D3D12_COMMAND_LIST_TYPE_COPY,
+			IID_PPV_ARGS(_openBatch.Allocator.GetAddressOf())
+		));
+	}
+
+	if (_cmdList == nullptr) {
+		ThrowIfFailed(_device->CreateCommandList(
+			0,
+			D3D12_COMMAND_LIST_TYPE_COPY,
+			_openBatch.Allocator.Get(),
+			nullptr,
+			IID_PPV_ARGS(_cmdList.GetAddressOf())
+		));
+	} else {
+		ThrowIfFailed(_cmdList->Reset(_openBatch.Allocator.Get(), nullptr));
+	}
+
+	_open = true;
+	return _cmdList.Get();
+}
+
+CopyUploadQueue::Ticket CopyUploadQueue::Enqueue(ComPtr<ID3D12Resource> uploadBuffer) {
+	assert(_open);
+
+	if (uploadBuffer != nullptr) {
+		_openBatch.UploadBuffers.push_back(uploadBuffer);
+	}
+	return _scheduler.Enqueue();
+}
+
+void CopyUploadQueue::Submit() {
+	if (!_open)
+		return;
+
+	ThrowIfFailed(_cmdList->Close());
+	ID3D12CommandList* cmdsLists[] = {_cmdList.Get()};
+	_queue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+	_fenceValue++;
+	ThrowIfFailed(_queue->Signal(_fence.Get(), _fenceValue));
+
+	_scheduler.Submit(_fenceValue);
+	_batches.push_back(std::move(_openBatch));
+	_openBatch = Batch();
+	_open = false;
+}
+
+void CopyUploadQueue::Update() {
+	uint32_t retired = _scheduler.Retire(_fence->GetCompletedValue());
+	for (uint32_t i = 0; i < retired; ++i) {
+		_freeAllocators.push_back(_batches.front().Allocator);
+		_batches.pop_front();
+	}
+}
+
+void CopyUploadQueue::Wait(ID3D12CommandQueue* queue, Ticket ticket) const {
+	UINT64 fence = _scheduler.FenceOf(ticket);
+	assert(fence != 0 || _scheduler.IsComplete(ticket));
+
+	if (fence != 0) {
+		ThrowIfFailed(queue->Wait(_fence.Get(), fence));
+	}
+}
+
+void CopyUploadQueue::Flush() {
+	Submit();
+
+	if (_fence->GetCompletedValue() < _fenceValue) {
+		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
+		ThrowIfFailed(_fence->SetEventOnCompletion(_fenceValue, eventHandle));
+		WaitForSingleObject(eventHandle, INFINITE);
+		CloseHandle(eventHandle);
+	}
+
+	Update();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include "UploadScheduler.h"
+
+#include <deque>
+
+// Runs uploads on a copy queue of their own so they overlap rendering instead of being flushed
+// through the direct queue. Record copies into CommandList(), Enqueue() each one for a ticket, then
+// Submit(). The frame loop calls Update() and checks IsComplete() before using what a ticket covers.
+//
+// Copy command lists only take copies and COMMON/COPY_DEST barriers. Resources decay to COMMON
+// after the copy queue is done with them; buffers and read-only texture states are promoted from
+// there implicitly on the direct queue.
+class CopyUploadQueue {
+public:
+	typedef UploadScheduler::Ticket Ticket;
+
+public:
+	CopyUploadQueue(ID3D12Device* device);
+	CopyUploadQueue(const CopyUploadQueue& rhs) = delete;
+	CopyUploadQueue& operator=(const CopyUploadQueue& rhs) = delete;
+	~CopyUploadQueue();
+
+public:
+	// Open copy command list, reset on first use after a Submit().
+	ID3D12GraphicsCommandList* CommandList();
+
+	// Adds the upload just recorded to the open batch. uploadBuffer, the staging memory it reads (if
+	// any), is kept alive until the upload completes.
+	Ticket Enqueue(Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer = nullptr);
+
+	// Executes what was recorded since the last Submit(). Does nothing if CommandList() was not called.
+	void Submit();
+
+	// Polls the fence and releases batches that have finished. Call once per frame: IsComplete()
+	// only changes here, so it gives the same answer all frame long.
+	void Update();
+
+	bool IsComplete(Ticket ticket) const {
+		return _scheduler.IsComplete(ticket);
+	}
+
+	// Makes queue wait on the GPU for ticket, without blocking the CPU. ticket must be submitted.
+	void Wait(ID3D12CommandQueue* queue, Ticket ticket) const;
+
+	// Submits and blocks until everything has finished.
+	void Flush();
+
+	// Fence value the open batch will signal, for code that tracks reuse by fence.
+	UINT64 NextFence() const {
+		return _fenceValue + 1;
+	}
+
+	UINT64 CompletedFence() const {
+		return _fence->GetCompletedValue();
+	}
+
+	ID3D12CommandQueue* Queue() const {
+		return _queue.Get();
+	}
+
+	UINT InFlightBatches() const {
+		return _scheduler.InFlightBatches();
+	}
+
+private:
+	struct Batch {
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> UploadBuffers;
+	};
+
+private:
+	ID3D12Device* _device;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> _queue;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> _cmdList;
+	Microsoft::WRL::ComPtr<ID3D12Fence> _fence;
+	UINT64 _fenceValue = 0;
+
+	bool _open = false;
+	Batch _openBatch;
+	std::deque<Batch> _batches;		// Submitted, oldest first; parallel to the scheduler's.
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> _freeAllocators;
+
+	UploadScheduler _scheduler;
+};
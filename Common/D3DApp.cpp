@@ -609,7 +609,8 @@ void D3DApp::CalculateFrameStats() {
 		wstring windowText = _mainWndCaption +
 			(_4xMsaaState ? L"    4X MSAA " : L"") +
 			L"    fps: " + fpsStr +
-			L"   mspf: " + mspfStr;
+			L"   mspf: " + mspfStr +
+			FrameStatsText(frameCnt);
 
 		SetWindowText(_mainWnd, windowText.c_str());
 
@@ -44,6 +44,10 @@ protected:
 	virtual void OnMouseUp(WPARAM btnState, int x, int y) {}
 	virtual void OnMouseMove(WPARAM btnState, int x, int y) {}
 
+	// Extra text for the caption, appended after fps and mspf once a second. frameCount is the
+	// number of frames since the previous call.
+	virtual std::wstring FrameStatsText(int frameCount) { return L""; }
+
 protected:
 	bool InitMainWindow();
 	bool InitDirect3D();
@@ -1,4 +1,5 @@
 #include "D3DUtil.h"	
+#include "ShaderCache.h"
 
 #include <comdef.h>
 
@@ -86,6 +87,21 @@ ComPtr<ID3DBlob> D3DUtil::CompileShader(const std::wstring& filename,
 	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
 
+	__int64 countsPerSec, startTime, endTime;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+
+	// The same file is usually compiled with several define sets; each combination has an entry.
+	uint64_t key = ShaderCache::Key(filename, defines, entrypoint, target, compileFlags);
+	if (key != 0) {
+		ComPtr<ID3DBlob> cached = ShaderCache::Find(key);
+		if (cached != nullptr) {
+			QueryPerformanceCounter((LARGE_INTEGER*)&endTime);
+			ShaderCache::Record(true, (double)(endTime - startTime) / countsPerSec);
+			return cached;
+		}
+	}
+
 	HRESULT hr = S_OK;
 
 	ComPtr<ID3DBlob> byteCode = nullptr;
@@ -108,6 +124,13 @@ ComPtr<ID3DBlob> D3DUtil::CompileShader(const std::wstring& filename,
 
 	ThrowIfFailed(hr);
 
+	if (key != 0) {
+		ShaderCache::Store(key, byteCode.Get());
+	}
+
+	QueryPerformanceCounter((LARGE_INTEGER*)&endTime);
+	ShaderCache::Record(false, (double)(endTime - startTime) / countsPerSec);
+
 	return byteCode;
 }
 
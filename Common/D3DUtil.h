@@ -76,14 +76,16 @@ struct MeshGeometry {
 
 	UINT VertexByteStride = 0;
 	UINT VertexBufferByteSize = 0;
+	UINT64 VertexBufferOffset = 0;		// Where the vertices start in VertexBufferGPU, for buffers shared with other data.
 	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R16_UINT;
 	UINT IndexBufferByteSize = 0;
+	UINT64 IndexBufferOffset = 0;
 
 	std::unordered_map<std::string, SubmeshGeometry> DrawArgs;
 
 	D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const {
 		D3D12_VERTEX_BUFFER_VIEW vbv;
-		vbv.BufferLocation = VertexBufferGPU->GetGPUVirtualAddress();
+		vbv.BufferLocation = VertexBufferGPU->GetGPUVirtualAddress() + VertexBufferOffset;
 		vbv.StrideInBytes = VertexByteStride;
 		vbv.SizeInBytes = VertexBufferByteSize;
 		return vbv;
@@ -91,7 +93,7 @@ struct MeshGeometry {
 
 	D3D12_INDEX_BUFFER_VIEW IndexBufferView() const {
 		D3D12_INDEX_BUFFER_VIEW ibv;
-		ibv.BufferLocation = IndexBufferGPU->GetGPUVirtualAddress();
+		ibv.BufferLocation = IndexBufferGPU->GetGPUVirtualAddress() + IndexBufferOffset;
 		ibv.Format = IndexFormat;
 		ibv.SizeInBytes = IndexBufferByteSize;
 		return ibv;
@@ -109,6 +111,9 @@ struct MaterialConstants {
 	float Roughness = 0.25f;
 
 	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	// Slice of a Texture2DArray diffuse map (flipbook animation).
+	UINT DiffuseArraySlice = 0;
 };
 
 struct Material {
@@ -118,6 +123,10 @@ struct Material {
 	int NormalSrvHeapIndex = -1;
 	int NumFrameDirty = g_NumFrameResources;
 
+	// Only used when DiffuseSrvHeapIndex refers to a Texture2DArray. Animating the slice
+	// avoids switching descriptors or heaps per frame.
+	UINT DiffuseArraySlice = 0;
+
 	DirectX::XMFLOAT4 DiffuseAlbedo = {1.0f, 1.0f, 1.0f, 1.0f};
 	DirectX::XMFLOAT3 FresnelR0 = {0.01f, 0.01f, 0.01f};
 	float Roughness = 0.25f;
@@ -130,6 +130,10 @@ typedef public std::unique_ptr<void, handle_closer> ScopedHandle;
 
 inline HANDLE safe_handle( HANDLE h ) { return (h == INVALID_HANDLE_VALUE) ? 0 : h; }
 
+struct view_unmapper { void operator()(const void* p) { if (p) UnmapViewOfFile(p); } };
+
+typedef std::unique_ptr<const void, view_unmapper> ScopedMapView;
+
 template<UINT TNameLength>
 inline void SetDebugObjectName(_In_ ID3D11DeviceChild* resource, _In_ const char (&name)[TNameLength])
 {
@@ -269,6 +273,132 @@ static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
 }
 
 
+//--------------------------------------------------------------------------------------
+// Same as LoadTextureDataFromFile, but maps the file read-only instead of copying it into
+// a heap buffer. The returned header and bit pointers reference the view directly, so
+// ddsView must outlive every use of them (for the D3D12 path, until UpdateSubresources
+// has copied the subresources into the upload heap).
+static HRESULT LoadTextureDataFromFileMapped(_In_z_ const wchar_t* fileName,
+	ScopedMapView& ddsView,
+	const DDS_HEADER** header,
+	const uint8_t** bitData,
+	size_t* bitSize
+	)
+{
+	if (!header || !bitData || !bitSize)
+	{
+		return E_POINTER;
+	}
+
+	// open the file
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+	ScopedHandle hFile(safe_handle(CreateFile2(fileName,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		OPEN_EXISTING,
+		nullptr)));
+#else
+	ScopedHandle hFile(safe_handle(CreateFileW(fileName,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr)));
+#endif
+
+	if (!hFile)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	// Get the file size
+	LARGE_INTEGER FileSize = { 0 };
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_VISTA)
+	FILE_STANDARD_INFO fileInfo;
+	if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+	FileSize = fileInfo.EndOfFile;
+#else
+	GetFileSizeEx(hFile.get(), &FileSize);
+#endif
+
+	// File is too big for a single 32-bit view, so reject it
+	if (FileSize.HighPart > 0)
+	{
+		return E_FAIL;
+	}
+
+	// Need at least enough data to fill the header and magic number to be a valid DDS
+	if (FileSize.LowPart < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
+	{
+		return E_FAIL;
+	}
+
+	// The view keeps the section alive, so the mapping handle can be closed on return
+	ScopedHandle hMapping(CreateFileMappingW(hFile.get(),
+		nullptr,
+		PAGE_READONLY,
+		0,
+		0,
+		nullptr));
+	if (!hMapping)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	ddsView.reset(MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0));
+	if (!ddsView)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	auto ddsData = static_cast<const uint8_t*>(ddsView.get());
+
+	// DDS files always start with the same magic number ("DDS ")
+	uint32_t dwMagicNumber = *(const uint32_t*)(ddsData);
+	if (dwMagicNumber != DDS_MAGIC)
+	{
+		return E_FAIL;
+	}
+
+	auto hdr = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
+
+	// Verify header to validate DDS file
+	if (hdr->size != sizeof(DDS_HEADER) ||
+		hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
+	{
+		return E_FAIL;
+	}
+
+	// Check for DX10 extension
+	bool bDXT10Header = false;
+	if ((hdr->ddspf.flags & DDS_FOURCC) &&
+		(MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC))
+	{
+		// Must be long enough for both headers and magic value
+		if (FileSize.LowPart < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
+		{
+			return E_FAIL;
+		}
+
+		bDXT10Header = true;
+	}
+
+	// setup the pointers in the process request
+	*header = hdr;
+	ptrdiff_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER)
+		+ (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
+	*bitData = ddsData + offset;
+	*bitSize = FileSize.LowPart - offset;
+
+	return S_OK;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Return the BPP for a particular format
 //--------------------------------------------------------------------------------------
@@ -1308,8 +1438,13 @@ static HRESULT CreateD3DResources12(
 				// Use Heap-allocating UpdateSubresources implementation for variable number of subresources (which is the case for textures).
 				UpdateSubresources(cmdList, texture.Get(), textureUploadHeap.Get(), 0, 0, num2DSubresources, initData);
 
-				cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
-					D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+				// Copy command lists cannot transition to shader states. The texture decays to COMMON
+				// once the copy queue is done and the caller moves it on from there.
+				if (cmdList->GetType() != D3D12_COMMAND_LIST_TYPE_COPY)
+				{
+					cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
+						D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+				}
 			}
 		}
 	} break;
@@ -2160,12 +2295,15 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 		return E_INVALIDARG;
 	}
 
-	DDS_HEADER* header = nullptr;
-	uint8_t* bitData = nullptr;
+	const DDS_HEADER* header = nullptr;
+	const uint8_t* bitData = nullptr;
 	size_t bitSize = 0;
 
-	std::unique_ptr<uint8_t[]> ddsData;
-	HRESULT hr = LoadTextureDataFromFile(szFileName, ddsData, &header, &bitData, &bitSize);
+	// The subresource data handed to UpdateSubresources points into the mapped view, so the
+	// only copy of the texels is the one into the upload heap. Keep the view alive until
+	// CreateTextureFromDDS12 has returned.
+	ScopedMapView ddsView;
+	HRESULT hr = LoadTextureDataFromFileMapped(szFileName, ddsView, &header, &bitData, &bitSize);
 	if (FAILED(hr))
 	{
 		return hr;
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Sorted set of disjoint byte ranges [Begin, End). Overlapping and touching ranges are merged on
+// insertion, so the set is always the minimal list of copies that covers everything added.
+class DirtyRangeSet {
+public:
+	struct Range {
+		uint64_t Begin;
+		uint64_t End;
+	};
+
+public:
+	void Add(uint64_t begin, uint64_t end) {
+		if (begin >= end)
+			return;
+
+		// Writes mostly arrive in increasing order, so try the back first.
+		if (_ranges.empty() || begin > _ranges.back().End) {
+			_ranges.push_back({ begin, end });
+			return;
+		}
+
+		if (begin >= _ranges.back().Begin) {
+			_ranges.back().End = std::max(_ranges.back().End, end);
+			return;
+		}
+
+		// First range that ends at or after begin, then every range that starts before end.
+		auto first = std::lower_bound(_ranges.begin(), _ranges.end(), begin,
+									  [](const Range& range, uint64_t value) { return range.End < value; });
+		auto last = first;
+		while (last != _ranges.end() && last->Begin <= end) {
+			begin = std::min(begin, last->Begin);
+			end = std::max(end, last->End);
+			++last;
+		}
+
+		first = _ranges.erase(first, last);
+		_ranges.insert(first, { begin, end });
+	}
+
+	void Clear() {
+		_ranges.clear();
+	}
+
+	bool Empty() const {
+		return _ranges.empty();
+	}
+
+	const std::vector<Range>& Ranges() const {
+		return _ranges;
+	}
+
+	// Total bytes covered.
+	uint64_t Bytes() const {
+		uint64_t bytes = 0;
+		for (const Range& range : _ranges) {
+			bytes += range.End - range.Begin;
+		}
+		return bytes;
+	}
+
+private:
+	std::vector<Range> _ranges;
+};
@@ -0,0 +1,76 @@
+#include "DrawSorter.h"
+
+namespace {
+uint64_t Field(uint32_t value, uint32_t bits) {
+	return (uint64_t)value & ((1ull << bits) - 1);
+}
+
+uint32_t QuantizeDepth(float depth) {
+	if (!(depth > 0.0f))	// Also catches NaN.
+		return 0;
+	if (depth >= 1.0f)
+		return (1u << DrawSorter::DepthBits) - 1;
+	return (uint32_t)(depth * (float)((1u << DrawSorter::DepthBits) - 1));
+}
+}
+
+uint64_t DrawSorter::OpaqueKey(uint32_t layer, uint32_t pso, uint32_t material, uint32_t geometry, float depth) {
+	uint64_t key = Field(layer, LayerBits);
+	key = (key << PSOBits) | Field(pso, PSOBits);
+	key = (key << MaterialBits) | Field(material, MaterialBits);
+	key = (key << GeometryBits) | Field(geometry, GeometryBits);
+	key = (key << DepthBits) | QuantizeDepth(depth);
+	return key;
+}
+
+uint64_t DrawSorter::BlendedKey(uint32_t layer, uint32_t pso, uint32_t material, uint32_t geometry, float depth) {
+	uint32_t farFirst = ((1u << DepthBits) - 1) - QuantizeDepth(depth);
+
+	uint64_t key = Field(layer, LayerBits);
+	key = (key << PSOBits) | Field(pso, PSOBits);
+	key = (key << DepthBits) | farFirst;
+	key = (key << MaterialBits) | Field(material, MaterialBits);
+	key = (key << GeometryBits) | Field(geometry, GeometryBits);
+	return key;
+}
+
+float DrawSorter::NormalizedDepth(float viewZ, float nearZ, float farZ) {
+	return (viewZ - nearZ) / (farZ - nearZ);
+}
+
+void DrawSorter::Sort() {
+	size_t count = _entries.size();
+	if (count < 2)
+		return;
+
+	_scratch.resize(count);
+
+	// Bits that differ between any two keys; passes over bytes with none of them would only copy.
+	uint64_t differing = 0;
+	for (const Entry& entry : _entries) {
+		differing |= entry.Key ^ _entries[0].Key;
+	}
+
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		if (((differing >> shift) & 0xff) == 0)
+			continue;
+
+		size_t offsets[256] = {};
+		for (const Entry& entry : _entries) {
+			offsets[(entry.Key >> shift) & 0xff]++;
+		}
+
+		size_t total = 0;
+		for (size_t& offset : offsets) {
+			size_t bucketCount = offset;
+			offset = total;
+			total += bucketCount;
+		}
+
+		for (const Entry& entry : _entries) {
+			_scratch[offsets[(entry.Key >> shift) & 0xff]++] = entry;
+		}
+
+		_entries.swap(_scratch);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Orders draws by a 64-bit sort key so items sharing state end up next to each other and the
+// state only has to be set once per run. From the top bit down an opaque key holds
+//
+//   layer (4) | PSO (8) | texture or material (16) | geometry (12) | depth (24, front to back)
+//
+// A blended key moves the depth, inverted so far draws come first, up next to the PSO: blending
+// needs the order more than it needs fewer state changes.
+//
+// Sort() is an LSD radix sort, one pass per key byte, skipping bytes that are the same in every
+// key.
+class DrawSorter {
+public:
+	struct Entry {
+		uint64_t Key;
+		uint32_t Item;		// Caller's index, carried along.
+	};
+
+	static const uint32_t LayerBits = 4;
+	static const uint32_t PSOBits = 8;
+	static const uint32_t MaterialBits = 16;
+	static const uint32_t GeometryBits = 12;
+	static const uint32_t DepthBits = 24;
+
+public:
+	// Fields wider than their bits are truncated. depth is 0 at the near plane and 1 at the far one;
+	// it is clamped to that range.
+	static uint64_t OpaqueKey(uint32_t layer, uint32_t pso, uint32_t material, uint32_t geometry, float depth);
+	static uint64_t BlendedKey(uint32_t layer, uint32_t pso, uint32_t material, uint32_t geometry, float depth);
+
+	// Depth of a view space z between nearZ and farZ, in the 0 to 1 range the keys take.
+	static float NormalizedDepth(float viewZ, float nearZ, float farZ);
+
+	void Clear() {
+		_entries.clear();
+	}
+
+	void Add(uint64_t key, uint32_t item) {
+		_entries.push_back({ key, item });
+	}
+
+	// Stable: entries with equal keys keep the order they were added in.
+	void Sort();
+
+	const std::vector<Entry>& Entries() const {
+		return _entries;
+	}
+
+private:
+	std::vector<Entry> _entries;
+	std::vector<Entry> _scratch;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "BitSet.h"
+
+// Which indexed items (object or material constants) still have to be written to each frame
+// resource. Mark() flags an item in every frame resource's bit set; ForEachDirty() visits and clears
+// the flags of one, so a change is uploaded exactly once to each of the frameCount resources however
+// the frames come around, and items that do not change cost nothing but the scan of empty words.
+class FrameDirtySet {
+public:
+	explicit FrameDirtySet(uint32_t frameCount) : _frames(frameCount) {}
+
+	// Items added by growing start out dirty in every frame resource.
+	void Resize(uint32_t size) {
+		uint32_t oldSize = Size();
+		for (BitSet& frame : _frames) {
+			frame.Resize(size);
+			for (uint32_t i = oldSize; i < size; ++i) {
+				frame.Set(i);
+			}
+		}
+	}
+
+	uint32_t Size() const {
+		return _frames.empty() ? 0 : _frames[0].Size();
+	}
+
+	uint32_t FrameCount() const {
+		return (uint32_t)_frames.size();
+	}
+
+	void Mark(uint32_t index) {
+		for (BitSet& frame : _frames) {
+			frame.Set(index);
+		}
+	}
+
+	void MarkAll() {
+		for (BitSet& frame : _frames) {
+			frame.SetAll();
+		}
+	}
+
+	bool IsDirty(uint32_t frame, uint32_t index) const {
+		return _frames[frame].Test(index);
+	}
+
+	// Calls fn(index) for every item dirty in frame resource frame, in index order, and clears them.
+	template<typename Fn>
+	void ForEachDirty(uint32_t frame, Fn fn) {
+		_frames[frame].ForEachClear(fn);
+	}
+
+private:
+	std::vector<BitSet> _frames;
+};
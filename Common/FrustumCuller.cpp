@@ -0,0 +1,132 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE 1
+#include <xmmintrin.h>
+#else
+#define FRUSTUM_CULLER_SSE 0
+#endif
+
+using namespace DirectX;
+
+// Cull() reads boxes as six packed floats, Center then Extents.
+static_assert(sizeof(BoundingBox) == 6 * sizeof(float), "BoundingBox is expected to be two packed XMFLOAT3s");
+
+void FrustumCuller::SetCamera(FXMMATRIX view, CXMMATRIX proj) {
+	BoundingFrustum viewFrustum;
+	BoundingFrustum::CreateFromMatrix(viewFrustum, proj);
+
+	XMVECTOR determinant = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&determinant, view);
+
+	BoundingFrustum worldFrustum;
+	viewFrustum.Transform(worldFrustum, invView);
+	SetFrustum(worldFrustum);
+}
+
+void FrustumCuller::SetFrustum(const BoundingFrustum& worldFrustum) {
+	XMVECTOR planes[6];
+	worldFrustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+
+	for (int i = 0; i < 6; ++i) {
+		XMStoreFloat4(&_planes[i], planes[i]);
+	}
+}
+
+bool FrustumCuller::IsVisible(const BoundingBox& bounds) const {
+	// Outside a plane when the center is further out than the box's extent along the normal.
+	for (const XMFLOAT4& plane : _planes) {
+		float distance = plane.x * bounds.Center.x + plane.y * bounds.Center.y + plane.z * bounds.Center.z + plane.w;
+		float radius = fabsf(plane.x) * bounds.Extents.x + fabsf(plane.y) * bounds.Extents.y + fabsf(plane.z) * bounds.Extents.z;
+		if (distance > radius)
+			return false;
+	}
+	return true;
+}
+
+uint32_t FrustumCuller::Cull(const BoundingBox* bounds, uint32_t count, std::vector<uint32_t>& visible) const {
+	size_t first = visible.size();
+	uint32_t i = 0;
+
+#if FRUSTUM_CULLER_SSE
+	__m128 normalX[6], normalY[6], normalZ[6], planeD[6];
+	__m128 absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; ++p) {
+		normalX[p] = _mm_set1_ps(_planes[p].x);
+		normalY[p] = _mm_set1_ps(_planes[p].y);
+		normalZ[p] = _mm_set1_ps(_planes[p].z);
+		planeD[p] = _mm_set1_ps(_planes[p].w);
+		absX[p] = _mm_set1_ps(fabsf(_planes[p].x));
+		absY[p] = _mm_set1_ps(fabsf(_planes[p].y));
+		absZ[p] = _mm_set1_ps(fabsf(_planes[p].z));
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		// Four boxes are 24 packed floats; shuffle them into one register per component.
+		const float* f = &bounds[i].Center.x;
+		__m128 v0 = _mm_loadu_ps(f);		// cx0 cy0 cz0 ex0
+		__m128 v1 = _mm_loadu_ps(f + 4);	// ey0 ez0 cx1 cy1
+		__m128 v2 = _mm_loadu_ps(f + 8);	// cz1 ex1 ey1 ez1
+		__m128 v3 = _mm_loadu_ps(f + 12);
+		__m128 v4 = _mm_loadu_ps(f + 16);
+		__m128 v5 = _mm_loadu_ps(f + 20);
+
+		__m128 xy0 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 2, 1, 0));
+		__m128 xy1 = _mm_shuffle_ps(v3, v4, _MM_SHUFFLE(3, 2, 1, 0));
+		__m128 centerX = _mm_shuffle_ps(xy0, xy1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 centerY = _mm_shuffle_ps(xy0, xy1, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m128 zx0 = _mm_shuffle_ps(v0, v2, _MM_SHUFFLE(1, 0, 3, 2));
+		__m128 zx1 = _mm_shuffle_ps(v3, v5, _MM_SHUFFLE(1, 0, 3, 2));
+		__m128 centerZ = _mm_shuffle_ps(zx0, zx1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 extentX = _mm_shuffle_ps(zx0, zx1, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m128 yz0 = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(3, 2, 1, 0));
+		__m128 yz1 = _mm_shuffle_ps(v4, v5, _MM_SHUFFLE(3, 2, 1, 0));
+		__m128 extentY = _mm_shuffle_ps(yz0, yz1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 extentZ = _mm_shuffle_ps(yz0, yz1, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; ++p) {
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(normalX[p], centerX), _mm_mul_ps(normalY[p], centerY)),
+				_mm_add_ps(_mm_mul_ps(normalZ[p], centerZ), planeD[p]));
+			__m128 radius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)),
+				_mm_mul_ps(absZ[p], extentZ));
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(distance, radius));
+		}
+
+		int outsideMask = _mm_movemask_ps(outside);
+		if (outsideMask == 0xf)
+			continue;
+
+		for (uint32_t lane = 0; lane < 4; ++lane) {
+			if ((outsideMask & (1 << lane)) == 0) {
+				visible.push_back(i + lane);
+			}
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		if (IsVisible(bounds[i])) {
+			visible.push_back(i);
+		}
+	}
+
+	return (uint32_t)(visible.size() - first);
+}
+
+void FrustumCuller::TransformBounds(const BoundingBox& local, FXMMATRIX world, BoundingBox& out) {
+	XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+	local.GetCorners(corners);
+
+	for (XMFLOAT3& corner : corners) {
+		XMStoreFloat3(&corner, XMVector3TransformCoord(XMLoadFloat3(&corner), world));
+	}
+
+	BoundingBox::CreateFromPoints(out, BoundingBox::CORNER_COUNT, corners, sizeof(XMFLOAT3));
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <DirectXCollision.h>
+
+#include <cstdint>
+#include <vector>
+
+// Tests world space bounding boxes against the camera frustum. SetCamera() builds the frustum with
+// DirectXCollision, moves it to world space and keeps its six planes; Cull() then tests four boxes
+// at a time against them with SSE, straight from an array of BoundingBox.
+class FrustumCuller {
+public:
+	// view and proj are the camera's (left handed) view and projection matrices.
+	void SetCamera(DirectX::FXMMATRIX view, DirectX::CXMMATRIX proj);
+
+	// Same, from a frustum already in world space.
+	void SetFrustum(const DirectX::BoundingFrustum& worldFrustum);
+
+	// True if any part of bounds may be inside the frustum. Boxes near a frustum corner can pass
+	// without being visible; that only costs a draw.
+	bool IsVisible(const DirectX::BoundingBox& bounds) const;
+
+	// Appends the index of every box that IsVisible() to visible, in order, and returns how many
+	// were appended.
+	uint32_t Cull(const DirectX::BoundingBox* bounds, uint32_t count, std::vector<uint32_t>& visible) const;
+
+	// local transformed by world. Unlike BoundingBox::Transform the corners are divided by w, so
+	// projective world matrices such as planar shadows give the right box.
+	static void TransformBounds(const DirectX::BoundingBox& local, DirectX::FXMMATRIX world, DirectX::BoundingBox& out);
+
+private:
+	// Normals point out of the frustum: a point is inside when dot(normal, point) + d <= 0 for all six.
+	DirectX::XMFLOAT4 _planes[6];
+};
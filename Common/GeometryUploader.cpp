@@ -0,0 +1,137 @@
+#include "GeometryUploader.h"
+
+#include <cassert>
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+// Vertex and index data only need their element alignment; 16 keeps every mesh start
+// friendly for memcpy and any stride the samples use.
+const UINT64 g_MeshAlignment = 16;
+
+UINT64 AlignUp(UINT64 value, UINT64 alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+}
+
+GeometryUploader::GeometryUploader(ID3D12Device* device, GpuHeapAllocator* heaps) :
+	_device(device),
+	_heaps(heaps) {
+}
+
+void GeometryUploader::Add(MeshGeometry* geo) {
+	assert(geo->VertexBufferCPU != nullptr && geo->IndexBufferCPU != nullptr);
+	_pending.push_back(geo);
+}
+
+void GeometryUploader::Flush(ID3D12GraphicsCommandList* cmdList, UINT64 fence) {
+	if (_pending.empty())
+		return;
+
+	// Lay the meshes out back to back: vertices then indices of each.
+	std::vector<UINT64> offsets;
+	offsets.reserve(_pending.size() * 2);
+
+	UINT64 byteSize = 0;
+	for (MeshGeometry* geo : _pending) {
+		byteSize = AlignUp(byteSize, g_MeshAlignment);
+		offsets.push_back(byteSize);
+		byteSize += geo->VertexBufferByteSize;
+
+		byteSize = AlignUp(byteSize, g_MeshAlignment);
+		offsets.push_back(byteSize);
+		byteSize += geo->IndexBufferByteSize;
+	}
+
+	// Reuse the arena when it is big enough and the GPU is done with it; otherwise retire it until
+	// its last copy has executed.
+	if (_arena.Buffer == nullptr || _arena.ByteSize < byteSize || _arena.Fence > _completedFence) {
+		if (_arena.Buffer != nullptr) {
+			_retiredArenas.push_back(_arena);
+		}
+		_arena = CreateArena(byteSize);
+	}
+	_arena.Fence = fence;
+
+	ComPtr<ID3D12Resource> defaultBuffer;
+	if (_heaps != nullptr) {
+		GpuHeapAllocator::Allocation placement;
+		defaultBuffer = _heaps->CreateResource(CD3DX12_RESOURCE_DESC::Buffer(byteSize), D3D12_RESOURCE_STATE_COMMON, nullptr, placement);
+		_placements.push_back(placement);
+	} else {
+		ThrowIfFailed(_device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(defaultBuffer.GetAddressOf())
+		));
+	}
+
+	for (size_t i = 0; i < _pending.size(); ++i) {
+		MeshGeometry* geo = _pending[i];
+		memcpy(_arena.MappedData + offsets[i * 2], geo->VertexBufferCPU->GetBufferPointer(), geo->VertexBufferByteSize);
+		memcpy(_arena.MappedData + offsets[i * 2 + 1], geo->IndexBufferCPU->GetBufferPointer(), geo->IndexBufferByteSize);
+
+		geo->VertexBufferGPU = defaultBuffer;
+		geo->VertexBufferOffset = offsets[i * 2];
+		geo->IndexBufferGPU = defaultBuffer;
+		geo->IndexBufferOffset = offsets[i * 2 + 1];
+	}
+
+	// The buffer is promoted from COMMON to COPY_DEST by the copy, then leaves it with one barrier
+	// for the whole batch. A copy queue cannot make that transition; the buffer decays back to COMMON
+	// after the copy there and is promoted again when first drawn from.
+	cmdList->CopyBufferRegion(defaultBuffer.Get(), 0, _arena.Buffer.Get(), 0, byteSize);
+	if (cmdList->GetType() != D3D12_COMMAND_LIST_TYPE_COPY) {
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+								 D3D12_RESOURCE_STATE_COPY_DEST,
+								 D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER));
+	}
+
+	_stats.Meshes += (UINT)_pending.size();
+	_stats.Batches++;
+	_stats.DefaultBuffers++;
+	for (MeshGeometry* geo : _pending) {
+		_stats.DataBytes += geo->VertexBufferByteSize + geo->IndexBufferByteSize;
+	}
+
+	_pending.clear();
+}
+
+void GeometryUploader::Reclaim(UINT64 completedFence) {
+	_completedFence = completedFence;
+
+	for (size_t i = 0; i < _retiredArenas.size();) {
+		if (_retiredArenas[i].Fence <= completedFence) {
+			_retiredArenas[i].Buffer->Unmap(0, nullptr);
+			_retiredArenas.erase(_retiredArenas.begin() + i);
+		} else {
+			++i;
+		}
+	}
+}
+
+GeometryUploader::Arena GeometryUploader::CreateArena(UINT64 byteSize) {
+	Arena arena;
+	arena.ByteSize = byteSize;
+
+	ThrowIfFailed(_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(arena.Buffer.GetAddressOf())
+	));
+
+	// Write-only from the CPU, see UploadBuffer.
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(arena.Buffer->Map(0, &readRange, reinterpret_cast<void**>(&arena.MappedData)));
+
+	_stats.UploadBuffers++;
+	_stats.StagingBytes = MathHelper::Max(_stats.StagingBytes, byteSize);
+
+	return arena;
+}
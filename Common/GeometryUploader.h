@@ -0,0 +1,67 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include "GpuHeapAllocator.h"
+
+// Uploads static vertex and index buffers in batches. Every mesh added before a Flush() is placed
+// in one default buffer and staged through one upload arena, so a scene costs two resources, one
+// copy and one barrier instead of two resources and two barriers per buffer. The arena is kept and
+// reused by later batches once the GPU has finished reading it.
+class GeometryUploader {
+public:
+	struct Stats {
+		UINT Meshes = 0;
+		UINT Batches = 0;
+		UINT DefaultBuffers = 0;
+		UINT UploadBuffers = 0;
+		UINT64 DataBytes = 0;		// Vertex and index bytes uploaded.
+		UINT64 StagingBytes = 0;	// Size of the largest arena created.
+	};
+
+public:
+	// With heaps, the default buffers are placed in them instead of being committed resources.
+	GeometryUploader(ID3D12Device* device, GpuHeapAllocator* heaps = nullptr);
+	GeometryUploader(const GeometryUploader& rhs) = delete;
+	GeometryUploader& operator=(const GeometryUploader& rhs) = delete;
+
+public:
+	// Queues geo for the next Flush(). VertexBufferCPU, IndexBufferCPU and their byte sizes must be
+	// filled in; VertexBufferGPU / IndexBufferGPU and their offsets are set by Flush().
+	void Add(MeshGeometry* geo);
+
+	// Records the copy of everything queued into cmdList. fence is the value the caller signals after
+	// executing cmdList; the arena is not reused before it completes.
+	void Flush(ID3D12GraphicsCommandList* cmdList, UINT64 fence);
+
+	// Releases arenas replaced by a bigger one once their fence has completed.
+	void Reclaim(UINT64 completedFence);
+
+	const Stats& GetStats() const {
+		return _stats;
+	}
+
+private:
+	struct Arena {
+		Microsoft::WRL::ComPtr<ID3D12Resource> Buffer;
+		BYTE* MappedData = nullptr;
+		UINT64 ByteSize = 0;
+		UINT64 Fence = 0;
+	};
+
+	Arena CreateArena(UINT64 byteSize);
+
+private:
+	ID3D12Device* _device;
+	GpuHeapAllocator* _heaps;
+
+	std::vector<MeshGeometry*> _pending;
+
+	Arena _arena;
+	std::vector<Arena> _retiredArenas;
+	UINT64 _completedFence = 0;
+
+	// Static geometry stays for the lifetime of the uploader.
+	std::vector<GpuHeapAllocator::Allocation> _placements;
+
+	Stats _stats;
+};
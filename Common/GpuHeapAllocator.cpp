@@ -0,0 +1,141 @@
+#include "GpuHeapAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+GpuHeapAllocator::GpuHeapAllocator(ID3D12Device* device, UINT64 heapByteSize) :
+	_device(device),
+	_heapByteSize(heapByteSize) {
+}
+
+ComPtr<ID3D12Resource> GpuHeapAllocator::CreateResource(const D3D12_RESOURCE_DESC& desc,
+														D3D12_RESOURCE_STATES initialState,
+														const D3D12_CLEAR_VALUE* clearValue,
+														Allocation& allocation) {
+	HeapKind kind = HeapKind::Textures;
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+		kind = HeapKind::Buffers;
+	} else if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) {
+		kind = HeapKind::RenderTargets;
+	}
+
+	// Small textures may be placed at 4 KB instead of 64 KB. The runtime says whether this one
+	// qualifies by returning the alignment asked for.
+	D3D12_RESOURCE_DESC placedDesc = desc;
+	D3D12_RESOURCE_ALLOCATION_INFO info = {};
+	if (kind == HeapKind::Textures && desc.SampleDesc.Count == 1) {
+		placedDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		info = _device->GetResourceAllocationInfo(0, 1, &placedDesc);
+	}
+	if (info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
+		placedDesc.Alignment = 0;
+		info = _device->GetResourceAllocationInfo(0, 1, &placedDesc);
+	}
+
+	if (info.SizeInBytes == UINT64_MAX)
+		ThrowIfFailed(E_INVALIDARG);
+
+	allocation = Allocation();
+	for (UINT i = 0; i < (UINT)_heaps.size(); ++i) {
+		Heap* heap = _heaps[i].get();
+		if (heap != nullptr && heap->Kind == kind && !heap->Dedicated &&
+			heap->Allocator.Allocate(info.SizeInBytes, info.Alignment, allocation.Range)) {
+			allocation.Heap = i;
+			break;
+		}
+	}
+
+	if (!allocation.IsValid()) {
+		bool dedicated = info.SizeInBytes > _heapByteSize;
+		UINT64 heapByteSize = dedicated ? info.SizeInBytes : _heapByteSize;
+
+		allocation.Heap = CreateHeap(kind, heapByteSize, info.Alignment, dedicated);
+		_heaps[allocation.Heap]->Allocator.Allocate(info.SizeInBytes, info.Alignment, allocation.Range);
+	}
+
+	ComPtr<ID3D12Resource> resource;
+	HRESULT hr = _device->CreatePlacedResource(
+		_heaps[allocation.Heap]->Resource.Get(),
+		allocation.Range.Offset,
+		&placedDesc,
+		initialState,
+		clearValue,
+		IID_PPV_ARGS(resource.GetAddressOf()));
+
+	if (FAILED(hr)) {
+		Free(allocation);
+		ThrowIfFailed(hr);
+	}
+
+	return resource;
+}
+
+void GpuHeapAllocator::Free(Allocation& allocation) {
+	if (!allocation.IsValid())
+		return;
+
+	Heap* heap = _heaps[allocation.Heap].get();
+	heap->Allocator.Free(allocation.Range);
+
+	if (heap->Dedicated && heap->Allocator.Empty()) {
+		_heaps[allocation.Heap] = nullptr;
+	}
+
+	allocation = Allocation();
+}
+
+UINT GpuHeapAllocator::HeapCount() const {
+	UINT count = 0;
+	for (const auto& heap : _heaps) {
+		if (heap != nullptr) {
+			count++;
+		}
+	}
+	return count;
+}
+
+TlsfAllocator::Stats GpuHeapAllocator::GetStats() const {
+	TlsfAllocator::Stats stats;
+	for (const auto& heap : _heaps) {
+		if (heap == nullptr)
+			continue;
+
+		TlsfAllocator::Stats heapStats = heap->Allocator.GetStats();
+		stats.Capacity += heapStats.Capacity;
+		stats.UsedBytes += heapStats.UsedBytes;
+		stats.FreeBytes += heapStats.FreeBytes;
+		stats.LargestFreeBlock = MathHelper::Max(stats.LargestFreeBlock, heapStats.LargestFreeBlock);
+		stats.Allocations += heapStats.Allocations;
+		stats.FreeBlocks += heapStats.FreeBlocks;
+	}
+	return stats;
+}
+
+UINT GpuHeapAllocator::CreateHeap(HeapKind kind, UINT64 byteSize, UINT64 alignment, bool dedicated) {
+	D3D12_HEAP_FLAGS flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	if (kind == HeapKind::Buffers) {
+		flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	} else if (kind == HeapKind::RenderTargets) {
+		flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+	}
+
+	// Heaps that may hold MSAA targets need the larger alignment; everything else takes 64 KB.
+	UINT64 heapAlignment = alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT ?
+		D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+	auto heap = std::make_unique<Heap>(byteSize);
+	heap->Kind = kind;
+	heap->Dedicated = dedicated;
+
+	CD3DX12_HEAP_DESC heapDesc(byteSize, D3D12_HEAP_TYPE_DEFAULT, heapAlignment, flags);
+	ThrowIfFailed(_device->CreateHeap(&heapDesc, IID_PPV_ARGS(heap->Resource.GetAddressOf())));
+
+	for (UINT i = 0; i < (UINT)_heaps.size(); ++i) {
+		if (_heaps[i] == nullptr) {
+			_heaps[i] = std::move(heap);
+			return i;
+		}
+	}
+
+	_heaps.push_back(std::move(heap));
+	return (UINT)_heaps.size() - 1;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include "TlsfAllocator.h"
+
+// Places default-heap resources in a few large ID3D12Heaps instead of giving each one an implicit
+// heap of its own. Each heap is carved up by a TlsfAllocator. Buffers, textures and render targets
+// get separate heaps so it also works on resource heap tier 1 hardware.
+//
+// Free() hands the memory back at once: the caller releases the resource and frees its allocation
+// only after the GPU has finished with it.
+class GpuHeapAllocator {
+public:
+	struct Allocation {
+		UINT Heap = UINT_MAX;
+		TlsfAllocator::Allocation Range;
+
+		bool IsValid() const {
+			return Heap != UINT_MAX;
+		}
+	};
+
+public:
+	GpuHeapAllocator(ID3D12Device* device, UINT64 heapByteSize = 64 * 1024 * 1024);
+	GpuHeapAllocator(const GpuHeapAllocator& rhs) = delete;
+	GpuHeapAllocator& operator=(const GpuHeapAllocator& rhs) = delete;
+
+public:
+	// Same arguments as CreateCommittedResource on a default heap. Resources bigger than a heap get
+	// a heap of their own, released again when they are freed.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateResource(const D3D12_RESOURCE_DESC& desc,
+														  D3D12_RESOURCE_STATES initialState,
+														  const D3D12_CLEAR_VALUE* clearValue,
+														  Allocation& allocation);
+
+	// Resets allocation. Does nothing for an invalid one.
+	void Free(Allocation& allocation);
+
+	UINT HeapCount() const;
+
+	// Summed over every heap; LargestFreeBlock is the largest in any single heap.
+	TlsfAllocator::Stats GetStats() const;
+
+private:
+	enum class HeapKind {
+		Buffers,
+		Textures,
+		RenderTargets,
+	};
+
+	struct Heap {
+		Microsoft::WRL::ComPtr<ID3D12Heap> Resource;
+		HeapKind Kind;
+		bool Dedicated;
+		TlsfAllocator Allocator;
+
+		Heap(UINT64 byteSize) : Allocator(byteSize) {
+		}
+	};
+
+	UINT CreateHeap(HeapKind kind, UINT64 byteSize, UINT64 alignment, bool dedicated);
+
+private:
+	ID3D12Device* _device;
+	UINT64 _heapByteSize;
+
+	// Indices are kept stable; a released dedicated heap leaves a null slot for the next one.
+	std::vector<std::unique_ptr<Heap>> _heaps;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Incremental 64-bit FNV-1a hash, for keying caches on the contents of descriptions and byte code.
+//
+// Hash structs field by field rather than as one block: padding bytes between fields are not
+// guaranteed to be initialised, so two equal descriptions could otherwise hash differently.
+class HashBuilder {
+public:
+	HashBuilder& Add(const void* data, size_t byteSize) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < byteSize; ++i) {
+			_hash ^= bytes[i];
+			_hash *= FNVPrime;
+		}
+		return *this;
+	}
+
+	template<typename T>
+	HashBuilder& Add(const T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "only plain values can be hashed by their bytes");
+		return Add(&value, sizeof(T));
+	}
+
+	// The terminator is hashed too, so "ab" + "c" differs from "a" + "bc". A null string hashes
+	// differently from an empty one.
+	HashBuilder& AddString(const char* str) {
+		if (str == nullptr)
+			return Add<uint8_t>(0xff);
+		return Add(str, strlen(str) + 1);
+	}
+
+	uint64_t Value() const {
+		return _hash;
+	}
+
+private:
+	static const uint64_t FNVOffsetBasis = 14695981039346656037ull;
+	static const uint64_t FNVPrime = 1099511628211ull;
+
+	uint64_t _hash = FNVOffsetBasis;
+};
@@ -0,0 +1,12 @@
+#include "IndirectArgumentBuilder.h"
+
+void IndirectArgumentBuilder::Add(uint64_t stateKey, uint32_t item, const Command& command) {
+	if (_split || stateKey != _runKey) {
+		_runs.push_back({ (uint32_t)_commands.size(), 0, item });
+		_runKey = stateKey;
+		_split = false;
+	}
+
+	_runs.back().CommandCount++;
+	_commands.push_back(command);
+}
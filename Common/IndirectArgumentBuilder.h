@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lays out the argument buffer ExecuteIndirect reads for a list of draws, for a command signature of
+// a root CBV for the object constants, one for the material constants and an indexed draw, in that
+// order. The signature cannot change vertex buffers, topology or descriptor tables, so consecutive
+// draws sharing those (the caller's state key) form a run, recorded as one ExecuteIndirect.
+//
+// Command mirrors the D3D12 argument layout; the offsets below are what the command signature has
+// to match.
+class IndirectArgumentBuilder {
+public:
+	struct Command {
+		uint64_t ObjectCB;
+		uint64_t MaterialCB;
+
+		// D3D12_DRAW_INDEXED_ARGUMENTS
+		uint32_t IndexCountPerInstance;
+		uint32_t InstanceCount;
+		uint32_t StartIndexLocation;
+		int32_t BaseVertexLocation;
+		uint32_t StartInstanceLocation;
+
+		uint32_t Padding;	// Keeps the next command's addresses 8-byte aligned.
+	};
+
+	static const uint32_t ObjectCBOffset = 0;
+	static const uint32_t MaterialCBOffset = 8;
+	static const uint32_t DrawArgumentsOffset = 16;
+	static const uint32_t DrawArgumentsSize = 20;
+	static const uint32_t CommandStride = 40;
+
+	struct Run {
+		uint32_t FirstCommand;
+		uint32_t CommandCount;
+		uint32_t Item;		// Caller's index of the run's first draw, which has the state of the run.
+	};
+
+public:
+	void Clear() {
+		_commands.clear();
+		_runs.clear();
+		_split = true;
+	}
+
+	// Appends a draw, to the current run if stateKey matches it and Split() was not called since.
+	void Add(uint64_t stateKey, uint32_t item, const Command& command);
+
+	// Makes the next Add() start a new run, for draws that are recorded separately (another pass
+	// or command list) even when their state matches.
+	void Split() {
+		_split = true;
+	}
+
+	const std::vector<Command>& Commands() const {
+		return _commands;
+	}
+
+	const std::vector<Run>& Runs() const {
+		return _runs;
+	}
+
+private:
+	std::vector<Command> _commands;
+	std::vector<Run> _runs;
+	uint64_t _runKey = 0;
+	bool _split = true;
+};
+
+static_assert(offsetof(IndirectArgumentBuilder::Command, ObjectCB) == IndirectArgumentBuilder::ObjectCBOffset, "object CBV argument misplaced");
+static_assert(offsetof(IndirectArgumentBuilder::Command, MaterialCB) == IndirectArgumentBuilder::MaterialCBOffset, "material CBV argument misplaced");
+static_assert(offsetof(IndirectArgumentBuilder::Command, IndexCountPerInstance) == IndirectArgumentBuilder::DrawArgumentsOffset, "draw arguments misplaced");
+static_assert(offsetof(IndirectArgumentBuilder::Command, Padding) == IndirectArgumentBuilder::DrawArgumentsOffset + IndirectArgumentBuilder::DrawArgumentsSize, "draw arguments have the wrong size");
+static_assert(sizeof(IndirectArgumentBuilder::Command) == IndirectArgumentBuilder::CommandStride, "command stride changed");
@@ -0,0 +1,42 @@
+#include "InstanceBatcher.h"
+#include "HashBuilder.h"
+
+size_t InstanceBatcher::KeyHash::operator()(const Key& key) const {
+	HashBuilder hash;
+	hash.Add(key.Geometry).Add(key.Submesh).Add(key.Material).Add(key.PSO);
+	return (size_t)hash.Value();
+}
+
+void InstanceBatcher::Build() {
+	_batches.clear();
+	_batchOfKey.clear();
+	_batchOfItem.resize(_pending.size());
+
+	// First pass: which batch each item goes to, and how many items each batch gets.
+	for (size_t i = 0; i < _pending.size(); ++i) {
+		auto found = _batchOfKey.emplace(_pending[i].first, (uint32_t)_batches.size());
+		if (found.second) {
+			_batches.push_back({ 0, 0 });
+		}
+
+		uint32_t batch = found.first->second;
+		_batchOfItem[i] = batch;
+		_batches[batch].InstanceCount++;
+	}
+
+	uint32_t total = 0;
+	for (Batch& batch : _batches) {
+		batch.FirstInstance = total;
+		total += batch.InstanceCount;
+	}
+
+	// Second pass: place the items, using InstanceCount as the fill cursor and putting it back after.
+	_instances.resize(_pending.size());
+	for (Batch& batch : _batches) {
+		batch.InstanceCount = 0;
+	}
+	for (size_t i = 0; i < _pending.size(); ++i) {
+		Batch& batch = _batches[_batchOfItem[i]];
+		_instances[batch.FirstInstance + batch.InstanceCount++] = _pending[i].second;
+	}
+}
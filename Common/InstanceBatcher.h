@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Groups draws that only differ in their per-instance data (world and texture transforms) so each
+// group can be recorded as one instanced draw. Items with the same geometry, submesh, material and
+// PSO go into the same batch.
+//
+// Batches come out in the order their first item was added, and the items of a batch in the order
+// they were added, so Instances() is the order to lay the per-instance data out in. The key fields
+// are whatever the caller identifies those things by.
+class InstanceBatcher {
+public:
+	struct Key {
+		const void* Geometry;
+		uint32_t Submesh;
+		uint32_t Material;
+		uint32_t PSO;
+
+		bool operator==(const Key& rhs) const {
+			return Geometry == rhs.Geometry && Submesh == rhs.Submesh && Material == rhs.Material && PSO == rhs.PSO;
+		}
+	};
+
+	struct Batch {
+		uint32_t FirstInstance;		// Into Instances().
+		uint32_t InstanceCount;
+	};
+
+public:
+	void Clear() {
+		_pending.clear();
+		_batches.clear();
+		_instances.clear();
+	}
+
+	void Add(const Key& key, uint32_t item) {
+		_pending.push_back({ key, item });
+	}
+
+	// Groups everything added since Clear().
+	void Build();
+
+	const std::vector<Batch>& Batches() const {
+		return _batches;
+	}
+
+	// The caller's item indices, batch by batch.
+	const std::vector<uint32_t>& Instances() const {
+		return _instances;
+	}
+
+private:
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	std::vector<std::pair<Key, uint32_t>> _pending;
+	std::vector<Batch> _batches;
+	std::vector<uint32_t> _instances;
+
+	std::unordered_map<Key, uint32_t, KeyHash> _batchOfKey;
+	std::vector<uint32_t> _batchOfItem;
+};
@@ -0,0 +1,159 @@
+#include "JobGraph.h"
+
+#include <cassert>
+
+JobGraph::JobGraph(uint32_t threadCount) : _threadCount(threadCount) {
+	if (_threadCount == 0) {
+		_threadCount = std::thread::hardware_concurrency();
+	}
+	if (_threadCount == 0) {
+		_threadCount = 1;
+	}
+
+	// The thread calling Run() is worker 0.
+	for (uint32_t thread = 1; thread < _threadCount; ++thread) {
+		_workers.emplace_back(&JobGraph::WorkerThread, this, thread);
+	}
+}
+
+JobGraph::~JobGraph() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_wake.notify_all();
+
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+}
+
+void JobGraph::Clear() {
+	_jobs.clear();
+	_timings.clear();
+}
+
+JobGraph::JobId JobGraph::Add(const std::string& name, std::function<void()> work, const std::vector<JobId>& dependencies) {
+	JobId id = (JobId)_jobs.size();
+
+	Job job;
+	job.Work = std::move(work);
+	for (JobId dependency : dependencies) {
+		assert(dependency < id);
+		_jobs[dependency].Dependents.push_back(id);
+		job.DependencyCount++;
+	}
+	_jobs.push_back(std::move(job));
+
+	Timing timing;
+	timing.Name = name;
+	_timings.push_back(timing);
+
+	return id;
+}
+
+void JobGraph::Run() {
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	_ready.clear();
+	_pendingDependencies.resize(_jobs.size());
+	_finished = 0;
+	_error = nullptr;
+
+	for (JobId id = 0; id < (JobId)_jobs.size(); ++id) {
+		_pendingDependencies[id] = _jobs[id].DependencyCount;
+		if (_pendingDependencies[id] == 0) {
+			_ready.push_back(id);
+		}
+	}
+
+	_runStart = std::chrono::steady_clock::now();
+
+	// An empty graph has nothing to hand out, so the workers can sleep through it.
+	if (!_jobs.empty()) {
+		_run++;
+		_workersFinished = 0;
+		_wake.notify_all();
+
+		RunJobs(lock, 0);
+
+		_workersDone.wait(lock, [this]() {
+			return _workersFinished == (uint32_t)_workers.size();
+		});
+	}
+
+	_seconds = SecondsSinceRun();
+
+	if (_error != nullptr) {
+		std::rethrow_exception(_error);
+	}
+}
+
+double JobGraph::SecondsSinceRun() const {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - _runStart).count();
+}
+
+void JobGraph::WorkerThread(uint32_t thread) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	uint64_t lastRun = 0;
+
+	for (;;) {
+		_wake.wait(lock, [this, lastRun]() {
+			return _quit || _run != lastRun;
+		});
+		if (_quit)
+			return;
+
+		lastRun = _run;
+		RunJobs(lock, thread);
+
+		if (++_workersFinished == (uint32_t)_workers.size()) {
+			_workersDone.notify_one();
+		}
+	}
+}
+
+void JobGraph::RunJobs(std::unique_lock<std::mutex>& lock, uint32_t thread) {
+	while (_finished < (uint32_t)_jobs.size()) {
+		if (_ready.empty()) {
+			_wake.wait(lock);
+			continue;
+		}
+
+		JobId id = _ready.front();
+		_ready.pop_front();
+		bool skip = _error != nullptr;
+
+		lock.unlock();
+
+		Timing& timing = _timings[id];
+		timing.Thread = thread;
+		timing.Start = SecondsSinceRun();
+
+		std::exception_ptr error;
+		if (!skip) {
+			try {
+				_jobs[id].Work();
+			} catch (...) {
+				error = std::current_exception();
+			}
+		}
+
+		timing.End = SecondsSinceRun();
+
+		lock.lock();
+
+		if (error != nullptr && _error == nullptr) {
+			_error = error;
+		}
+
+		for (JobId dependent : _jobs[id].Dependents) {
+			if (--_pendingDependencies[dependent] == 0) {
+				_ready.push_back(dependent);
+			}
+		}
+
+		_finished++;
+		_wake.notify_all();
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs a set of jobs on worker threads, each job starting as soon as the jobs it depends on have
+// finished. Dependencies can only name jobs added earlier, so the graph can never have a cycle.
+//
+// The worker threads are started once, in the constructor, and sleep between runs, so one graph can
+// be cleared, refilled and run every frame without creating threads. Run() must not be called from
+// inside a job.
+class JobGraph {
+public:
+	typedef uint32_t JobId;
+
+	struct Timing {
+		std::string Name;
+		double Start = 0.0;		// Seconds since Run() was called.
+		double End = 0.0;
+		uint32_t Thread = 0;	// Worker index.
+	};
+
+public:
+	// 0 threads uses one per hardware thread.
+	JobGraph(uint32_t threadCount = 0);
+	JobGraph(const JobGraph& rhs) = delete;
+	JobGraph& operator=(const JobGraph& rhs) = delete;
+	~JobGraph();
+
+public:
+	// Removes every job, keeping the worker threads, so the graph can be filled again.
+	void Clear();
+
+	JobId Add(const std::string& name, std::function<void()> work, const std::vector<JobId>& dependencies = {});
+
+	// Runs every job and returns once all are done. If a job throws, jobs not yet started are
+	// skipped and the first exception is rethrown here.
+	void Run();
+
+	// One entry per job, in the order they were added. Valid after Run().
+	const std::vector<Timing>& Timings() const {
+		return _timings;
+	}
+
+	// Wall clock time of the last Run().
+	double Seconds() const {
+		return _seconds;
+	}
+
+	uint32_t ThreadCount() const {
+		return _threadCount;
+	}
+
+private:
+	struct Job {
+		std::function<void()> Work;
+		std::vector<JobId> Dependents;
+		uint32_t DependencyCount = 0;
+	};
+
+	void WorkerThread(uint32_t thread);
+	void RunJobs(std::unique_lock<std::mutex>& lock, uint32_t thread);
+	double SecondsSinceRun() const;
+
+private:
+	uint32_t _threadCount;
+	std::vector<std::thread> _workers;
+
+	std::vector<Job> _jobs;
+	std::vector<Timing> _timings;
+	double _seconds = 0.0;
+	std::chrono::steady_clock::time_point _runStart;
+
+	// Shared with the workers. Each Run() bumps _run, and returns once every worker has finished
+	// with it, so nothing touches the jobs between runs.
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _workersDone;
+	uint64_t _run = 0;
+	uint32_t _workersFinished = 0;
+	bool _quit = false;
+	std::deque<JobId> _ready;
+	std::vector<uint32_t> _pendingDependencies;
+	uint32_t _finished = 0;
+	std::exception_ptr _error;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Named values in a dense array. Names are looked up once, while a scene or its pipelines are
+// built, and the Handle that comes back indexes the array directly, so per-frame code never hashes
+// a string. Find() and Get() by name stay available for build code, tools and debug output.
+//
+// Values are never removed, so a handle stays valid for the registry's lifetime. Add() may grow the
+// array, so references into it only last until the next Add(); T is typically a unique_ptr or a
+// ComPtr when the object itself has to stay put.
+template<typename T>
+class NameRegistry {
+public:
+	struct Handle {
+		uint32_t Index = InvalidIndex;
+
+		bool IsValid() const {
+			return Index != InvalidIndex;
+		}
+	};
+
+	static const uint32_t InvalidIndex = UINT32_MAX;
+
+public:
+	// Stores value under name, replacing the value already there if name is taken.
+	template<typename V>
+	Handle Add(const std::string& name, V&& value) {
+		auto it = _indices.find(name);
+		if (it != _indices.end()) {
+			_values[it->second] = std::forward<V>(value);
+			return { it->second };
+		}
+
+		uint32_t index = (uint32_t)_values.size();
+		_values.push_back(std::forward<V>(value));
+		_names.push_back(name);
+		_indices.emplace(name, index);
+		return { index };
+	}
+
+	// An invalid handle if there is no value named name.
+	Handle Find(const std::string& name) const {
+		auto it = _indices.find(name);
+		if (it == _indices.end())
+			return {};
+		return { it->second };
+	}
+
+	// Throws std::out_of_range if there is no value named name, as std::map::at does.
+	T& Get(const std::string& name) {
+		return _values[Checked(name).Index];
+	}
+
+	const T& Get(const std::string& name) const {
+		return _values[Checked(name).Index];
+	}
+
+	T& operator[](Handle handle) {
+		return _values[handle.Index];
+	}
+
+	const T& operator[](Handle handle) const {
+		return _values[handle.Index];
+	}
+
+	const std::string& Name(Handle handle) const {
+		return _names[handle.Index];
+	}
+
+	uint32_t Count() const {
+		return (uint32_t)_values.size();
+	}
+
+	// The values in the order they were added, which is also handle order.
+	typename std::vector<T>::iterator begin() {
+		return _values.begin();
+	}
+
+	typename std::vector<T>::iterator end() {
+		return _values.end();
+	}
+
+	typename std::vector<T>::const_iterator begin() const {
+		return _values.begin();
+	}
+
+	typename std::vector<T>::const_iterator end() const {
+		return _values.end();
+	}
+
+private:
+	Handle Checked(const std::string& name) const {
+		Handle handle = Find(name);
+		if (!handle.IsValid())
+			throw std::out_of_range("NameRegistry: no value named '" + name + "'");
+		return handle;
+	}
+
+private:
+	std::vector<T> _values;
+	std::vector<std::string> _names;
+	std::unordered_map<std::string, uint32_t> _indices;
+};
@@ -0,0 +1,65 @@
+#include "ObjectConstantBuilder.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OBJECT_CONSTANTS_SSE 1
+#include <xmmintrin.h>
+#else
+#define OBJECT_CONSTANTS_SSE 0
+#endif
+
+namespace {
+#if OBJECT_CONSTANTS_SSE
+void TransposeStream(const DirectX::XMFLOAT4X4& m, float* dst) {
+	__m128 r0 = _mm_loadu_ps(m.m[0]);
+	__m128 r1 = _mm_loadu_ps(m.m[1]);
+	__m128 r2 = _mm_loadu_ps(m.m[2]);
+	__m128 r3 = _mm_loadu_ps(m.m[3]);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_stream_ps(dst, r0);
+	_mm_stream_ps(dst + 4, r1);
+	_mm_stream_ps(dst + 8, r2);
+	_mm_stream_ps(dst + 12, r3);
+}
+#else
+void TransposeStream(const DirectX::XMFLOAT4X4& m, float* dst) {
+	float t[16];
+	for (int row = 0; row < 4; ++row) {
+		for (int col = 0; col < 4; ++col) {
+			t[col * 4 + row] = m.m[row][col];
+		}
+	}
+	memcpy(dst, t, sizeof(t));
+}
+#endif
+
+void BuildOne(uint32_t index, const DirectX::XMFLOAT4X4* world, const DirectX::XMFLOAT4X4* texTransform,
+			  uint8_t* dst, uint32_t dstStride) {
+	float* out = reinterpret_cast<float*>(dst + (size_t)index * dstStride);
+	TransposeStream(world[index], out);
+	TransposeStream(texTransform[index], out + 16);
+}
+}
+
+void ObjectConstantBuilder::Build(const uint32_t* indices, uint32_t count, const DirectX::XMFLOAT4X4* world,
+								  const DirectX::XMFLOAT4X4* texTransform, uint8_t* dst, uint32_t dstStride) {
+	assert(((uintptr_t)dst & 15) == 0 && (dstStride & 15) == 0);
+
+	// Four items per iteration, so the loads of one item overlap the shuffles and stores of the others.
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		BuildOne(indices[i], world, texTransform, dst, dstStride);
+		BuildOne(indices[i + 1], world, texTransform, dst, dstStride);
+		BuildOne(indices[i + 2], world, texTransform, dst, dstStride);
+		BuildOne(indices[i + 3], world, texTransform, dst, dstStride);
+	}
+	for (; i < count; ++i) {
+		BuildOne(indices[i], world, texTransform, dst, dstStride);
+	}
+
+#if OBJECT_CONSTANTS_SSE
+	_mm_sfence();
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+
+// Writes per-object constants, a world and a texture transform transposed for HLSL's column major
+// packing, straight into a mapped constant buffer. Items go through four at a time, each matrix
+// transposed in SSE registers and written back with non-temporal stores, so the constants never
+// pass through the cache on their way to write-combined memory.
+//
+// Build() only touches the slots of the items it is given, so disjoint blocks of items can be
+// built on separate threads.
+class ObjectConstantBuilder {
+public:
+	// Bytes written per item: the two matrices, world first.
+	static const uint32_t ConstantsSize = 2 * sizeof(DirectX::XMFLOAT4X4);
+
+	// Items per job when building in parallel: large enough that a job outweighs its scheduling,
+	// small enough to keep every worker busy at a few thousand items.
+	static const uint32_t BlockSize = 1024;
+
+public:
+	// For each index i in indices[0, count), writes world[i] and texTransform[i] transposed to
+	// dst + i * dstStride. dst and dstStride must be multiples of 16, and should be multiples of 64
+	// (as constant buffers are): a streamed matrix that straddles two cache lines is many times
+	// slower to write. Ends with a store fence, so the writes are complete once it returns on
+	// whichever thread ran it.
+	static void Build(const uint32_t* indices, uint32_t count, const DirectX::XMFLOAT4X4* world,
+					  const DirectX::XMFLOAT4X4* texTransform, uint8_t* dst, uint32_t dstStride);
+};
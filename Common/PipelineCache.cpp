@@ -0,0 +1,153 @@
+#include "PipelineCache.h"
+#include "PipelineDescHash.h"
+
+#include <cstdio>
+#include <iterator>
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+double SecondsSince(__int64 startTime) {
+	__int64 countsPerSec, endTime;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	QueryPerformanceCounter((LARGE_INTEGER*)&endTime);
+	return (double)(endTime - startTime) / countsPerSec;
+}
+}
+
+PipelineCache::PipelineCache(ID3D12Device* device, const std::wstring& filename) :
+	_device(device),
+	_filename(filename) {
+	// Pipeline libraries need ID3D12Device1; without it every PSO is simply compiled.
+	if (FAILED(_device->QueryInterface(IID_PPV_ARGS(_device1.GetAddressOf()))))
+		return;
+
+	std::ifstream fin(_filename, std::ios::binary);
+	if (fin) {
+		_libraryBlob.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	if (!_libraryBlob.empty()) {
+		// Fails with D3D12_ERROR_DRIVER_VERSION_MISMATCH or D3D12_ERROR_ADAPTER_NOT_FOUND when the
+		// library came from another driver or GPU, and E_INVALIDARG when the file is damaged.
+		HRESULT hr = _device1->CreatePipelineLibrary(_libraryBlob.data(), _libraryBlob.size(),
+													 IID_PPV_ARGS(_library.GetAddressOf()));
+		if (SUCCEEDED(hr))
+			return;
+
+		char message[256];
+		sprintf_s(message, "PipelineCache: discarding library (0x%08X)\n", (UINT)hr);
+		OutputDebugStringA(message);
+		_libraryBlob.clear();
+	}
+
+	CreateEmptyLibrary();
+}
+
+ComPtr<ID3D12PipelineState> PipelineCache::CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) {
+	__int64 startTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+
+	wchar_t name[32];
+	swprintf_s(name, L"%016llx", PipelineDescHash::Hash(desc));
+
+	ComPtr<ID3D12PipelineState> pso;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_library != nullptr) {
+			// E_INVALIDARG covers both "not stored" and "stored with a different root signature".
+			HRESULT hr = _library->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(pso.GetAddressOf()));
+			if (SUCCEEDED(hr)) {
+				_created.emplace_back(name, pso);
+				_stats.Loaded++;
+				_stats.LoadSeconds += SecondsSince(startTime);
+				return pso;
+			}
+		}
+	}
+
+	ThrowIfFailed(_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pso.GetAddressOf())));
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_library != nullptr) {
+		// A name already in the library means its entry no longer matches this description.
+		if (SUCCEEDED(_library->StorePipeline(name, pso.Get()))) {
+			_dirty = true;
+		} else {
+			_stale = true;
+		}
+	}
+	_created.emplace_back(name, pso);
+	_stats.Compiled++;
+	_stats.CompileSeconds += SecondsSince(startTime);
+
+	return pso;
+}
+
+void PipelineCache::Save() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_library == nullptr)
+		return;
+
+	if (_stale) {
+		// PSOs loaded from the old library may still depend on it and its blob, so both are kept.
+		_staleLibrary = _library;
+		CreateEmptyLibrary();
+		if (_library == nullptr)
+			return;
+
+		for (const auto& entry : _created) {
+			_library->StorePipeline(entry.first.c_str(), entry.second.Get());
+		}
+		_stale = false;
+		_dirty = true;
+	}
+
+	if (!_dirty)
+		return;
+
+	std::vector<char> blob(_library->GetSerializedSize());
+	if (blob.empty() || FAILED(_library->Serialize(blob.data(), blob.size())))
+		return;
+
+	// Write then rename, like the shader cache, so an interrupted run never leaves a truncated file.
+	size_t slash = _filename.find_last_of(L"/\\");
+	if (slash != std::wstring::npos) {
+		CreateDirectory(_filename.substr(0, slash).c_str(), nullptr);
+	}
+
+	std::wstring tempPath = _filename + L".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary);
+		fout.write(blob.data(), blob.size());
+		if (!fout)
+			return;
+	}
+	if (MoveFileEx(tempPath.c_str(), _filename.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		_dirty = false;
+	}
+}
+
+PipelineCache::Stats PipelineCache::GetStats() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stats;
+}
+
+void PipelineCache::LogStats() const {
+	Stats stats = GetStats();
+
+	char message[256];
+	sprintf_s(message, "PipelineCache: %u PSOs loaded in %.1f ms, %u compiled in %.1f ms\n",
+			  stats.Loaded, stats.LoadSeconds * 1000.0, stats.Compiled, stats.CompileSeconds * 1000.0);
+	OutputDebugStringA(message);
+}
+
+void PipelineCache::CreateEmptyLibrary() {
+	_library = nullptr;
+
+	// DXGI_ERROR_UNSUPPORTED when the driver has no pipeline library support; PSOs are then
+	// always compiled.
+	if (FAILED(_device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(_library.GetAddressOf())))) {
+		_library = nullptr;
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "D3DUtil.h"
+
+#include <mutex>
+
+// Creates graphics PSOs through an ID3D12PipelineLibrary kept on disk, so a warm start loads the
+// driver's compiled pipelines instead of compiling them again. Each PSO is stored under a hash of
+// its description (PipelineDescHash), shader byte code included, so changing a shader or any state
+// simply misses.
+// The driver rejects a library written by another adapter or driver version; the cache then
+// starts empty.
+//
+// Call Save() once the PSOs are built; it writes the library back only if something was added.
+// Without ID3D12Device1 every call compiles as usual.
+class PipelineCache {
+public:
+	struct Stats {
+		UINT Loaded = 0;
+		UINT Compiled = 0;
+		double LoadSeconds = 0.0;
+		double CompileSeconds = 0.0;	// Includes storing into the library.
+	};
+
+public:
+	PipelineCache(ID3D12Device* device, const std::wstring& filename);
+	PipelineCache(const PipelineCache& rhs) = delete;
+	PipelineCache& operator=(const PipelineCache& rhs) = delete;
+
+public:
+	// Safe to call from several threads; a miss compiles without holding the lock.
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	// Failing to write only costs a compile next time, so errors are ignored.
+	void Save();
+
+	Stats GetStats() const;
+
+	// Writes how many PSOs were loaded and compiled and the time spent on each to the debug output.
+	// Compare a first run (all compiled) with a second one (all loaded).
+	void LogStats() const;
+
+private:
+	void CreateEmptyLibrary();
+
+private:
+	ID3D12Device* _device;
+	Microsoft::WRL::ComPtr<ID3D12Device1> _device1;
+	std::wstring _filename;
+
+	mutable std::mutex _mutex;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> _library;
+	std::vector<char> _libraryBlob;		// The library reads from this for as long as it lives.
+	bool _dirty = false;
+
+	// Set when a stored entry no longer matches (a new root signature, say). Entries cannot be
+	// replaced, so Save() writes a fresh library from the PSOs created this run.
+	bool _stale = false;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> _staleLibrary;
+	std::vector<std::pair<std::wstring, Microsoft::WRL::ComPtr<ID3D12PipelineState>>> _created;
+
+	Stats _stats;
+};
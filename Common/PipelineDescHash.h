@@ -0,0 +1,103 @@
+#pragma once
+
+#include "HashBuilder.h"
+
+#include <cstdint>
+
+// The key PipelineCache stores a graphics PSO under: everything in the description that affects the
+// compiled pipeline except pRootSignature, which the library checks itself, and CachedPSO. Shader
+// byte code, stream output and input layout entries are hashed by content, not by pointer.
+//
+// Every struct is hashed field by field. Descriptions are usually filled by copying stack
+// temporaries, so padding bytes (after the UINT8 masks of the blend and depth stencil descriptions)
+// hold whatever was there, and hashing them would give the same state a new key each run.
+//
+// Needs only the D3D12 description types, which must be declared before this header is included.
+class PipelineDescHash {
+public:
+	static uint64_t Hash(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) {
+		HashBuilder hash;
+
+		AddShader(hash, desc.VS);
+		AddShader(hash, desc.PS);
+		AddShader(hash, desc.DS);
+		AddShader(hash, desc.HS);
+		AddShader(hash, desc.GS);
+
+		hash.Add(desc.StreamOutput.NumEntries);
+		for (UINT i = 0; i < desc.StreamOutput.NumEntries; ++i) {
+			const D3D12_SO_DECLARATION_ENTRY& entry = desc.StreamOutput.pSODeclaration[i];
+			hash.Add(entry.Stream).AddString(entry.SemanticName).Add(entry.SemanticIndex);
+			hash.Add(entry.StartComponent).Add(entry.ComponentCount).Add(entry.OutputSlot);
+		}
+		hash.Add(desc.StreamOutput.NumStrides);
+		for (UINT i = 0; i < desc.StreamOutput.NumStrides; ++i) {
+			hash.Add(desc.StreamOutput.pBufferStrides[i]);
+		}
+		hash.Add(desc.StreamOutput.RasterizedStream);
+
+		AddBlend(hash, desc.BlendState);
+		hash.Add(desc.SampleMask);
+		AddRasterizer(hash, desc.RasterizerState);
+		AddDepthStencil(hash, desc.DepthStencilState);
+
+		hash.Add(desc.InputLayout.NumElements);
+		for (UINT i = 0; i < desc.InputLayout.NumElements; ++i) {
+			const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+			hash.AddString(element.SemanticName).Add(element.SemanticIndex).Add(element.Format);
+			hash.Add(element.InputSlot).Add(element.AlignedByteOffset);
+			hash.Add(element.InputSlotClass).Add(element.InstanceDataStepRate);
+		}
+
+		hash.Add(desc.IBStripCutValue);
+		hash.Add(desc.PrimitiveTopologyType);
+		hash.Add(desc.NumRenderTargets);
+		for (UINT i = 0; i < desc.NumRenderTargets; ++i) {
+			hash.Add(desc.RTVFormats[i]);
+		}
+		hash.Add(desc.DSVFormat);
+		hash.Add(desc.SampleDesc.Count).Add(desc.SampleDesc.Quality);
+		hash.Add(desc.NodeMask);
+		hash.Add(desc.Flags);
+
+		return hash.Value();
+	}
+
+private:
+	static void AddShader(HashBuilder& hash, const D3D12_SHADER_BYTECODE& shader) {
+		hash.Add(shader.BytecodeLength);
+		if (shader.pShaderBytecode != nullptr) {
+			hash.Add(shader.pShaderBytecode, shader.BytecodeLength);
+		}
+	}
+
+	// Each render target entry ends in a UINT8 write mask followed by three bytes of padding.
+	static void AddBlend(HashBuilder& hash, const D3D12_BLEND_DESC& blend) {
+		hash.Add(blend.AlphaToCoverageEnable).Add(blend.IndependentBlendEnable);
+		for (const D3D12_RENDER_TARGET_BLEND_DESC& target : blend.RenderTarget) {
+			hash.Add(target.BlendEnable).Add(target.LogicOpEnable);
+			hash.Add(target.SrcBlend).Add(target.DestBlend).Add(target.BlendOp);
+			hash.Add(target.SrcBlendAlpha).Add(target.DestBlendAlpha).Add(target.BlendOpAlpha);
+			hash.Add(target.LogicOp).Add(target.RenderTargetWriteMask);
+		}
+	}
+
+	static void AddRasterizer(HashBuilder& hash, const D3D12_RASTERIZER_DESC& rasterizer) {
+		hash.Add(rasterizer.FillMode).Add(rasterizer.CullMode).Add(rasterizer.FrontCounterClockwise);
+		hash.Add(rasterizer.DepthBias).Add(rasterizer.DepthBiasClamp).Add(rasterizer.SlopeScaledDepthBias);
+		hash.Add(rasterizer.DepthClipEnable).Add(rasterizer.MultisampleEnable).Add(rasterizer.AntialiasedLineEnable);
+		hash.Add(rasterizer.ForcedSampleCount).Add(rasterizer.ConservativeRaster);
+	}
+
+	static void AddStencilOp(HashBuilder& hash, const D3D12_DEPTH_STENCILOP_DESC& op) {
+		hash.Add(op.StencilFailOp).Add(op.StencilDepthFailOp).Add(op.StencilPassOp).Add(op.StencilFunc);
+	}
+
+	// Padding follows the UINT8 stencil masks.
+	static void AddDepthStencil(HashBuilder& hash, const D3D12_DEPTH_STENCIL_DESC& depthStencil) {
+		hash.Add(depthStencil.DepthEnable).Add(depthStencil.DepthWriteMask).Add(depthStencil.DepthFunc);
+		hash.Add(depthStencil.StencilEnable).Add(depthStencil.StencilReadMask).Add(depthStencil.StencilWriteMask);
+		AddStencilOp(hash, depthStencil.FrontFace);
+		AddStencilOp(hash, depthStencil.BackFace);
+	}
+};
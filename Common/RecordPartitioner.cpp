@@ -0,0 +1,42 @@
+#include "RecordPartitioner.h"
+
+void RecordPartitioner::Partition(const uint32_t* drawCounts, uint32_t passCount, uint32_t workerCount, uint32_t minChunkDraws,
+								  std::vector<Chunk>& chunks) {
+	chunks.clear();
+
+	uint64_t totalDraws = 0;
+	for (uint32_t pass = 0; pass < passCount; ++pass) {
+		totalDraws += drawCounts[pass];
+	}
+
+	uint64_t targetChunks = (uint64_t)(workerCount > 0 ? workerCount : 1) * ChunksPerWorker;
+	uint64_t target = (totalDraws + targetChunks - 1) / targetChunks;
+	if (target < minChunkDraws) {
+		target = minChunkDraws;
+	}
+	if (target == 0) {
+		target = 1;
+	}
+
+	for (uint32_t pass = 0; pass < passCount; ++pass) {
+		uint32_t count = drawCounts[pass];
+		if (count == 0)
+			continue;
+
+		// Rounding down keeps every piece at least target long. The pieces are even: the first
+		// count % pieces of them get one draw more.
+		uint32_t pieces = (uint32_t)(count / target);
+		if (pieces == 0) {
+			pieces = 1;
+		}
+		uint32_t size = count / pieces;
+		uint32_t larger = count % pieces;
+
+		uint32_t first = 0;
+		for (uint32_t piece = 0; piece < pieces; ++piece) {
+			uint32_t pieceCount = size + (piece < larger ? 1 : 0);
+			chunks.push_back({ pass, first, pieceCount });
+			first += pieceCount;
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Splits a frame's render passes into chunks of draws to be recorded on separate command lists, one
+// worker per chunk. Small passes stay whole; a pass with more draws than the target is cut into
+// even pieces. Chunks come out in pass order and then draw order, which is the order their command
+// lists have to be submitted in.
+class RecordPartitioner {
+public:
+	struct Chunk {
+		uint32_t Pass;
+		uint32_t First;		// Draws [First, First + Count) of the pass.
+		uint32_t Count;
+	};
+
+	// Chunks aimed for per worker, so a worker that finishes early can pick up another.
+	static const uint32_t ChunksPerWorker = 2;
+
+public:
+	// drawCounts[i] is the number of draws in pass i. Every chunk gets at least minChunkDraws draws
+	// unless its whole pass has fewer: each command list costs a reset, a close and the state setup,
+	// which a handful of draws does not pay for. Passes without draws get no chunk.
+	static void Partition(const uint32_t* drawCounts, uint32_t passCount, uint32_t workerCount, uint32_t minChunkDraws,
+						  std::vector<Chunk>& chunks);
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <DirectXCollision.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "BitSet.h"
+#include "FrameDirtySet.h"
+
+// Render items kept structure-of-arrays: world and texture transforms, object and world space
+// bounds and whatever else the caller keeps per item (Item) each live in their own array, packed at
+// indices [0, Count()). Per-frame work such as uploading object constants walks the arrays it needs
+// instead of following a pointer per item, and only visits the items changed since the frame
+// resource was last written (see FrameDirtySet).
+//
+// Items are referred to by Handle, a slot plus a generation. Destroy() moves the last item into the
+// hole, so indices change but handles stay valid; a destroyed item's handle stops being valid even
+// when its slot is reused. An item's index is also its slot in the per-frame object constants, so
+// an item that moves is marked dirty again.
+//
+// Layer membership is a bit set per layer over the indices.
+template<typename Item>
+class RenderItemStore {
+public:
+	struct Handle {
+		uint32_t Slot = InvalidSlot;
+		uint32_t Generation = 0;
+	};
+
+	static const uint32_t InvalidSlot = UINT32_MAX;
+
+public:
+	// New and changed items are dirty in each of the frameCount frame resources until UpdateDirty
+	// has been called for it.
+	RenderItemStore(uint32_t layerCount, uint32_t frameCount) : _layers(layerCount), _dirty(frameCount) {}
+
+	// Identity transforms, empty bounds, in no layer and dirty.
+	Handle Create(const Item& item) {
+		uint32_t index = Count();
+
+		uint32_t slot;
+		if (!_freeSlots.empty()) {
+			slot = _freeSlots.back();
+			_freeSlots.pop_back();
+		} else {
+			slot = (uint32_t)_slots.size();
+			_slots.push_back({ 0, 1 });
+		}
+		_slots[slot].Index = index;
+
+		DirectX::XMFLOAT4X4 identity(1.0f, 0.0f, 0.0f, 0.0f,
+									 0.0f, 1.0f, 0.0f, 0.0f,
+									 0.0f, 0.0f, 1.0f, 0.0f,
+									 0.0f, 0.0f, 0.0f, 1.0f);
+		DirectX::BoundingBox empty(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+		_items.push_back(item);
+		_world.push_back(identity);
+		_texTransform.push_back(identity);
+		_localBounds.push_back(empty);
+		_worldBounds.push_back(empty);
+		_handleSlots.push_back(slot);
+
+		_dirty.Resize(index + 1);
+		for (BitSet& layer : _layers) {
+			layer.Resize(index + 1);
+		}
+
+		return { slot, _slots[slot].Generation };
+	}
+
+	// Creates a copy of source's item, transforms and bounds, in no layer.
+	Handle Clone(Handle source) {
+		Item item = _items[Index(source)];
+		Handle handle = Create(item);
+
+		uint32_t from = Index(source);
+		uint32_t to = Index(handle);
+		_world[to] = _world[from];
+		_texTransform[to] = _texTransform[from];
+		_localBounds[to] = _localBounds[from];
+		_worldBounds[to] = _worldBounds[from];
+		return handle;
+	}
+
+	void Destroy(Handle handle) {
+		uint32_t index = Index(handle);
+		uint32_t last = Count() - 1;
+
+		if (index != last) {
+			_items[index] = _items[last];
+			_world[index] = _world[last];
+			_texTransform[index] = _texTransform[last];
+			_localBounds[index] = _localBounds[last];
+			_worldBounds[index] = _worldBounds[last];
+			_handleSlots[index] = _handleSlots[last];
+			_slots[_handleSlots[index]].Index = index;
+			for (BitSet& layer : _layers) {
+				layer.Assign(index, layer.Test(last));
+			}
+
+			// The moved item's constants are at its old index.
+			_dirty.Mark(index);
+		}
+
+		_items.pop_back();
+		_world.pop_back();
+		_texTransform.pop_back();
+		_localBounds.pop_back();
+		_worldBounds.pop_back();
+		_handleSlots.pop_back();
+		_dirty.Resize(last);
+		for (BitSet& layer : _layers) {
+			layer.Resize(last);
+		}
+
+		_slots[handle.Slot].Generation++;
+		_freeSlots.push_back(handle.Slot);
+	}
+
+	bool IsValid(Handle handle) const {
+		return handle.Slot < _slots.size() && _slots[handle.Slot].Generation == handle.Generation;
+	}
+
+	// Where the item is in the arrays now. handle must be valid.
+	uint32_t Index(Handle handle) const {
+		return _slots[handle.Slot].Index;
+	}
+
+	Handle HandleAt(uint32_t index) const {
+		uint32_t slot = _handleSlots[index];
+		return { slot, _slots[slot].Generation };
+	}
+
+	uint32_t Count() const {
+		return (uint32_t)_items.size();
+	}
+
+	Item& Get(Handle handle) {
+		return _items[Index(handle)];
+	}
+
+	const Item& Get(Handle handle) const {
+		return _items[Index(handle)];
+	}
+
+	void SetWorld(Handle handle, const DirectX::XMFLOAT4X4& world) {
+		uint32_t index = Index(handle);
+		_world[index] = world;
+		_dirty.Mark(index);
+	}
+
+	void SetTexTransform(Handle handle, const DirectX::XMFLOAT4X4& texTransform) {
+		uint32_t index = Index(handle);
+		_texTransform[index] = texTransform;
+		_dirty.Mark(index);
+	}
+
+	// Object space bounds. The world space ones follow when the item is next updated.
+	void SetLocalBounds(Handle handle, const DirectX::BoundingBox& bounds) {
+		uint32_t index = Index(handle);
+		_localBounds[index] = bounds;
+		_dirty.Mark(index);
+	}
+
+	// Calls fn(index) for every item dirty in frame resource frame, in index order, and marks them
+	// clean there. fn writes the item's constants and its world bounds.
+	template<typename Fn>
+	void UpdateDirty(uint32_t frame, Fn fn) {
+		_dirty.ForEachDirty(frame, fn);
+	}
+
+	void AddToLayer(Handle handle, uint32_t layer) {
+		_layers[layer].Set(Index(handle));
+	}
+
+	void RemoveFromLayer(Handle handle, uint32_t layer) {
+		_layers[layer].Reset(Index(handle));
+	}
+
+	// Indices of the items in layer.
+	const BitSet& Layer(uint32_t layer) const {
+		return _layers[layer];
+	}
+
+	// The arrays, Count() long.
+	Item* Items() {
+		return _items.data();
+	}
+
+	const Item* Items() const {
+		return _items.data();
+	}
+
+	const DirectX::XMFLOAT4X4* World() const {
+		return _world.data();
+	}
+
+	const DirectX::XMFLOAT4X4* TexTransform() const {
+		return _texTransform.data();
+	}
+
+	const DirectX::BoundingBox* LocalBounds() const {
+		return _localBounds.data();
+	}
+
+	// Kept up to date by the caller, from UpdateDirty.
+	DirectX::BoundingBox* WorldBounds() {
+		return _worldBounds.data();
+	}
+
+	const DirectX::BoundingBox* WorldBounds() const {
+		return _worldBounds.data();
+	}
+
+private:
+	struct Slot {
+		uint32_t Index;
+		uint32_t Generation;	// Starts at 1, so a default Handle is never valid.
+	};
+
+	std::vector<Item> _items;
+	std::vector<DirectX::XMFLOAT4X4> _world;
+	std::vector<DirectX::XMFLOAT4X4> _texTransform;
+	std::vector<DirectX::BoundingBox> _localBounds;
+	std::vector<DirectX::BoundingBox> _worldBounds;
+	std::vector<uint32_t> _handleSlots;		// Slot of the item at each index.
+
+	std::vector<Slot> _slots;
+	std::vector<uint32_t> _freeSlots;
+
+	std::vector<BitSet> _layers;
+	FrameDirtySet _dirty;
+};
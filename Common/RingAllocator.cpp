@@ -0,0 +1,61 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(uint64_t capacity) : _capacity(capacity) {
+}
+
+bool RingAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t& offset) {
+	uint64_t used = Used();
+
+	// Nothing is live, so start over at the beginning. Open frames can only be empty here and end
+	// where the new head is.
+	if (used == 0) {
+		_head = 0;
+		_tail = 0;
+		for (Frame& frame : _frames) {
+			frame.End = 0;
+		}
+	}
+
+	uint64_t start = (_head + alignment - 1) & ~(alignment - 1);
+
+	if (_head >= _tail && used < _capacity) {
+		// Free space is [_head, _capacity) followed by [0, _tail).
+		if (start + size <= _capacity) {
+			_allocated += start + size - _head;
+			_head = start + size;
+			offset = start;
+			return true;
+		}
+
+		// Skip the end of the ring; the skipped bytes stay used until this frame retires.
+		if (size > _tail)
+			return false;
+
+		_allocated += _capacity - _head + size;
+		_head = size;
+		offset = 0;
+		return true;
+	}
+
+	// Wrapped: free space is [_head, _tail).
+	if (_head < _tail && start + size <= _tail) {
+		_allocated += start + size - _head;
+		_head = start + size;
+		offset = start;
+		return true;
+	}
+
+	return false;
+}
+
+void RingAllocator::EndFrame(uint64_t fence) {
+	_frames.push_back({ fence, _head, _allocated });
+}
+
+void RingAllocator::Retire(uint64_t completedFence) {
+	while (!_frames.empty() && _frames.front().Fence <= completedFence) {
+		_tail = _frames.front().End;
+		_retired = _frames.front().Allocated;
+		_frames.pop_front();
+	}
+}
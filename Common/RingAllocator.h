@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Hands out offsets into a ring of capacity bytes. Allocations are grouped into frames; a frame is
+// closed with the fence value that signals the GPU is done with it, and its space comes back once
+// Retire() sees that fence completed. Works on offsets only, so it can sit on top of any memory:
+// an upload heap in the app, a plain byte array in a test.
+class RingAllocator {
+public:
+	RingAllocator(uint64_t capacity);
+
+public:
+	// Returns false if size bytes at the requested alignment (a power of two) are not free right now.
+	bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+
+	// Closes the current frame. Everything allocated since the previous call belongs to it.
+	void EndFrame(uint64_t fence);
+
+	// Frees every closed frame whose fence is <= completedFence.
+	void Retire(uint64_t completedFence);
+
+	uint64_t Capacity() const {
+		return _capacity;
+	}
+
+	// Bytes in use, alignment padding and the skipped end of the ring included.
+	uint64_t Used() const {
+		return _allocated - _retired;
+	}
+
+private:
+	struct Frame {
+		uint64_t Fence;
+		uint64_t End;			// _head when the frame was closed.
+		uint64_t Allocated;		// _allocated when the frame was closed.
+	};
+
+	uint64_t _capacity;
+	uint64_t _head = 0;			// Next free byte.
+	uint64_t _tail = 0;			// Oldest byte still in use.
+
+	// Running totals. Their difference is the used size, which tells a full ring from an empty one
+	// when _head == _tail.
+	uint64_t _allocated = 0;
+	uint64_t _retired = 0;
+
+	std::deque<Frame> _frames;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include "HashBuilder.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <mutex>
+
+// On-disk cache of compiled shader byte code, used by D3DUtil::CompileShader. The key is an FNV-1a
+// hash of the preprocessed source (so edits to included files count), the defines, entry point,
+// target, compile flags and compiler version. Entries are plain .cso files read back with
+// D3DUtil::LoadBinary; delete the directory to start over.
+//
+// Header only so every sample picks it up through D3DUtil.cpp without project changes.
+class ShaderCache {
+public:
+	struct Stats {
+		UINT Hits = 0;
+		UINT Misses = 0;
+		double HitSeconds = 0.0;	// Preprocessing, hashing and loading, for hits.
+		double MissSeconds = 0.0;	// The same plus compiling and storing, for misses.
+	};
+
+public:
+	// Hash identifying the byte code the arguments compile to, or 0 if the source cannot be
+	// preprocessed (the compiler will then report the error).
+	static uint64_t Key(const std::wstring& filename,
+						const D3D_SHADER_MACRO* defines,
+						const std::string& entrypoint,
+						const std::string& target,
+						UINT compileFlags) {
+		std::ifstream fin(filename, std::ios::binary);
+		if (!fin)
+			return 0;
+
+		std::string source((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+		std::string sourceName = WStringToAnsi(filename);
+
+		Microsoft::WRL::ComPtr<ID3DBlob> preprocessed;
+		Microsoft::WRL::ComPtr<ID3DBlob> errors;
+		HRESULT hr = D3DPreprocess(source.data(), source.size(), sourceName.c_str(), defines,
+								   D3D_COMPILE_STANDARD_FILE_INCLUDE, &preprocessed, &errors);
+		if (FAILED(hr))
+			return 0;
+
+		HashBuilder hash;
+		hash.Add(preprocessed->GetBufferPointer(), preprocessed->GetBufferSize());
+		for (const D3D_SHADER_MACRO* define = defines; define != nullptr && define->Name != nullptr; ++define) {
+			hash.AddString(define->Name);
+			if (define->Definition != nullptr) {
+				hash.AddString(define->Definition);
+			}
+		}
+
+		UINT compilerVersion = D3D_COMPILER_VERSION;
+		hash.AddString(entrypoint.c_str());
+		hash.AddString(target.c_str());
+		hash.Add(compileFlags);
+		hash.Add(compilerVersion);
+
+		// 0 means "no key".
+		return hash.Value() != 0 ? hash.Value() : 1;
+	}
+
+	// Cached byte code for key, or nullptr.
+	static Microsoft::WRL::ComPtr<ID3DBlob> Find(uint64_t key) {
+		std::wstring path = Path(key);
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributes) ||
+			(attributes.nFileSizeLow == 0 && attributes.nFileSizeHigh == 0))
+			return nullptr;
+
+		return D3DUtil::LoadBinary(path);
+	}
+
+	// Failing to write only costs a recompile next time, so errors are ignored.
+	static void Store(uint64_t key, ID3DBlob* byteCode) {
+		CreateDirectory(Directory().c_str(), nullptr);
+
+		// Write then rename, so an interrupted run never leaves a truncated entry behind. The temporary
+		// name is per thread in case two threads store the same entry.
+		std::wstring path = Path(key);
+		std::wstring tempPath = path + L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+		{
+			std::ofstream fout(tempPath, std::ios::binary);
+			fout.write((const char*)byteCode->GetBufferPointer(), byteCode->GetBufferSize());
+			if (!fout)
+				return;
+		}
+		MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+	}
+
+	// Shaders may be compiled from several threads at once, so the counters are locked.
+	static void Record(bool hit, double seconds) {
+		std::lock_guard<std::mutex> lock(StatsMutex());
+		if (hit) {
+			StatsStorage().Hits++;
+			StatsStorage().HitSeconds += seconds;
+		} else {
+			StatsStorage().Misses++;
+			StatsStorage().MissSeconds += seconds;
+		}
+	}
+
+	static Stats GetStats() {
+		std::lock_guard<std::mutex> lock(StatsMutex());
+		return StatsStorage();
+	}
+
+	// Writes the hit rate and the time spent on hits and misses to the debug output. Compare the
+	// totals of a first run (all misses) with a second one (all hits) for the startup saving.
+	static void LogStats() {
+		Stats stats = GetStats();
+		UINT lookups = stats.Hits + stats.Misses;
+
+		char message[256];
+		sprintf_s(message, "ShaderCache: %u / %u hits (%.0f%%), hits %.1f ms, misses %.1f ms\n",
+				  stats.Hits, lookups, lookups > 0 ? 100.0 * stats.Hits / lookups : 0.0,
+				  stats.HitSeconds * 1000.0, stats.MissSeconds * 1000.0);
+		OutputDebugStringA(message);
+	}
+
+	static std::wstring Directory() {
+		return L"ShaderCache";
+	}
+
+private:
+	static Stats& StatsStorage() {
+		static Stats stats;
+		return stats;
+	}
+
+	static std::mutex& StatsMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::wstring Path(uint64_t key) {
+		wchar_t name[32];
+		swprintf_s(name, L"%016llx.cso", key);
+		return Directory() + L"/" + name;
+	}
+
+	static std::string WStringToAnsi(const std::wstring& str) {
+		char buffer[512];
+		WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, buffer, 512, nullptr, nullptr);
+		return std::string(buffer);
+	}
+};
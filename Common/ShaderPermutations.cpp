@@ -0,0 +1,99 @@
+#include "ShaderPermutations.h"
+
+#include <cassert>
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+UINT RoundLightCount(UINT count) {
+	if (count <= 4)
+		return count;
+	if (count <= 8)
+		return 8;
+	return MaxLights;
+}
+
+Light* PackGroup(const std::vector<Light>& group, UINT slots, Light* lights) {
+	assert(group.size() <= slots);
+
+	for (UINT i = 0; i < slots; ++i) {
+		if (i < group.size()) {
+			lights[i] = group[i];
+		} else {
+			lights[i] = Light();
+			lights[i].Strength = {0.0f, 0.0f, 0.0f};
+		}
+	}
+	return lights + slots;
+}
+}
+
+ShaderPermutations::ShaderPermutations(const std::wstring& filename,
+									   const D3D_SHADER_MACRO* defines,
+									   const std::string& entrypoint,
+									   const std::string& target) :
+	_filename(filename),
+	_entrypoint(entrypoint),
+	_target(target) {
+	for (const D3D_SHADER_MACRO* define = defines; define != nullptr && define->Name != nullptr; ++define) {
+		_defines.emplace_back(define->Name, define->Definition != nullptr ? define->Definition : "");
+	}
+}
+
+LightCounts ShaderPermutations::Tightest(const LightCounts& lights) {
+	assert(lights.Total() <= MaxLights);
+
+	LightCounts variant;
+	variant.Directional = RoundLightCount(lights.Directional);
+	variant.Point = RoundLightCount(lights.Point);
+	variant.Spot = RoundLightCount(lights.Spot);
+
+	if (variant.Total() > MaxLights)
+		return lights;
+	return variant;
+}
+
+ID3DBlob* ShaderPermutations::Get(const LightCounts& counts) {
+	assert(counts.Total() <= MaxLights);
+
+	// Compiling under the lock keeps two threads from building the same variant; different
+	// ShaderPermutations still compile in parallel.
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	ComPtr<ID3DBlob>& byteCode = _variants[KeyOf(counts)];
+	if (byteCode != nullptr)
+		return byteCode.Get();
+
+	std::string dirLights = std::to_string(counts.Directional);
+	std::string pointLights = std::to_string(counts.Point);
+	std::string spotLights = std::to_string(counts.Spot);
+
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const auto& define : _defines) {
+		macros.push_back({define.first.c_str(), define.second.c_str()});
+	}
+	macros.push_back({"NUM_DIR_LIGHTS", dirLights.c_str()});
+	macros.push_back({"NUM_POINT_LIGHTS", pointLights.c_str()});
+	macros.push_back({"NUM_SPOT_LIGHTS", spotLights.c_str()});
+	macros.push_back({nullptr, nullptr});
+
+	byteCode = D3DUtil::CompileShader(_filename, macros.data(), _entrypoint, _target);
+	return byteCode.Get();
+}
+
+UINT ShaderPermutations::PackLights(const LightCounts& variant,
+									const std::vector<Light>& directional,
+									const std::vector<Light>& point,
+									const std::vector<Light>& spot,
+									Light* lights) {
+	Light* next = lights;
+	next = PackGroup(directional, variant.Directional, next);
+	next = PackGroup(point, variant.Point, next);
+	next = PackGroup(spot, variant.Spot, next);
+	return (UINT)(next - lights);
+}
+
+UINT ShaderPermutations::VariantCount() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return (UINT)_variants.size();
+}
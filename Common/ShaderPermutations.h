@@ -0,0 +1,81 @@
+#pragma once
+
+#include "D3DUtil.h"
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// How many lights of each kind a shader built on LightingUtil.hlsl loops over. The pass constants
+// hold the directional lights first, then the point lights, then the spot lights.
+struct LightCounts {
+	UINT Directional = 0;
+	UINT Point = 0;
+	UINT Spot = 0;
+
+	UINT Total() const {
+		return Directional + Point + Spot;
+	}
+
+	bool operator==(const LightCounts& rhs) const {
+		return Directional == rhs.Directional && Point == rhs.Point && Spot == rhs.Spot;
+	}
+
+	bool operator!=(const LightCounts& rhs) const {
+		return !(*this == rhs);
+	}
+};
+
+// The light count variants of one shader entry point and feature set (FOG, ALPHA_TEST, ...). Each
+// variant is compiled the first time it is asked for, with NUM_DIR_LIGHTS, NUM_POINT_LIGHTS and
+// NUM_SPOT_LIGHTS added to the feature defines, and goes through the ShaderCache like any other
+// shader. Get() may be called from several threads.
+//
+// Counts are rounded up by Tightest() so a scene whose lights come and go only ever needs a
+// handful of variants; the slots a variant reads beyond the real lights are filled by
+// PackLights() with lights that add nothing.
+class ShaderPermutations {
+public:
+	typedef uint32_t Key;
+
+public:
+	ShaderPermutations(const std::wstring& filename,
+					   const D3D_SHADER_MACRO* defines,
+					   const std::string& entrypoint,
+					   const std::string& target);
+	ShaderPermutations(const ShaderPermutations& rhs) = delete;
+	ShaderPermutations& operator=(const ShaderPermutations& rhs) = delete;
+
+public:
+	// Smallest supported variant with at least lights' counts: exact up to 4 of a kind, then 8,
+	// then MaxLights. Falls back to the exact counts when rounding would overflow MaxLights.
+	static LightCounts Tightest(const LightCounts& lights);
+
+	static Key KeyOf(const LightCounts& counts) {
+		return counts.Directional | (counts.Point << 8) | (counts.Spot << 16);
+	}
+
+	// Byte code for the variant, which should come from Tightest(). Compiles it on first use.
+	ID3DBlob* Get(const LightCounts& counts);
+
+	// Writes the lights into the slots variant reads, each kind padded with zero strength lights.
+	// Returns the number of slots written, variant.Total().
+	static UINT PackLights(const LightCounts& variant,
+						   const std::vector<Light>& directional,
+						   const std::vector<Light>& point,
+						   const std::vector<Light>& spot,
+						   Light* lights);
+
+	UINT VariantCount() const;
+
+private:
+	std::wstring _filename;
+	std::string _entrypoint;
+	std::string _target;
+
+	// Copies of the feature defines; D3D_SHADER_MACRO only points at them.
+	std::vector<std::pair<std::string, std::string>> _defines;
+
+	mutable std::mutex _mutex;
+	std::unordered_map<Key, Microsoft::WRL::ComPtr<ID3DBlob>> _variants;
+};
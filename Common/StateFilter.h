@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Records through a command list while shadowing the state it has bound, and drops calls that would
+// set what is already set: descriptor heaps, root signature, PSO, root CBVs and descriptor tables,
+// vertex and index buffers, topology and stencil reference. Everything else goes to Get() directly.
+//
+// CommandList is ID3D12GraphicsCommandList in the samples; any class with the same methods works,
+// so the filtering can be checked against a fake list that records the calls it receives. The
+// D3D12 types must be declared before this header is included.
+template<typename CommandList>
+class StateFilter {
+public:
+	struct Stats {
+		uint32_t Issued = 0;
+		uint32_t Filtered = 0;
+	};
+
+public:
+	StateFilter() {
+		Invalidate();
+	}
+
+	// Call after cmdList->Reset(). Nothing is known to be bound except initialState.
+	void Reset(CommandList* cmdList, ID3D12PipelineState* initialState = nullptr) {
+		_cmdList = cmdList;
+		Invalidate();
+		_pso = initialState;
+		_psoKnown = true;
+	}
+
+	// Forgets all shadowed state, for when something was recorded around the filter.
+	void Invalidate() {
+		_heapsKnown = false;
+		_rootSignatureKnown = false;
+		_psoKnown = false;
+		_indexBufferKnown = false;
+		_topologyKnown = false;
+		_stencilRefKnown = false;
+		InvalidateRootArguments();
+		for (bool& known : _vertexBufferKnown) {
+			known = false;
+		}
+	}
+
+	CommandList* Get() const {
+		return _cmdList;
+	}
+
+	void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps) {
+		if (_heapsKnown && count == _heapCount && memcmp(heaps, _heaps, count * sizeof(*heaps)) == 0) {
+			_stats.Filtered++;
+			return;
+		}
+
+		_cmdList->SetDescriptorHeaps(count, heaps);
+		_stats.Issued++;
+
+		// Tables set against the old heaps are no longer valid.
+		for (RootArgument& argument : _rootArguments) {
+			if (argument.Kind == RootArgumentKind::Table) {
+				argument.Kind = RootArgumentKind::Unknown;
+			}
+		}
+
+		_heapsKnown = count <= MaxHeaps;
+		_heapCount = count;
+		if (_heapsKnown) {
+			memcpy(_heaps, heaps, count * sizeof(*heaps));
+		}
+	}
+
+	void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) {
+		if (_rootSignatureKnown && rootSignature == _rootSignature) {
+			_stats.Filtered++;
+			return;
+		}
+
+		_cmdList->SetGraphicsRootSignature(rootSignature);
+		_stats.Issued++;
+
+		// A different root signature resets every root argument.
+		_rootSignature = rootSignature;
+		_rootSignatureKnown = true;
+		InvalidateRootArguments();
+	}
+
+	void SetPipelineState(ID3D12PipelineState* pso) {
+		if (_psoKnown && pso == _pso) {
+			_stats.Filtered++;
+			return;
+		}
+
+		_cmdList->SetPipelineState(pso);
+		_stats.Issued++;
+		_pso = pso;
+		_psoKnown = true;
+	}
+
+	void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) {
+		if (SetRootArgument(rootParameterIndex, RootArgumentKind::ConstantBufferView, address)) {
+			_cmdList->SetGraphicsRootConstantBufferView(rootParameterIndex, address);
+		}
+	}
+
+	void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) {
+		if (SetRootArgument(rootParameterIndex, RootArgumentKind::Table, baseDescriptor.ptr)) {
+			_cmdList->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+		}
+	}
+
+	void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) {
+		bool same = views != nullptr && startSlot + numViews <= MaxVertexBuffers;
+		for (UINT i = 0; same && i < numViews; ++i) {
+			same = _vertexBufferKnown[startSlot + i] &&
+				memcmp(&views[i], &_vertexBuffers[startSlot + i], sizeof(D3D12_VERTEX_BUFFER_VIEW)) == 0;
+		}
+
+		if (same) {
+			_stats.Filtered++;
+			return;
+		}
+
+		_cmdList->IASetVertexBuffers(startSlot, numViews, views);
+		_stats.Issued++;
+
+		for (UINT i = 0; i < numViews && startSlot + i < MaxVertexBuffers; ++i) {
+			_vertexBufferKnown[startSlot + i] = views != nullptr;
+			if (views != nullptr) {
+				_vertexBuffers[startSlot + i] = views[i];
+			}
+		}
+	}
+
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) {
+		if (view != nullptr && _indexBufferKnown && memcmp(view, &_indexBuffer, sizeof(D3D12_INDEX_BUFFER_VIEW)) == 0) {
+			_stats.Filtered++;
+			return;
+		}
+
+		_cmdList->IASetIndexBuffer(view);
+		_stats.Issued++;
+
+		_indexBufferKnown = view != nullptr;
+		if (view != nullptr) {
+			_indexBuffer = *view;
+		}
+	}
+
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) {
+		if (_topologyKnown && topology == _topology) {
+			_stats.Filtered++;
+			return;
+		}
+
+		_cmdList->IASetPrimitiveTopology(topology);
+		_stats.Issued++;
+		_topology = topology;
+		_topologyKnown = true;
+	}
+
+	void OMSetStencilRef(UINT stencilRef) {
+		if (_stencilRefKnown && stencilRef == _stencilRef) {
+			_stats.Filtered++;
+			return;
+		}
+
+		_cmdList->OMSetStencilRef(stencilRef);
+		_stats.Issued++;
+		_stencilRef = stencilRef;
+		_stencilRefKnown = true;
+	}
+
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation,
+							  INT baseVertexLocation, UINT startInstanceLocation) {
+		_cmdList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation,
+									   baseVertexLocation, startInstanceLocation);
+	}
+
+	// The command signature may change root arguments, and the filter cannot tell which, so all of
+	// them are forgotten.
+	void ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount, ID3D12Resource* argumentBuffer,
+						 UINT64 argumentBufferOffset, ID3D12Resource* countBuffer, UINT64 countBufferOffset) {
+		_cmdList->ExecuteIndirect(commandSignature, maxCommandCount, argumentBuffer, argumentBufferOffset,
+								  countBuffer, countBufferOffset);
+		InvalidateRootArguments();
+	}
+
+	const Stats& GetStats() const {
+		return _stats;
+	}
+
+	void ResetStats() {
+		_stats = Stats();
+	}
+
+private:
+	enum class RootArgumentKind : uint8_t {
+		Unknown,
+		ConstantBufferView,
+		Table,
+	};
+
+	struct RootArgument {
+		RootArgumentKind Kind = RootArgumentKind::Unknown;
+		uint64_t Value = 0;
+	};
+
+	// Root signatures hold at most 64 DWORDs, so at most 64 parameters.
+	static const UINT MaxRootArguments = 64;
+	static const UINT MaxVertexBuffers = 32;
+	static const UINT MaxHeaps = 2;
+
+	// True if the call has to be recorded.
+	bool SetRootArgument(UINT index, RootArgumentKind kind, uint64_t value) {
+		if (index < MaxRootArguments && _rootArguments[index].Kind == kind && _rootArguments[index].Value == value) {
+			_stats.Filtered++;
+			return false;
+		}
+
+		_stats.Issued++;
+		if (index < MaxRootArguments) {
+			_rootArguments[index].Kind = kind;
+			_rootArguments[index].Value = value;
+		}
+		return true;
+	}
+
+	void InvalidateRootArguments() {
+		for (RootArgument& argument : _rootArguments) {
+			argument.Kind = RootArgumentKind::Unknown;
+		}
+	}
+
+private:
+	CommandList* _cmdList = nullptr;
+
+	ID3D12DescriptorHeap* _heaps[MaxHeaps] = {};
+	UINT _heapCount = 0;
+	bool _heapsKnown = false;
+
+	ID3D12RootSignature* _rootSignature = nullptr;
+	bool _rootSignatureKnown = false;
+
+	ID3D12PipelineState* _pso = nullptr;
+	bool _psoKnown = false;
+
+	RootArgument _rootArguments[MaxRootArguments];
+
+	D3D12_VERTEX_BUFFER_VIEW _vertexBuffers[MaxVertexBuffers];
+	bool _vertexBufferKnown[MaxVertexBuffers];
+
+	D3D12_INDEX_BUFFER_VIEW _indexBuffer;
+	bool _indexBufferKnown = false;
+
+	D3D12_PRIMITIVE_TOPOLOGY _topology;
+	bool _topologyKnown = false;
+
+	UINT _stencilRef = 0;
+	bool _stencilRefKnown = false;
+
+	Stats _stats;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STREAM_COPY_SSE2 1
+#include <emmintrin.h>
+#else
+#define STREAM_COPY_SSE2 0
+#endif
+
+// Copies into write-combined memory such as a mapped upload heap. The bulk of the copy uses
+// non-temporal stores on 16-byte aligned destinations, so whole lines go out in one burst and the
+// data does not pass through the cache. Only the unaligned head and tail use plain stores.
+class StreamCopy {
+public:
+	static void Copy(void* dst, const void* src, size_t byteSize) {
+		uint8_t* d = static_cast<uint8_t*>(dst);
+		const uint8_t* s = static_cast<const uint8_t*>(src);
+
+#if STREAM_COPY_SSE2
+		size_t head = (16 - ((uintptr_t)d & 15)) & 15;
+		if (head > byteSize)
+			head = byteSize;
+
+		memcpy(d, s, head);
+		d += head;
+		s += head;
+		byteSize -= head;
+
+		for (; byteSize >= 64; byteSize -= 64, d += 64, s += 64) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+			__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+		}
+
+		for (; byteSize >= 16; byteSize -= 16, d += 16, s += 16) {
+			_mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+		}
+#endif
+
+		memcpy(d, s, byteSize);
+	}
+
+	// Copies count elements of elementSize bytes, reading every srcStride bytes and writing every
+	// dstStride bytes. Use it to spread packed constants onto 256-byte constant buffer slots, or to
+	// pick one member array out of a larger struct.
+	static void CopyStrided(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t elementSize, size_t count) {
+		if (dstStride == elementSize && srcStride == elementSize) {
+			Copy(dst, src, elementSize * count);
+			return;
+		}
+
+		uint8_t* d = static_cast<uint8_t*>(dst);
+		const uint8_t* s = static_cast<const uint8_t*>(src);
+		for (size_t i = 0; i < count; ++i, d += dstStride, s += srcStride) {
+			Copy(d, s, elementSize);
+		}
+	}
+
+	// Non-temporal stores are weakly ordered. Call once after a batch of copies, before the data is
+	// handed to the GPU.
+	static void Fence() {
+#if STREAM_COPY_SSE2
+		_mm_sfence();
+#endif
+	}
+};
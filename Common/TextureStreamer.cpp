@@ -0,0 +1,244 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+TextureStreamer::TextureStreamer(uint64_t budgetBytes) : _budget(budgetBytes) {
+}
+
+uint32_t TextureStreamer::Register(const std::string& name, const std::vector<uint64_t>& mipBytes, uint32_t baseMip) {
+	assert(!mipBytes.empty());
+
+	Entry entry;
+	entry.Name = name;
+	entry.MipBytes = mipBytes;
+	entry.BaseMip = std::min(baseMip, (uint32_t)mipBytes.size() - 1);
+	entry.ResidentMip = entry.BaseMip;
+	entry.WantedMip = entry.BaseMip;
+
+	entry.TailBytes.resize(mipBytes.size() + 1, 0);
+	for (size_t m = mipBytes.size(); m-- > 0;) {
+		entry.TailBytes[m] = entry.TailBytes[m + 1] + mipBytes[m];
+	}
+
+	_committed += entry.TailBytes[entry.ResidentMip];
+	_entries.push_back(std::move(entry));
+	return (uint32_t)_entries.size() - 1;
+}
+
+void TextureStreamer::SetBudget(uint64_t budgetBytes) {
+	_budget = budgetBytes;
+}
+
+uint64_t TextureStreamer::Budget() const {
+	return _budget;
+}
+
+void TextureStreamer::BeginFrame(uint64_t frame) {
+	_frame = frame;
+	for (Entry& entry : _entries) {
+		entry.WantedMip = entry.BaseMip;
+	}
+}
+
+void TextureStreamer::RequestMip(uint32_t texture, uint32_t mip) {
+	Entry& entry = _entries[texture];
+	entry.WantedMip = std::min(entry.WantedMip, std::min(mip, entry.BaseMip));
+	entry.LastRequested = _frame;
+}
+
+bool TextureStreamer::EvictFor(uint64_t bytes, uint32_t exclude, std::vector<Command>& commands) {
+	while (_committed - _evicting + bytes > _budget) {
+		// Least recently requested texture holding more than it needs. Textures seen this frame only
+		// give up mips finer than they asked for.
+		uint32_t victim = UINT32_MAX;
+		for (uint32_t i = 0; i < (uint32_t)_entries.size(); ++i) {
+			const Entry& entry = _entries[i];
+			uint32_t floor = entry.LastRequested == _frame ? entry.WantedMip : entry.BaseMip;
+			if (i == exclude || entry.Pending || entry.ResidentMip >= floor)
+				continue;
+			if (victim == UINT32_MAX || entry.LastRequested < _entries[victim].LastRequested)
+				victim = i;
+		}
+
+		if (victim == UINT32_MAX)
+			return false;
+
+		Entry& entry = _entries[victim];
+		entry.PendingMip = entry.LastRequested == _frame ? entry.WantedMip : entry.BaseMip;
+		entry.Pending = true;
+		_evicting += entry.TailBytes[entry.ResidentMip] - entry.TailBytes[entry.PendingMip];
+		++_totalEvictions;
+
+		commands.push_back({ CommandType::Evict, victim, entry.PendingMip });
+	}
+
+	return true;
+}
+
+void TextureStreamer::TrimToBudget(std::vector<Command>& commands) {
+	// Detail nothing asked for this frame goes first, least recently requested texture first.
+	if (EvictFor(0, UINT32_MAX, commands))
+		return;
+
+	// Still over: textures in view give up their finest mip, largest first. A texture has at most
+	// one command in flight, so one that has to drop several mips loses the rest on later frames.
+	while (_committed - _evicting > _budget) {
+		uint32_t victim = UINT32_MAX;
+		for (uint32_t i = 0; i < (uint32_t)_entries.size(); ++i) {
+			const Entry& entry = _entries[i];
+			if (entry.Pending || entry.ResidentMip >= entry.BaseMip)
+				continue;
+			if (victim == UINT32_MAX ||
+				entry.MipBytes[entry.ResidentMip] > _entries[victim].MipBytes[_entries[victim].ResidentMip])
+				victim = i;
+		}
+
+		// Only base mips and pending commands are left.
+		if (victim == UINT32_MAX)
+			return;
+
+		Entry& entry = _entries[victim];
+		entry.PendingMip = entry.ResidentMip + 1;
+		entry.Pending = true;
+		_evicting += entry.MipBytes[entry.ResidentMip];
+		++_totalEvictions;
+
+		commands.push_back({ CommandType::Evict, victim, entry.PendingMip });
+	}
+}
+
+std::vector<TextureStreamer::Command> TextureStreamer::Update(uint32_t maxLoads) {
+	std::vector<Command> commands;
+	TrimToBudget(commands);
+
+	std::vector<uint32_t> candidates;
+	for (uint32_t i = 0; i < (uint32_t)_entries.size(); ++i) {
+		if (!_entries[i].Pending && _entries[i].WantedMip < _entries[i].ResidentMip)
+			candidates.push_back(i);
+	}
+
+	// Most missing detail first.
+	std::stable_sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+		return _entries[a].ResidentMip - _entries[a].WantedMip > _entries[b].ResidentMip - _entries[b].WantedMip;
+	});
+
+	uint32_t loads = 0;
+	for (uint32_t i : candidates) {
+		if (loads == maxLoads)
+			break;
+
+		Entry& entry = _entries[i];
+
+		// Bytes that evictions could give back, not counting this texture.
+		uint64_t reclaimable = 0;
+		for (uint32_t j = 0; j < (uint32_t)_entries.size(); ++j) {
+			const Entry& other = _entries[j];
+			uint32_t floor = other.LastRequested == _frame ? other.WantedMip : other.BaseMip;
+			if (j != i && !other.Pending && other.ResidentMip < floor)
+				reclaimable += other.TailBytes[other.ResidentMip] - other.TailBytes[floor];
+		}
+
+		// Settle for a coarser mip if the wanted one cannot fit at all.
+		uint64_t floorBytes = _committed - _evicting - reclaimable;
+		uint32_t target = entry.WantedMip;
+		while (target < entry.ResidentMip &&
+			   floorBytes + entry.TailBytes[target] - entry.TailBytes[entry.ResidentMip] > _budget) {
+			++target;
+		}
+
+		if (target == entry.ResidentMip)
+			continue;
+
+		uint64_t bytes = entry.TailBytes[target] - entry.TailBytes[entry.ResidentMip];
+		EvictFor(bytes, i, commands);
+
+		// The memory only becomes free once the evictions complete. Wait for it rather than let a
+		// smaller texture take the space.
+		if (_committed + bytes > _budget)
+			break;
+
+		entry.PendingMip = target;
+		entry.Pending = true;
+		_committed += bytes;
+		++_totalLoads;
+		++loads;
+
+		commands.push_back({ CommandType::Load, i, target });
+	}
+
+	return commands;
+}
+
+void TextureStreamer::Complete(uint32_t texture) {
+	Entry& entry = _entries[texture];
+	if (!entry.Pending)
+		return;
+
+	if (entry.PendingMip > entry.ResidentMip) {
+		uint64_t freed = entry.TailBytes[entry.ResidentMip] - entry.TailBytes[entry.PendingMip];
+		_committed -= freed;
+		_evicting -= freed;
+	}
+
+	entry.ResidentMip = entry.PendingMip;
+	entry.Pending = false;
+}
+
+uint32_t TextureStreamer::TextureCount() const {
+	return (uint32_t)_entries.size();
+}
+
+const std::string& TextureStreamer::Name(uint32_t texture) const {
+	return _entries[texture].Name;
+}
+
+uint32_t TextureStreamer::MipCount(uint32_t texture) const {
+	return (uint32_t)_entries[texture].MipBytes.size();
+}
+
+uint32_t TextureStreamer::ResidentMip(uint32_t texture) const {
+	return _entries[texture].ResidentMip;
+}
+
+uint32_t TextureStreamer::RequestedMip(uint32_t texture) const {
+	return _entries[texture].WantedMip;
+}
+
+bool TextureStreamer::IsPending(uint32_t texture) const {
+	return _entries[texture].Pending;
+}
+
+uint64_t TextureStreamer::ResidentBytes(uint32_t texture) const {
+	const Entry& entry = _entries[texture];
+	return entry.TailBytes[entry.ResidentMip];
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const {
+	Stats stats;
+	stats.Budget = _budget;
+	stats.Committed = _committed;
+	stats.TotalLoads = _totalLoads;
+	stats.TotalEvictions = _totalEvictions;
+
+	for (const Entry& entry : _entries) {
+		if (!entry.Pending)
+			continue;
+		if (entry.PendingMip < entry.ResidentMip)
+			++stats.PendingLoads;
+		else
+			++stats.PendingEvictions;
+	}
+
+	return stats;
+}
+
+uint32_t TextureStreamer::MipForScreenSize(float texelsAcross, float pixelsAcross) {
+	if (pixelsAcross <= 0.0f)
+		return UINT32_MAX;
+	if (texelsAcross <= pixelsAcross)
+		return 0;
+
+	return (uint32_t)std::floor(std::log2(texelsAcross / pixelsAcross));
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Decides which mips of each streamed texture should be resident. It only does bookkeeping and has no
+// D3D dependency, so the policy can be driven headlessly with a fake budget and camera path. The app
+// executes the returned commands and calls Complete() once the GPU no longer needs the old data.
+//
+// Mips are numbered as in D3D, 0 being the finest. A texture with resident mip m holds mips m..N-1.
+class TextureStreamer {
+public:
+	enum class CommandType {
+		Load,	// Make mips Mip..N-1 resident.
+		Evict,	// Drop everything finer than Mip.
+	};
+
+	struct Command {
+		CommandType Type;
+		uint32_t Texture;
+		uint32_t Mip;
+	};
+
+	struct Stats {
+		uint64_t Budget = 0;
+		uint64_t Committed = 0;		// Resident bytes plus bytes reserved for pending loads.
+		uint32_t PendingLoads = 0;
+		uint32_t PendingEvictions = 0;
+		uint64_t TotalLoads = 0;
+		uint64_t TotalEvictions = 0;
+	};
+
+public:
+	TextureStreamer(uint64_t budgetBytes);
+
+public:
+	// mipBytes[i] is the size of mip i. Mips baseMip..N-1 are loaded at startup, count against the
+	// budget and are never evicted.
+	uint32_t Register(const std::string& name, const std::vector<uint64_t>& mipBytes, uint32_t baseMip);
+
+	void SetBudget(uint64_t budgetBytes);
+	uint64_t Budget() const;
+
+	void BeginFrame(uint64_t frame);
+
+	// Asks for mip to be resident this frame. Several requests for one texture keep the finest.
+	void RequestMip(uint32_t texture, uint32_t mip);
+
+	// Returns the work for this frame, at most maxLoads loads. Evictions that bring the committed
+	// bytes back under the budget come first. Bytes for a load are reserved right away; bytes of an
+	// eviction stay committed until it completes.
+	std::vector<Command> Update(uint32_t maxLoads);
+
+	// Marks the outstanding command of a texture as done.
+	void Complete(uint32_t texture);
+
+	uint32_t TextureCount() const;
+	const std::string& Name(uint32_t texture) const;
+	uint32_t MipCount(uint32_t texture) const;
+	uint32_t ResidentMip(uint32_t texture) const;
+	uint32_t RequestedMip(uint32_t texture) const;
+	bool IsPending(uint32_t texture) const;
+	uint64_t ResidentBytes(uint32_t texture) const;
+
+	Stats GetStats() const;
+
+	// Mip whose footprint matches the screen: one texel per pixel along the largest axis.
+	static uint32_t MipForScreenSize(float texelsAcross, float pixelsAcross);
+
+private:
+	struct Entry {
+		std::string Name;
+		std::vector<uint64_t> MipBytes;
+		std::vector<uint64_t> TailBytes;	// TailBytes[m] = bytes of mips m..N-1.
+		uint32_t BaseMip = 0;
+		uint32_t ResidentMip = 0;
+		uint32_t WantedMip = 0;
+		uint32_t PendingMip = 0;
+		bool Pending = false;
+		uint64_t LastRequested = 0;
+	};
+
+	// Issues evictions until bytes more fit once they complete. Returns false if that is not possible.
+	bool EvictFor(uint64_t bytes, uint32_t exclude, std::vector<Command>& commands);
+
+	// Issues evictions until what stays committed fits the budget, for when the budget was lowered
+	// or the textures in view ask for more than it holds.
+	void TrimToBudget(std::vector<Command>& commands);
+
+private:
+	std::vector<Entry> _entries;
+
+	uint64_t _budget;
+	uint64_t _committed = 0;
+	uint64_t _evicting = 0;		// Committed bytes that pending evictions will free.
+	uint64_t _frame = 0;
+
+	uint64_t _totalLoads = 0;
+	uint64_t _totalEvictions = 0;
+};
@@ -0,0 +1,329 @@
+#include "TlsfAllocator.h"
+
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+// Index of the highest set bit. value must not be 0.
+uint32_t HighestBit(uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+// Index of the lowest set bit. value must not be 0.
+uint32_t LowestBit(uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return index;
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity) : _capacity(capacity) {
+	for (uint32_t fl = 0; fl < FLCount; ++fl) {
+		for (uint32_t sl = 0; sl < SLCount; ++sl) {
+			_bins[fl][sl] = InvalidBlock;
+		}
+	}
+
+	// Block 0 is the lowest block for good: merges always keep the lower of the two blocks.
+	uint32_t block = NewBlock();
+	_blocks[block].Size = capacity;
+	InsertFree(block);
+}
+
+bool TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, Allocation& allocation) {
+	if (size == 0)
+		size = 1;
+	if (alignment == 0)
+		alignment = 1;
+
+	if (size > _capacity)
+		return false;
+
+	// Try the size itself first; the head of the bin is often aligned already (everything is, when
+	// all requests share one alignment). Otherwise look for room to slide the start forward.
+	uint32_t block = FindFreeBlock(size);
+	if (block == InvalidBlock || (_blocks[block].Offset & (alignment - 1)) != 0) {
+		if (size + alignment - 1 > _capacity)
+			return false;
+
+		block = FindFreeBlock(size + alignment - 1);
+		if (block == InvalidBlock)
+			return false;
+	}
+
+	RemoveFree(block);
+
+	// Neighbours of a free block are in use, so the padding and the tail become free blocks of their
+	// own without merging.
+	uint64_t padding = AlignUp(_blocks[block].Offset, alignment) - _blocks[block].Offset;
+	if (padding > 0) {
+		uint32_t aligned = Split(block, padding);
+		InsertFree(block);
+		block = aligned;
+	}
+
+	if (_blocks[block].Size > size) {
+		InsertFree(Split(block, size));
+	}
+
+	_usedBytes += size;
+	_allocations++;
+
+	allocation.Offset = _blocks[block].Offset;
+	allocation.Size = size;
+	allocation.Block = block;
+	return true;
+}
+
+void TlsfAllocator::Free(const Allocation& allocation) {
+	uint32_t block = allocation.Block;
+	assert(block < _blocks.size() && !_blocks[block].Free && _blocks[block].Size == allocation.Size);
+
+	_usedBytes -= _blocks[block].Size;
+	_allocations--;
+
+	uint32_t next = _blocks[block].NextPhysical;
+	if (next != InvalidBlock && _blocks[next].Free) {
+		RemoveFree(next);
+		Merge(block, next);
+	}
+
+	uint32_t prev = _blocks[block].PrevPhysical;
+	if (prev != InvalidBlock && _blocks[prev].Free) {
+		RemoveFree(prev);
+		Merge(prev, block);
+		block = prev;
+	}
+
+	InsertFree(block);
+}
+
+TlsfAllocator::Stats TlsfAllocator::GetStats() const {
+	Stats stats;
+	stats.Capacity = _capacity;
+	stats.UsedBytes = _usedBytes;
+	stats.FreeBytes = _capacity - _usedBytes;
+	stats.Allocations = _allocations;
+
+	for (uint32_t fl = 0; fl < FLCount; ++fl) {
+		for (uint32_t sl = 0; sl < SLCount; ++sl) {
+			for (uint32_t block = _bins[fl][sl]; block != InvalidBlock; block = _blocks[block].NextFree) {
+				stats.FreeBlocks++;
+			}
+		}
+	}
+
+	// The largest block is in the highest non-empty bin, which spans a range of sizes.
+	if (_flBitmap != 0) {
+		uint32_t fl = HighestBit(_flBitmap);
+		uint32_t sl = HighestBit(_slBitmap[fl]);
+		for (uint32_t block = _bins[fl][sl]; block != InvalidBlock; block = _blocks[block].NextFree) {
+			if (_blocks[block].Size > stats.LargestFreeBlock) {
+				stats.LargestFreeBlock = _blocks[block].Size;
+			}
+		}
+	}
+
+	return stats;
+}
+
+bool TlsfAllocator::Validate() const {
+	// Physical chain: contiguous, covering the capacity, no two free blocks side by side.
+	uint64_t offset = 0;
+	uint64_t usedBytes = 0;
+	uint32_t allocations = 0;
+	uint32_t freeBlocks = 0;
+	uint32_t prev = InvalidBlock;
+
+	for (uint32_t block = 0; block != InvalidBlock; block = _blocks[block].NextPhysical) {
+		const Block& b = _blocks[block];
+		if (b.Offset != offset || b.Size == 0 || b.PrevPhysical != prev)
+			return false;
+		if (b.Free && prev != InvalidBlock && _blocks[prev].Free)
+			return false;
+
+		if (b.Free) {
+			freeBlocks++;
+		} else {
+			usedBytes += b.Size;
+			allocations++;
+		}
+
+		offset += b.Size;
+		prev = block;
+	}
+
+	if (offset != _capacity || usedBytes != _usedBytes || allocations != _allocations)
+		return false;
+
+	// Bins: every listed block is free, in the right bin, and the bitmaps match the lists.
+	uint32_t binned = 0;
+	for (uint32_t fl = 0; fl < FLCount; ++fl) {
+		bool flBit = (_flBitmap >> fl) & 1;
+		if (flBit != (_slBitmap[fl] != 0))
+			return false;
+
+		for (uint32_t sl = 0; sl < SLCount; ++sl) {
+			bool slBit = (_slBitmap[fl] >> sl) & 1;
+			if (slBit != (_bins[fl][sl] != InvalidBlock))
+				return false;
+
+			uint32_t prevFree = InvalidBlock;
+			for (uint32_t block = _bins[fl][sl]; block != InvalidBlock; block = _blocks[block].NextFree) {
+				const Block& b = _blocks[block];
+				uint32_t blockFl, blockSl;
+				Mapping(b.Size, blockFl, blockSl);
+				if (!b.Free || b.PrevFree != prevFree || blockFl != fl || blockSl != sl)
+					return false;
+
+				binned++;
+				prevFree = block;
+			}
+		}
+	}
+
+	return binned == freeBlocks;
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl) {
+	if (size < SLCount) {
+		// Small sizes get a bin each.
+		fl = 0;
+		sl = (uint32_t)size;
+	} else {
+		uint32_t bit = HighestBit(size);
+		fl = bit - SLBits + 1;
+		sl = (uint32_t)(size >> (bit - SLBits)) ^ SLCount;
+	}
+}
+
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t size) const {
+	// Round up to the next bin boundary so any block of the bin found fits.
+	if (size >= SLCount) {
+		size += (1ull << (HighestBit(size) - SLBits)) - 1;
+	}
+
+	uint32_t fl, sl;
+	Mapping(size, fl, sl);
+
+	uint32_t slMap = _slBitmap[fl] & (~0u << sl);
+	if (slMap == 0) {
+		uint64_t flMap = fl + 1 < FLCount ? _flBitmap & (~0ull << (fl + 1)) : 0;
+		if (flMap == 0)
+			return InvalidBlock;
+
+		fl = LowestBit(flMap);
+		slMap = _slBitmap[fl];
+	}
+
+	sl = LowestBit(slMap);
+	return _bins[fl][sl];
+}
+
+void TlsfAllocator::InsertFree(uint32_t block) {
+	uint32_t fl, sl;
+	Mapping(_blocks[block].Size, fl, sl);
+
+	Block& b = _blocks[block];
+	b.Free = true;
+	b.PrevFree = InvalidBlock;
+	b.NextFree = _bins[fl][sl];
+	if (b.NextFree != InvalidBlock) {
+		_blocks[b.NextFree].PrevFree = block;
+	}
+
+	_bins[fl][sl] = block;
+	_slBitmap[fl] |= 1u << sl;
+	_flBitmap |= 1ull << fl;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t block) {
+	uint32_t fl, sl;
+	Mapping(_blocks[block].Size, fl, sl);
+
+	Block& b = _blocks[block];
+	if (b.PrevFree != InvalidBlock) {
+		_blocks[b.PrevFree].NextFree = b.NextFree;
+	} else {
+		_bins[fl][sl] = b.NextFree;
+	}
+
+	if (b.NextFree != InvalidBlock) {
+		_blocks[b.NextFree].PrevFree = b.PrevFree;
+	}
+
+	if (_bins[fl][sl] == InvalidBlock) {
+		_slBitmap[fl] &= ~(1u << sl);
+		if (_slBitmap[fl] == 0) {
+			_flBitmap &= ~(1ull << fl);
+		}
+	}
+
+	b.Free = false;
+	b.PrevFree = InvalidBlock;
+	b.NextFree = InvalidBlock;
+}
+
+uint32_t TlsfAllocator::Split(uint32_t block, uint64_t size) {
+	// NewBlock() may grow _blocks, so no references across it.
+	uint32_t rest = NewBlock();
+
+	Block& b = _blocks[block];
+	Block& r = _blocks[rest];
+	r.Offset = b.Offset + size;
+	r.Size = b.Size - size;
+	r.PrevPhysical = block;
+	r.NextPhysical = b.NextPhysical;
+	if (r.NextPhysical != InvalidBlock) {
+		_blocks[r.NextPhysical].PrevPhysical = rest;
+	}
+
+	b.Size = size;
+	b.NextPhysical = rest;
+	return rest;
+}
+
+void TlsfAllocator::Merge(uint32_t block, uint32_t next) {
+	Block& b = _blocks[block];
+	const Block& n = _blocks[next];
+	b.Size += n.Size;
+	b.NextPhysical = n.NextPhysical;
+	if (b.NextPhysical != InvalidBlock) {
+		_blocks[b.NextPhysical].PrevPhysical = block;
+	}
+
+	DeleteBlock(next);
+}
+
+uint32_t TlsfAllocator::NewBlock() {
+	if (!_unusedBlocks.empty()) {
+		uint32_t block = _unusedBlocks.back();
+		_unusedBlocks.pop_back();
+		return block;
+	}
+
+	_blocks.emplace_back();
+	return (uint32_t)_blocks.size() - 1;
+}
+
+void TlsfAllocator::DeleteBlock(uint32_t block) {
+	_blocks[block] = Block();
+	_unusedBlocks.push_back(block);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit allocator over a range of capacity bytes. Free blocks are binned by size
+// into power-of-two classes, each split into SLCount linear sub-classes, and two levels of bitmaps
+// find a fitting bin in constant time. Freed blocks merge with free neighbours at once.
+//
+// Block headers live in a side table instead of in the managed memory, so the range can be a
+// D3D12 heap the CPU cannot touch. No D3D dependency: fuzz or benchmark it on offsets alone.
+class TlsfAllocator {
+public:
+	static const uint32_t InvalidBlock = 0xffffffff;
+
+	struct Allocation {
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+		uint32_t Block = InvalidBlock;
+	};
+
+	struct Stats {
+		uint64_t Capacity = 0;
+		uint64_t UsedBytes = 0;
+		uint64_t FreeBytes = 0;
+		uint64_t LargestFreeBlock = 0;
+		uint32_t Allocations = 0;
+		uint32_t FreeBlocks = 0;
+
+		// 0 when all free space is one block, towards 1 as it is scattered into small pieces.
+		double Fragmentation() const {
+			return FreeBytes == 0 ? 0.0 : 1.0 - (double)LargestFreeBlock / (double)FreeBytes;
+		}
+	};
+
+public:
+	TlsfAllocator(uint64_t capacity);
+
+public:
+	// Returns false if no free block can hold size bytes at the requested alignment (a power of two).
+	bool Allocate(uint64_t size, uint64_t alignment, Allocation& allocation);
+
+	void Free(const Allocation& allocation);
+
+	uint64_t Capacity() const {
+		return _capacity;
+	}
+
+	bool Empty() const {
+		return _allocations == 0;
+	}
+
+	Stats GetStats() const;
+
+	// Walks every block and bin and checks they agree. For tests and fuzzing; linear in the block count.
+	bool Validate() const;
+
+private:
+	static const uint32_t SLBits = 5;
+	static const uint32_t SLCount = 1 << SLBits;
+	static const uint32_t FLCount = 64 - SLBits + 1;
+
+	struct Block {
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+		uint32_t PrevPhysical = InvalidBlock;
+		uint32_t NextPhysical = InvalidBlock;
+		uint32_t PrevFree = InvalidBlock;
+		uint32_t NextFree = InvalidBlock;
+		bool Free = false;
+	};
+
+	static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+	uint32_t FindFreeBlock(uint64_t size) const;
+	void InsertFree(uint32_t block);
+	void RemoveFree(uint32_t block);
+
+	// Cuts size bytes off the front of block; the rest becomes a new free block, which is returned.
+	uint32_t Split(uint32_t block, uint64_t size);
+
+	// Absorbs next into block. Both must be free and unlinked from the bins.
+	void Merge(uint32_t block, uint32_t next);
+
+	uint32_t NewBlock();
+	void DeleteBlock(uint32_t block);
+
+private:
+	uint64_t _capacity;
+	uint64_t _usedBytes = 0;
+	uint32_t _allocations = 0;
+
+	uint64_t _flBitmap = 0;
+	uint32_t _slBitmap[FLCount] = {};
+	uint32_t _bins[FLCount][SLCount];
+
+	std::vector<Block> _blocks;
+	std::vector<uint32_t> _unusedBlocks;
+};
@@ -1,11 +1,19 @@
 #pragma once
 
 #include "D3DUtil.h"
+#include "DirtyRangeSet.h"
+#include "StreamCopy.h"
+#include "UploadStats.h"
+
+#include <cassert>
+#include <typeinfo>
 
 template<typename T>
 class UploadBuffer {
 public:
-	UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer) : _isConstantBuffer(isConstantBuffer) {
+	UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer) :
+		_isConstantBuffer(isConstantBuffer),
+		_stats(&UploadStats::Get(typeid(T).name())) {
 		_elementByteSize = sizeof(T);
 
 		// Constant buffer elements need to be multiples of 256 bytes.
@@ -25,7 +33,11 @@ public:
 			IID_PPV_ARGS(&_uploadBuffer)
 		));
 
-		ThrowIfFailed(_uploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&_mappedData)));
+		// The CPU never reads this memory back: upload heaps are write-combined, and a read is an
+		// uncached round trip over the bus.
+		CD3DX12_RANGE readRange(0, 0);
+		ThrowIfFailed(_uploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&_mappedData)));
+		_byteSize = _elementByteSize * elementCount;
 
 		// We do not need to unmap until we are done with the resource. However, we must not write to
 		// the resource while it is in use by the GPU (so we must use synchronization techniques).
@@ -48,7 +60,82 @@ public:
 	}
 
 	void CopyData(int elementIndex, const T& data) {
+		AssertNotMapped(&data, sizeof(T));
 		memcpy(&_mappedData[elementIndex * _elementByteSize], &data, sizeof(T));
+		MarkWritten(elementIndex, 1, sizeof(T));
+	}
+
+	// Copies only the first byteSize bytes of data, for elements whose tail the shaders will not
+	// read (the light slots past the ones a shader variant loops over, say).
+	void CopyPrefix(int elementIndex, const T& data, UINT byteSize) {
+		assert(byteSize <= sizeof(T));
+		AssertNotMapped(&data, byteSize);
+		memcpy(&_mappedData[elementIndex * _elementByteSize], &data, byteSize);
+		MarkWritten(elementIndex, 1, byteSize);
+	}
+
+	// Copies count contiguous elements starting at elementIndex. Constant buffer elements are spread
+	// onto their 256-byte slots.
+	void CopyRange(int elementIndex, const T* data, UINT count) {
+		CopyStrided(elementIndex, data, sizeof(T), count);
+	}
+
+	// Same, reading the source elements every srcStride bytes.
+	void CopyStrided(int elementIndex, const void* data, UINT srcStride, UINT count) {
+		assert((elementIndex + count) * _elementByteSize <= _byteSize);
+		AssertNotMapped(data, (size_t)srcStride * count);
+
+		StreamCopy::CopyStrided(&_mappedData[elementIndex * _elementByteSize], _elementByteSize, data, srcStride, sizeof(T), count);
+		StreamCopy::Fence();
+		MarkWritten(elementIndex, count, (UINT64)count * sizeof(T));
+	}
+
+	// For callers that fill elements themselves, from worker threads say: the slot of element
+	// elementIndex in the mapped memory, and the distance between slots. Writes made this way are
+	// reported with MarkElementsWritten() on the thread that owns the buffer, as the bookkeeping is
+	// not thread-safe.
+	BYTE* MappedElement(int elementIndex) const {
+		return &_mappedData[elementIndex * _elementByteSize];
+	}
+
+	UINT ElementByteSize() const {
+		return _elementByteSize;
+	}
+
+	UINT ElementCount() const {
+		return _byteSize / _elementByteSize;
+	}
+
+	void MarkElementsWritten(int elementIndex, UINT count) {
+		assert((elementIndex + count) * _elementByteSize <= _byteSize);
+		MarkWritten(elementIndex, count, (UINT64)count * sizeof(T));
+	}
+
+	// Byte ranges written since the last ClearDirtyRanges(), merged. Constant buffer ranges cover
+	// whole 256-byte slots so neighbouring elements merge into one range.
+	const DirtyRangeSet& DirtyRanges() const {
+		return _dirtyRanges;
+	}
+
+	// Call when the buffer's frame starts over, after its fence has completed.
+	void ClearDirtyRanges() {
+		_dirtyRanges.Clear();
+	}
+
+private:
+	void MarkWritten(int elementIndex, UINT count, UINT64 bytesCopied) {
+		UINT64 begin = (UINT64)elementIndex * _elementByteSize;
+		_dirtyRanges.Add(begin, begin + (UINT64)count * _elementByteSize);
+
+		_stats->Bytes += bytesCopied;
+		_stats->Copies++;
+	}
+
+	// Debug builds catch copies whose source lies in the mapped buffer itself (copying one element
+	// onto another, say), which would read write-combined memory.
+	void AssertNotMapped(const void* data, size_t byteSize) const {
+		const BYTE* p = static_cast<const BYTE*>(data);
+		assert(p + byteSize <= _mappedData || p >= _mappedData + _byteSize);
 	}
 
 private:
@@ -56,5 +143,9 @@ private:
 	BYTE* _mappedData = nullptr;
 
 	UINT _elementByteSize = 0;
+	UINT _byteSize = 0;
 	bool _isConstantBuffer = false;
+
+	DirtyRangeSet _dirtyRanges;
+	UploadStats::Counter* _stats = nullptr;
 };
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "D3DUtil.h"
+#include "RingAllocator.h"
+#include "StreamCopy.h"
+
+// One persistently mapped upload buffer shared by all per-frame data (constants, dynamic vertices).
+// Space is handed out on demand and recycled once the frame that used it has finished on the GPU,
+// so callers no longer size a buffer per type up front.
+class UploadRing {
+public:
+	struct Allocation {
+		BYTE* CPU = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS GPU = 0;
+		UINT64 Size = 0;
+	};
+
+public:
+	UploadRing(ID3D12Device* device, UINT64 byteSize) : _ring(byteSize) {
+		ThrowIfFailed(device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&_uploadBuffer)
+		));
+
+		// Write-only from the CPU, see UploadBuffer.
+		CD3DX12_RANGE readRange(0, 0);
+		ThrowIfFailed(_uploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&_mappedData)));
+	}
+
+	UploadRing(const UploadRing& rhs) = delete;
+
+	UploadRing& operator=(const UploadRing& rhs) = delete;
+
+	~UploadRing() {
+		if (_uploadBuffer != nullptr) {
+			_uploadBuffer->Unmap(0, nullptr);
+		}
+
+		_mappedData = nullptr;
+	}
+
+	ID3D12Resource* Resource() const {
+		return _uploadBuffer.Get();
+	}
+
+	// The default alignment suits constant buffers, which is also enough for vertex and index data.
+	Allocation Allocate(UINT64 byteSize, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT) {
+		UINT64 offset = 0;
+		if (!_ring.Allocate(byteSize, alignment, offset)) {
+			// Every frame in flight together needs more than the ring holds.
+			throw DxException(E_OUTOFMEMORY, L"UploadRing::Allocate", AnsiToWString(__FILE__), __LINE__);
+		}
+
+		Allocation allocation;
+		allocation.CPU = _mappedData + offset;
+		allocation.GPU = _uploadBuffer->GetGPUVirtualAddress() + offset;
+		allocation.Size = byteSize;
+		return allocation;
+	}
+
+	// Call once per frame, after signalling fence for the frame's command lists.
+	void EndFrame(UINT64 fence) {
+		_ring.EndFrame(fence);
+	}
+
+	// Call with the fence's completed value before allocating for a new frame.
+	void Retire(UINT64 completedFence) {
+		_ring.Retire(completedFence);
+	}
+
+	UINT64 Used() const {
+		return _ring.Used();
+	}
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Resource> _uploadBuffer;
+	BYTE* _mappedData = nullptr;
+
+	RingAllocator _ring;
+};
@@ -0,0 +1,36 @@
+#include "UploadScheduler.h"
+
+#include <cassert>
+
+UploadScheduler::Ticket UploadScheduler::Enqueue() {
+	return _nextTicket++;
+}
+
+void UploadScheduler::Submit(uint64_t fence) {
+	assert(_batches.empty() || _batches.back().Fence < fence);
+
+	_batches.push_back({ fence, _nextTicket });
+	_submittedEnd = _nextTicket;
+}
+
+uint32_t UploadScheduler::Retire(uint64_t completedFence) {
+	uint32_t retired = 0;
+	while (!_batches.empty() && _batches.front().Fence <= completedFence) {
+		_completedEnd = _batches.front().End;
+		_batches.pop_front();
+		retired++;
+	}
+	return retired;
+}
+
+uint64_t UploadScheduler::FenceOf(Ticket ticket) const {
+	if (IsComplete(ticket) || !IsSubmitted(ticket))
+		return 0;
+
+	// Only batches in flight are left; there are a handful at most.
+	for (const Batch& batch : _batches) {
+		if (ticket < batch.End)
+			return batch.Fence;
+	}
+	return 0;
+}
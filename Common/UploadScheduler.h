@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Bookkeeping for uploads running on their own queue. Each upload gets a ticket; uploads are grouped
+// into batches, and a batch is submitted with the fence value the queue signals after it. Works on
+// fence values only, so it can be driven by a fake queue and fence as well as by CopyUploadQueue.
+//
+// Tickets increase and one queue finishes batches in submission order, so a ticket is complete
+// exactly when every earlier ticket is: waiting on the highest ticket an object needs covers all.
+class UploadScheduler {
+public:
+	// 0 is never handed out and always reads as complete, for things with nothing to upload.
+	typedef uint64_t Ticket;
+
+public:
+	// Adds an upload to the open batch.
+	Ticket Enqueue();
+
+	bool HasOpenBatch() const {
+		return _nextTicket != _submittedEnd;
+	}
+
+	// Closes the open batch; it is complete once the queue's fence reaches fence. Fences must increase.
+	void Submit(uint64_t fence);
+
+	// Completes every batch whose fence is <= completedFence and returns how many there were, oldest
+	// first, so the caller can release what it kept for them.
+	uint32_t Retire(uint64_t completedFence);
+
+	bool IsComplete(Ticket ticket) const {
+		return ticket < _completedEnd;
+	}
+
+	bool IsSubmitted(Ticket ticket) const {
+		return ticket < _submittedEnd;
+	}
+
+	// Fence value that completes ticket, or 0 if it is complete or not yet submitted.
+	uint64_t FenceOf(Ticket ticket) const;
+
+	// Highest ticket handed out so far (0 if none).
+	Ticket LastTicket() const {
+		return _nextTicket - 1;
+	}
+
+	uint32_t InFlightBatches() const {
+		return (uint32_t)_batches.size();
+	}
+
+private:
+	struct Batch {
+		uint64_t Fence;
+		Ticket End;		// One past the batch's last ticket.
+	};
+
+	Ticket _nextTicket = 1;
+	Ticket _submittedEnd = 1;
+	Ticket _completedEnd = 1;
+
+	std::deque<Batch> _batches;
+};
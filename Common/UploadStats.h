@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+// Bytes the CPU wrote into upload buffers, one counter per element type. UploadBuffer feeds it;
+// apps read it for their frame stats and reset it after each report.
+class UploadStats {
+public:
+	struct Counter {
+		std::string Name;
+		uint64_t Bytes = 0;
+		uint64_t Copies = 0;
+	};
+
+public:
+	// Returns the counter called name, creating it on first use. The reference stays valid.
+	static Counter& Get(const std::string& name) {
+		for (Counter& counter : Storage()) {
+			if (counter.Name == name)
+				return counter;
+		}
+
+		Storage().push_back({ name });
+		return Storage().back();
+	}
+
+	static const std::deque<Counter>& Counters() {
+		return Storage();
+	}
+
+	static void Reset() {
+		for (Counter& counter : Storage()) {
+			counter.Bytes = 0;
+			counter.Copies = 0;
+		}
+	}
+
+private:
+	// A deque never moves its elements when growing at the back, so UploadBuffers can hold on to
+	// their counter.
+	static std::deque<Counter>& Storage() {
+		static std::deque<Counter> counters;
+		return counters;
+	}
+};
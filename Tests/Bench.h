@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// A minimal timing harness for the benchmarks next to the tests. Each benchmark is its own
+// executable with a main() that calls Bench::Report; they are built but not run by ctest.
+namespace Bench {
+	// Keeps the compiler from dropping a result that is otherwise unused.
+	template <typename T>
+	inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static const T* volatile sink;
+		sink = &value;
+#endif
+	}
+
+	// Calls fn until at least minSeconds have passed, doubling the batch each round so the clock is
+	// read rarely, and returns the mean seconds per call. fn is called once first to warm caches.
+	template <typename Fn>
+	double SecondsPerCall(Fn&& fn, double minSeconds = 0.5) {
+		using Clock = std::chrono::steady_clock;
+		fn();
+
+		uint64_t calls = 0;
+		uint64_t batch = 1;
+		double elapsed = 0.0;
+		while (elapsed < minSeconds) {
+			auto start = Clock::now();
+			for (uint64_t i = 0; i < batch; ++i) {
+				fn();
+			}
+			elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+			calls += batch;
+			batch *= 2;
+		}
+		return elapsed / (double)calls;
+	}
+
+	// Times fn, which does itemsPerCall units of work, and prints the time per call and per item.
+	template <typename Fn>
+	double Report(const char* name, uint64_t itemsPerCall, Fn&& fn) {
+		double seconds = SecondsPerCall(fn);
+		double nsPerItem = seconds * 1e9 / (double)itemsPerCall;
+		printf("%-48s %12.3f us/call %10.2f ns/item\n", name, seconds * 1e6, nsPerItem);
+		return nsPerItem;
+	}
+}
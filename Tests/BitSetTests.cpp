@@ -0,0 +1,120 @@
+#include "Check.h"
+
+#include "BitSet.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+	std::vector<uint32_t> Indices(const BitSet& bits) {
+		std::vector<uint32_t> indices;
+		bits.ForEach([&](uint32_t index) { indices.push_back(index); });
+		return indices;
+	}
+}
+
+TEST_CASE(SetResetAndTest) {
+	BitSet bits;
+	bits.Resize(200);
+	CHECK(bits.Size() == 200);
+	CHECK(!bits.Any());
+
+	bits.Set(0);
+	bits.Set(63);
+	bits.Set(64);
+	bits.Set(199);
+	bits.Assign(100, true);
+	bits.Assign(63, false);
+	bits.Reset(0);
+	CHECK((Indices(bits) == std::vector<uint32_t>{ 64, 100, 199 }));
+	CHECK(bits.Test(64) && !bits.Test(63) && !bits.Test(0));
+
+	bits.ClearAll();
+	CHECK(!bits.Any());
+	CHECK(bits.Size() == 200);
+}
+
+TEST_CASE(LowestBitFindsTheTrailingZeroCount) {
+	CHECK(BitSet::LowestBit(1) == 0);
+	CHECK(BitSet::LowestBit(0x8000000000000000ull) == 63);
+	CHECK(BitSet::LowestBit(0x0000000000f00000ull) == 20);
+}
+
+TEST_CASE(ResizeMasksTheTailBits) {
+	BitSet bits;
+	bits.Resize(130);
+	bits.SetAll();
+	REQUIRE(bits.WordCount() == 3);
+	CHECK(bits.Words()[2] == 0x3);	// Only 128 and 129; SetAll() leaves the rest of the word clear.
+	CHECK(Indices(bits).size() == 130);
+
+	// Shrinking into the middle of a word clears the bits past the new end...
+	bits.Resize(65);
+	REQUIRE(bits.WordCount() == 2);
+	CHECK(bits.Words()[0] == ~0ull);
+	CHECK(bits.Words()[1] == 0x1);
+	CHECK(Indices(bits).size() == 65);
+
+	// ...so growing again does not bring them back.
+	bits.Resize(200);
+	std::vector<uint32_t> indices = Indices(bits);
+	CHECK(indices.size() == 65 && indices.back() == 64);
+	CHECK(!bits.Test(65) && !bits.Test(129) && !bits.Test(199));
+
+	// A size on a word boundary keeps the whole last word.
+	bits.SetAll();
+	bits.Resize(128);
+	CHECK(bits.WordCount() == 2 && bits.Words()[1] == ~0ull);
+
+	bits.Resize(0);
+	CHECK(bits.WordCount() == 0 && !bits.Any());
+}
+
+TEST_CASE(ForEachClearVisitsInOrderAndClears) {
+	BitSet bits;
+	bits.Resize(300);
+	bits.Set(257);
+	bits.Set(3);
+	bits.Set(64);
+	bits.Set(2);
+
+	std::vector<uint32_t> visited;
+	bits.ForEachClear([&](uint32_t index) { visited.push_back(index); });
+	CHECK((visited == std::vector<uint32_t>{ 2, 3, 64, 257 }));
+	CHECK(!bits.Any());
+}
+
+// Random operations against a std::vector<bool>.
+TEST_CASE(RandomOperationsMatchAVectorOfBool) {
+	for (uint32_t seed = 0; seed < 50; ++seed) {
+		std::mt19937 random(seed);
+		BitSet bits;
+		std::vector<bool> reference;
+
+		for (uint32_t operation = 0; operation < 500; ++operation) {
+			uint32_t kind = random() % 10;
+			if (kind == 0 || reference.empty()) {
+				uint32_t size = random() % 300;
+				bits.Resize(size);
+				reference.resize(size, false);
+			} else if (kind == 1) {
+				bits.SetAll();
+				reference.assign(reference.size(), true);
+			} else {
+				uint32_t index = random() % reference.size();
+				bool value = random() % 2 == 0;
+				bits.Assign(index, value);
+				reference[index] = value;
+			}
+
+			std::vector<uint32_t> expected;
+			for (uint32_t i = 0; i < reference.size(); ++i) {
+				if (reference[i])
+					expected.push_back(i);
+			}
+			REQUIRE(Indices(bits) == expected);
+			REQUIRE(bits.Any() == !expected.empty());
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+// A minimal harness for the Common tests, so the target needs nothing beyond a C++ compiler.
+// TEST_CASE defines a function that TestMain.cpp runs; CHECK reports a failed expression and keeps
+// going, REQUIRE also leaves the test case.
+namespace Check {
+	struct TestCase {
+		const char* Name;
+		void (*Fn)();
+	};
+
+	inline std::vector<TestCase>& TestCases() {
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	inline int& FailureCount() {
+		static int failureCount = 0;
+		return failureCount;
+	}
+
+	inline void Fail(const char* file, int line, const char* expression) {
+		fprintf(stderr, "%s(%d): failed: %s\n", file, line, expression);
+		FailureCount()++;
+	}
+
+	struct Registrar {
+		Registrar(const char* name, void (*fn)()) {
+			TestCases().push_back({ name, fn });
+		}
+	};
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static Check::Registrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) \
+			Check::Fail(__FILE__, __LINE__, #expression); \
+	} while (false)
+
+#define REQUIRE(expression) \
+	do { \
+		if (!(expression)) { \
+			Check::Fail(__FILE__, __LINE__, #expression); \
+			return; \
+		} \
+	} while (false)
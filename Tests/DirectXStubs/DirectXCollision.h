@@ -0,0 +1,172 @@
+#pragma once
+
+#include "DirectXMath.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+
+// Stand-ins for the DirectXCollision types the tested Common code uses; see DirectXMath.h. The
+// members, plane order and tests follow DirectXCollision, including BoundingFrustum::Contains,
+// which classifies a box against the six normalized planes by center distance and projected
+// extent.
+namespace DirectX {
+	enum ContainmentType {
+		DISJOINT = 0,
+		INTERSECTS = 1,
+		CONTAINS = 2,
+	};
+
+	struct BoundingBox {
+		static const size_t CORNER_COUNT = 8;
+
+		XMFLOAT3 Center;
+		XMFLOAT3 Extents;
+
+		BoundingBox() : Center(0.0f, 0.0f, 0.0f), Extents(1.0f, 1.0f, 1.0f) {}
+		constexpr BoundingBox(const XMFLOAT3& center, const XMFLOAT3& extents) : Center(center), Extents(extents) {}
+
+		void GetCorners(XMFLOAT3* corners) const {
+			static const float offsets[CORNER_COUNT][3] = {
+				{ -1.0f, -1.0f, 1.0f }, { 1.0f, -1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f }, { -1.0f, 1.0f, 1.0f },
+				{ -1.0f, -1.0f, -1.0f }, { 1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f }, { -1.0f, 1.0f, -1.0f },
+			};
+			for (size_t i = 0; i < CORNER_COUNT; ++i) {
+				corners[i] = XMFLOAT3(Center.x + offsets[i][0] * Extents.x, Center.y + offsets[i][1] * Extents.y,
+									  Center.z + offsets[i][2] * Extents.z);
+			}
+		}
+
+		// Classifies the box against six planes whose normals point out of the volume.
+		ContainmentType ContainedBy(const XMVECTOR* planes) const {
+			bool inside = true;
+			for (int i = 0; i < 6; ++i) {
+				const float* p = planes[i].v;
+				float distance = p[0] * Center.x + p[1] * Center.y + p[2] * Center.z + p[3];
+				float radius = fabsf(p[0]) * Extents.x + fabsf(p[1]) * Extents.y + fabsf(p[2]) * Extents.z;
+				if (distance > radius)
+					return DISJOINT;
+				inside = inside && distance < -radius;
+			}
+			return inside ? CONTAINS : INTERSECTS;
+		}
+
+		static void CreateFromPoints(BoundingBox& out, size_t count, const XMFLOAT3* points, size_t stride) {
+			XMFLOAT3 lo(FLT_MAX, FLT_MAX, FLT_MAX);
+			XMFLOAT3 hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (size_t i = 0; i < count; ++i) {
+				const XMFLOAT3& point = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(points) + i * stride);
+				lo = XMFLOAT3(std::min(lo.x, point.x), std::min(lo.y, point.y), std::min(lo.z, point.z));
+				hi = XMFLOAT3(std::max(hi.x, point.x), std::max(hi.y, point.y), std::max(hi.z, point.z));
+			}
+			out.Center = XMFLOAT3(0.5f * (lo.x + hi.x), 0.5f * (lo.y + hi.y), 0.5f * (lo.z + hi.z));
+			out.Extents = XMFLOAT3(0.5f * (hi.x - lo.x), 0.5f * (hi.y - lo.y), 0.5f * (hi.z - lo.z));
+		}
+	};
+
+	// A view frustum looking down +z from Origin, rotated by Orientation. The slopes are x/z and y/z
+	// of the side planes.
+	struct BoundingFrustum {
+		static const size_t CORNER_COUNT = 8;
+
+		XMFLOAT3 Origin;
+		XMFLOAT4 Orientation;
+		float RightSlope;
+		float LeftSlope;
+		float TopSlope;
+		float BottomSlope;
+		float Near;
+		float Far;
+
+		BoundingFrustum()
+			: Origin(0.0f, 0.0f, 0.0f), Orientation(0.0f, 0.0f, 0.0f, 1.0f), RightSlope(1.0f), LeftSlope(-1.0f),
+			  TopSlope(1.0f), BottomSlope(-1.0f), Near(0.0f), Far(1.0f) {}
+
+		constexpr BoundingFrustum(const XMFLOAT3& origin, const XMFLOAT4& orientation, float rightSlope, float leftSlope,
+								  float topSlope, float bottomSlope, float nearPlane, float farPlane)
+			: Origin(origin), Orientation(orientation), RightSlope(rightSlope), LeftSlope(leftSlope),
+			  TopSlope(topSlope), BottomSlope(bottomSlope), Near(nearPlane), Far(farPlane) {}
+
+		// m must be a rotation, uniform scale and translation.
+		void Transform(BoundingFrustum& out, FXMMATRIX m) const {
+			XMMATRIX rotation = { { XMVector3Normalize(m.r[0]), XMVector3Normalize(m.r[1]), XMVector3Normalize(m.r[2]),
+									XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+			XMVECTOR orientation = XMQuaternionMultiply(XMLoadFloat4(&Orientation), XMQuaternionRotationMatrix(rotation));
+			XMVECTOR origin = XMVector3Transform(XMLoadFloat3(&Origin), m);
+
+			float scale = sqrtf(std::max(XMVector3DotScalar(m.r[0], m.r[0]),
+										 std::max(XMVector3DotScalar(m.r[1], m.r[1]), XMVector3DotScalar(m.r[2], m.r[2]))));
+
+			XMStoreFloat3(&out.Origin, origin);
+			XMStoreFloat4(&out.Orientation, orientation);
+			out.RightSlope = RightSlope;
+			out.LeftSlope = LeftSlope;
+			out.TopSlope = TopSlope;
+			out.BottomSlope = BottomSlope;
+			out.Near = Near * scale;
+			out.Far = Far * scale;
+		}
+
+		// Near, far, right, left, top, bottom; normalized, normals pointing out.
+		void GetPlanes(XMVECTOR* nearPlane, XMVECTOR* farPlane, XMVECTOR* rightPlane, XMVECTOR* leftPlane,
+					   XMVECTOR* topPlane, XMVECTOR* bottomPlane) const {
+			XMVECTOR planes[6];
+			Planes(planes);
+			*nearPlane = planes[0];
+			*farPlane = planes[1];
+			*rightPlane = planes[2];
+			*leftPlane = planes[3];
+			*topPlane = planes[4];
+			*bottomPlane = planes[5];
+		}
+
+		ContainmentType Contains(const BoundingBox& box) const {
+			XMVECTOR planes[6];
+			Planes(planes);
+			return box.ContainedBy(planes);
+		}
+
+		static void CreateFromMatrix(BoundingFrustum& out, FXMMATRIX projection) {
+			// Corners of the projection volume in homogeneous space, back to view space.
+			static const float points[6][4] = {
+				{ 1.0f, 0.0f, 1.0f, 1.0f }, { -1.0f, 0.0f, 1.0f, 1.0f }, { 0.0f, 1.0f, 1.0f, 1.0f },
+				{ 0.0f, -1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 1.0f },
+			};
+
+			XMMATRIX inverse = XMMatrixInverse(nullptr, projection);
+			XMVECTOR view[6];
+			for (int i = 0; i < 6; ++i) {
+				XMVECTOR p = XMVector4Transform(XMVectorSet(points[i][0], points[i][1], points[i][2], points[i][3]), inverse);
+				view[i] = XMVectorSet(p.v[0] / p.v[3], p.v[1] / p.v[3], p.v[2] / p.v[3], 1.0f);
+			}
+
+			out.Origin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			out.Orientation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			out.RightSlope = view[0].v[0] / view[0].v[2];
+			out.LeftSlope = view[1].v[0] / view[1].v[2];
+			out.TopSlope = view[2].v[1] / view[2].v[2];
+			out.BottomSlope = view[3].v[1] / view[3].v[2];
+			out.Near = view[4].v[2];
+			out.Far = view[5].v[2];
+		}
+
+	private:
+		void Planes(XMVECTOR* planes) const {
+			planes[0] = XMVectorSet(0.0f, 0.0f, -1.0f, Near);
+			planes[1] = XMVectorSet(0.0f, 0.0f, 1.0f, -Far);
+			planes[2] = XMVectorSet(1.0f, 0.0f, -RightSlope, 0.0f);
+			planes[3] = XMVectorSet(-1.0f, 0.0f, LeftSlope, 0.0f);
+			planes[4] = XMVectorSet(0.0f, 1.0f, -TopSlope, 0.0f);
+			planes[5] = XMVectorSet(0.0f, -1.0f, BottomSlope, 0.0f);
+
+			XMVECTOR orientation = XMLoadFloat4(&Orientation);
+			XMVECTOR origin = XMLoadFloat3(&Origin);
+			for (int i = 0; i < 6; ++i) {
+				// Rotate the normal, then move the plane with the origin.
+				XMVECTOR normal = XMVector3Rotate(planes[i], orientation);
+				float d = planes[i].v[3] - XMVector3DotScalar(normal, origin);
+				planes[i] = XMPlaneNormalize(XMVectorSet(normal.v[0], normal.v[1], normal.v[2], d));
+			}
+		}
+	};
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+// Stand-ins for the parts of DirectXMath the tested Common code uses, so it builds on Linux without
+// the Windows SDK. Types have the real layouts and functions the real (row vector, left handed)
+// conventions, written out in plain scalar code. MSVC builds use the SDK's headers instead.
+namespace DirectX {
+	const float XM_PI = 3.141592654f;
+
+	struct XMFLOAT3 {
+		float x;
+		float y;
+		float z;
+
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4 {
+		float x;
+		float y;
+		float z;
+		float w;
+
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct XMFLOAT4X4 {
+		float m[4][4];
+
+		XMFLOAT4X4() = default;
+		constexpr XMFLOAT4X4(float m00, float m01, float m02, float m03,
+							 float m10, float m11, float m12, float m13,
+							 float m20, float m21, float m22, float m23,
+							 float m30, float m31, float m32, float m33)
+			: m{ { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { m30, m31, m32, m33 } } {}
+
+		float operator()(size_t row, size_t column) const {
+			return m[row][column];
+		}
+
+		float& operator()(size_t row, size_t column) {
+			return m[row][column];
+		}
+	};
+
+	struct XMVECTOR {
+		float v[4];
+	};
+
+	struct XMMATRIX {
+		XMVECTOR r[4];
+	};
+
+	typedef const XMVECTOR FXMVECTOR;
+	typedef const XMMATRIX FXMMATRIX;
+	typedef const XMMATRIX& CXMMATRIX;
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) {
+		return { { x, y, z, w } };
+	}
+
+	inline XMVECTOR XMVectorReplicate(float value) {
+		return { { value, value, value, value } };
+	}
+
+	inline float XMVectorGetX(FXMVECTOR v) {
+		return v.v[0];
+	}
+
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) {
+		return { { source->x, source->y, source->z, 0.0f } };
+	}
+
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) {
+		return { { source->x, source->y, source->z, source->w } };
+	}
+
+	inline void XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v) {
+		*destination = XMFLOAT3(v.v[0], v.v[1], v.v[2]);
+	}
+
+	inline void XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) {
+		*destination = XMFLOAT4(v.v[0], v.v[1], v.v[2], v.v[3]);
+	}
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source) {
+		XMMATRIX m;
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				m.r[row].v[column] = source->m[row][column];
+			}
+		}
+		return m;
+	}
+
+	inline void XMStoreFloat4x4(XMFLOAT4X4* destination, FXMMATRIX m) {
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				destination->m[row][column] = m.r[row].v[column];
+			}
+		}
+	}
+
+	inline float XMVector3DotScalar(FXMVECTOR a, FXMVECTOR b) {
+		return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
+	}
+
+	inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b) {
+		return XMVectorReplicate(XMVector3DotScalar(a, b));
+	}
+
+	inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b) {
+		return XMVectorSet(a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2],
+						   a.v[0] * b.v[1] - a.v[1] * b.v[0], 0.0f);
+	}
+
+	inline XMVECTOR XMVector3Normalize(FXMVECTOR v) {
+		float length = sqrtf(XMVector3DotScalar(v, v));
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		return XMVectorSet(v.v[0] * scale, v.v[1] * scale, v.v[2] * scale, v.v[3] * scale);
+	}
+
+	inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) {
+		return XMVectorSet(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]);
+	}
+
+	// v as a row vector times m.
+	inline XMVECTOR XMVector4Transform(FXMVECTOR v, FXMMATRIX m) {
+		XMVECTOR result;
+		for (int column = 0; column < 4; ++column) {
+			result.v[column] = v.v[0] * m.r[0].v[column] + v.v[1] * m.r[1].v[column] +
+							   v.v[2] * m.r[2].v[column] + v.v[3] * m.r[3].v[column];
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMVector3Transform(FXMVECTOR v, FXMMATRIX m) {
+		return XMVector4Transform(XMVectorSet(v.v[0], v.v[1], v.v[2], 1.0f), m);
+	}
+
+	inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m) {
+		XMVECTOR result = XMVector3Transform(v, m);
+		float invW = 1.0f / result.v[3];
+		return XMVectorSet(result.v[0] * invW, result.v[1] * invW, result.v[2] * invW, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixSet(float m00, float m01, float m02, float m03,
+								float m10, float m11, float m12, float m13,
+								float m20, float m21, float m22, float m23,
+								float m30, float m31, float m32, float m33) {
+		return { { XMVectorSet(m00, m01, m02, m03), XMVectorSet(m10, m11, m12, m13),
+				   XMVectorSet(m20, m21, m22, m23), XMVectorSet(m30, m31, m32, m33) } };
+	}
+
+	inline XMMATRIX XMMatrixIdentity() {
+		return XMMatrixSet(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b) {
+		XMMATRIX result;
+		for (int row = 0; row < 4; ++row) {
+			result.r[row] = XMVector4Transform(a.r[row], b);
+		}
+		return result;
+	}
+
+	inline XMMATRIX XMMatrixTranslation(float x, float y, float z) {
+		return XMMatrixSet(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, x, y, z, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixScaling(float x, float y, float z) {
+		return XMMatrixSet(x, 0.0f, 0.0f, 0.0f, 0.0f, y, 0.0f, 0.0f, 0.0f, 0.0f, z, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixRotationX(float angle) {
+		float s = sinf(angle), c = cosf(angle);
+		return XMMatrixSet(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixRotationY(float angle) {
+		float s = sinf(angle), c = cosf(angle);
+		return XMMatrixSet(c, 0.0f, -s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eye, FXMVECTOR focus, FXMVECTOR up) {
+		XMVECTOR z = XMVector3Normalize(XMVectorSubtract(focus, eye));
+		XMVECTOR x = XMVector3Normalize(XMVector3Cross(up, z));
+		XMVECTOR y = XMVector3Cross(z, x);
+		return XMMatrixSet(x.v[0], y.v[0], z.v[0], 0.0f,
+						   x.v[1], y.v[1], z.v[1], 0.0f,
+						   x.v[2], y.v[2], z.v[2], 0.0f,
+						   -XMVector3DotScalar(x, eye), -XMVector3DotScalar(y, eye), -XMVector3DotScalar(z, eye), 1.0f);
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ) {
+		float height = 1.0f / tanf(0.5f * fovAngleY);
+		float width = height / aspectRatio;
+		float range = farZ / (farZ - nearZ);
+		return XMMatrixSet(width, 0.0f, 0.0f, 0.0f, 0.0f, height, 0.0f, 0.0f, 0.0f, 0.0f, range, 1.0f, 0.0f, 0.0f, -range * nearZ, 0.0f);
+	}
+
+	namespace Internal {
+		// Cofactor expansion in double precision; returns the determinant.
+		inline double Invert4x4(const XMMATRIX& m, double inverse[4][4]) {
+			double a[4][4];
+			for (int row = 0; row < 4; ++row) {
+				for (int column = 0; column < 4; ++column) {
+					a[row][column] = m.r[row].v[column];
+				}
+			}
+
+			double minor[4][4];
+			for (int row = 0; row < 4; ++row) {
+				for (int column = 0; column < 4; ++column) {
+					double sub[3][3];
+					for (int i = 0, si = 0; i < 4; ++i) {
+						if (i == row)
+							continue;
+						for (int j = 0, sj = 0; j < 4; ++j) {
+							if (j == column)
+								continue;
+							sub[si][sj++] = a[i][j];
+						}
+						si++;
+					}
+					double det3 = sub[0][0] * (sub[1][1] * sub[2][2] - sub[1][2] * sub[2][1]) -
+								  sub[0][1] * (sub[1][0] * sub[2][2] - sub[1][2] * sub[2][0]) +
+								  sub[0][2] * (sub[1][0] * sub[2][1] - sub[1][1] * sub[2][0]);
+					minor[row][column] = ((row + column) % 2 == 0 ? 1.0 : -1.0) * det3;
+				}
+			}
+
+			double determinant = 0.0;
+			for (int column = 0; column < 4; ++column) {
+				determinant += a[0][column] * minor[0][column];
+			}
+
+			for (int row = 0; row < 4; ++row) {
+				for (int column = 0; column < 4; ++column) {
+					inverse[row][column] = minor[column][row] / determinant;
+				}
+			}
+			return determinant;
+		}
+	}
+
+	inline XMVECTOR XMMatrixDeterminant(FXMMATRIX m) {
+		double inverse[4][4];
+		return XMVectorReplicate((float)Internal::Invert4x4(m, inverse));
+	}
+
+	inline XMMATRIX XMMatrixInverse(XMVECTOR* determinant, FXMMATRIX m) {
+		double inverse[4][4];
+		double det = Internal::Invert4x4(m, inverse);
+		if (determinant != nullptr)
+			*determinant = XMVectorReplicate((float)det);
+
+		XMMATRIX result;
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				result.r[row].v[column] = (float)inverse[row][column];
+			}
+		}
+		return result;
+	}
+
+	// Quaternions are (x, y, z, w). XMQuaternionMultiply(a, b) rotates by a, then by b.
+	inline XMVECTOR XMQuaternionMultiply(FXMVECTOR a, FXMVECTOR b) {
+		const float* p = b.v;
+		const float* q = a.v;
+		return XMVectorSet(p[3] * q[0] + p[0] * q[3] + p[1] * q[2] - p[2] * q[1],
+						   p[3] * q[1] - p[0] * q[2] + p[1] * q[3] + p[2] * q[0],
+						   p[3] * q[2] + p[0] * q[1] - p[1] * q[0] + p[2] * q[3],
+						   p[3] * q[3] - p[0] * q[0] - p[1] * q[1] - p[2] * q[2]);
+	}
+
+	inline XMVECTOR XMQuaternionConjugate(FXMVECTOR q) {
+		return XMVectorSet(-q.v[0], -q.v[1], -q.v[2], q.v[3]);
+	}
+
+	inline XMVECTOR XMQuaternionIdentity() {
+		return XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	inline XMVECTOR XMVector3Rotate(FXMVECTOR v, FXMVECTOR rotation) {
+		XMVECTOR a = XMVectorSet(v.v[0], v.v[1], v.v[2], 0.0f);
+		return XMQuaternionMultiply(XMQuaternionMultiply(XMQuaternionConjugate(rotation), a), rotation);
+	}
+
+	// From the upper 3x3 of m, which must be a rotation.
+	inline XMVECTOR XMQuaternionRotationMatrix(FXMMATRIX m) {
+		float m00 = m.r[0].v[0], m01 = m.r[0].v[1], m02 = m.r[0].v[2];
+		float m10 = m.r[1].v[0], m11 = m.r[1].v[1], m12 = m.r[1].v[2];
+		float m20 = m.r[2].v[0], m21 = m.r[2].v[1], m22 = m.r[2].v[2];
+
+		if (m22 <= 0.0f) {
+			float dif10 = m11 - m00;
+			float omr22 = 1.0f - m22;
+			if (dif10 <= 0.0f) {
+				float fourXSqr = omr22 - dif10;
+				float inv4x = 0.5f / sqrtf(fourXSqr);
+				return XMVectorSet(fourXSqr * inv4x, (m01 + m10) * inv4x, (m02 + m20) * inv4x, (m12 - m21) * inv4x);
+			}
+			float fourYSqr = omr22 + dif10;
+			float inv4y = 0.5f / sqrtf(fourYSqr);
+			return XMVectorSet((m01 + m10) * inv4y, fourYSqr * inv4y, (m12 + m21) * inv4y, (m20 - m02) * inv4y);
+		}
+
+		float sum10 = m11 + m00;
+		float opr22 = 1.0f + m22;
+		if (sum10 <= 0.0f) {
+			float fourZSqr = opr22 - sum10;
+			float inv4z = 0.5f / sqrtf(fourZSqr);
+			return XMVectorSet((m02 + m20) * inv4z, (m12 + m21) * inv4z, fourZSqr * inv4z, (m01 - m10) * inv4z);
+		}
+		float fourWSqr = opr22 + sum10;
+		float inv4w = 0.5f / sqrtf(fourWSqr);
+		return XMVectorSet((m12 - m21) * inv4w, (m20 - m02) * inv4w, (m01 - m10) * inv4w, fourWSqr * inv4w);
+	}
+
+	inline XMVECTOR XMPlaneNormalize(FXMVECTOR plane) {
+		float length = sqrtf(XMVector3DotScalar(plane, plane));
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		return XMVectorSet(plane.v[0] * scale, plane.v[1] * scale, plane.v[2] * scale, plane.v[3] * scale);
+	}
+}
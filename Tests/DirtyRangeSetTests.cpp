@@ -0,0 +1,129 @@
+#include "Check.h"
+
+#include "DirtyRangeSet.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+	// One bool per byte. The runs of set bytes are exactly the minimal list of ranges, since
+	// touching ranges have no gap between them.
+	std::vector<DirtyRangeSet::Range> Runs(const std::vector<bool>& bitmap) {
+		std::vector<DirtyRangeSet::Range> runs;
+		for (uint64_t i = 0; i < bitmap.size(); ++i) {
+			if (!bitmap[i])
+				continue;
+			if (!runs.empty() && runs.back().End == i)
+				runs.back().End = i + 1;
+			else
+				runs.push_back({ i, i + 1 });
+		}
+		return runs;
+	}
+
+	bool Matches(const DirtyRangeSet& set, const std::vector<bool>& bitmap) {
+		std::vector<DirtyRangeSet::Range> runs = Runs(bitmap);
+		const std::vector<DirtyRangeSet::Range>& ranges = set.Ranges();
+		if (ranges.size() != runs.size())
+			return false;
+
+		uint64_t bytes = 0;
+		for (size_t i = 0; i < runs.size(); ++i) {
+			if (ranges[i].Begin != runs[i].Begin || ranges[i].End != runs[i].End)
+				return false;
+			bytes += runs[i].End - runs[i].Begin;
+		}
+		return set.Bytes() == bytes && set.Empty() == runs.empty();
+	}
+
+	void Mark(std::vector<bool>& bitmap, uint64_t begin, uint64_t end) {
+		for (uint64_t i = begin; i < end; ++i) {
+			bitmap[i] = true;
+		}
+	}
+}
+
+TEST_CASE(EmptyRangesAreIgnored) {
+	DirtyRangeSet set;
+	set.Add(8, 8);
+	set.Add(16, 4);
+	CHECK(set.Empty());
+	CHECK(set.Bytes() == 0);
+
+	set.Add(0, 4);
+	set.Add(4, 4);
+	CHECK(set.Ranges().size() == 1);
+	CHECK(set.Bytes() == 4);
+}
+
+TEST_CASE(InOrderRangesAppendOrExtendTheBack) {
+	DirtyRangeSet set;
+	set.Add(0, 16);
+	set.Add(32, 48);	// Gap: appended.
+	CHECK(set.Ranges().size() == 2);
+
+	set.Add(48, 64);	// Touches the back: extended.
+	set.Add(40, 56);	// Starts inside the back: extended, not split.
+	set.Add(36, 40);	// Fully contained in the back.
+	REQUIRE(set.Ranges().size() == 2);
+	CHECK(set.Ranges()[1].Begin == 32 && set.Ranges()[1].End == 64);
+	CHECK(set.Bytes() == 16 + 32);
+
+	set.Clear();
+	CHECK(set.Empty());
+}
+
+TEST_CASE(OutOfOrderRangesMergeWithEveryOverlap) {
+	DirtyRangeSet set;
+	set.Add(100, 110);
+	set.Add(120, 130);
+	set.Add(140, 150);
+	set.Add(160, 170);
+
+	// Lands before everything without touching: inserted at the front.
+	set.Add(0, 10);
+	CHECK(set.Ranges().size() == 5);
+
+	// Touches 110 on the left and 140 on the right, swallowing the range between them.
+	set.Add(110, 140);
+	REQUIRE(set.Ranges().size() == 3);
+	CHECK(set.Ranges()[1].Begin == 100 && set.Ranges()[1].End == 150);
+
+	// Fully contained in a range that is not the back.
+	set.Add(102, 108);
+	CHECK(set.Ranges().size() == 3);
+	CHECK(set.Bytes() == 10 + 50 + 10);
+}
+
+// Random inserts over a small span, so touching, contained and overlapping ranges all come up
+// often, and both the back paths and the lower_bound path are taken. The set has to match the
+// runs of a byte bitmap after every Add.
+TEST_CASE(RandomRangesMatchABitmap) {
+	const uint64_t span = 256;
+
+	for (uint32_t seed = 0; seed < 200; ++seed) {
+		std::mt19937 random(seed);
+		DirtyRangeSet set;
+		std::vector<bool> bitmap(span, false);
+
+		for (uint32_t i = 0; i < 64; ++i) {
+			uint64_t begin = random() % span;
+			uint64_t end = begin + random() % 17;
+			if (end > span)
+				end = span;
+
+			// Every third seed writes mostly in increasing order, like a frame of constant updates.
+			if (seed % 3 == 0 && !set.Empty() && random() % 4 != 0) {
+				begin = set.Ranges().back().End + random() % 3;
+				end = begin + 1 + random() % 8;
+				if (end > span)
+					break;
+			}
+
+			set.Add(begin, end);
+			Mark(bitmap, begin, end);
+			REQUIRE(Matches(set, bitmap));
+		}
+	}
+}
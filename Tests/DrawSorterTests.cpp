@@ -0,0 +1,152 @@
+#include "Check.h"
+
+#include "DrawSorter.h"
+#include "RecordingCommandList.h"
+#include "StateFilter.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+template<typename T>
+T* Fake(uintptr_t id) {
+	return reinterpret_cast<T*>(id * 0x100);
+}
+
+// A render item reduced to the state StencilDemo binds for it.
+struct Item {
+	uint32_t Material;
+	uint32_t Geometry;
+	float Depth;
+};
+
+std::vector<Item> RandomScene(uint32_t seed, uint32_t count, uint32_t materials, uint32_t geometries) {
+	std::mt19937 random(seed);
+	std::vector<Item> items;
+	for (uint32_t i = 0; i < count; ++i) {
+		items.push_back({ (uint32_t)(random() % materials), (uint32_t)(random() % geometries),
+						  std::uniform_real_distribution<float>(0.0f, 1.0f)(random) });
+	}
+	return items;
+}
+
+// Records the items the way StencilDemoApp::DrawRenderItems does: buffers, topology, texture table
+// and the object and material CBVs per item, all through the filter.
+void Record(StateFilter<RecordingCommandList>& filter, const std::vector<Item>& items, const std::vector<uint32_t>& order) {
+	for (uint32_t index : order) {
+		const Item& item = items[index];
+		D3D12_VERTEX_BUFFER_VIEW vb = { 0x100000 * (D3D12_GPU_VIRTUAL_ADDRESS)(item.Geometry + 1), 0x10000, 32 };
+		D3D12_INDEX_BUFFER_VIEW ib = { 0x200000 * (D3D12_GPU_VIRTUAL_ADDRESS)(item.Geometry + 1), 0x1000, DXGI_FORMAT_UNKNOWN };
+
+		filter.IASetVertexBuffers(0, 1, &vb);
+		filter.IASetIndexBuffer(&ib);
+		filter.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		filter.SetGraphicsRootDescriptorTable(0, { 0x40 * (UINT64)(item.Material + 1) });
+		filter.SetGraphicsRootConstantBufferView(1, 0x10000 + 0x100 * (D3D12_GPU_VIRTUAL_ADDRESS)index);
+		filter.SetGraphicsRootConstantBufferView(3, 0x20000 + 0x100 * (D3D12_GPU_VIRTUAL_ADDRESS)item.Material);
+		filter.DrawIndexedInstanced(index + 1, 1, 0, 0, 0);
+	}
+}
+}
+
+TEST_CASE(SortMatchesStableSortByKey) {
+	for (uint32_t seed = 0; seed < 20; ++seed) {
+		std::mt19937_64 random(seed);
+		DrawSorter sorter;
+		std::vector<DrawSorter::Entry> expected;
+
+		// Few distinct values per field, so equal keys are common and stability matters.
+		for (uint32_t i = 0; i < 2000; ++i) {
+			uint64_t key = random() & 0x0f00ff000000f00full;
+			sorter.Add(key, i);
+			expected.push_back({ key, i });
+		}
+
+		sorter.Sort();
+		std::stable_sort(expected.begin(), expected.end(), [](const DrawSorter::Entry& a, const DrawSorter::Entry& b) {
+			return a.Key < b.Key;
+		});
+
+		const std::vector<DrawSorter::Entry>& entries = sorter.Entries();
+		REQUIRE(entries.size() == expected.size());
+		for (size_t i = 0; i < entries.size(); ++i) {
+			CHECK(entries[i].Key == expected[i].Key && entries[i].Item == expected[i].Item);
+		}
+	}
+}
+
+TEST_CASE(OpaqueKeysGoFrontToBackWithinState) {
+	CHECK(DrawSorter::OpaqueKey(1, 1, 3, 2, 0.25f) < DrawSorter::OpaqueKey(1, 1, 3, 2, 0.75f));
+
+	// State outranks depth.
+	CHECK(DrawSorter::OpaqueKey(1, 1, 2, 9, 0.9f) < DrawSorter::OpaqueKey(1, 1, 3, 0, 0.1f));
+	CHECK(DrawSorter::OpaqueKey(0, 9, 9, 9, 1.0f) < DrawSorter::OpaqueKey(1, 0, 0, 0, 0.0f));
+}
+
+TEST_CASE(BlendedKeysGoBackToFrontBeforeState) {
+	CHECK(DrawSorter::BlendedKey(3, 3, 0, 0, 0.75f) < DrawSorter::BlendedKey(3, 3, 0, 0, 0.25f));
+	CHECK(DrawSorter::BlendedKey(3, 3, 9, 9, 0.75f) < DrawSorter::BlendedKey(3, 3, 0, 0, 0.25f));
+}
+
+TEST_CASE(DepthOutsideRangeIsClamped) {
+	CHECK(DrawSorter::OpaqueKey(0, 0, 0, 0, -1.0f) == DrawSorter::OpaqueKey(0, 0, 0, 0, 0.0f));
+	CHECK(DrawSorter::OpaqueKey(0, 0, 0, 0, 2.0f) == DrawSorter::OpaqueKey(0, 0, 0, 0, 1.0f));
+	CHECK(DrawSorter::NormalizedDepth(1.0f, 1.0f, 1000.0f) == 0.0f);
+	CHECK(DrawSorter::NormalizedDepth(1000.0f, 1.0f, 1000.0f) == 1.0f);
+}
+
+TEST_CASE(SortingCutsStateChanges) {
+	// The before and after of sorting: the same scene recorded in submission order and in key
+	// order through the filter, counting the calls that reach the list.
+	for (uint32_t seed = 0; seed < 10; ++seed) {
+		std::vector<Item> items = RandomScene(seed, 400, 8, 6);
+
+		std::vector<uint32_t> unsorted;
+		DrawSorter sorter;
+		for (uint32_t i = 0; i < (uint32_t)items.size(); ++i) {
+			unsorted.push_back(i);
+			sorter.Add(DrawSorter::OpaqueKey(0, 0, items[i].Material, items[i].Geometry, items[i].Depth), i);
+		}
+		sorter.Sort();
+
+		std::vector<uint32_t> sorted;
+		for (const DrawSorter::Entry& entry : sorter.Entries()) {
+			sorted.push_back(entry.Item);
+		}
+
+		RecordingCommandList before, after;
+		StateFilter<RecordingCommandList> filter;
+		filter.Reset(&before, Fake<ID3D12PipelineState>(1));
+		Record(filter, items, unsorted);
+		filter.Reset(&after, Fake<ID3D12PipelineState>(1));
+		Record(filter, items, sorted);
+
+		// Every item is drawn once either way.
+		REQUIRE(after.Draws.size() == items.size());
+		std::vector<UINT> drawn;
+		for (const RecordingCommandList::Snapshot& draw : after.Draws) {
+			drawn.push_back(draw.IndexCount - 1);
+		}
+		std::sort(drawn.begin(), drawn.end());
+		for (uint32_t i = 0; i < (uint32_t)drawn.size(); ++i) {
+			CHECK(drawn[i] == i);
+		}
+
+		// The object CBV changes every draw regardless, the rest at most once per material or
+		// geometry run.
+		CHECK(after.Calls("SetGraphicsRootConstantBufferView") == items.size() + 8);
+		CHECK(after.Calls("SetGraphicsRootDescriptorTable") == 8);
+		CHECK(after.Calls("IASetVertexBuffers") <= 8 * 6);
+		CHECK(after.Calls("IASetPrimitiveTopology") == 1);
+
+		CHECK(after.Calls("SetGraphicsRootDescriptorTable") * 10 < before.Calls("SetGraphicsRootDescriptorTable"));
+		CHECK(after.Calls("IASetVertexBuffers") * 4 < before.Calls("IASetVertexBuffers"));
+		CHECK(after.StateCalls() * 2 < before.StateCalls());
+
+		if (seed == 0) {
+			printf("  state calls for %u items: %u unsorted, %u sorted\n",
+				   (uint32_t)items.size(), before.StateCalls(), after.StateCalls());
+		}
+	}
+}
@@ -0,0 +1,107 @@
+#include "Check.h"
+
+#include "FrameDirtySet.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+	// As many frame resources as the samples keep in flight (g_NumFrameResources).
+	const uint32_t FrameCount = 3;
+
+	std::vector<uint32_t> Upload(FrameDirtySet& dirty, uint32_t frame) {
+		std::vector<uint32_t> uploaded;
+		dirty.ForEachDirty(frame, [&](uint32_t index) { uploaded.push_back(index); });
+		return uploaded;
+	}
+}
+
+// Runs the frame ring the way the samples do and counts what each frame resource receives: every
+// item goes to each frame resource exactly once, then never again until it changes.
+TEST_CASE(EachItemIsUploadedOncePerFrameResource) {
+	FrameDirtySet dirty(FrameCount);
+	dirty.Resize(100);
+
+	std::vector<uint32_t> uploads(100 * FrameCount, 0);
+	for (uint32_t frame = 0; frame < 5 * FrameCount; ++frame) {
+		uint32_t resource = frame % FrameCount;
+		for (uint32_t index : Upload(dirty, resource)) {
+			uploads[index * FrameCount + resource]++;
+		}
+	}
+
+	for (uint32_t count : uploads) {
+		CHECK(count == 1);
+	}
+}
+
+TEST_CASE(MarkingMidRingFlagsEveryFrameResourceAgain) {
+	FrameDirtySet dirty(FrameCount);
+	dirty.Resize(100);
+	for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+		Upload(dirty, frame);
+	}
+
+	// Item 5 changes before frame 1; frame 1 uploads it, then it changes again before frame 2.
+	dirty.Mark(5);
+	dirty.Mark(70);
+	CHECK((Upload(dirty, 1) == std::vector<uint32_t>{ 5, 70 }));
+	dirty.Mark(5);
+
+	// Frames 2 and 0 still owe both; frame 1 owes the second change to 5.
+	CHECK((Upload(dirty, 2) == std::vector<uint32_t>{ 5, 70 }));
+	CHECK((Upload(dirty, 0) == std::vector<uint32_t>{ 5, 70 }));
+	CHECK((Upload(dirty, 1) == std::vector<uint32_t>{ 5 }));
+	for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+		CHECK(Upload(dirty, frame).empty());
+		CHECK(!dirty.IsDirty(frame, 5));
+	}
+}
+
+TEST_CASE(GrowingAddsDirtyItems) {
+	FrameDirtySet dirty(FrameCount);
+	dirty.Resize(100);
+	for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+		Upload(dirty, frame);
+	}
+
+	dirty.Resize(130);
+	CHECK(dirty.Size() == 130);
+	for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+		std::vector<uint32_t> uploaded = Upload(dirty, frame);
+		REQUIRE(uploaded.size() == 30);
+		CHECK(uploaded.front() == 100 && uploaded.back() == 129);
+	}
+}
+
+TEST_CASE(ShrinkingDropsTheRemovedItems) {
+	FrameDirtySet dirty(FrameCount);
+	dirty.Resize(130);
+	Upload(dirty, 0);
+
+	// Frame resources 1 and 2 still owe everything; after the shrink only the items that are left.
+	dirty.Resize(65);
+	CHECK(dirty.Size() == 65);
+	CHECK(Upload(dirty, 0).empty());
+	CHECK(Upload(dirty, 1).size() == 65);
+
+	// Growing back brings the removed items back as new, dirty everywhere, but nothing twice.
+	dirty.Resize(130);
+	CHECK(Upload(dirty, 0).size() == 65);
+	CHECK(Upload(dirty, 1).size() == 65);
+	CHECK(Upload(dirty, 2).size() == 130);
+}
+
+TEST_CASE(MarkAllFlagsEverything) {
+	FrameDirtySet dirty(FrameCount);
+	dirty.Resize(70);
+	for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+		Upload(dirty, frame);
+	}
+
+	dirty.MarkAll();
+	for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+		CHECK(Upload(dirty, frame).size() == 70);
+	}
+	CHECK(dirty.FrameCount() == FrameCount);
+}
@@ -0,0 +1,51 @@
+#include "Bench.h"
+
+#include "FrustumCuller.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// Cull() against IsVisible() in a loop, on 100k boxes scattered around a view frustum so that
+// about a third of them are visible.
+int main() {
+	const uint32_t count = 100000;
+
+	BoundingFrustum frustum;
+	BoundingFrustum::CreateFromMatrix(frustum, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 100.0f));
+	FrustumCuller culler;
+	culler.SetFrustum(frustum);
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> x(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> z(-20.0f, 120.0f);
+	std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+	std::vector<BoundingBox> boxes(count);
+	for (BoundingBox& box : boxes) {
+		box = BoundingBox(XMFLOAT3(x(random), x(random) * 0.6f, z(random)), XMFLOAT3(extent(random), extent(random), extent(random)));
+	}
+
+	std::vector<uint32_t> visible;
+	visible.reserve(count);
+
+	Bench::Report("FrustumCuller::IsVisible, 100k boxes", count, [&]() {
+		visible.clear();
+		for (uint32_t i = 0; i < count; ++i) {
+			if (culler.IsVisible(boxes[i]))
+				visible.push_back(i);
+		}
+		Bench::DoNotOptimize(visible.data());
+	});
+	size_t scalarVisible = visible.size();
+
+	Bench::Report("FrustumCuller::Cull, 100k boxes", count, [&]() {
+		visible.clear();
+		culler.Cull(boxes.data(), count, visible);
+		Bench::DoNotOptimize(visible.data());
+	});
+
+	printf("%zu of %u boxes visible\n", visible.size(), count);
+	return visible.size() == scalarVisible ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include "Check.h"
+
+#include "FrustumCuller.h"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+	// A 45 degree, 16:9 view frustum from 1 to 100, either at the origin or moved and turned the way
+	// a camera would be.
+	BoundingFrustum ViewFrustum() {
+		BoundingFrustum frustum;
+		BoundingFrustum::CreateFromMatrix(frustum, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 100.0f));
+		return frustum;
+	}
+
+	XMMATRIX CameraToWorld() {
+		return XMMatrixMultiply(XMMatrixMultiply(XMMatrixRotationX(0.3f), XMMatrixRotationY(1.2f)), XMMatrixTranslation(5.0f, 2.0f, -10.0f));
+	}
+
+	// Boxes from points to several units across, placed around the view frustum in its own space
+	// and then moved to world space with it.
+	BoundingBox RandomBox(std::mt19937& random, FXMMATRIX cameraToWorld) {
+		std::uniform_real_distribution<float> x(-80.0f, 80.0f);
+		std::uniform_real_distribution<float> z(-20.0f, 120.0f);
+		std::uniform_real_distribution<float> extent(0.0f, 5.0f);
+
+		XMFLOAT3 center;
+		XMStoreFloat3(&center, XMVector3TransformCoord(XMVectorSet(x(random), x(random) * 0.6f, z(random), 1.0f), cameraToWorld));
+		if (random() % 4 == 0)
+			return BoundingBox(center, XMFLOAT3(0.0f, 0.0f, 0.0f));
+		return BoundingBox(center, XMFLOAT3(extent(random), extent(random), extent(random)));
+	}
+
+	// How far the box is from flipping sides on the nearest plane. The SSE path adds in a different
+	// order than IsVisible (and DirectXCollision in another again), so boxes closer than a rounding
+	// error to a plane can come out either way; the comparisons skip them.
+	float Margin(const BoundingFrustum& frustum, const BoundingBox& box) {
+		XMVECTOR planes[6];
+		frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+
+		float margin = INFINITY;
+		for (const XMVECTOR& plane : planes) {
+			XMFLOAT4 p;
+			XMStoreFloat4(&p, plane);
+			float distance = p.x * box.Center.x + p.y * box.Center.y + p.z * box.Center.z + p.w;
+			float radius = fabsf(p.x) * box.Extents.x + fabsf(p.y) * box.Extents.y + fabsf(p.z) * box.Extents.z;
+			margin = std::fmin(margin, fabsf(distance - radius));
+		}
+		return margin;
+	}
+
+	// Cull() over boxes against IsVisible() one at a time and BoundingFrustum::Contains.
+	bool CullMatchesReference(const FrustumCuller& culler, const BoundingFrustum& frustum, const std::vector<BoundingBox>& boxes) {
+		std::vector<uint32_t> visible;
+		uint32_t appended = culler.Cull(boxes.data(), (uint32_t)boxes.size(), visible);
+		if (appended != visible.size())
+			return false;
+
+		size_t next = 0;
+		for (uint32_t i = 0; i < boxes.size(); ++i) {
+			bool culled = next == visible.size() || visible[next] != i;
+			if (!culled)
+				next++;
+
+			bool isVisible = culler.IsVisible(boxes[i]);
+			if (culled == isVisible || isVisible != (frustum.Contains(boxes[i]) != DISJOINT))
+				return false;
+		}
+		return next == visible.size();
+	}
+}
+
+// Counts 0 to 8 cover an empty input, the scalar tail alone, one SSE group with every tail length
+// and two full groups; the larger counts mix many groups with a tail.
+TEST_CASE(CullMatchesIsVisibleAndContains) {
+	const XMMATRIX placements[] = { XMMatrixIdentity(), CameraToWorld() };
+	const uint32_t counts[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 13, 1000, 1003 };
+
+	for (const XMMATRIX& placement : placements) {
+		BoundingFrustum frustum;
+		ViewFrustum().Transform(frustum, placement);
+		FrustumCuller culler;
+		culler.SetFrustum(frustum);
+
+		std::mt19937 random(7);
+		for (uint32_t count : counts) {
+			for (uint32_t round = 0; round < 50; ++round) {
+				std::vector<BoundingBox> boxes;
+				while (boxes.size() < count) {
+					BoundingBox box = RandomBox(random, placement);
+					if (Margin(frustum, box) > 1e-3f)
+						boxes.push_back(box);
+				}
+				REQUIRE(CullMatchesReference(culler, frustum, boxes));
+			}
+		}
+	}
+}
+
+TEST_CASE(CullAppendsToTheIndexList) {
+	FrustumCuller culler;
+	culler.SetFrustum(ViewFrustum());
+
+	std::vector<BoundingBox> boxes(6, BoundingBox(XMFLOAT3(0.0f, 0.0f, 50.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+	boxes[1].Center.z = -50.0f;
+	boxes[4].Center.x = 500.0f;
+
+	std::vector<uint32_t> visible = { 99 };
+	CHECK(culler.Cull(boxes.data(), (uint32_t)boxes.size(), visible) == 4);
+	CHECK((visible == std::vector<uint32_t>{ 99, 0, 2, 3, 5 }));
+
+	// Starting mid-array: the loads are unaligned and the indices relative to the pointer.
+	visible.clear();
+	CHECK(culler.Cull(boxes.data() + 1, 5, visible) == 3);
+	CHECK((visible == std::vector<uint32_t>{ 1, 2, 4 }));
+}
+
+TEST_CASE(SetCameraCullsAroundTheView) {
+	XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -10.0f, 1.0f), XMVectorSet(10.0f, 0.0f, -10.0f, 1.0f),
+									 XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 1.0f, 1.0f, 100.0f);
+
+	FrustumCuller culler;
+	culler.SetCamera(view, proj);
+
+	// Looking down +x from (0, 0, -10).
+	XMFLOAT3 unit(0.5f, 0.5f, 0.5f);
+	CHECK(culler.IsVisible(BoundingBox(XMFLOAT3(20.0f, 0.0f, -10.0f), unit)));
+	CHECK(!culler.IsVisible(BoundingBox(XMFLOAT3(-20.0f, 0.0f, -10.0f), unit)));
+	CHECK(!culler.IsVisible(BoundingBox(XMFLOAT3(0.3f, 0.0f, -10.0f), unit)));	// Before the near plane.
+	CHECK(!culler.IsVisible(BoundingBox(XMFLOAT3(120.0f, 0.0f, -10.0f), unit)));	// Past the far plane.
+	CHECK(!culler.IsVisible(BoundingBox(XMFLOAT3(20.0f, 0.0f, 20.0f), unit)));	// Off to the side.
+	CHECK(culler.IsVisible(BoundingBox(XMFLOAT3(20.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 25.0f))));
+}
+
+TEST_CASE(TransformBoundsDividesByW) {
+	BoundingBox local(XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 2.0f, 3.0f));
+	BoundingBox world;
+	FrustumCuller::TransformBounds(local, XMMatrixMultiply(XMMatrixScaling(2.0f, 2.0f, 2.0f), XMMatrixTranslation(0.0f, 5.0f, 0.0f)), world);
+	CHECK(fabsf(world.Center.x - 2.0f) < 1e-5f && fabsf(world.Center.y - 5.0f) < 1e-5f && fabsf(world.Center.z) < 1e-5f);
+	CHECK(fabsf(world.Extents.x - 2.0f) < 1e-5f && fabsf(world.Extents.y - 4.0f) < 1e-5f && fabsf(world.Extents.z - 6.0f) < 1e-5f);
+
+	// A w of 2 everywhere halves the box.
+	XMMATRIX halve = XMMatrixIdentity();
+	halve.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 2.0f);
+	FrustumCuller::TransformBounds(local, halve, world);
+	CHECK(fabsf(world.Center.x - 0.5f) < 1e-5f && fabsf(world.Extents.y - 1.0f) < 1e-5f);
+}
@@ -0,0 +1,143 @@
+#include "Check.h"
+
+#include "IndirectArgumentBuilder.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+IndirectArgumentBuilder::Command MakeCommand(uint32_t item) {
+	IndirectArgumentBuilder::Command command = {};
+	command.ObjectCB = 0x10000 + 0x100 * (uint64_t)item;
+	command.MaterialCB = 0x20000;
+	command.IndexCountPerInstance = 3 * (item + 1);
+	command.InstanceCount = 1;
+	return command;
+}
+
+bool SameRun(const IndirectArgumentBuilder::Run& run, uint32_t firstCommand, uint32_t commandCount, uint32_t item) {
+	return run.FirstCommand == firstCommand && run.CommandCount == commandCount && run.Item == item;
+}
+}
+
+TEST_CASE(EqualKeysShareARun) {
+	IndirectArgumentBuilder builder;
+	const uint64_t keys[] = { 7, 7, 7, 9, 9, 7 };
+	for (uint32_t i = 0; i < 6; ++i) {
+		builder.Add(keys[i], 10 + i, MakeCommand(i));
+	}
+
+	const std::vector<IndirectArgumentBuilder::Run>& runs = builder.Runs();
+	REQUIRE(runs.size() == 3);
+	CHECK(SameRun(runs[0], 0, 3, 10));
+	CHECK(SameRun(runs[1], 3, 2, 13));
+	CHECK(SameRun(runs[2], 5, 1, 15));
+}
+
+TEST_CASE(SplitStartsARunForTheSameKey) {
+	IndirectArgumentBuilder builder;
+	builder.Add(7, 0, MakeCommand(0));
+	builder.Add(7, 1, MakeCommand(1));
+	builder.Split();
+	builder.Add(7, 2, MakeCommand(2));
+
+	// Splitting twice, or before anything is added, makes no empty runs.
+	builder.Split();
+	builder.Split();
+	builder.Add(7, 3, MakeCommand(3));
+
+	const std::vector<IndirectArgumentBuilder::Run>& runs = builder.Runs();
+	REQUIRE(runs.size() == 3);
+	CHECK(SameRun(runs[0], 0, 2, 0));
+	CHECK(SameRun(runs[1], 2, 1, 2));
+	CHECK(SameRun(runs[2], 3, 1, 3));
+}
+
+TEST_CASE(ClearStartsOver) {
+	IndirectArgumentBuilder builder;
+	builder.Add(7, 0, MakeCommand(0));
+	builder.Clear();
+	CHECK(builder.Commands().empty());
+	CHECK(builder.Runs().empty());
+
+	// Even the same key as before the clear starts a run.
+	builder.Add(7, 5, MakeCommand(5));
+	REQUIRE(builder.Runs().size() == 1);
+	CHECK(SameRun(builder.Runs()[0], 0, 1, 5));
+}
+
+TEST_CASE(CommandsAreStoredAsAdded) {
+	IndirectArgumentBuilder builder;
+	for (uint32_t i = 0; i < 16; ++i) {
+		builder.Add(i / 4, i, MakeCommand(i));
+	}
+
+	REQUIRE(builder.Commands().size() == 16);
+	for (uint32_t i = 0; i < 16; ++i) {
+		IndirectArgumentBuilder::Command expected = MakeCommand(i);
+		CHECK(memcmp(&builder.Commands()[i], &expected, sizeof(expected)) == 0);
+	}
+	CHECK((const char*)&builder.Commands()[1] - (const char*)&builder.Commands()[0] == IndirectArgumentBuilder::CommandStride);
+}
+
+TEST_CASE(OneCommandPerItemPerPass) {
+	// An item in two layers, as StencilDemo's mirror is in Mirrors and Transparent, gets a command
+	// in each pass, so the argument buffer needs a slot per layer membership, not per item.
+	const std::vector<std::vector<uint32_t>> passes = { { 0, 1, 2 }, { 3 }, { 3, 4 } };
+	uint32_t memberships = 0;
+
+	IndirectArgumentBuilder builder;
+	for (const std::vector<uint32_t>& pass : passes) {
+		builder.Split();
+		for (uint32_t item : pass) {
+			builder.Add(0, item, MakeCommand(item));
+			memberships++;
+		}
+	}
+
+	CHECK(builder.Commands().size() == memberships);
+	CHECK(builder.Commands().size() > 5);
+	CHECK(builder.Runs().size() == passes.size());
+}
+
+TEST_CASE(RunsTileTheCommands) {
+	for (uint32_t seed = 0; seed < 20; ++seed) {
+		std::mt19937 random(seed);
+		IndirectArgumentBuilder builder;
+		std::vector<uint64_t> keys;
+		std::vector<bool> splitBefore;
+
+		for (uint32_t i = 0; i < 500; ++i) {
+			splitBefore.push_back(random() % 50 == 0);
+			if (splitBefore.back()) {
+				builder.Split();
+			}
+			uint64_t key = random() % 3;
+			keys.push_back(key);
+			builder.Add(key, i, MakeCommand(i));
+		}
+
+		// Runs cover every command once, in order, and each holds one key.
+		uint32_t next = 0;
+		for (const IndirectArgumentBuilder::Run& run : builder.Runs()) {
+			REQUIRE(run.FirstCommand == next);
+			REQUIRE(run.CommandCount > 0);
+			CHECK(run.Item == run.FirstCommand);
+			for (uint32_t i = run.FirstCommand; i < run.FirstCommand + run.CommandCount; ++i) {
+				CHECK(keys[i] == keys[run.FirstCommand]);
+			}
+			next += run.CommandCount;
+		}
+		CHECK(next == builder.Commands().size());
+
+		// A new run starts exactly where the key changes or Split() was called.
+		std::vector<bool> runStarts(keys.size(), false);
+		for (const IndirectArgumentBuilder::Run& run : builder.Runs()) {
+			runStarts[run.FirstCommand] = true;
+		}
+		for (size_t i = 1; i < keys.size(); ++i) {
+			CHECK(runStarts[i] == (keys[i] != keys[i - 1] || splitBefore[i]));
+		}
+	}
+}
@@ -0,0 +1,128 @@
+#include "Check.h"
+
+#include "InstanceBatcher.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+	// Two distinct addresses to stand in for geometry.
+	const int Geometries[2] = {};
+	const void* const GeometryA = &Geometries[0];
+	const void* const GeometryB = &Geometries[1];
+
+	InstanceBatcher::Key MakeKey(const void* geometry, uint32_t submesh, uint32_t material, uint32_t pso) {
+		return { geometry, submesh, material, pso };
+	}
+
+	// The items of batch, in instance order.
+	std::vector<uint32_t> ItemsOf(const InstanceBatcher& batcher, size_t batch) {
+		const InstanceBatcher::Batch& b = batcher.Batches()[batch];
+		return std::vector<uint32_t>(batcher.Instances().begin() + b.FirstInstance,
+									 batcher.Instances().begin() + b.FirstInstance + b.InstanceCount);
+	}
+}
+
+TEST_CASE(EmptyBuildHasNoBatches) {
+	InstanceBatcher batcher;
+	batcher.Build();
+	CHECK(batcher.Batches().empty());
+	CHECK(batcher.Instances().empty());
+}
+
+TEST_CASE(ItemsGroupByEveryKeyField) {
+	InstanceBatcher batcher;
+	InstanceBatcher::Key key = MakeKey(GeometryA, 0, 0, 0);
+	batcher.Add(key, 0);
+	batcher.Add(MakeKey(GeometryB, 0, 0, 0), 1);
+	batcher.Add(MakeKey(GeometryA, 1, 0, 0), 2);
+	batcher.Add(MakeKey(GeometryA, 0, 1, 0), 3);
+	batcher.Add(MakeKey(GeometryA, 0, 0, 1), 4);
+	batcher.Add(key, 5);
+	batcher.Build();
+
+	// One field differing is enough for a separate batch.
+	REQUIRE(batcher.Batches().size() == 5);
+	CHECK((ItemsOf(batcher, 0) == std::vector<uint32_t>{ 0, 5 }));
+	for (size_t batch = 1; batch < 5; ++batch) {
+		CHECK(batcher.Batches()[batch].InstanceCount == 1);
+	}
+	CHECK(batcher.Instances().size() == 6);
+}
+
+TEST_CASE(BatchesFollowFirstSeenOrderAndKeepAddOrder) {
+	InstanceBatcher batcher;
+	InstanceBatcher::Key a = MakeKey(GeometryA, 0, 0, 0);
+	InstanceBatcher::Key b = MakeKey(GeometryA, 0, 2, 0);
+	InstanceBatcher::Key c = MakeKey(GeometryB, 3, 0, 0);
+
+	// b is seen first, then a, then c; the items interleave.
+	batcher.Add(b, 10);
+	batcher.Add(a, 11);
+	batcher.Add(b, 12);
+	batcher.Add(c, 13);
+	batcher.Add(a, 14);
+	batcher.Add(b, 15);
+	batcher.Build();
+
+	REQUIRE(batcher.Batches().size() == 3);
+	CHECK((ItemsOf(batcher, 0) == std::vector<uint32_t>{ 10, 12, 15 }));
+	CHECK((ItemsOf(batcher, 1) == std::vector<uint32_t>{ 11, 14 }));
+	CHECK((ItemsOf(batcher, 2) == std::vector<uint32_t>{ 13 }));
+
+	// Batches are laid out back to back.
+	CHECK(batcher.Batches()[0].FirstInstance == 0);
+	CHECK(batcher.Batches()[1].FirstInstance == 3);
+	CHECK(batcher.Batches()[2].FirstInstance == 5);
+}
+
+TEST_CASE(ClearStartsOver) {
+	InstanceBatcher batcher;
+	batcher.Add(MakeKey(GeometryA, 0, 0, 0), 1);
+	batcher.Add(MakeKey(GeometryB, 0, 0, 0), 2);
+	batcher.Build();
+
+	batcher.Clear();
+	CHECK(batcher.Batches().empty());
+	CHECK(batcher.Instances().empty());
+
+	batcher.Add(MakeKey(GeometryB, 0, 0, 0), 7);
+	batcher.Build();
+	REQUIRE(batcher.Batches().size() == 1);
+	CHECK((ItemsOf(batcher, 0) == std::vector<uint32_t>{ 7 }));
+}
+
+// Random keys from a small set against a batching done the slow way: scan for the batch of the
+// key, append to it.
+TEST_CASE(RandomItemsMatchALinearScan) {
+	for (uint32_t seed = 0; seed < 50; ++seed) {
+		std::mt19937 random(seed);
+		InstanceBatcher batcher;
+		std::vector<InstanceBatcher::Key> expectedKeys;
+		std::vector<std::vector<uint32_t>> expectedItems;
+
+		uint32_t count = random() % 300;
+		for (uint32_t item = 0; item < count; ++item) {
+			InstanceBatcher::Key key = MakeKey(&Geometries[random() % 2], random() % 3, random() % 2, random() % 2);
+			batcher.Add(key, item);
+
+			size_t batch = 0;
+			while (batch < expectedKeys.size() && !(expectedKeys[batch] == key)) {
+				batch++;
+			}
+			if (batch == expectedKeys.size()) {
+				expectedKeys.push_back(key);
+				expectedItems.emplace_back();
+			}
+			expectedItems[batch].push_back(item);
+		}
+		batcher.Build();
+
+		REQUIRE(batcher.Batches().size() == expectedItems.size());
+		REQUIRE(batcher.Instances().size() == count);
+		for (size_t batch = 0; batch < expectedItems.size(); ++batch) {
+			REQUIRE(ItemsOf(batcher, batch) == expectedItems[batch]);
+		}
+	}
+}
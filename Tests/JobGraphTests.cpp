@@ -0,0 +1,223 @@
+#include "Check.h"
+
+#include "JobGraph.h"
+
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// Stub jobs that only note when they started and finished, as ticks of one shared counter, so the
+// order the graph ran them in can be checked against their dependencies afterwards.
+struct StubJobs {
+	struct Record {
+		std::atomic<uint32_t> Runs{ 0 };
+		std::atomic<uint32_t> Started{ 0 };
+		std::atomic<uint32_t> Finished{ 0 };
+	};
+
+	explicit StubJobs(uint32_t count) : Records(count) {}
+
+	std::function<void()> Job(uint32_t index) {
+		return [this, index]() {
+			Record& record = Records[index];
+			record.Runs++;
+			record.Started = ++Clock;
+
+			// A little work, so jobs on different threads overlap.
+			volatile uint32_t sink = 0;
+			for (uint32_t i = 0; i < 2000; ++i) {
+				sink += i;
+			}
+
+			record.Finished = ++Clock;
+		};
+	}
+
+	std::atomic<uint32_t> Clock{ 0 };
+	std::vector<Record> Records;
+};
+}
+
+TEST_CASE(RunsEveryJobOnce) {
+	JobGraph jobs(4);
+	StubJobs stubs(64);
+	for (uint32_t i = 0; i < 64; ++i) {
+		jobs.Add("job" + std::to_string(i), stubs.Job(i));
+	}
+	jobs.Run();
+
+	for (const StubJobs::Record& record : stubs.Records) {
+		CHECK(record.Runs == 1);
+	}
+}
+
+TEST_CASE(EmptyGraphRuns) {
+	JobGraph jobs(4);
+	jobs.Run();
+	CHECK(jobs.Timings().empty());
+}
+
+TEST_CASE(DefaultThreadCountIsAtLeastOne) {
+	JobGraph jobs;
+	CHECK(jobs.ThreadCount() >= 1);
+}
+
+TEST_CASE(DependentsStartAfterTheirDependencies) {
+	// A diamond feeding a chain: 0 -> {1, 2} -> 3 -> 4 -> 5.
+	JobGraph jobs(4);
+	StubJobs stubs(6);
+	JobGraph::JobId a = jobs.Add("a", stubs.Job(0));
+	JobGraph::JobId b = jobs.Add("b", stubs.Job(1), { a });
+	JobGraph::JobId c = jobs.Add("c", stubs.Job(2), { a });
+	JobGraph::JobId d = jobs.Add("d", stubs.Job(3), { b, c });
+	JobGraph::JobId e = jobs.Add("e", stubs.Job(4), { d });
+	jobs.Add("f", stubs.Job(5), { e });
+	jobs.Run();
+
+	const std::vector<StubJobs::Record>& r = stubs.Records;
+	CHECK(r[1].Started > r[0].Finished);
+	CHECK(r[2].Started > r[0].Finished);
+	CHECK(r[3].Started > r[1].Finished);
+	CHECK(r[3].Started > r[2].Finished);
+	CHECK(r[4].Started > r[3].Finished);
+	CHECK(r[5].Started > r[4].Finished);
+}
+
+TEST_CASE(RandomGraphsRespectDependencies) {
+	for (uint32_t seed = 0; seed < 20; ++seed) {
+		std::mt19937 random(seed);
+		const uint32_t jobCount = 200;
+
+		JobGraph jobs(1 + seed % 6);
+		StubJobs stubs(jobCount);
+		std::vector<std::vector<JobGraph::JobId>> dependencies(jobCount);
+
+		for (uint32_t i = 0; i < jobCount; ++i) {
+			uint32_t dependencyCount = i == 0 ? 0 : random() % 4;
+			for (uint32_t k = 0; k < dependencyCount; ++k) {
+				dependencies[i].push_back(random() % i);
+			}
+			jobs.Add("job" + std::to_string(i), stubs.Job(i), dependencies[i]);
+		}
+		jobs.Run();
+
+		for (uint32_t i = 0; i < jobCount; ++i) {
+			REQUIRE(stubs.Records[i].Runs == 1);
+			for (JobGraph::JobId dependency : dependencies[i]) {
+				REQUIRE(stubs.Records[i].Started > stubs.Records[dependency].Finished);
+			}
+		}
+	}
+}
+
+TEST_CASE(TimingsFollowAddOrder) {
+	JobGraph jobs(2);
+	StubJobs stubs(3);
+	jobs.Add("first", stubs.Job(0));
+	jobs.Add("second", stubs.Job(1));
+	jobs.Add("third", stubs.Job(2), { 0, 1 });
+	jobs.Run();
+
+	const std::vector<JobGraph::Timing>& timings = jobs.Timings();
+	REQUIRE(timings.size() == 3);
+	CHECK(timings[0].Name == "first");
+	CHECK(timings[1].Name == "second");
+	CHECK(timings[2].Name == "third");
+	for (const JobGraph::Timing& timing : timings) {
+		CHECK(timing.End >= timing.Start);
+		CHECK(timing.Thread < jobs.ThreadCount());
+	}
+	CHECK(timings[2].Start >= timings[0].End);
+	CHECK(timings[2].Start >= timings[1].End);
+	CHECK(jobs.Seconds() >= timings[2].End);
+}
+
+TEST_CASE(ExceptionSkipsDependentsAndIsRethrown) {
+	JobGraph jobs(1);
+	bool dependentRan = false;
+	JobGraph::JobId failing = jobs.Add("failing", []() {
+		throw std::runtime_error("stub failure");
+	});
+	jobs.Add("dependent", [&dependentRan]() {
+		dependentRan = true;
+	}, { failing });
+
+	bool caught = false;
+	try {
+		jobs.Run();
+	} catch (const std::runtime_error& error) {
+		caught = std::string(error.what()) == "stub failure";
+	}
+	CHECK(caught);
+	CHECK(!dependentRan);
+}
+
+TEST_CASE(ClearedGraphRunsAgainOnTheSameThreads) {
+	// Filled and run every frame, the way StencilDemo uses its one graph.
+	JobGraph jobs(4);
+	std::mutex mutex;
+	std::set<std::thread::id> threads;
+
+	for (uint32_t frame = 0; frame < 300; ++frame) {
+		jobs.Clear();
+		StubJobs stubs(1 + frame % 16);
+		JobGraph::JobId previous = 0;
+		for (uint32_t i = 0; i < (uint32_t)stubs.Records.size(); ++i) {
+			std::function<void()> job = stubs.Job(i);
+			auto work = [&, job]() {
+				job();
+				std::lock_guard<std::mutex> lock(mutex);
+				threads.insert(std::this_thread::get_id());
+			};
+			// Every fourth job waits for the one before it.
+			previous = i % 4 == 3 ? jobs.Add("job", work, { previous }) : jobs.Add("job", work);
+		}
+		jobs.Run();
+
+		REQUIRE(jobs.Timings().size() == stubs.Records.size());
+		for (uint32_t i = 0; i < (uint32_t)stubs.Records.size(); ++i) {
+			REQUIRE(stubs.Records[i].Runs == 1);
+			if (i % 4 == 3) {
+				REQUIRE(stubs.Records[i].Started > stubs.Records[i - 1].Finished);
+			}
+		}
+	}
+
+	CHECK(threads.size() <= 4);
+}
+
+TEST_CASE(RunsAgainAfterAnException) {
+	JobGraph jobs(3);
+	jobs.Add("throws", []() {
+		throw std::runtime_error("job failed");
+	});
+
+	bool threw = false;
+	try {
+		jobs.Run();
+	} catch (const std::runtime_error&) {
+		threw = true;
+	}
+	CHECK(threw);
+
+	jobs.Clear();
+	StubJobs stubs(8);
+	for (uint32_t i = 0; i < 8; ++i) {
+		jobs.Add("job", stubs.Job(i));
+	}
+	jobs.Run();
+	for (const StubJobs::Record& record : stubs.Records) {
+		CHECK(record.Runs == 1);
+	}
+}
+
+TEST_CASE(UnusedGraphShutsDown) {
+	JobGraph jobs(8);
+	CHECK(jobs.ThreadCount() == 8);
+}
@@ -0,0 +1,123 @@
+#include "Bench.h"
+
+#include "NameRegistry.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+	// ShaderPermutations.h needs the Windows headers; these are the same three counts.
+	struct LightCounts {
+		uint32_t Directional = 0;
+		uint32_t Point = 0;
+		uint32_t Spot = 0;
+
+		bool operator==(const LightCounts& rhs) const {
+			return Directional == rhs.Directional && Point == rhs.Point && Spot == rhs.Spot;
+		}
+	};
+
+	// Stands in for the PSO and material objects; only their addresses are looked up.
+	struct Object {
+		int Id;
+	};
+
+	// The key StencilDemo built for every PSO lookup before the registry.
+	std::string VariantName(const std::string& name, const LightCounts& lights) {
+		return name + "/" + std::to_string(lights.Directional) + "." + std::to_string(lights.Point) + "." +
+			std::to_string(lights.Spot);
+	}
+
+	struct PSOSource {
+		struct Variant {
+			LightCounts Lights;
+			NameRegistry<std::unique_ptr<Object>>::Handle PSO;
+		};
+
+		std::vector<Variant> Variants;
+	};
+
+	const char* const SourceNames[] = {
+		"opaque", "opaque_wireframe", "markStencilMirrors", "drawStencilReflections",
+		"transparent", "shadow", "alphaTest", "zTest",
+	};
+
+	const char* const MaterialNames[] = {
+		"bricks", "checkertile", "icemirror", "skullMat", "shadowMat", "boltMat",
+	};
+}
+
+// One frame of StencilDemo's lookups: the five passes' PSOs, each for the main or the reflected
+// lights, and the bolt material. There are 16 PSO variants, every source built for both light lists.
+int main() {
+	LightCounts mainLights;
+	mainLights.Directional = 3;
+	LightCounts reflectedLights = mainLights;
+	reflectedLights.Point = 1;
+
+	struct Pass {
+		uint32_t Source;
+		bool Reflected;
+	};
+	const Pass passes[] = { { 0, false }, { 2, false }, { 3, true }, { 4, false }, { 5, false } };
+
+	std::unordered_map<std::string, std::unique_ptr<Object>> stringPSOs;
+	std::unordered_map<std::string, std::unique_ptr<Object>> stringMaterials;
+	NameRegistry<std::unique_ptr<Object>> psos;
+	NameRegistry<PSOSource> sources;
+	NameRegistry<std::unique_ptr<Object>> materials;
+
+	int id = 0;
+	for (const char* name : SourceNames) {
+		PSOSource source;
+		for (const LightCounts& lights : { mainLights, reflectedLights }) {
+			stringPSOs[VariantName(name, lights)].reset(new Object{ id });
+			source.Variants.push_back({ lights, psos.Add(VariantName(name, lights), std::unique_ptr<Object>(new Object{ id })) });
+			id++;
+		}
+		sources.Add(name, std::move(source));
+	}
+	for (const char* name : MaterialNames) {
+		stringMaterials[name].reset(new Object{ id });
+		materials.Add(name, std::unique_ptr<Object>(new Object{ id }));
+		id++;
+	}
+
+	// Resolved once at build time, as StencilDemo does for its passes and the bolt material.
+	NameRegistry<PSOSource>::Handle sourceHandles[sizeof(passes) / sizeof(passes[0])];
+	for (size_t i = 0; i < sizeof(passes) / sizeof(passes[0]); ++i) {
+		sourceHandles[i] = sources.Find(SourceNames[passes[i].Source]);
+	}
+	NameRegistry<std::unique_ptr<Object>>::Handle boltMat = materials.Find("boltMat");
+
+	Object* resolved[6];
+	double stringNs = Bench::Report("per frame, variant name strings", 1, [&]() {
+		for (size_t i = 0; i < sizeof(passes) / sizeof(passes[0]); ++i) {
+			const LightCounts& lights = passes[i].Reflected ? reflectedLights : mainLights;
+			resolved[i] = stringPSOs[VariantName(SourceNames[passes[i].Source], lights)].get();
+		}
+		resolved[5] = stringMaterials["boltMat"].get();
+		Bench::DoNotOptimize(resolved);
+	});
+
+	double handleNs = Bench::Report("per frame, NameRegistry handles", 1, [&]() {
+		for (size_t i = 0; i < sizeof(passes) / sizeof(passes[0]); ++i) {
+			const LightCounts& lights = passes[i].Reflected ? reflectedLights : mainLights;
+			resolved[i] = nullptr;
+			for (const PSOSource::Variant& variant : sources[sourceHandles[i]].Variants) {
+				if (variant.Lights == lights) {
+					resolved[i] = psos[variant.PSO].get();
+					break;
+				}
+			}
+		}
+		resolved[5] = materials[boltMat].get();
+		Bench::DoNotOptimize(resolved);
+	});
+
+	printf("  handles are %.1fx the speed of strings\n", stringNs / handleNs);
+	return 0;
+}
@@ -0,0 +1,76 @@
+#include "Check.h"
+
+#include "NameRegistry.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+TEST_CASE(AddedValuesAreFoundByNameAndHandle) {
+	NameRegistry<int> registry;
+	NameRegistry<int>::Handle a = registry.Add("a", 1);
+	NameRegistry<int>::Handle b = registry.Add("b", 2);
+
+	CHECK(a.IsValid() && b.IsValid());
+	CHECK(a.Index != b.Index);
+	CHECK(registry.Count() == 2);
+	CHECK(registry.Find("b").Index == b.Index);
+	CHECK(registry[a] == 1);
+	CHECK(registry.Get("b") == 2);
+	CHECK(registry.Name(b) == "b");
+}
+
+TEST_CASE(AddingATakenNameReplacesTheValue) {
+	NameRegistry<std::unique_ptr<int>> registry;
+	NameRegistry<std::unique_ptr<int>>::Handle first = registry.Add("a", std::make_unique<int>(1));
+	NameRegistry<std::unique_ptr<int>>::Handle second = registry.Add("a", std::make_unique<int>(2));
+
+	CHECK(first.Index == second.Index);
+	CHECK(registry.Count() == 1);
+	CHECK(*registry.Get("a") == 2);
+}
+
+TEST_CASE(UnknownNameIsAnInvalidHandle) {
+	NameRegistry<int> registry;
+	registry.Add("a", 1);
+	CHECK(!registry.Find("missing").IsValid());
+	CHECK(!NameRegistry<int>::Handle().IsValid());
+}
+
+TEST_CASE(GetThrowsForAnUnknownName) {
+	NameRegistry<int> registry;
+	registry.Add("a", 1);
+
+	bool threw = false;
+	try {
+		registry.Get("missing");
+	} catch (const std::out_of_range& e) {
+		threw = std::string(e.what()).find("missing") != std::string::npos;
+	}
+	CHECK(threw);
+
+	const NameRegistry<int>& constRegistry = registry;
+	threw = false;
+	try {
+		constRegistry.Get("");
+	} catch (const std::out_of_range&) {
+		threw = true;
+	}
+	CHECK(threw);
+
+	// The failed lookups added nothing.
+	CHECK(registry.Count() == 1);
+}
+
+TEST_CASE(IterationFollowsHandleOrder) {
+	NameRegistry<int> registry;
+	for (int i = 0; i < 10; ++i) {
+		registry.Add("value" + std::to_string(i), i);
+	}
+
+	int expected = 0;
+	for (int value : registry) {
+		CHECK(value == expected++);
+	}
+	CHECK(expected == 10);
+}
@@ -0,0 +1,167 @@
+#include "Check.h"
+
+#include "ObjectConstantBuilder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+	// Constant buffer elements are padded to 256 bytes, like CalcConstantBufferByteSize does.
+	const uint32_t Stride = 256;
+	const uint8_t Untouched = 0xcd;
+
+	struct alignas(16) Chunk16 {
+		uint8_t Bytes[16];
+	};
+
+	// A 16-byte aligned buffer of count elements, filled with Untouched.
+	struct ConstantBuffer {
+		explicit ConstantBuffer(uint32_t count) : Storage(count * Stride / sizeof(Chunk16)) {
+			memset(Data(), Untouched, Storage.size() * sizeof(Chunk16));
+		}
+
+		uint8_t* Data() {
+			return Storage.front().Bytes;
+		}
+
+		const float* Element(uint32_t index) {
+			return reinterpret_cast<const float*>(Data() + (size_t)index * Stride);
+		}
+
+		std::vector<Chunk16> Storage;
+	};
+
+	std::vector<XMFLOAT4X4> RandomMatrices(std::mt19937& random, uint32_t count) {
+		std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+		std::vector<XMFLOAT4X4> matrices(count);
+		for (XMFLOAT4X4& m : matrices) {
+			for (int row = 0; row < 4; ++row) {
+				for (int column = 0; column < 4; ++column) {
+					m.m[row][column] = value(random);
+				}
+			}
+		}
+		return matrices;
+	}
+
+	// The element holds world then texTransform, each transposed, and nothing else of the 256 bytes
+	// was written.
+	bool MatchesScalarTranspose(ConstantBuffer& buffer, uint32_t index, const XMFLOAT4X4& world, const XMFLOAT4X4& texTransform) {
+		const float* element = buffer.Element(index);
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				if (element[column * 4 + row] != world.m[row][column] || element[16 + column * 4 + row] != texTransform.m[row][column])
+					return false;
+			}
+		}
+
+		const uint8_t* rest = reinterpret_cast<const uint8_t*>(element) + ObjectConstantBuilder::ConstantsSize;
+		for (uint32_t i = 0; i < Stride - ObjectConstantBuilder::ConstantsSize; ++i) {
+			if (rest[i] != Untouched)
+				return false;
+		}
+		return true;
+	}
+
+	bool IsUntouched(ConstantBuffer& buffer, uint32_t index) {
+		const uint8_t* element = reinterpret_cast<const uint8_t*>(buffer.Element(index));
+		for (uint32_t i = 0; i < Stride; ++i) {
+			if (element[i] != Untouched)
+				return false;
+		}
+		return true;
+	}
+}
+
+// Every index from 0 to count - 1. The counts cover the scalar tail alone, every tail length after
+// a group of four, and larger lists with and without a tail.
+TEST_CASE(DenseIndicesMatchAScalarTranspose) {
+	const uint32_t counts[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 1001, 1024 };
+
+	std::mt19937 random(3);
+	for (uint32_t count : counts) {
+		std::vector<XMFLOAT4X4> world = RandomMatrices(random, count);
+		std::vector<XMFLOAT4X4> texTransform = RandomMatrices(random, count);
+		std::vector<uint32_t> indices(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			indices[i] = i;
+		}
+
+		ConstantBuffer buffer(count + 1);
+		ObjectConstantBuilder::Build(indices.data(), count, world.data(), texTransform.data(), buffer.Data(), Stride);
+
+		for (uint32_t i = 0; i < count; ++i) {
+			REQUIRE(MatchesScalarTranspose(buffer, i, world[i], texTransform[i]));
+		}
+		CHECK(IsUntouched(buffer, count));
+	}
+}
+
+// A sorted subset of the items, as UpdateObjectCBs passes the dirty ones: only their elements are
+// written, each from its own matrices.
+TEST_CASE(SparseIndicesOnlyWriteTheirElements) {
+	const uint32_t itemCount = 2000;
+	const uint32_t counts[] = { 1, 3, 5, 7, 10, 99, 1001 };
+
+	std::mt19937 random(5);
+	std::vector<XMFLOAT4X4> world = RandomMatrices(random, itemCount);
+	std::vector<XMFLOAT4X4> texTransform = RandomMatrices(random, itemCount);
+
+	for (uint32_t count : counts) {
+		std::vector<bool> chosen(itemCount, false);
+		for (uint32_t picked = 0; picked < count;) {
+			uint32_t index = random() % itemCount;
+			if (!chosen[index]) {
+				chosen[index] = true;
+				picked++;
+			}
+		}
+		std::vector<uint32_t> indices;
+		for (uint32_t i = 0; i < itemCount; ++i) {
+			if (chosen[i])
+				indices.push_back(i);
+		}
+
+		ConstantBuffer buffer(itemCount);
+		ObjectConstantBuilder::Build(indices.data(), (uint32_t)indices.size(), world.data(), texTransform.data(), buffer.Data(), Stride);
+
+		for (uint32_t i = 0; i < itemCount; ++i) {
+			if (chosen[i]) {
+				REQUIRE(MatchesScalarTranspose(buffer, i, world[i], texTransform[i]));
+			} else {
+				REQUIRE(IsUntouched(buffer, i));
+			}
+		}
+	}
+}
+
+// Disjoint blocks of one index list, built separately (as the workers do), give the same buffer as
+// one call over the whole list.
+TEST_CASE(BlocksBuildTheSameAsOneCall) {
+	const uint32_t count = 2 * ObjectConstantBuilder::BlockSize + 5;
+
+	std::mt19937 random(9);
+	std::vector<XMFLOAT4X4> world = RandomMatrices(random, count);
+	std::vector<XMFLOAT4X4> texTransform = RandomMatrices(random, count);
+	std::vector<uint32_t> indices(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		indices[i] = count - 1 - i;
+	}
+
+	ConstantBuffer whole(count);
+	ObjectConstantBuilder::Build(indices.data(), count, world.data(), texTransform.data(), whole.Data(), Stride);
+
+	const uint32_t blockSize = ObjectConstantBuilder::BlockSize;
+	ConstantBuffer blocks(count);
+	for (uint32_t first = 0; first < count; first += blockSize) {
+		uint32_t blockCount = std::min(blockSize, count - first);
+		ObjectConstantBuilder::Build(indices.data() + first, blockCount, world.data(), texTransform.data(), blocks.Data(), Stride);
+	}
+
+	CHECK(memcmp(whole.Data(), blocks.Data(), (size_t)count * Stride) == 0);
+}
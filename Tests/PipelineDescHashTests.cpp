@@ -0,0 +1,229 @@
+#include "Check.h"
+
+#include "D3D12Stubs.h"
+#include "PipelineDescHash.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+static_assert(sizeof(D3D12_RENDER_TARGET_BLEND_DESC) == 40, "the write mask should be followed by padding");
+
+namespace {
+const unsigned char g_VS[] = { 0x44, 0x58, 0x42, 0x43, 0x01, 0x02, 0x03, 0x04 };
+const unsigned char g_PS[] = { 0x44, 0x58, 0x42, 0x43, 0x05, 0x06, 0x07, 0x08, 0x09 };
+
+const D3D12_INPUT_ELEMENT_DESC g_InputLayout[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+// The description lives in memory filled with garbage, and the blend and depth stencil states are
+// built in stack temporaries and copied in, the way StencilDemo fills its PSO descriptions, so
+// every padding byte holds garbage.
+struct DescStorage {
+	explicit DescStorage(unsigned char garbage) {
+		memset(Bytes, garbage, sizeof(Bytes));
+		Desc = reinterpret_cast<D3D12_GRAPHICS_PIPELINE_STATE_DESC*>(Bytes);
+	}
+
+	alignas(D3D12_GRAPHICS_PIPELINE_STATE_DESC) unsigned char Bytes[sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC)];
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC* Desc;
+};
+
+D3D12_BLEND_DESC TransparentBlend(unsigned char garbage) {
+	D3D12_BLEND_DESC blend;
+	memset(&blend, garbage, sizeof(blend));
+	blend.AlphaToCoverageEnable = false;
+	blend.IndependentBlendEnable = false;
+	for (D3D12_RENDER_TARGET_BLEND_DESC& target : blend.RenderTarget) {
+		target.BlendEnable = true;
+		target.LogicOpEnable = false;
+		target.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+		target.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+		target.BlendOp = D3D12_BLEND_OP_ADD;
+		target.SrcBlendAlpha = D3D12_BLEND_ONE;
+		target.DestBlendAlpha = D3D12_BLEND_ZERO;
+		target.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+		target.LogicOp = D3D12_LOGIC_OP_NOOP;
+		target.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+	}
+	return blend;
+}
+
+D3D12_DEPTH_STENCIL_DESC MarkMirrorsDepthStencil(unsigned char garbage) {
+	D3D12_DEPTH_STENCIL_DESC depthStencil;
+	memset(&depthStencil, garbage, sizeof(depthStencil));
+	depthStencil.DepthEnable = true;
+	depthStencil.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	depthStencil.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+	depthStencil.StencilEnable = true;
+	depthStencil.StencilReadMask = 0xff;
+	depthStencil.StencilWriteMask = 0xff;
+	depthStencil.FrontFace = { D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_REPLACE, D3D12_COMPARISON_FUNC_ALWAYS };
+	depthStencil.BackFace = depthStencil.FrontFace;
+	return depthStencil;
+}
+
+void Fill(D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, unsigned char garbage) {
+	desc.pRootSignature = nullptr;
+	desc.VS = { g_VS, sizeof(g_VS) };
+	desc.PS = { g_PS, sizeof(g_PS) };
+	desc.DS = { nullptr, 0 };
+	desc.HS = { nullptr, 0 };
+	desc.GS = { nullptr, 0 };
+	desc.StreamOutput.pSODeclaration = nullptr;
+	desc.StreamOutput.NumEntries = 0;
+	desc.StreamOutput.pBufferStrides = nullptr;
+	desc.StreamOutput.NumStrides = 0;
+	desc.StreamOutput.RasterizedStream = 0;
+	desc.BlendState = TransparentBlend(garbage);
+	desc.SampleMask = UINT32_MAX;
+	desc.RasterizerState = { D3D12_FILL_MODE_SOLID, D3D12_CULL_MODE_BACK, false, 0, 0.0f, 0.0f, true, false, false, 0,
+							 D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF };
+	desc.DepthStencilState = MarkMirrorsDepthStencil(garbage);
+	desc.InputLayout = { g_InputLayout, 3 };
+	desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+	desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	desc.NumRenderTargets = 1;
+	for (DXGI_FORMAT& format : desc.RTVFormats) {
+		format = DXGI_FORMAT_UNKNOWN;
+	}
+	desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	desc.SampleDesc = { 1, 0 };
+	desc.NodeMask = 0;
+	desc.CachedPSO = { nullptr, 0 };
+	desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+}
+
+uint64_t HashOf(unsigned char garbage, const std::function<void(D3D12_GRAPHICS_PIPELINE_STATE_DESC&)>& change = nullptr) {
+	DescStorage storage(garbage);
+	Fill(*storage.Desc, garbage);
+	if (change) {
+		change(*storage.Desc);
+	}
+	return PipelineDescHash::Hash(*storage.Desc);
+}
+}
+
+TEST_CASE(SameDescriptionHashesTheSame) {
+	CHECK(HashOf(0x00) == HashOf(0x00));
+	CHECK(HashOf(0xcd) == HashOf(0xcd));
+}
+
+TEST_CASE(PaddingBytesDoNotAffectTheHash) {
+	// Make sure the garbage really ends up in the descriptions being compared.
+	DescStorage a(0x00), b(0xcd);
+	Fill(*a.Desc, 0x00);
+	Fill(*b.Desc, 0xcd);
+	CHECK(memcmp(&a.Desc->BlendState, &b.Desc->BlendState, sizeof(D3D12_BLEND_DESC)) != 0);
+	CHECK(memcmp(&a.Desc->DepthStencilState, &b.Desc->DepthStencilState, sizeof(D3D12_DEPTH_STENCIL_DESC)) != 0);
+
+	CHECK(PipelineDescHash::Hash(*a.Desc) == PipelineDescHash::Hash(*b.Desc));
+	CHECK(HashOf(0x00) == HashOf(0xff));
+	CHECK(HashOf(0x5a) == HashOf(0xa5));
+}
+
+TEST_CASE(ContentIsHashedNotPointers) {
+	// Same byte code and semantic names at other addresses.
+	std::vector<unsigned char> vs(g_VS, g_VS + sizeof(g_VS));
+	std::string position = "POSITION";
+	D3D12_INPUT_ELEMENT_DESC layout[3] = { g_InputLayout[0], g_InputLayout[1], g_InputLayout[2] };
+	layout[0].SemanticName = position.c_str();
+
+	uint64_t moved = HashOf(0x00, [&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) {
+		desc.VS = { vs.data(), vs.size() };
+		desc.InputLayout = { layout, 3 };
+	});
+	CHECK(moved == HashOf(0x00));
+}
+
+TEST_CASE(RootSignatureAndCachedBlobAreIgnored) {
+	uint64_t changed = HashOf(0x00, [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) {
+		desc.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(uintptr_t(0x1000));
+		desc.CachedPSO = { g_VS, sizeof(g_VS) };
+	});
+	CHECK(changed == HashOf(0x00));
+}
+
+TEST_CASE(EveryFieldChangesTheHash) {
+	typedef std::function<void(D3D12_GRAPHICS_PIPELINE_STATE_DESC&)> Change;
+	static const unsigned char otherShader[] = { 0x44, 0x58, 0x42, 0x43, 0x01, 0x02, 0x03, 0x05 };
+	static const D3D12_SO_DECLARATION_ENTRY soEntry = { 0, "SV_POSITION", 0, 0, 4, 0 };
+	static const UINT soStride = 16;
+
+	std::vector<std::pair<const char*, Change>> changes = {
+		{ "VS bytes", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.VS = { otherShader, sizeof(otherShader) }; } },
+		{ "PS length", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.PS.BytecodeLength--; } },
+		{ "GS", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.GS = { g_VS, sizeof(g_VS) }; } },
+		{ "stream output", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) {
+			d.StreamOutput = { &soEntry, 1, &soStride, 1, 0 };
+		} },
+		{ "AlphaToCoverageEnable", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.AlphaToCoverageEnable = true; } },
+		{ "IndependentBlendEnable", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.IndependentBlendEnable = true; } },
+		{ "BlendEnable", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.RenderTarget[0].BlendEnable = false; } },
+		{ "DestBlend", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_ONE; } },
+		{ "BlendOpAlpha", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_SUBTRACT; } },
+		{ "LogicOp", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.RenderTarget[0].LogicOp = D3D12_LOGIC_OP_CLEAR; } },
+		{ "RenderTargetWriteMask", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.RenderTarget[0].RenderTargetWriteMask = 0; } },
+		{ "last render target", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.RenderTarget[7].SrcBlend = D3D12_BLEND_ZERO; } },
+		{ "SampleMask", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.SampleMask = 1; } },
+		{ "FillMode", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME; } },
+		{ "CullMode", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; } },
+		{ "FrontCounterClockwise", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RasterizerState.FrontCounterClockwise = true; } },
+		{ "DepthBias", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RasterizerState.DepthBias = 1; } },
+		{ "SlopeScaledDepthBias", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RasterizerState.SlopeScaledDepthBias = 1.0f; } },
+		{ "ConservativeRaster", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) {
+			d.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON;
+		} },
+		{ "DepthWriteMask", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL; } },
+		{ "DepthFunc", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL; } },
+		{ "StencilWriteMask", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.StencilWriteMask = 0x0f; } },
+		{ "FrontFace pass op", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_INCR; } },
+		{ "BackFace func", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_NEVER; } },
+		{ "input element count", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.InputLayout.NumElements = 2; } },
+		{ "semantic name", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) {
+			static D3D12_INPUT_ELEMENT_DESC layout[3] = { g_InputLayout[0], g_InputLayout[1], g_InputLayout[2] };
+			layout[1].SemanticName = "TANGENT";
+			d.InputLayout = { layout, 3 };
+		} },
+		{ "AlignedByteOffset", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) {
+			static D3D12_INPUT_ELEMENT_DESC layout[3] = { g_InputLayout[0], g_InputLayout[1], g_InputLayout[2] };
+			layout[2].AlignedByteOffset = 28;
+			d.InputLayout = { layout, 3 };
+		} },
+		{ "IBStripCutValue", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF; } },
+		{ "PrimitiveTopologyType", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; } },
+		{ "NumRenderTargets", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.NumRenderTargets = 2; } },
+		{ "RTVFormats", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RTVFormats[0] = DXGI_FORMAT_R32G32_FLOAT; } },
+		{ "DSVFormat", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DSVFormat = DXGI_FORMAT_UNKNOWN; } },
+		{ "SampleDesc", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.SampleDesc.Count = 4; } },
+		{ "NodeMask", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.NodeMask = 1; } },
+		{ "Flags", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.Flags = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG; } },
+	};
+
+	std::set<uint64_t> hashes = { HashOf(0x00) };
+	for (const auto& change : changes) {
+		uint64_t hash = HashOf(0x00, change.second);
+		if (!hashes.insert(hash).second) {
+			fprintf(stderr, "  no new hash after changing %s\n", change.first);
+			CHECK(false);
+		}
+
+		// And still independent of padding with the change made.
+		CHECK(hash == HashOf(0xcd, change.second));
+	}
+}
+
+TEST_CASE(ChangingUnusedRenderTargetFormatsIsIgnored) {
+	uint64_t changed = HashOf(0x00, [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) {
+		desc.RTVFormats[5] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	});
+	CHECK(changed == HashOf(0x00));
+}
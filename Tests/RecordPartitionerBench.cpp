@@ -0,0 +1,96 @@
+#include "Bench.h"
+
+#include "JobGraph.h"
+#include "RecordPartitioner.h"
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+	// Stands in for a command list: recording appends commands, and opening a list costs about as
+	// much as the state setup every list starts with.
+	struct MockList {
+		std::vector<uint64_t> Commands;
+
+		void Open() {
+			Commands.clear();
+			for (uint64_t i = 0; i < ListSetupCommands; ++i) {
+				Record(i);
+			}
+		}
+
+		void Record(uint64_t command) {
+			// A little work per command, like validating and encoding the arguments.
+			uint64_t word = command * 0x9e3779b97f4a7c15ull;
+			for (int i = 0; i < 8; ++i) {
+				word ^= word >> 29;
+				word *= 0xbf58476d1ce4e5b9ull;
+			}
+			Commands.push_back(word);
+		}
+
+		static const uint64_t ListSetupCommands = 50;
+	};
+
+	// A draw binds its object constants and textures, then draws.
+	void RecordDraws(MockList& list, uint32_t pass, uint32_t first, uint32_t count) {
+		for (uint32_t draw = first; draw < first + count; ++draw) {
+			uint64_t id = ((uint64_t)pass << 32) | draw;
+			list.Record(id);
+			list.Record(id + 1);
+			list.Record(id + 2);
+		}
+	}
+}
+
+// Records a frame of passes shaped like StencilDemo's (a large opaque pass, smaller mirrored,
+// transparent and shadow passes) into mock lists, whole on one thread and in chunks on a JobGraph.
+// The speedup depends on the cores available; on one core the chunks only add list overhead.
+int main() {
+	const uint32_t minChunkDraws = 64;
+	const uint32_t threadCount = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+	printf("%u hardware threads\n", threadCount);
+
+	const uint32_t scales[] = { 1, 10, 100 };
+	for (uint32_t scale : scales) {
+		std::vector<uint32_t> drawCounts = { 150 * scale, 20 * scale, 20 * scale, 40 * scale, 10 * scale, 10 * scale };
+		uint32_t totalDraws = 0;
+		for (uint32_t count : drawCounts) {
+			totalDraws += count;
+		}
+
+		std::vector<RecordPartitioner::Chunk> whole;
+		RecordPartitioner::Partition(drawCounts.data(), (uint32_t)drawCounts.size(), 1, UINT32_MAX, whole);
+		std::vector<RecordPartitioner::Chunk> chunks;
+		RecordPartitioner::Partition(drawCounts.data(), (uint32_t)drawCounts.size(), threadCount, minChunkDraws, chunks);
+
+		char name[96];
+		MockList serialList;
+		snprintf(name, sizeof(name), "serial, %u draws", totalDraws);
+		Bench::Report(name, totalDraws, [&]() {
+			serialList.Open();
+			for (const RecordPartitioner::Chunk& chunk : whole) {
+				RecordDraws(serialList, chunk.Pass, chunk.First, chunk.Count);
+			}
+			Bench::DoNotOptimize(serialList.Commands.data());
+		});
+
+		JobGraph jobs(threadCount);
+		std::vector<MockList> lists(chunks.size());
+		snprintf(name, sizeof(name), "%zu chunks on %u threads, %u draws", chunks.size(), threadCount, totalDraws);
+		Bench::Report(name, totalDraws, [&]() {
+			jobs.Clear();
+			for (size_t i = 0; i < chunks.size(); ++i) {
+				jobs.Add("record chunk", [&, i]() {
+					lists[i].Open();
+					RecordDraws(lists[i], chunks[i].Pass, chunks[i].First, chunks[i].Count);
+				});
+			}
+			jobs.Run();
+			Bench::DoNotOptimize(lists.data());
+		});
+	}
+
+	return 0;
+}
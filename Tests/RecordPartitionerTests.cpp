@@ -0,0 +1,127 @@
+#include "Check.h"
+
+#include "RecordPartitioner.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+	typedef std::vector<RecordPartitioner::Chunk> Chunks;
+
+	Chunks Partition(const std::vector<uint32_t>& drawCounts, uint32_t workerCount, uint32_t minChunkDraws) {
+		Chunks chunks = { { 99, 99, 99 } };	// Partition() starts from an empty list.
+		RecordPartitioner::Partition(drawCounts.data(), (uint32_t)drawCounts.size(), workerCount, minChunkDraws, chunks);
+		return chunks;
+	}
+
+	// Chunks cover every draw of every pass exactly once, in pass order and then draw order, with no
+	// empty chunks; within a pass they are even and none is under the minimum unless the pass is.
+	bool CoversInOrder(const std::vector<uint32_t>& drawCounts, uint32_t minChunkDraws, const Chunks& chunks) {
+		size_t next = 0;
+		for (uint32_t pass = 0; pass < drawCounts.size(); ++pass) {
+			uint32_t covered = 0;
+			uint32_t smallest = UINT32_MAX;
+			uint32_t largest = 0;
+			for (; next < chunks.size() && chunks[next].Pass == pass; ++next) {
+				const RecordPartitioner::Chunk& chunk = chunks[next];
+				if (chunk.First != covered || chunk.Count == 0)
+					return false;
+				covered += chunk.Count;
+				smallest = std::min(smallest, chunk.Count);
+				largest = std::max(largest, chunk.Count);
+			}
+
+			if (covered != drawCounts[pass])
+				return false;
+			if (covered > 0 && (largest - smallest > 1 || smallest < std::min(minChunkDraws, drawCounts[pass])))
+				return false;
+		}
+		return next == chunks.size();
+	}
+}
+
+TEST_CASE(NoPassesGiveNoChunks) {
+	CHECK(Partition({}, 4, 64).empty());
+	CHECK(Partition({ 0, 0, 0 }, 4, 64).empty());
+	CHECK(Partition({ 0, 0 }, 4, 0).empty());
+}
+
+TEST_CASE(EmptyPassesAreSkipped) {
+	std::vector<uint32_t> drawCounts = { 0, 10, 0, 0, 5, 0 };
+	Chunks chunks = Partition(drawCounts, 4, 64);
+	REQUIRE(chunks.size() == 2);
+	CHECK(chunks[0].Pass == 1 && chunks[0].First == 0 && chunks[0].Count == 10);
+	CHECK(chunks[1].Pass == 4 && chunks[1].First == 0 && chunks[1].Count == 5);
+	CHECK(CoversInOrder(drawCounts, 64, chunks));
+}
+
+TEST_CASE(PassesUnderTheMinimumStayWhole) {
+	std::vector<uint32_t> drawCounts = { 3, 63, 64 };
+	Chunks chunks = Partition(drawCounts, 8, 64);
+	CHECK(chunks.size() == 3);
+	CHECK(CoversInOrder(drawCounts, 64, chunks));
+}
+
+TEST_CASE(LargePassesSplitEvenlyPerWorker) {
+	// 1000 draws for 4 workers is 8 chunks of 125.
+	std::vector<uint32_t> drawCounts = { 1000 };
+	Chunks chunks = Partition(drawCounts, 4, 64);
+	REQUIRE(chunks.size() == 4 * RecordPartitioner::ChunksPerWorker);
+	for (const RecordPartitioner::Chunk& chunk : chunks) {
+		CHECK(chunk.Count == 125);
+	}
+	CHECK(CoversInOrder(drawCounts, 64, chunks));
+
+	// 1010 draws aim for 127 a chunk, so the big pass is 7 chunks: the first six get the 6 draws
+	// that do not divide evenly. The small pass stays whole.
+	drawCounts = { 1000, 10 };
+	chunks = Partition(drawCounts, 4, 64);
+	REQUIRE(chunks.size() == 8);
+	CHECK(chunks[0].Count == 143 && chunks[5].Count == 143 && chunks[6].Count == 142);
+	CHECK(chunks[7].Pass == 1 && chunks[7].Count == 10);
+	CHECK(CoversInOrder(drawCounts, 64, chunks));
+}
+
+TEST_CASE(MinimumChunkSizeLimitsTheSplit) {
+	// 16 workers would want 32 chunks of about 32 draws; the minimum of 100 allows only 10.
+	std::vector<uint32_t> drawCounts = { 1000 };
+	Chunks chunks = Partition(drawCounts, 16, 100);
+	CHECK(chunks.size() == 10);
+	CHECK(CoversInOrder(drawCounts, 100, chunks));
+
+	// A minimum above every pass keeps them all whole, which is how the serial path records.
+	drawCounts = { 1000, 20, 5000 };
+	chunks = Partition(drawCounts, 16, UINT32_MAX);
+	CHECK(chunks.size() == 3);
+	CHECK(CoversInOrder(drawCounts, UINT32_MAX, chunks));
+}
+
+TEST_CASE(ZeroWorkersCountAsOne) {
+	std::vector<uint32_t> drawCounts = { 1000, 7 };
+	Chunks none = Partition(drawCounts, 0, 1);
+	Chunks one = Partition(drawCounts, 1, 1);
+	REQUIRE(none.size() == one.size());
+	for (size_t i = 0; i < none.size(); ++i) {
+		CHECK(none[i].Pass == one[i].Pass && none[i].First == one[i].First && none[i].Count == one[i].Count);
+	}
+	CHECK(CoversInOrder(drawCounts, 1, none));
+}
+
+TEST_CASE(RandomPassesAreCoveredInOrder) {
+	for (uint32_t seed = 0; seed < 500; ++seed) {
+		std::mt19937 random(seed);
+		std::vector<uint32_t> drawCounts(random() % 10);
+		for (uint32_t& count : drawCounts) {
+			// Empty, small and large passes.
+			uint32_t kind = random() % 3;
+			count = kind == 0 ? 0 : kind == 1 ? random() % 100 : random() % 20000;
+		}
+		uint32_t workerCount = random() % 17;
+		uint32_t minChunkDraws = random() % 2 == 0 ? random() % 200 : 64;
+
+		Chunks chunks = Partition(drawCounts, workerCount, minChunkDraws);
+		REQUIRE(CoversInOrder(drawCounts, minChunkDraws, chunks));
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "D3D12Stubs.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// A fake ID3D12GraphicsCommandList for StateFilter. It counts the calls it receives and tracks the
+// state they leave bound, following the D3D12 rules the filter relies on: a new root signature
+// clears every root argument, new descriptor heaps leave the tables undefined, and ExecuteIndirect
+// leaves undefined the root arguments its command signature writes (IndirectRootArguments).
+//
+// Every draw and ExecuteIndirect takes a snapshot of the bound state, so a filtered recording can be
+// checked to draw with exactly the state an unfiltered one would.
+class RecordingCommandList {
+public:
+	struct RootArgument {
+		bool Set = false;
+		uint64_t Value = 0;
+
+		bool operator==(const RootArgument& other) const {
+			return Set == other.Set && (!Set || Value == other.Value);
+		}
+	};
+
+	static const UINT RootArgumentCount = 4;
+
+	struct Snapshot {
+		ID3D12DescriptorHeap* Heap = nullptr;
+		ID3D12RootSignature* RootSignature = nullptr;
+		ID3D12PipelineState* PSO = nullptr;
+		RootArgument RootArguments[RootArgumentCount];
+		D3D12_GPU_VIRTUAL_ADDRESS VertexBuffer = 0;
+		D3D12_GPU_VIRTUAL_ADDRESS IndexBuffer = 0;
+		D3D12_PRIMITIVE_TOPOLOGY Topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+		UINT StencilRef = 0;
+		UINT IndexCount = 0;
+
+		bool operator==(const Snapshot& other) const {
+			for (UINT i = 0; i < RootArgumentCount; ++i) {
+				if (!(RootArguments[i] == other.RootArguments[i]))
+					return false;
+			}
+			return Heap == other.Heap && RootSignature == other.RootSignature && PSO == other.PSO &&
+				VertexBuffer == other.VertexBuffer && IndexBuffer == other.IndexBuffer &&
+				Topology == other.Topology && StencilRef == other.StencilRef && IndexCount == other.IndexCount;
+		}
+	};
+
+public:
+	void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps) {
+		Count("SetDescriptorHeaps");
+		_state.Heap = count > 0 ? heaps[0] : nullptr;
+		for (UINT i : TableArguments) {
+			_state.RootArguments[i].Set = false;
+		}
+	}
+
+	void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) {
+		Count("SetGraphicsRootSignature");
+		_state.RootSignature = rootSignature;
+		for (RootArgument& argument : _state.RootArguments) {
+			argument.Set = false;
+		}
+	}
+
+	void SetPipelineState(ID3D12PipelineState* pso) {
+		Count("SetPipelineState");
+		_state.PSO = pso;
+	}
+
+	void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) {
+		Count("SetGraphicsRootConstantBufferView");
+		_state.RootArguments[rootParameterIndex] = { true, address };
+	}
+
+	void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) {
+		Count("SetGraphicsRootDescriptorTable");
+		_state.RootArguments[rootParameterIndex] = { true, baseDescriptor.ptr };
+	}
+
+	void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) {
+		Count("IASetVertexBuffers");
+		if (startSlot == 0 && numViews > 0) {
+			_state.VertexBuffer = views != nullptr ? views[0].BufferLocation : 0;
+		}
+	}
+
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) {
+		Count("IASetIndexBuffer");
+		_state.IndexBuffer = view != nullptr ? view->BufferLocation : 0;
+	}
+
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) {
+		Count("IASetPrimitiveTopology");
+		_state.Topology = topology;
+	}
+
+	void OMSetStencilRef(UINT stencilRef) {
+		Count("OMSetStencilRef");
+		_state.StencilRef = stencilRef;
+	}
+
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT, UINT, INT, UINT) {
+		Count("DrawIndexedInstanced");
+		Snapshot snapshot = _state;
+		snapshot.IndexCount = indexCountPerInstance;
+		Draws.push_back(snapshot);
+	}
+
+	void ExecuteIndirect(ID3D12CommandSignature*, UINT maxCommandCount, ID3D12Resource*, UINT64, ID3D12Resource*, UINT64) {
+		Count("ExecuteIndirect");
+		Snapshot snapshot = _state;
+		snapshot.IndexCount = maxCommandCount;
+		Draws.push_back(snapshot);
+
+		for (UINT i : IndirectRootArguments) {
+			_state.RootArguments[i].Set = false;
+		}
+	}
+
+	uint32_t Calls(const std::string& name) const {
+		auto it = _calls.find(name);
+		return it == _calls.end() ? 0 : it->second;
+	}
+
+	// Every call except draws.
+	uint32_t StateCalls() const {
+		return _stateCalls;
+	}
+
+public:
+	// Root parameters bound as descriptor tables, which new heaps invalidate.
+	std::vector<UINT> TableArguments = { 0 };
+
+	// Root parameters the command signature of ExecuteIndirect writes.
+	std::vector<UINT> IndirectRootArguments = { 1, 3 };
+
+	std::vector<Snapshot> Draws;
+
+private:
+	void Count(const char* name) {
+		_calls[name]++;
+		if (std::string(name) != "DrawIndexedInstanced" && std::string(name) != "ExecuteIndirect") {
+			_stateCalls++;
+		}
+	}
+
+private:
+	Snapshot _state;
+	std::map<std::string, uint32_t> _calls;
+	uint32_t _stateCalls = 0;
+};
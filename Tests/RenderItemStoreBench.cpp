@@ -0,0 +1,152 @@
+#include "Bench.h"
+
+#include "RenderItemStore.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+	// The layout RenderItemStore replaced: one heap allocation per item, everything in it.
+	struct PointerItem {
+		XMFLOAT4X4 World;
+		XMFLOAT4X4 TexTransform;
+		int NumFramesDirty;
+		uint32_t ObjCBIndex;
+		void* Mat;
+		void* Geo;
+		int PrimitiveType;
+		uint32_t IndexCount;
+		uint32_t StartIndexLocation;
+		int BaseVertexLocation;
+		BoundingBox Bounds;
+		BoundingBox WorldBounds;
+	};
+
+	struct DrawItem {
+		void* Mat;
+		void* Geo;
+		int PrimitiveType;
+		uint32_t IndexCount;
+	};
+
+	struct ObjectConstants {
+		XMFLOAT4X4 World;
+		XMFLOAT4X4 TexTransform;
+	};
+
+	void Transpose(const XMFLOAT4X4& m, XMFLOAT4X4& out) {
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				out.m[column][row] = m.m[row][column];
+			}
+		}
+	}
+
+	// The body of UpdateObjectCBs: write the constants, move the bounds to world space.
+	void WriteConstants(ObjectConstants* constants, uint32_t index, const XMFLOAT4X4& world, const XMFLOAT4X4& texTransform,
+						const BoundingBox& local, BoundingBox& worldBounds) {
+		ObjectConstants c;
+		Transpose(world, c.World);
+		Transpose(texTransform, c.TexTransform);
+		memcpy(&constants[index], &c, sizeof(c));
+
+		const float* center = &local.Center.x;
+		const float* extents = &local.Extents.x;
+		float outCenter[3], outExtents[3];
+		for (int column = 0; column < 3; ++column) {
+			outCenter[column] = world.m[3][column];
+			outExtents[column] = 0.0f;
+			for (int row = 0; row < 3; ++row) {
+				outCenter[column] += center[row] * world.m[row][column];
+				outExtents[column] += extents[row] * fabsf(world.m[row][column]);
+			}
+		}
+		worldBounds = BoundingBox(XMFLOAT3(outCenter[0], outCenter[1], outCenter[2]), XMFLOAT3(outExtents[0], outExtents[1], outExtents[2]));
+	}
+
+	// Marks a share of the items changed and runs the constant update over them, both ways. With
+	// interleave, unrelated allocations sit between the pointer items, as they do after a while.
+	void Run(uint32_t count, double dirtyShare, bool interleave) {
+		const XMFLOAT4X4 identity(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+		XMFLOAT4X4 moved = identity;
+		moved.m[3][1] = 1.0f;
+
+		std::mt19937 random(7);
+		std::vector<std::unique_ptr<PointerItem>> pointerItems;
+		std::vector<std::unique_ptr<char[]>> clutter;
+		RenderItemStore<DrawItem> store(6, 1);
+		for (uint32_t i = 0; i < count; ++i) {
+			std::unique_ptr<PointerItem> item(new PointerItem());
+			item->World = identity;
+			item->TexTransform = identity;
+			item->ObjCBIndex = i;
+			pointerItems.push_back(std::move(item));
+			if (interleave) {
+				clutter.emplace_back(new char[64 + random() % 512]);
+			}
+
+			store.Create({});
+		}
+		store.UpdateDirty(0, [](uint32_t) {});
+
+		std::vector<uint32_t> dirty;
+		std::uniform_real_distribution<double> share(0.0, 1.0);
+		for (uint32_t i = 0; i < count; ++i) {
+			if (share(random) < dirtyShare)
+				dirty.push_back(i);
+		}
+
+		std::vector<ObjectConstants> constants(count);
+		char name[96];
+
+		snprintf(name, sizeof(name), "pointers, %u items, %d%% dirty%s", count, (int)(dirtyShare * 100.0), interleave ? ", interleaved" : "");
+		double pointerNs = Bench::Report(name, count, [&]() {
+			for (uint32_t index : dirty) {
+				pointerItems[index]->World = moved;
+				pointerItems[index]->NumFramesDirty = 1;
+			}
+			for (const std::unique_ptr<PointerItem>& item : pointerItems) {
+				if (item->NumFramesDirty > 0) {
+					WriteConstants(constants.data(), item->ObjCBIndex, item->World, item->TexTransform, item->Bounds, item->WorldBounds);
+					item->NumFramesDirty--;
+				}
+			}
+			Bench::DoNotOptimize(constants.data());
+		});
+
+		snprintf(name, sizeof(name), "RenderItemStore, %u items, %d%% dirty", count, (int)(dirtyShare * 100.0));
+		double storeNs = Bench::Report(name, count, [&]() {
+			for (uint32_t index : dirty) {
+				store.SetWorld(store.HandleAt(index), moved);
+			}
+			const XMFLOAT4X4* world = store.World();
+			const XMFLOAT4X4* texTransform = store.TexTransform();
+			const BoundingBox* local = store.LocalBounds();
+			BoundingBox* worldBounds = store.WorldBounds();
+			store.UpdateDirty(0, [&](uint32_t index) {
+				WriteConstants(constants.data(), index, world[index], texTransform[index], local[index], worldBounds[index]);
+			});
+			Bench::DoNotOptimize(constants.data());
+		});
+
+		printf("  store is %.2fx the speed of pointers\n", pointerNs / storeNs);
+	}
+}
+
+int main() {
+	const uint32_t counts[] = { 1000, 100000 };
+	const double dirtyShares[] = { 1.0, 0.05 };
+	for (uint32_t count : counts) {
+		for (double dirtyShare : dirtyShares) {
+			Run(count, dirtyShare, false);
+			Run(count, dirtyShare, true);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,219 @@
+#include "Check.h"
+
+#include "RenderItemStore.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+	struct TestItem {
+		int Tag;
+	};
+
+	typedef RenderItemStore<TestItem> Store;
+
+	const uint32_t LayerCount = 3;
+	const uint32_t FrameCount = 3;
+
+	XMFLOAT4X4 Translation(float x) {
+		return XMFLOAT4X4(1.0f, 0.0f, 0.0f, 0.0f,
+						  0.0f, 1.0f, 0.0f, 0.0f,
+						  0.0f, 0.0f, 1.0f, 0.0f,
+						  x, 0.0f, 0.0f, 1.0f);
+	}
+
+	std::vector<uint32_t> Dirty(Store& store, uint32_t frame) {
+		std::vector<uint32_t> dirty;
+		store.UpdateDirty(frame, [&](uint32_t index) { dirty.push_back(index); });
+		return dirty;
+	}
+
+	void CleanAll(Store& store) {
+		for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+			Dirty(store, frame);
+		}
+	}
+
+	std::vector<uint32_t> LayerIndices(const Store& store, uint32_t layer) {
+		std::vector<uint32_t> indices;
+		store.Layer(layer).ForEach([&](uint32_t index) { indices.push_back(index); });
+		return indices;
+	}
+}
+
+TEST_CASE(HandlesAreGenerational) {
+	Store store(LayerCount, FrameCount);
+	CHECK(!store.IsValid(Store::Handle()));
+
+	Store::Handle a = store.Create({ 1 });
+	Store::Handle b = store.Create({ 2 });
+	CHECK(store.IsValid(a) && store.IsValid(b));
+	CHECK(store.Get(a).Tag == 1 && store.Get(b).Tag == 2);
+
+	store.Destroy(a);
+	CHECK(!store.IsValid(a));
+	CHECK(store.IsValid(b));
+
+	// The next item reuses a's slot with a new generation: the old handle stays invalid.
+	Store::Handle c = store.Create({ 3 });
+	CHECK(c.Slot == a.Slot && c.Generation != a.Generation);
+	CHECK(!store.IsValid(a));
+	CHECK(store.IsValid(c) && store.Get(c).Tag == 3);
+
+	store.Destroy(c);
+	Store::Handle d = store.Create({ 4 });
+	CHECK(d.Slot == a.Slot && !store.IsValid(a) && !store.IsValid(c));
+	CHECK(store.Count() == 2);
+}
+
+TEST_CASE(DestroyMovesTheLastItemIntoTheHole) {
+	Store store(LayerCount, FrameCount);
+	std::vector<Store::Handle> handles;
+	for (int i = 0; i < 5; ++i) {
+		handles.push_back(store.Create({ i }));
+		store.SetWorld(handles.back(), Translation((float)i));
+	}
+	store.AddToLayer(handles[1], 1);
+	store.AddToLayer(handles[4], 0);
+	store.AddToLayer(handles[4], 2);
+	CleanAll(store);
+
+	store.Destroy(handles[1]);
+	REQUIRE(store.Count() == 4);
+
+	// The last item (4) now sits at the destroyed one's index, found through its handle.
+	CHECK(store.Index(handles[4]) == 1);
+	CHECK(store.HandleAt(1).Slot == handles[4].Slot && store.HandleAt(1).Generation == handles[4].Generation);
+	CHECK(store.Get(handles[4]).Tag == 4);
+	CHECK(store.Items()[1].Tag == 4);
+	CHECK(store.World()[1].m[3][0] == 4.0f);
+
+	// Its layer bits came along and item 1's went.
+	CHECK((LayerIndices(store, 0) == std::vector<uint32_t>{ 1 }));
+	CHECK(LayerIndices(store, 1).empty());
+	CHECK((LayerIndices(store, 2) == std::vector<uint32_t>{ 1 }));
+	CHECK(store.Layer(0).Size() == 4);
+
+	// Its constants live at its old index, so it is dirty again in every frame resource.
+	for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+		CHECK((Dirty(store, frame) == std::vector<uint32_t>{ 1 }));
+	}
+
+	// Everything else kept its index.
+	CHECK(store.Index(handles[0]) == 0 && store.Index(handles[2]) == 2 && store.Index(handles[3]) == 3);
+}
+
+TEST_CASE(DestroyingTheLastItemMovesNothing) {
+	Store store(LayerCount, FrameCount);
+	Store::Handle a = store.Create({ 0 });
+	Store::Handle b = store.Create({ 1 });
+	store.AddToLayer(b, 0);
+	CleanAll(store);
+
+	store.Destroy(b);
+	CHECK(store.Count() == 1 && store.Index(a) == 0);
+	CHECK(!store.Layer(0).Any());
+	CHECK(Dirty(store, 0).empty());
+}
+
+TEST_CASE(ChangesAreDirtyOncePerFrameResource) {
+	Store store(LayerCount, FrameCount);
+	Store::Handle a = store.Create({ 0 });
+	Store::Handle b = store.Create({ 1 });
+
+	// New items start dirty everywhere.
+	for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+		CHECK((Dirty(store, frame) == std::vector<uint32_t>{ 0, 1 }));
+		CHECK(Dirty(store, frame).empty());
+	}
+
+	store.SetTexTransform(b, Translation(2.0f));
+	store.SetLocalBounds(a, BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+	for (uint32_t frame = 0; frame < FrameCount; ++frame) {
+		CHECK((Dirty(store, frame) == std::vector<uint32_t>{ 0, 1 }));
+	}
+	CHECK(store.TexTransform()[1].m[3][0] == 2.0f);
+	CHECK(store.LocalBounds()[0].Extents.x == 1.0f);
+}
+
+TEST_CASE(CloneCopiesTransformsButNotLayers) {
+	Store store(LayerCount, FrameCount);
+	Store::Handle source = store.Create({ 7 });
+	store.SetWorld(source, Translation(3.0f));
+	store.AddToLayer(source, 2);
+	store.WorldBounds()[store.Index(source)] = BoundingBox(XMFLOAT3(3.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+
+	Store::Handle clone = store.Clone(source);
+	uint32_t index = store.Index(clone);
+	CHECK(store.Get(clone).Tag == 7);
+	CHECK(store.World()[index].m[3][0] == 3.0f);
+	CHECK(store.WorldBounds()[index].Center.x == 3.0f);
+	for (uint32_t layer = 0; layer < LayerCount; ++layer) {
+		CHECK(!store.Layer(layer).Test(index));
+	}
+
+	store.RemoveFromLayer(source, 2);
+	CHECK(!store.Layer(2).Any());
+}
+
+// Random creates, destroys and layer changes against a plain list of live items. After every
+// operation each live handle has to reach its own item, HandleAt() has to invert Index(), and the
+// layer bits have to follow the items around.
+TEST_CASE(RandomOperationsKeepHandlesAndLayersConsistent) {
+	struct Live {
+		Store::Handle Handle;
+		int Tag;
+		bool Layers[LayerCount];
+	};
+
+	for (uint32_t seed = 0; seed < 20; ++seed) {
+		std::mt19937 random(seed);
+		Store store(LayerCount, FrameCount);
+		std::vector<Live> live;
+		std::vector<Store::Handle> dead;
+		int nextTag = 0;
+
+		for (uint32_t operation = 0; operation < 1000; ++operation) {
+			uint32_t kind = random() % 10;
+			if (live.empty() || kind < 4) {
+				Live item = { store.Create({ nextTag }), nextTag, {} };
+				nextTag++;
+				live.push_back(item);
+			} else if (kind < 7) {
+				size_t victim = random() % live.size();
+				store.Destroy(live[victim].Handle);
+				dead.push_back(live[victim].Handle);
+				live.erase(live.begin() + victim);
+			} else {
+				Live& item = live[random() % live.size()];
+				uint32_t layer = random() % LayerCount;
+				item.Layers[layer] = !item.Layers[layer];
+				if (item.Layers[layer]) {
+					store.AddToLayer(item.Handle, layer);
+				} else {
+					store.RemoveFromLayer(item.Handle, layer);
+				}
+			}
+
+			REQUIRE(store.Count() == live.size());
+			for (const Live& item : live) {
+				REQUIRE(store.IsValid(item.Handle));
+				uint32_t index = store.Index(item.Handle);
+				REQUIRE(index < store.Count());
+				REQUIRE(store.Get(item.Handle).Tag == item.Tag);
+
+				Store::Handle back = store.HandleAt(index);
+				REQUIRE(back.Slot == item.Handle.Slot && back.Generation == item.Handle.Generation);
+				for (uint32_t layer = 0; layer < LayerCount; ++layer) {
+					REQUIRE(store.Layer(layer).Test(index) == item.Layers[layer]);
+				}
+			}
+			for (const Store::Handle& handle : dead) {
+				REQUIRE(!store.IsValid(handle));
+			}
+		}
+	}
+}
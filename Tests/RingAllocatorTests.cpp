@@ -0,0 +1,189 @@
+#include "Check.h"
+
+#include "RingAllocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+// The CPU-memory backend: the ring hands out offsets into a plain byte array, as UploadRing does
+// into its mapped upload heap.
+struct CpuRing {
+	explicit CpuRing(uint64_t capacity) : Allocator(capacity), Memory(capacity) {}
+
+	uint8_t* Allocate(uint64_t size, uint64_t alignment) {
+		uint64_t offset;
+		if (!Allocator.Allocate(size, alignment, offset))
+			return nullptr;
+		return Memory.data() + offset;
+	}
+
+	RingAllocator Allocator;
+	std::vector<uint8_t> Memory;
+};
+}
+
+TEST_CASE(AllocatesBackToBack) {
+	RingAllocator ring(256);
+	uint64_t a, b;
+	REQUIRE(ring.Allocate(100, 1, a));
+	REQUIRE(ring.Allocate(100, 1, b));
+	CHECK(a == 0);
+	CHECK(b == 100);
+	CHECK(ring.Used() == 200);
+	CHECK(ring.Capacity() == 256);
+}
+
+TEST_CASE(AlignsOffsetsAndCountsPadding) {
+	RingAllocator ring(1024);
+	uint64_t a, b, c;
+	REQUIRE(ring.Allocate(10, 1, a));
+	REQUIRE(ring.Allocate(16, 256, b));
+	REQUIRE(ring.Allocate(1, 16, c));
+	CHECK(a == 0);
+	CHECK(b == 256);
+	CHECK(c == 272);
+
+	// The 246 bytes skipped to align b stay used until the frame retires.
+	CHECK(ring.Used() == 273);
+}
+
+TEST_CASE(FailsWhenFullUntilAFrameRetires) {
+	RingAllocator ring(256);
+	uint64_t offset;
+	REQUIRE(ring.Allocate(200, 1, offset));
+	ring.EndFrame(1);
+	CHECK(!ring.Allocate(100, 1, offset));
+
+	// Retiring at an older fence frees nothing.
+	ring.Retire(0);
+	CHECK(!ring.Allocate(100, 1, offset));
+	CHECK(ring.Used() == 200);
+
+	ring.Retire(1);
+	CHECK(ring.Used() == 0);
+	REQUIRE(ring.Allocate(100, 1, offset));
+	CHECK(offset == 0);
+}
+
+TEST_CASE(WrapsAroundPastTheEnd) {
+	RingAllocator ring(256);
+	uint64_t a, b, c, d;
+	REQUIRE(ring.Allocate(100, 1, a));
+	ring.EndFrame(1);
+	REQUIRE(ring.Allocate(100, 1, b));
+	ring.EndFrame(2);
+	ring.Retire(1);
+
+	// [200, 256) is too small, so the allocation goes to the start and the end is skipped.
+	REQUIRE(ring.Allocate(100, 1, c));
+	CHECK(c == 0);
+	CHECK(ring.Used() == 256);
+	CHECK(!ring.Allocate(1, 1, d));
+	ring.EndFrame(3);
+
+	// Frame 2 frees [100, 200); the skipped end comes back with frame 3.
+	ring.Retire(2);
+	CHECK(ring.Used() == 156);
+	REQUIRE(ring.Allocate(100, 1, d));
+	CHECK(d == 100);
+	CHECK(!ring.Allocate(1, 1, d));
+	ring.EndFrame(4);
+
+	ring.Retire(4);
+	CHECK(ring.Used() == 0);
+}
+
+TEST_CASE(WrappedAllocationRespectsTheTail) {
+	RingAllocator ring(256);
+	uint64_t offset;
+	REQUIRE(ring.Allocate(64, 1, offset));
+	ring.EndFrame(1);
+	REQUIRE(ring.Allocate(128, 1, offset));
+	ring.EndFrame(2);
+	ring.Retire(1);
+
+	// Only [192, 256) and [0, 64) are free: 65 bytes fit in neither.
+	CHECK(!ring.Allocate(65, 1, offset));
+	REQUIRE(ring.Allocate(64, 1, offset));
+	CHECK(offset == 192);
+	REQUIRE(ring.Allocate(64, 1, offset));
+	CHECK(offset == 0);
+	CHECK(!ring.Allocate(1, 1, offset));
+}
+
+TEST_CASE(FramesRetireInFenceOrder) {
+	RingAllocator ring(1024);
+	uint64_t offset;
+	for (uint64_t fence = 1; fence <= 4; ++fence) {
+		REQUIRE(ring.Allocate(100, 1, offset));
+		ring.EndFrame(fence);
+	}
+	CHECK(ring.Used() == 400);
+
+	ring.Retire(2);
+	CHECK(ring.Used() == 200);
+	ring.Retire(3);
+	CHECK(ring.Used() == 100);
+	ring.Retire(10);
+	CHECK(ring.Used() == 0);
+}
+
+// Frames of random allocations stamped with their frame number in CPU memory, with a few frames in
+// flight. Any overlap between live allocations shows up as a stamp overwritten before it retires.
+TEST_CASE(RandomFramesNeverOverlapInCpuMemory) {
+	struct Live {
+		uint8_t* Data;
+		uint64_t Size;
+		uint8_t Stamp;
+	};
+
+	const uint64_t capacity = 4096;
+	const uint32_t framesInFlight = 3;
+
+	for (uint32_t seed = 0; seed < 20; ++seed) {
+		std::mt19937 random(seed);
+		CpuRing ring(capacity);
+		std::deque<std::vector<Live>> frames;
+
+		for (uint64_t fence = 1; fence <= 500; ++fence) {
+			// The "GPU" finishes the oldest frame once too many are queued.
+			if (frames.size() == framesInFlight) {
+				for (const Live& live : frames.front()) {
+					for (uint64_t i = 0; i < live.Size; ++i) {
+						REQUIRE(live.Data[i] == live.Stamp);
+					}
+				}
+				frames.pop_front();
+				ring.Allocator.Retire(fence - framesInFlight);
+			}
+
+			std::vector<Live> frame;
+			uint32_t count = random() % 8;
+			for (uint32_t i = 0; i < count; ++i) {
+				uint64_t size = 1 + random() % 400;
+				uint64_t alignment = 1ull << (random() % 9);
+				uint8_t* data = ring.Allocate(size, alignment);
+				if (data == nullptr)
+					continue;
+
+				REQUIRE((uint64_t)(data - ring.Memory.data()) % alignment == 0);
+				REQUIRE(data + size <= ring.Memory.data() + capacity);
+
+				uint8_t stamp = (uint8_t)fence;
+				memset(data, stamp, size);
+				frame.push_back({ data, size, stamp });
+			}
+
+			CHECK(ring.Allocator.Used() <= capacity);
+			ring.Allocator.EndFrame(fence);
+			frames.push_back(frame);
+		}
+
+		ring.Allocator.Retire(UINT64_MAX);
+		CHECK(ring.Allocator.Used() == 0);
+	}
+}
@@ -0,0 +1,333 @@
+#include "Check.h"
+
+#include "RecordingCommandList.h"
+#include "StateFilter.h"
+
+#include <random>
+
+namespace {
+typedef StateFilter<RecordingCommandList> Filter;
+
+// Distinct non-null pointers; the filter and the fake list only compare them.
+template<typename T>
+T* Fake(uintptr_t id) {
+	return reinterpret_cast<T*>(id * 0x100);
+}
+
+D3D12_VERTEX_BUFFER_VIEW VertexBuffer(D3D12_GPU_VIRTUAL_ADDRESS address, UINT stride = 32) {
+	return { address, 0x10000, stride };
+}
+
+D3D12_INDEX_BUFFER_VIEW IndexBuffer(D3D12_GPU_VIRTUAL_ADDRESS address) {
+	return { address, 0x1000, DXGI_FORMAT_UNKNOWN };
+}
+}
+
+TEST_CASE(RepeatedStateIsFiltered) {
+	RecordingCommandList list;
+	Filter filter;
+	filter.Reset(&list);
+
+	ID3D12DescriptorHeap* heaps[] = { Fake<ID3D12DescriptorHeap>(1) };
+	D3D12_VERTEX_BUFFER_VIEW vb = VertexBuffer(0x1000);
+	D3D12_INDEX_BUFFER_VIEW ib = IndexBuffer(0x2000);
+	for (int i = 0; i < 3; ++i) {
+		filter.SetDescriptorHeaps(1, heaps);
+		filter.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(1));
+		filter.SetPipelineState(Fake<ID3D12PipelineState>(1));
+		filter.SetGraphicsRootDescriptorTable(0, { 0x40 });
+		filter.SetGraphicsRootConstantBufferView(1, 0x3000);
+		filter.IASetVertexBuffers(0, 1, &vb);
+		filter.IASetIndexBuffer(&ib);
+		filter.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		filter.OMSetStencilRef(1);
+	}
+
+	CHECK(list.Calls("SetDescriptorHeaps") == 1);
+	CHECK(list.Calls("SetGraphicsRootSignature") == 1);
+	CHECK(list.Calls("SetPipelineState") == 1);
+	CHECK(list.Calls("SetGraphicsRootDescriptorTable") == 1);
+	CHECK(list.Calls("SetGraphicsRootConstantBufferView") == 1);
+	CHECK(list.Calls("IASetVertexBuffers") == 1);
+	CHECK(list.Calls("IASetIndexBuffer") == 1);
+	CHECK(list.Calls("IASetPrimitiveTopology") == 1);
+	CHECK(list.Calls("OMSetStencilRef") == 1);
+	CHECK(filter.GetStats().Issued == 9);
+	CHECK(filter.GetStats().Filtered == 18);
+}
+
+TEST_CASE(ChangedStateIsIssued) {
+	RecordingCommandList list;
+	Filter filter;
+	filter.Reset(&list);
+
+	D3D12_VERTEX_BUFFER_VIEW vb = VertexBuffer(0x1000);
+	D3D12_VERTEX_BUFFER_VIEW otherStride = VertexBuffer(0x1000, 16);
+	filter.IASetVertexBuffers(0, 1, &vb);
+	filter.IASetVertexBuffers(0, 1, &otherStride);
+	filter.IASetVertexBuffers(1, 1, &otherStride);
+	CHECK(list.Calls("IASetVertexBuffers") == 3);
+
+	filter.SetPipelineState(Fake<ID3D12PipelineState>(1));
+	filter.SetPipelineState(Fake<ID3D12PipelineState>(2));
+	filter.SetPipelineState(Fake<ID3D12PipelineState>(1));
+	CHECK(list.Calls("SetPipelineState") == 3);
+
+	// The same address as a CBV and as a table, or in another parameter, is still a change.
+	filter.SetGraphicsRootConstantBufferView(1, 0x3000);
+	filter.SetGraphicsRootDescriptorTable(1, { 0x3000 });
+	filter.SetGraphicsRootDescriptorTable(2, { 0x3000 });
+	CHECK(list.Calls("SetGraphicsRootConstantBufferView") == 1);
+	CHECK(list.Calls("SetGraphicsRootDescriptorTable") == 2);
+
+	filter.OMSetStencilRef(0);
+	filter.OMSetStencilRef(1);
+	CHECK(list.Calls("OMSetStencilRef") == 2);
+	CHECK(filter.GetStats().Filtered == 0);
+}
+
+TEST_CASE(NewRootSignatureResetsRootArguments) {
+	RecordingCommandList list;
+	Filter filter;
+	filter.Reset(&list);
+
+	filter.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(1));
+	filter.SetGraphicsRootConstantBufferView(1, 0x3000);
+
+	// Setting the same signature again is filtered and keeps the arguments.
+	filter.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(1));
+	filter.SetGraphicsRootConstantBufferView(1, 0x3000);
+	CHECK(list.Calls("SetGraphicsRootConstantBufferView") == 1);
+
+	filter.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(2));
+	filter.SetGraphicsRootConstantBufferView(1, 0x3000);
+	CHECK(list.Calls("SetGraphicsRootSignature") == 2);
+	CHECK(list.Calls("SetGraphicsRootConstantBufferView") == 2);
+}
+
+TEST_CASE(NewHeapsInvalidateTablesOnly) {
+	RecordingCommandList list;
+	Filter filter;
+	filter.Reset(&list);
+
+	ID3D12DescriptorHeap* first[] = { Fake<ID3D12DescriptorHeap>(1) };
+	ID3D12DescriptorHeap* second[] = { Fake<ID3D12DescriptorHeap>(2) };
+	filter.SetDescriptorHeaps(1, first);
+	filter.SetGraphicsRootDescriptorTable(0, { 0x40 });
+	filter.SetGraphicsRootConstantBufferView(1, 0x3000);
+
+	filter.SetDescriptorHeaps(1, first);
+	filter.SetGraphicsRootDescriptorTable(0, { 0x40 });
+	CHECK(list.Calls("SetGraphicsRootDescriptorTable") == 1);
+
+	filter.SetDescriptorHeaps(1, second);
+	filter.SetGraphicsRootDescriptorTable(0, { 0x40 });
+	filter.SetGraphicsRootConstantBufferView(1, 0x3000);
+	CHECK(list.Calls("SetDescriptorHeaps") == 2);
+	CHECK(list.Calls("SetGraphicsRootDescriptorTable") == 2);
+	CHECK(list.Calls("SetGraphicsRootConstantBufferView") == 1);
+}
+
+TEST_CASE(ResetKnowsOnlyTheInitialState) {
+	RecordingCommandList list;
+	Filter filter;
+	filter.Reset(&list);
+	filter.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(1));
+	filter.OMSetStencilRef(1);
+
+	RecordingCommandList next;
+	filter.Reset(&next, Fake<ID3D12PipelineState>(1));
+	CHECK(filter.Get() == &next);
+
+	filter.SetPipelineState(Fake<ID3D12PipelineState>(1));
+	filter.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(1));
+	filter.OMSetStencilRef(1);
+	CHECK(next.Calls("SetPipelineState") == 0);
+	CHECK(next.Calls("SetGraphicsRootSignature") == 1);
+	CHECK(next.Calls("OMSetStencilRef") == 1);
+}
+
+TEST_CASE(InvalidateForgetsEverything) {
+	RecordingCommandList list;
+	Filter filter;
+	filter.Reset(&list, Fake<ID3D12PipelineState>(1));
+
+	ID3D12DescriptorHeap* heaps[] = { Fake<ID3D12DescriptorHeap>(1) };
+	D3D12_VERTEX_BUFFER_VIEW vb = VertexBuffer(0x1000);
+	D3D12_INDEX_BUFFER_VIEW ib = IndexBuffer(0x2000);
+	auto record = [&]() {
+		filter.SetDescriptorHeaps(1, heaps);
+		filter.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(1));
+		filter.SetPipelineState(Fake<ID3D12PipelineState>(1));
+		filter.SetGraphicsRootConstantBufferView(1, 0x3000);
+		filter.IASetVertexBuffers(0, 1, &vb);
+		filter.IASetIndexBuffer(&ib);
+		filter.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		filter.OMSetStencilRef(1);
+	};
+
+	record();
+	CHECK(list.StateCalls() == 7);
+
+	filter.Invalidate();
+	record();
+	CHECK(list.StateCalls() == 15);
+}
+
+TEST_CASE(NullBuffersAreAlwaysIssued) {
+	RecordingCommandList list;
+	Filter filter;
+	filter.Reset(&list);
+
+	filter.IASetIndexBuffer(nullptr);
+	filter.IASetIndexBuffer(nullptr);
+	filter.IASetVertexBuffers(0, 1, nullptr);
+	filter.IASetVertexBuffers(0, 1, nullptr);
+	CHECK(list.Calls("IASetIndexBuffer") == 2);
+	CHECK(list.Calls("IASetVertexBuffers") == 2);
+
+	// Unbinding forgets the buffer that was there.
+	D3D12_INDEX_BUFFER_VIEW ib = IndexBuffer(0x2000);
+	filter.IASetIndexBuffer(&ib);
+	filter.IASetIndexBuffer(nullptr);
+	filter.IASetIndexBuffer(&ib);
+	CHECK(list.Calls("IASetIndexBuffer") == 5);
+}
+
+TEST_CASE(FilteredRecordingDrawsWithTheSameState) {
+	// Random draws over small pools of state, with heap and root signature switches and the odd
+	// Invalidate() mixed in, recorded once through the filter and once straight to a list.
+	for (uint32_t seed = 0; seed < 20; ++seed) {
+		std::mt19937 random(seed);
+		auto pick = [&](uint32_t count) {
+			return (uint32_t)(random() % count);
+		};
+
+		RecordingCommandList filtered, direct;
+		Filter filter;
+		filter.Reset(&filtered);
+
+		for (uint32_t draw = 0; draw < 1000; ++draw) {
+			ID3D12DescriptorHeap* heaps[] = { Fake<ID3D12DescriptorHeap>(1 + pick(2)) };
+			ID3D12RootSignature* rootSignature = Fake<ID3D12RootSignature>(1 + (pick(50) == 0));
+			ID3D12PipelineState* pso = Fake<ID3D12PipelineState>(1 + pick(3));
+			D3D12_GPU_DESCRIPTOR_HANDLE table = { 0x40 * (1 + pick(4)) };
+			D3D12_GPU_VIRTUAL_ADDRESS passCB = 0x10000 + 0x100 * pick(2);
+			D3D12_GPU_VIRTUAL_ADDRESS objectCB = 0x20000 + 0x100 * pick(8);
+			D3D12_VERTEX_BUFFER_VIEW vb = VertexBuffer(0x1000 * (1 + pick(3)));
+			D3D12_INDEX_BUFFER_VIEW ib = IndexBuffer(0x1000 * (1 + pick(3)));
+			D3D12_PRIMITIVE_TOPOLOGY topology = pick(10) == 0 ? D3D_PRIMITIVE_TOPOLOGY_LINELIST : D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			UINT stencilRef = pick(2);
+
+			if (pick(100) == 0) {
+				filter.Invalidate();
+			}
+
+			if (pick(20) == 0) {
+				filter.SetDescriptorHeaps(1, heaps);
+				direct.SetDescriptorHeaps(1, heaps);
+			}
+			filter.SetGraphicsRootSignature(rootSignature);
+			filter.SetPipelineState(pso);
+			filter.SetGraphicsRootDescriptorTable(0, table);
+			filter.SetGraphicsRootConstantBufferView(1, objectCB);
+			filter.SetGraphicsRootConstantBufferView(2, passCB);
+			filter.IASetVertexBuffers(0, 1, &vb);
+			filter.IASetIndexBuffer(&ib);
+			filter.IASetPrimitiveTopology(topology);
+			filter.OMSetStencilRef(stencilRef);
+			filter.DrawIndexedInstanced(3 * (draw + 1), 1, 0, 0, 0);
+
+			direct.SetGraphicsRootSignature(rootSignature);
+			direct.SetPipelineState(pso);
+			direct.SetGraphicsRootDescriptorTable(0, table);
+			direct.SetGraphicsRootConstantBufferView(1, objectCB);
+			direct.SetGraphicsRootConstantBufferView(2, passCB);
+			direct.IASetVertexBuffers(0, 1, &vb);
+			direct.IASetIndexBuffer(&ib);
+			direct.IASetPrimitiveTopology(topology);
+			direct.OMSetStencilRef(stencilRef);
+			direct.DrawIndexedInstanced(3 * (draw + 1), 1, 0, 0, 0);
+		}
+
+		REQUIRE(filtered.Draws.size() == direct.Draws.size());
+		for (size_t i = 0; i < direct.Draws.size(); ++i) {
+			CHECK(filtered.Draws[i] == direct.Draws[i]);
+		}
+
+		CHECK(filter.GetStats().Issued == filtered.StateCalls());
+		CHECK(filter.GetStats().Issued + filter.GetStats().Filtered == direct.StateCalls());
+		CHECK(filtered.StateCalls() < direct.StateCalls());
+	}
+}
+
+TEST_CASE(ExecuteIndirectForgetsRootArguments) {
+	// The command signature writes the object and material CBVs (1 and 3), so a draw recorded after
+	// ExecuteIndirect has to set them again even when they hold the same addresses as before.
+	RecordingCommandList list;
+	Filter filter;
+	filter.Reset(&list);
+
+	filter.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(1));
+	filter.SetGraphicsRootDescriptorTable(0, { 0x40 });
+	filter.SetGraphicsRootConstantBufferView(1, 0x10000);
+	filter.SetGraphicsRootConstantBufferView(2, 0x30000);
+	filter.SetGraphicsRootConstantBufferView(3, 0x20000);
+	filter.ExecuteIndirect(Fake<ID3D12CommandSignature>(1), 4, Fake<ID3D12Resource>(1), 0, nullptr, 0);
+
+	filter.SetGraphicsRootDescriptorTable(0, { 0x40 });
+	filter.SetGraphicsRootConstantBufferView(1, 0x10000);
+	filter.SetGraphicsRootConstantBufferView(2, 0x30000);
+	filter.SetGraphicsRootConstantBufferView(3, 0x20000);
+	filter.DrawIndexedInstanced(3, 1, 0, 0, 0);
+
+	CHECK(list.Calls("ExecuteIndirect") == 1);
+	CHECK(list.Calls("SetGraphicsRootConstantBufferView") == 6);
+	CHECK(list.Calls("SetGraphicsRootDescriptorTable") == 2);
+
+	REQUIRE(list.Draws.size() == 2);
+	const RecordingCommandList::Snapshot& draw = list.Draws[1];
+	CHECK(draw.RootArguments[0].Set && draw.RootArguments[0].Value == 0x40);
+	CHECK(draw.RootArguments[1].Set && draw.RootArguments[1].Value == 0x10000);
+	CHECK(draw.RootArguments[2].Set && draw.RootArguments[2].Value == 0x30000);
+	CHECK(draw.RootArguments[3].Set && draw.RootArguments[3].Value == 0x20000);
+}
+
+TEST_CASE(IndirectRunsThenDirectDrawsKeepTheirState) {
+	// Runs of ExecuteIndirect mixed with direct draws, as happens when the 'X' toggle flips
+	// between chunks, recorded with and without the filter.
+	for (uint32_t seed = 0; seed < 20; ++seed) {
+		std::mt19937 random(seed);
+		RecordingCommandList filtered, direct;
+		Filter filter;
+		filter.Reset(&filtered);
+
+		for (uint32_t step = 0; step < 500; ++step) {
+			D3D12_GPU_DESCRIPTOR_HANDLE table = { 0x40 * (1 + random() % 2) };
+			D3D12_GPU_VIRTUAL_ADDRESS objectCB = 0x10000 + 0x100 * (random() % 3);
+			D3D12_GPU_VIRTUAL_ADDRESS materialCB = 0x20000 + 0x100 * (random() % 2);
+
+			filter.SetGraphicsRootDescriptorTable(0, table);
+			direct.SetGraphicsRootDescriptorTable(0, table);
+			filter.SetGraphicsRootConstantBufferView(2, 0x30000);
+			direct.SetGraphicsRootConstantBufferView(2, 0x30000);
+
+			if (random() % 2 == 0) {
+				filter.ExecuteIndirect(Fake<ID3D12CommandSignature>(1), 1 + step, Fake<ID3D12Resource>(1), 0, nullptr, 0);
+				direct.ExecuteIndirect(Fake<ID3D12CommandSignature>(1), 1 + step, Fake<ID3D12Resource>(1), 0, nullptr, 0);
+			} else {
+				filter.SetGraphicsRootConstantBufferView(1, objectCB);
+				filter.SetGraphicsRootConstantBufferView(3, materialCB);
+				filter.DrawIndexedInstanced(1 + step, 1, 0, 0, 0);
+				direct.SetGraphicsRootConstantBufferView(1, objectCB);
+				direct.SetGraphicsRootConstantBufferView(3, materialCB);
+				direct.DrawIndexedInstanced(1 + step, 1, 0, 0, 0);
+			}
+		}
+
+		REQUIRE(filtered.Draws.size() == direct.Draws.size());
+		for (size_t i = 0; i < direct.Draws.size(); ++i) {
+			CHECK(filtered.Draws[i] == direct.Draws[i]);
+		}
+	}
+}
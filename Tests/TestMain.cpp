@@ -0,0 +1,20 @@
+#include "Check.h"
+
+#include <cstdio>
+
+int main() {
+	int failedCases = 0;
+	for (const Check::TestCase& testCase : Check::TestCases()) {
+		int failuresBefore = Check::FailureCount();
+		testCase.Fn();
+
+		bool passed = Check::FailureCount() == failuresBefore;
+		printf("%-48s %s\n", testCase.Name, passed ? "ok" : "FAILED");
+		if (!passed) {
+			failedCases++;
+		}
+	}
+
+	printf("%d of %d test cases failed\n", failedCases, (int)Check::TestCases().size());
+	return failedCases == 0 ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+#include "Check.h"
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+namespace {
+// Mip sizes of a square RGBA8 texture.
+std::vector<uint64_t> MipBytes(uint32_t width) {
+	std::vector<uint64_t> bytes;
+	for (; width > 0; width /= 2) {
+		bytes.push_back((uint64_t)width * width * 4);
+	}
+	return bytes;
+}
+
+// Runs the streamer's commands with a fixed latency in frames, as the app does once the copy and
+// the frame that last used the old mips are done.
+struct FakeGpu {
+	void Submit(const std::vector<TextureStreamer::Command>& commands, uint64_t frame) {
+		for (const TextureStreamer::Command& command : commands) {
+			_inFlight.push_back({ command.Texture, frame + Latency });
+		}
+	}
+
+	void Finish(TextureStreamer& streamer, uint64_t frame) {
+		while (!_inFlight.empty() && _inFlight.front().Done <= frame) {
+			streamer.Complete(_inFlight.front().Texture);
+			_inFlight.pop_front();
+		}
+	}
+
+	void FinishAll(TextureStreamer& streamer) {
+		Finish(streamer, UINT64_MAX);
+	}
+
+	static const uint64_t Latency = 2;
+
+private:
+	struct InFlight {
+		uint32_t Texture;
+		uint64_t Done;
+	};
+
+	std::deque<InFlight> _inFlight;
+};
+
+// Loads every texture in streamer to mip 0, budget permitting.
+void LoadAll(TextureStreamer& streamer, uint64_t& frame) {
+	for (int i = 0; i < 20; ++i) {
+		streamer.BeginFrame(++frame);
+		for (uint32_t t = 0; t < streamer.TextureCount(); ++t) {
+			streamer.RequestMip(t, 0);
+		}
+		streamer.Update(UINT32_MAX);
+		for (uint32_t t = 0; t < streamer.TextureCount(); ++t) {
+			streamer.Complete(t);
+		}
+	}
+}
+}
+
+TEST_CASE(LoadsUpToTheBudget) {
+	TextureStreamer streamer(1 << 20);
+	uint32_t texture = streamer.Register("a", MipBytes(256), 4);
+	CHECK(streamer.ResidentMip(texture) == 4);
+
+	uint64_t frame = 0;
+	LoadAll(streamer, frame);
+	CHECK(streamer.ResidentMip(texture) == 0);
+	CHECK(streamer.GetStats().Committed <= streamer.Budget());
+}
+
+TEST_CASE(LoweringTheBudgetEvictsUnrequestedTextures) {
+	TextureStreamer streamer(8 << 20);
+	uint32_t a = streamer.Register("a", MipBytes(512), 4);
+	uint32_t b = streamer.Register("b", MipBytes(512), 4);
+
+	uint64_t frame = 0;
+	LoadAll(streamer, frame);
+	REQUIRE(streamer.ResidentMip(a) == 0);
+	REQUIRE(streamer.ResidentMip(b) == 0);
+
+	// Nothing is in view and nothing needs loading; the lower budget alone has to trigger evictions.
+	streamer.SetBudget(1 << 20);
+	streamer.BeginFrame(++frame);
+	std::vector<TextureStreamer::Command> commands = streamer.Update(0);
+	CHECK(!commands.empty());
+	for (const TextureStreamer::Command& command : commands) {
+		CHECK(command.Type == TextureStreamer::CommandType::Evict);
+		streamer.Complete(command.Texture);
+	}
+	CHECK(streamer.GetStats().Committed <= streamer.Budget());
+}
+
+TEST_CASE(LoweringTheBudgetTrimsTexturesInView) {
+	TextureStreamer streamer(8 << 20);
+	uint32_t a = streamer.Register("a", MipBytes(512), 4);
+	uint32_t b = streamer.Register("b", MipBytes(512), 4);
+
+	uint64_t frame = 0;
+	LoadAll(streamer, frame);
+
+	// Both stay in view wanting mip 0, but only about one mip 1 fits now.
+	streamer.SetBudget(400 << 10);
+	for (int i = 0; i < 10; ++i) {
+		streamer.BeginFrame(++frame);
+		streamer.RequestMip(a, 0);
+		streamer.RequestMip(b, 0);
+		for (const TextureStreamer::Command& command : streamer.Update(UINT32_MAX)) {
+			streamer.Complete(command.Texture);
+		}
+	}
+
+	CHECK(streamer.GetStats().Committed <= streamer.Budget());
+	CHECK(streamer.ResidentMip(a) > 0);
+	CHECK(streamer.ResidentMip(b) > 0);
+}
+
+TEST_CASE(BaseMipsAreNeverEvicted) {
+	TextureStreamer streamer(1 << 20);
+	uint32_t a = streamer.Register("a", MipBytes(256), 2);
+
+	uint64_t frame = 0;
+	LoadAll(streamer, frame);
+
+	// Below what the base mips need: everything above them goes, they stay.
+	streamer.SetBudget(1);
+	streamer.BeginFrame(++frame);
+	for (const TextureStreamer::Command& command : streamer.Update(UINT32_MAX)) {
+		streamer.Complete(command.Texture);
+	}
+	CHECK(streamer.ResidentMip(a) == 2);
+}
+
+// A camera flies along a row of textures and back while the budget is lowered and raised again.
+// Textures in view ask for the mip that matches their distance. The streamer has to stay within
+// the budget except while evictions it issued are still in flight, and with a roomy budget the
+// textures in view have to reach the detail they ask for.
+TEST_CASE(SimulatedCameraPathStaysWithinBudget) {
+	const uint32_t textureCount = 16;
+	const float spacing = 10.0f;
+	const float viewDistance = 30.0f;
+	const uint32_t maxLoadsPerFrame = 2;
+	const uint64_t settleFrames = 16;
+
+	TextureStreamer streamer(16 << 20);
+	for (uint32_t i = 0; i < textureCount; ++i) {
+		char name[16];
+		snprintf(name, sizeof(name), "tex%u", i);
+		streamer.Register(name, MipBytes(1024), 4);
+	}
+
+	FakeGpu gpu;
+	uint64_t lastBudgetChange = 0;
+	uint64_t overBudgetFrames = 0;
+	uint64_t maxCommitted = 0;
+
+	const uint64_t frameCount = 1200;
+	for (uint64_t frame = 1; frame <= frameCount; ++frame) {
+		if (frame == 400) {
+			streamer.SetBudget(4 << 20);
+			lastBudgetChange = frame;
+		} else if (frame == 800) {
+			streamer.SetBudget(64 << 20);
+			lastBudgetChange = frame;
+		}
+
+		// Out along the row for 300 frames, back for 300, repeat.
+		float t = (float)(frame % 600) / 300.0f;
+		float along = t < 1.0f ? t : 2.0f - t;
+		float cameraX = -20.0f + along * (textureCount * spacing + 20.0f);
+
+		gpu.Finish(streamer, frame);
+		streamer.BeginFrame(frame);
+
+		std::vector<uint32_t> wanted(textureCount, UINT32_MAX);
+		for (uint32_t i = 0; i < textureCount; ++i) {
+			float distance = std::fabs(i * spacing - cameraX);
+			if (distance > viewDistance)
+				continue;
+
+			float pixels = 2048.0f / std::max(distance, 1.0f);
+			wanted[i] = TextureStreamer::MipForScreenSize(1024.0f, pixels);
+			streamer.RequestMip(i, wanted[i]);
+		}
+
+		gpu.Submit(streamer.Update(maxLoadsPerFrame), frame);
+
+		TextureStreamer::Stats stats = streamer.GetStats();
+		maxCommitted = std::max(maxCommitted, stats.Committed);
+		if (stats.Committed > stats.Budget) {
+			overBudgetFrames++;
+			CHECK(frame < lastBudgetChange + settleFrames);
+		}
+	}
+
+	// The camera stops in the middle of the row; with the budget this roomy everything in view
+	// reaches at least the detail it asks for (finer mips from earlier passes may stay cached).
+	std::vector<uint32_t> wanted(textureCount, UINT32_MAX);
+	for (uint64_t frame = frameCount + 1; frame <= frameCount + 60; ++frame) {
+		gpu.Finish(streamer, frame);
+		streamer.BeginFrame(frame);
+		for (uint32_t i = 0; i < textureCount; ++i) {
+			float distance = std::fabs(i * spacing - 75.0f);
+			if (distance > viewDistance)
+				continue;
+
+			wanted[i] = TextureStreamer::MipForScreenSize(1024.0f, 2048.0f / std::max(distance, 1.0f));
+			streamer.RequestMip(i, wanted[i]);
+		}
+		gpu.Submit(streamer.Update(maxLoadsPerFrame), frame);
+	}
+
+	for (uint32_t i = 0; i < textureCount; ++i) {
+		if (wanted[i] != UINT32_MAX) {
+			CHECK(streamer.ResidentMip(i) <= std::min(wanted[i], 4u));
+		}
+	}
+
+	gpu.FinishAll(streamer);
+	TextureStreamer::Stats stats = streamer.GetStats();
+	CHECK(stats.Committed <= stats.Budget);
+	CHECK(stats.TotalLoads > 0);
+	CHECK(stats.TotalEvictions > 0);
+
+	printf("  %llu frames, %llu loads, %llu evictions, %llu frames over budget after a change, peak %.1f MiB\n",
+		   (unsigned long long)frameCount, (unsigned long long)stats.TotalLoads,
+		   (unsigned long long)stats.TotalEvictions, (unsigned long long)overBudgetFrames,
+		   maxCommitted / 1048576.0);
+}
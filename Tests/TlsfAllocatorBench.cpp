@@ -0,0 +1,53 @@
+#include "Bench.h"
+
+#include "TlsfAllocator.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Alloc/free cost of TlsfAllocator on the block sizes StencilDemo places in its heaps: multiples
+// of 64 KiB with 64 KiB alignment, in a heap kept about a third full so the bins stay mixed but nothing fails to fit.
+int main() {
+	const uint64_t capacity = 512ull << 20;
+	const uint64_t granularity = 64 * 1024;
+	const uint32_t liveCount = 1000;
+	const uint32_t sizeCount = 4096;
+
+	std::mt19937 random(1);
+	std::vector<uint64_t> sizes(sizeCount);
+	for (uint64_t& size : sizes) {
+		size = granularity * (1 + random() % 4);
+	}
+
+	TlsfAllocator allocator(capacity);
+	std::vector<TlsfAllocator::Allocation> live(liveCount);
+	for (uint32_t i = 0; i < liveCount; ++i) {
+		allocator.Allocate(sizes[i], granularity, live[i]);
+	}
+
+	// Steady state: free a pseudo-random live block and allocate a new one in its place.
+	uint32_t next = 0;
+	double nsPerOp = Bench::Report("TlsfAllocator free + allocate, 64 KiB blocks", 2, [&]() {
+		uint32_t slot = (next * 2654435761u) % liveCount;
+		allocator.Free(live[slot]);
+		allocator.Allocate(sizes[next % sizeCount], granularity, live[slot]);
+		Bench::DoNotOptimize(live[slot].Offset);
+		next++;
+	});
+
+	// Fill and drain: every allocation splits and every free merges.
+	for (const TlsfAllocator::Allocation& allocation : live) {
+		allocator.Free(allocation);
+	}
+	Bench::Report("TlsfAllocator allocate all, then free all", 2 * liveCount, [&]() {
+		for (uint32_t i = 0; i < liveCount; ++i) {
+			allocator.Allocate(sizes[i], granularity, live[i]);
+		}
+		for (uint32_t i = 0; i < liveCount; ++i) {
+			allocator.Free(live[liveCount - 1 - i]);
+		}
+	});
+
+	return allocator.Empty() && nsPerOp > 0.0 ? 0 : 1;
+}
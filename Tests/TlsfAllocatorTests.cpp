@@ -0,0 +1,121 @@
+#include "Check.h"
+
+#include "TlsfAllocator.h"
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+TEST_CASE(AllocatesAlignedBlocks) {
+	TlsfAllocator allocator(1 << 20);
+	TlsfAllocator::Allocation a, b;
+	REQUIRE(allocator.Allocate(100, 1, a));
+	REQUIRE(allocator.Allocate(4096, 65536, b));
+	CHECK(a.Size >= 100);
+	CHECK(b.Size >= 4096);
+	CHECK(b.Offset % 65536 == 0);
+	CHECK(a.Offset + a.Size <= b.Offset || b.Offset + b.Size <= a.Offset);
+	CHECK(allocator.Validate());
+}
+
+TEST_CASE(FailsWhenNothingFits) {
+	TlsfAllocator allocator(4096);
+	TlsfAllocator::Allocation a, b;
+	REQUIRE(allocator.Allocate(4096, 1, a));
+	CHECK(!allocator.Allocate(1, 1, b));
+	CHECK(!allocator.Empty());
+
+	allocator.Free(a);
+	CHECK(allocator.Empty());
+	CHECK(allocator.Allocate(4096, 1, b));
+	CHECK(allocator.Validate());
+}
+
+TEST_CASE(FreedNeighboursMerge) {
+	TlsfAllocator allocator(3 * 1024);
+	TlsfAllocator::Allocation blocks[3];
+	for (TlsfAllocator::Allocation& block : blocks) {
+		REQUIRE(allocator.Allocate(1024, 1, block));
+	}
+
+	// Freeing the outer two leaves two holes; freeing the middle one joins all three.
+	allocator.Free(blocks[0]);
+	allocator.Free(blocks[2]);
+	CHECK(allocator.GetStats().FreeBlocks == 2);
+	TlsfAllocator::Allocation whole;
+	CHECK(!allocator.Allocate(2048, 1, whole));
+
+	allocator.Free(blocks[1]);
+	TlsfAllocator::Stats stats = allocator.GetStats();
+	CHECK(stats.FreeBlocks == 1);
+	CHECK(stats.LargestFreeBlock == 3 * 1024);
+	CHECK(stats.Fragmentation() == 0.0);
+	CHECK(allocator.Allocate(3 * 1024, 1, whole));
+	CHECK(allocator.Validate());
+}
+
+// Random allocate and free with random sizes and alignments, per seed. After every operation the
+// block and bin structures must agree (Validate) and no two live allocations may overlap; once
+// everything is freed the range has to be a single free block again.
+TEST_CASE(FuzzAllocateFreeAlign) {
+	const uint64_t capacity = 64ull << 20;
+	const uint32_t seedCount = 50;
+	const uint32_t operationCount = 3000;
+
+	for (uint32_t seed = 0; seed < seedCount; ++seed) {
+		std::mt19937_64 random(seed);
+		TlsfAllocator allocator(capacity);
+		std::vector<TlsfAllocator::Allocation> live;
+		std::map<uint64_t, uint64_t> ranges;	// Offset to end of every live allocation.
+		uint64_t liveBytes = 0;
+
+		for (uint32_t operation = 0; operation < operationCount; ++operation) {
+			bool allocate = live.empty() || random() % 100 < 55;
+			if (allocate) {
+				// Mostly small, sometimes up to a few megabytes, like buffers and textures in a heap.
+				uint64_t size = random() % 10 == 0 ? 1 + random() % (4 << 20) : 1 + random() % 65536;
+				uint64_t alignment = 1ull << (random() % 17);
+
+				TlsfAllocator::Allocation allocation;
+				if (!allocator.Allocate(size, alignment, allocation))
+					continue;
+
+				REQUIRE(allocation.Size >= size);
+				REQUIRE(allocation.Offset % alignment == 0);
+				REQUIRE(allocation.Offset + allocation.Size <= capacity);
+
+				auto next = ranges.lower_bound(allocation.Offset);
+				REQUIRE(next == ranges.end() || allocation.Offset + allocation.Size <= next->first);
+				REQUIRE(next == ranges.begin() || std::prev(next)->second <= allocation.Offset);
+
+				ranges[allocation.Offset] = allocation.Offset + allocation.Size;
+				live.push_back(allocation);
+				liveBytes += allocation.Size;
+			} else {
+				size_t index = random() % live.size();
+				allocator.Free(live[index]);
+				ranges.erase(live[index].Offset);
+				liveBytes -= live[index].Size;
+				live[index] = live.back();
+				live.pop_back();
+			}
+
+			REQUIRE(allocator.Validate());
+			REQUIRE(allocator.GetStats().Allocations == live.size());
+			REQUIRE(allocator.GetStats().UsedBytes >= liveBytes);
+		}
+
+		for (const TlsfAllocator::Allocation& allocation : live) {
+			allocator.Free(allocation);
+		}
+
+		TlsfAllocator::Stats stats = allocator.GetStats();
+		REQUIRE(allocator.Validate());
+		REQUIRE(allocator.Empty());
+		REQUIRE(stats.FreeBlocks == 1);
+		REQUIRE(stats.LargestFreeBlock == capacity);
+		REQUIRE(stats.FreeBytes == capacity);
+	}
+}
@@ -0,0 +1,170 @@
+#include "Check.h"
+
+#include "UploadScheduler.h"
+
+namespace {
+// Stands in for the copy queue and its fence: Signal() returns the value the queue will reach once
+// everything submitted so far has run, and Execute() lets the "GPU" catch up to a value.
+struct FakeQueue {
+	uint64_t Signal() {
+		return ++_lastSignaled;
+	}
+
+	void Execute(uint64_t fence) {
+		_completed = fence;
+	}
+
+	void ExecuteAll() {
+		_completed = _lastSignaled;
+	}
+
+	uint64_t CompletedValue() const {
+		return _completed;
+	}
+
+private:
+	uint64_t _lastSignaled = 0;
+	uint64_t _completed = 0;
+};
+}
+
+TEST_CASE(TicketsIncreaseFromOne) {
+	UploadScheduler scheduler;
+	CHECK(scheduler.LastTicket() == 0);
+	CHECK(!scheduler.HasOpenBatch());
+
+	UploadScheduler::Ticket previous = 0;
+	for (int i = 0; i < 10; ++i) {
+		UploadScheduler::Ticket ticket = scheduler.Enqueue();
+		CHECK(ticket == previous + 1);
+		CHECK(scheduler.LastTicket() == ticket);
+		previous = ticket;
+	}
+	CHECK(scheduler.HasOpenBatch());
+}
+
+TEST_CASE(TicketZeroIsAlwaysComplete) {
+	UploadScheduler scheduler;
+	CHECK(scheduler.IsComplete(0));
+	CHECK(scheduler.FenceOf(0) == 0);
+
+	scheduler.Enqueue();
+	CHECK(scheduler.IsComplete(0));
+}
+
+TEST_CASE(TicketCompletesOnlyAfterItsFenceIsSignaled) {
+	FakeQueue queue;
+	UploadScheduler scheduler;
+
+	UploadScheduler::Ticket ticket = scheduler.Enqueue();
+	CHECK(!scheduler.IsSubmitted(ticket));
+	CHECK(!scheduler.IsComplete(ticket));
+	CHECK(scheduler.FenceOf(ticket) == 0);
+
+	uint64_t fence = queue.Signal();
+	scheduler.Submit(fence);
+	CHECK(scheduler.IsSubmitted(ticket));
+	CHECK(!scheduler.HasOpenBatch());
+	CHECK(scheduler.FenceOf(ticket) == fence);
+
+	// Nothing has run yet.
+	CHECK(scheduler.Retire(queue.CompletedValue()) == 0);
+	CHECK(!scheduler.IsComplete(ticket));
+
+	queue.Execute(fence);
+	CHECK(scheduler.Retire(queue.CompletedValue()) == 1);
+	CHECK(scheduler.IsComplete(ticket));
+	CHECK(scheduler.FenceOf(ticket) == 0);
+	CHECK(scheduler.InFlightBatches() == 0);
+}
+
+TEST_CASE(BatchesCompleteWhole) {
+	FakeQueue queue;
+	UploadScheduler scheduler;
+
+	UploadScheduler::Ticket first = scheduler.Enqueue();
+	UploadScheduler::Ticket second = scheduler.Enqueue();
+	UploadScheduler::Ticket third = scheduler.Enqueue();
+	uint64_t fence = queue.Signal();
+	scheduler.Submit(fence);
+
+	CHECK(scheduler.FenceOf(first) == fence);
+	CHECK(scheduler.FenceOf(second) == fence);
+	CHECK(scheduler.FenceOf(third) == fence);
+
+	queue.Execute(fence);
+	scheduler.Retire(queue.CompletedValue());
+	CHECK(scheduler.IsComplete(first));
+	CHECK(scheduler.IsComplete(second));
+	CHECK(scheduler.IsComplete(third));
+}
+
+TEST_CASE(BatchesRetireInSubmissionOrder) {
+	FakeQueue queue;
+	UploadScheduler scheduler;
+
+	UploadScheduler::Ticket tickets[4];
+	uint64_t fences[4];
+	for (int i = 0; i < 4; ++i) {
+		tickets[i] = scheduler.Enqueue();
+		fences[i] = queue.Signal();
+		scheduler.Submit(fences[i]);
+	}
+	CHECK(scheduler.InFlightBatches() == 4);
+
+	// The queue gets through the first two batches.
+	queue.Execute(fences[1]);
+	CHECK(scheduler.Retire(queue.CompletedValue()) == 2);
+	CHECK(scheduler.IsComplete(tickets[0]));
+	CHECK(scheduler.IsComplete(tickets[1]));
+	CHECK(!scheduler.IsComplete(tickets[2]));
+	CHECK(!scheduler.IsComplete(tickets[3]));
+	CHECK(scheduler.FenceOf(tickets[2]) == fences[2]);
+	CHECK(scheduler.FenceOf(tickets[3]) == fences[3]);
+
+	// Retiring again at the same value changes nothing.
+	CHECK(scheduler.Retire(queue.CompletedValue()) == 0);
+	CHECK(scheduler.InFlightBatches() == 2);
+
+	queue.ExecuteAll();
+	CHECK(scheduler.Retire(queue.CompletedValue()) == 2);
+	CHECK(scheduler.IsComplete(tickets[3]));
+	CHECK(scheduler.InFlightBatches() == 0);
+}
+
+TEST_CASE(OpenBatchStaysIncompleteWhileEarlierBatchesRetire) {
+	FakeQueue queue;
+	UploadScheduler scheduler;
+
+	UploadScheduler::Ticket submitted = scheduler.Enqueue();
+	uint64_t fence = queue.Signal();
+	scheduler.Submit(fence);
+
+	UploadScheduler::Ticket open = scheduler.Enqueue();
+	CHECK(scheduler.HasOpenBatch());
+
+	queue.ExecuteAll();
+	scheduler.Retire(queue.CompletedValue());
+	CHECK(scheduler.IsComplete(submitted));
+	CHECK(!scheduler.IsSubmitted(open));
+	CHECK(!scheduler.IsComplete(open));
+	CHECK(scheduler.FenceOf(open) == 0);
+}
+
+TEST_CASE(EmptyBatchStillAdvancesTheFence) {
+	FakeQueue queue;
+	UploadScheduler scheduler;
+
+	UploadScheduler::Ticket ticket = scheduler.Enqueue();
+	uint64_t first = queue.Signal();
+	scheduler.Submit(first);
+
+	// A batch with copies recorded but no ticket handed out.
+	uint64_t second = queue.Signal();
+	scheduler.Submit(second);
+	CHECK(scheduler.InFlightBatches() == 2);
+
+	queue.Execute(second);
+	CHECK(scheduler.Retire(queue.CompletedValue()) == 2);
+	CHECK(scheduler.IsComplete(ticket));
+}
@@ -0,0 +1,1004 @@
+#include "BlockCompressor.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COOKER_SSE2 1
+#include <emmintrin.h>
+#else
+#define COOKER_SSE2 0
+#endif
+
+namespace {
+	// A 4x4 block in planar float form, one 16-wide row per channel, so four texels fit in one SSE register.
+	struct alignas(16) Block {
+		float C[4][16];
+	};
+
+	void ToBlock(const uint8_t* rgba, Block& block) {
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < 4; ++c) {
+				block.C[c][i] = rgba[i * 4 + c];
+			}
+		}
+	}
+
+	// Finds the nearest palette entry for every texel and returns the summed weighted squared error.
+	// channelWeight zeroes out channels that are encoded elsewhere (BC3 alpha), texelWeight drops
+	// texels whose index is forced (BC1 transparent texels).
+	float FindIndices(const Block& block, const float (*palette)[4], int paletteSize,
+					  const float channelWeight[4], const float* texelWeight, uint8_t indices[16]) {
+#if COOKER_SSE2
+		__m128 total = _mm_setzero_ps();
+		for (int i = 0; i < 16; i += 4) {
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+
+			for (int p = 0; p < paletteSize; ++p) {
+				__m128 d = _mm_setzero_ps();
+				for (int c = 0; c < 4; ++c) {
+					__m128 diff = _mm_sub_ps(_mm_load_ps(&block.C[c][i]), _mm_set1_ps(palette[p][c]));
+					d = _mm_add_ps(d, _mm_mul_ps(_mm_mul_ps(diff, diff), _mm_set1_ps(channelWeight[c])));
+				}
+
+				__m128i less = _mm_castps_si128(_mm_cmplt_ps(d, best));
+				best = _mm_min_ps(d, best);
+				bestIndex = _mm_or_si128(_mm_andnot_si128(less, bestIndex),
+										 _mm_and_si128(less, _mm_set1_epi32(p)));
+			}
+
+			if (texelWeight)
+				best = _mm_mul_ps(best, _mm_loadu_ps(texelWeight + i));
+			total = _mm_add_ps(total, best);
+
+			alignas(16) int32_t index[4];
+			_mm_store_si128((__m128i*)index, bestIndex);
+			for (int k = 0; k < 4; ++k) {
+				indices[i + k] = (uint8_t)index[k];
+			}
+		}
+
+		alignas(16) float sum[4];
+		_mm_store_ps(sum, total);
+		return sum[0] + sum[1] + sum[2] + sum[3];
+#else
+		float total = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			float best = FLT_MAX;
+			for (int p = 0; p < paletteSize; ++p) {
+				float d = 0.0f;
+				for (int c = 0; c < 4; ++c) {
+					float diff = block.C[c][i] - palette[p][c];
+					d += diff * diff * channelWeight[c];
+				}
+				if (d < best) {
+					best = d;
+					indices[i] = (uint8_t)p;
+				}
+			}
+			total += texelWeight ? best * texelWeight[i] : best;
+		}
+		return total;
+#endif
+	}
+
+	// Principal axis fit: endpoints are the extremes of the texels projected onto the direction
+	// of greatest variance, optionally pulled in slightly so the interpolated entries land on the data.
+	void FitEndpoints(const Block& block, int channels, const float* texelWeight, bool inset, float e0[4], float e1[4]) {
+		float weightSum = 0.0f;
+		float mean[4] = {};
+		for (int i = 0; i < 16; ++i) {
+			float w = texelWeight ? texelWeight[i] : 1.0f;
+			weightSum += w;
+			for (int c = 0; c < channels; ++c) {
+				mean[c] += block.C[c][i] * w;
+			}
+		}
+
+		if (weightSum == 0.0f) {
+			for (int c = 0; c < 4; ++c) {
+				e0[c] = e1[c] = 0.0f;
+			}
+			return;
+		}
+
+		for (int c = 0; c < channels; ++c) {
+			mean[c] /= weightSum;
+		}
+
+		float cov[4][4] = {};
+		for (int i = 0; i < 16; ++i) {
+			float w = texelWeight ? texelWeight[i] : 1.0f;
+			for (int a = 0; a < channels; ++a) {
+				for (int b = a; b < channels; ++b) {
+					cov[a][b] += (block.C[a][i] - mean[a]) * (block.C[b][i] - mean[b]) * w;
+				}
+			}
+		}
+		for (int a = 0; a < channels; ++a) {
+			for (int b = 0; b < a; ++b) {
+				cov[a][b] = cov[b][a];
+			}
+		}
+
+		// A few rounds of power iteration are plenty for a 16 texel cloud.
+		float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+		for (int iteration = 0; iteration < 6; ++iteration) {
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < channels; ++a) {
+				for (int b = 0; b < channels; ++b) {
+					next[a] += cov[a][b] * axis[b];
+				}
+				length = std::max(length, std::fabs(next[a]));
+			}
+			if (length < 1e-6f)
+				break;
+			for (int a = 0; a < channels; ++a) {
+				axis[a] = next[a] / length;
+			}
+		}
+
+		float minT = FLT_MAX;
+		float maxT = -FLT_MAX;
+		for (int i = 0; i < 16; ++i) {
+			if (texelWeight && texelWeight[i] == 0.0f)
+				continue;
+			float t = 0.0f;
+			for (int c = 0; c < channels; ++c) {
+				t += (block.C[c][i] - mean[c]) * axis[c];
+			}
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		float lengthSq = 0.0f;
+		for (int c = 0; c < channels; ++c) {
+			lengthSq += axis[c] * axis[c];
+		}
+		if (lengthSq > 0.0f) {
+			minT /= lengthSq;
+			maxT /= lengthSq;
+		}
+
+		if (inset) {
+			float amount = (maxT - minT) / 32.0f;
+			minT += amount;
+			maxT -= amount;
+		}
+
+		for (int c = 0; c < 4; ++c) {
+			e0[c] = c < channels ? std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minT)) : 0.0f;
+			e1[c] = c < channels ? std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxT)) : 0.0f;
+		}
+	}
+
+	// Least squares endpoints for fixed indices, where weights[index] is the fraction of e1.
+	bool RefineEndpoints(const Block& block, int channels, const float* texelWeight, const uint8_t indices[16],
+						 const float* weights, float e0[4], float e1[4]) {
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < 16; ++i) {
+			float w = texelWeight ? texelWeight[i] : 1.0f;
+			float b = weights[indices[i]];
+			float a = 1.0f - b;
+			aa += a * a * w;
+			ab += a * b * w;
+			bb += b * b * w;
+			for (int c = 0; c < channels; ++c) {
+				ax[c] += a * block.C[c][i] * w;
+				bx[c] += b * block.C[c][i] * w;
+			}
+		}
+
+		float det = aa * bb - ab * ab;
+		if (std::fabs(det) < 1e-6f)
+			return false;
+
+		for (int c = 0; c < channels; ++c) {
+			e0[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / det));
+			e1[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / det));
+		}
+		return true;
+	}
+
+	// BC1 color endpoints --------------------------------------------------------------------------
+
+	uint16_t To565(const float color[4]) {
+		int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void From565(uint16_t packed, float color[4]) {
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (float)((r << 3) | (r >> 2));
+		color[1] = (float)((g << 2) | (g >> 4));
+		color[2] = (float)((b << 3) | (b >> 2));
+		color[3] = 0.0f;
+	}
+
+	// Four color mode when c0 > c1, three colors plus transparent black otherwise.
+	int BC1Palette(uint16_t c0, uint16_t c1, float palette[4][4]) {
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		if (c0 > c1) {
+			for (int c = 0; c < 3; ++c) {
+				palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+				palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+			}
+			palette[2][3] = palette[3][3] = 0.0f;
+			return 4;
+		}
+
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+			palette[3][c] = 0.0f;
+		}
+		palette[2][3] = palette[3][3] = 0.0f;
+		return 3;
+	}
+
+	struct ColorBlock {
+		uint16_t C0 = 0;
+		uint16_t C1 = 0;
+		uint8_t Indices[16] = {};
+		float Error = FLT_MAX;
+	};
+
+	// Encodes the RGB part of a BC1/BC3 block. With transparent texels (BC1 only) the three color
+	// mode is used and those texels get index 3.
+	ColorBlock EncodeColor(const Block& block, const bool transparent[16], bool anyTransparent) {
+		static const float fourColorWeights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+		static const float threeColorWeights[4] = {0.0f, 1.0f, 0.5f, 0.0f};
+		static const float rgbWeight[4] = {1.0f, 1.0f, 1.0f, 0.0f};
+
+		float texelWeight[16];
+		for (int i = 0; i < 16; ++i) {
+			texelWeight[i] = transparent[i] ? 0.0f : 1.0f;
+		}
+		const float* weightPtr = anyTransparent ? texelWeight : nullptr;
+
+		ColorBlock best;
+		float e0[4], e1[4];
+		FitEndpoints(block, 3, weightPtr, true, e0, e1);
+
+		for (int iteration = 0; iteration < 3; ++iteration) {
+			uint16_t c0 = To565(e0);
+			uint16_t c1 = To565(e1);
+
+			// Order the endpoints for the mode we want.
+			if (anyTransparent ? c0 > c1 : c0 < c1)
+				std::swap(c0, c1);
+
+			ColorBlock candidate;
+			candidate.C0 = c0;
+			candidate.C1 = c1;
+
+			if (!anyTransparent && c0 == c1) {
+				// A single color cannot express four color mode; index 0 is exact either way.
+				float palette[4][4];
+				BC1Palette(c0, c1, palette);
+				candidate.Error = FindIndices(block, palette, 1, rgbWeight, nullptr, candidate.Indices);
+			} else {
+				float palette[4][4];
+				int count = BC1Palette(c0, c1, palette);
+				candidate.Error = FindIndices(block, palette, anyTransparent ? 3 : count, rgbWeight, weightPtr, candidate.Indices);
+			}
+
+			if (candidate.Error < best.Error)
+				best = candidate;
+
+			if (best.Error == 0.0f)
+				break;
+
+			const float* weights = anyTransparent ? threeColorWeights : fourColorWeights;
+			if (!RefineEndpoints(block, 3, weightPtr, candidate.Indices, weights, e0, e1))
+				break;
+		}
+
+		if (anyTransparent) {
+			for (int i = 0; i < 16; ++i) {
+				if (transparent[i])
+					best.Indices[i] = 3;
+			}
+		}
+
+		return best;
+	}
+
+	void WriteColorBlock(const ColorBlock& color, uint8_t* out) {
+		out[0] = (uint8_t)(color.C0 & 0xff);
+		out[1] = (uint8_t)(color.C0 >> 8);
+		out[2] = (uint8_t)(color.C1 & 0xff);
+		out[3] = (uint8_t)(color.C1 >> 8);
+
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i) {
+			bits |= (uint32_t)(color.Indices[i] & 3) << (i * 2);
+		}
+		memcpy(out + 4, &bits, 4);
+	}
+
+	// BC3 alpha ------------------------------------------------------------------------------------
+
+	void AlphaPalette(uint8_t a0, uint8_t a1, int palette[8]) {
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1) {
+			for (int i = 1; i < 7; ++i) {
+				palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+			}
+		} else {
+			for (int i = 1; i < 5; ++i) {
+				palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	int AlphaIndices(const uint8_t alpha[16], uint8_t a0, uint8_t a1, uint8_t indices[16]) {
+		int palette[8];
+		AlphaPalette(a0, a1, palette);
+
+		int error = 0;
+		for (int i = 0; i < 16; ++i) {
+			int best = INT32_MAX;
+			for (int p = 0; p < 8; ++p) {
+				int d = (alpha[i] - palette[p]) * (alpha[i] - palette[p]);
+				if (d < best) {
+					best = d;
+					indices[i] = (uint8_t)p;
+				}
+			}
+			error += best;
+		}
+		return error;
+	}
+
+	void EncodeAlpha(const uint8_t alpha[16], uint8_t* out) {
+		int minA = 255, maxA = 0;
+		int minInner = 255, maxInner = 0;
+		for (int i = 0; i < 16; ++i) {
+			minA = std::min(minA, (int)alpha[i]);
+			maxA = std::max(maxA, (int)alpha[i]);
+			if (alpha[i] != 0 && alpha[i] != 255) {
+				minInner = std::min(minInner, (int)alpha[i]);
+				maxInner = std::max(maxInner, (int)alpha[i]);
+			}
+		}
+
+		// Eight interpolated values across the full range...
+		uint8_t a0 = (uint8_t)maxA;
+		uint8_t a1 = (uint8_t)minA;
+		uint8_t indices[16];
+		int error = AlphaIndices(alpha, a0, a1, indices);
+
+		// ...or six across the values strictly between 0 and 255, with exact 0 and 255 on the side.
+		// This wins for cutout foliage where most texels are fully opaque or fully clear.
+		if (error > 0) {
+			if (minInner > maxInner)
+				minInner = maxInner = minA == 0 ? maxA : minA;
+
+			uint8_t b0 = (uint8_t)minInner;
+			uint8_t b1 = (uint8_t)maxInner;
+			uint8_t other[16];
+			int otherError = AlphaIndices(alpha, b0, b1, other);
+			if (otherError < error) {
+				a0 = b0;
+				a1 = b1;
+				memcpy(indices, other, sizeof(indices));
+			}
+		}
+
+		out[0] = a0;
+		out[1] = a1;
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; ++i) {
+			bits |= (uint64_t)(indices[i] & 7) << (i * 3);
+		}
+		for (int i = 0; i < 6; ++i) {
+			out[2 + i] = (uint8_t)(bits >> (i * 8));
+		}
+	}
+
+	// BC7 ------------------------------------------------------------------------------------------
+
+	const int BC7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+	struct BitWriter {
+		uint8_t* Out;
+		uint32_t Position = 0;
+
+		void Write(uint32_t value, uint32_t bits) {
+			for (uint32_t i = 0; i < bits; ++i, ++Position) {
+				if (value & (1u << i))
+					Out[Position >> 3] |= (uint8_t)(1u << (Position & 7));
+			}
+		}
+	};
+
+	struct BitReader {
+		const uint8_t* In;
+		uint32_t Position = 0;
+
+		uint32_t Read(uint32_t bits) {
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bits; ++i, ++Position) {
+				value |= (uint32_t)((In[Position >> 3] >> (Position & 7)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	// Mode 6 endpoint: 7 bits per channel plus a p-bit shared by the channels.
+	struct Mode6Endpoint {
+		uint8_t Q[4];
+		uint8_t P;
+
+		void Expand(float color[4]) const {
+			for (int c = 0; c < 4; ++c) {
+				color[c] = (float)((Q[c] << 1) | P);
+			}
+		}
+	};
+
+	Mode6Endpoint QuantizeMode6(const float color[4], uint8_t p) {
+		Mode6Endpoint endpoint;
+		endpoint.P = p;
+		for (int c = 0; c < 4; ++c) {
+			int q = (int)std::floor((color[c] - p) / 2.0f + 0.5f);
+			endpoint.Q[c] = (uint8_t)std::min(127, std::max(0, q));
+		}
+		return endpoint;
+	}
+
+	void Mode6Palette(const Mode6Endpoint& e0, const Mode6Endpoint& e1, float palette[16][4]) {
+		float a[4], b[4];
+		e0.Expand(a);
+		e1.Expand(b);
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < 4; ++c) {
+				palette[i][c] = (float)((((64 - BC7Weights4[i]) * (int)a[c] + BC7Weights4[i] * (int)b[c] + 32)) >> 6);
+			}
+		}
+	}
+
+	struct Mode6Block {
+		Mode6Endpoint E0;
+		Mode6Endpoint E1;
+		uint8_t Indices[16];
+		float Error = FLT_MAX;
+	};
+
+	// The alpha of every texel if it is the same across the block, or -1.
+	int ConstantAlpha(const Block& block) {
+		for (int i = 1; i < 16; ++i) {
+			if (block.C[3][i] != block.C[3][0])
+				return -1;
+		}
+		return (int)block.C[3][0];
+	}
+
+	Mode6Block EncodeMode6(const Block& block, const float e0[4], const float e1[4]) {
+		static const float weight[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+		// The p-bit is shared by all four channels, so a free choice can trade an alpha step for a
+		// better color, and opaque blocks would decode to 254. Constant alpha is kept exact instead:
+		// both p-bits are its low bit and both alpha endpoints the rest.
+		int alpha = ConstantAlpha(block);
+		uint8_t firstP = alpha < 0 ? 0 : (uint8_t)(alpha & 1);
+		uint8_t lastP = alpha < 0 ? 1 : firstP;
+
+		// Try every allowed p-bit pair; at most four palette searches per block.
+		Mode6Block best;
+		for (uint8_t p0 = firstP; p0 <= lastP; ++p0) {
+			for (uint8_t p1 = firstP; p1 <= lastP; ++p1) {
+				Mode6Block candidate;
+				candidate.E0 = QuantizeMode6(e0, p0);
+				candidate.E1 = QuantizeMode6(e1, p1);
+				if (alpha >= 0) {
+					candidate.E0.Q[3] = (uint8_t)(alpha >> 1);
+					candidate.E1.Q[3] = (uint8_t)(alpha >> 1);
+				}
+
+				float palette[16][4];
+				Mode6Palette(candidate.E0, candidate.E1, palette);
+				candidate.Error = FindIndices(block, palette, 16, weight, nullptr, candidate.Indices);
+				if (candidate.Error < best.Error)
+					best = candidate;
+			}
+		}
+		return best;
+	}
+
+	// Mode 6 is one RGBA line with 4 bit indices; good for opaque and smoothly varying alpha.
+	Mode6Block SearchMode6(const Block& block) {
+		// The inset fit suits smooth gradients; the full extent keeps exact extremes.
+		float e0[4], e1[4];
+		FitEndpoints(block, 4, nullptr, true, e0, e1);
+		Mode6Block best = EncodeMode6(block, e0, e1);
+
+		float f0[4], f1[4];
+		FitEndpoints(block, 4, nullptr, false, f0, f1);
+		Mode6Block full = EncodeMode6(block, f0, f1);
+		if (full.Error < best.Error) {
+			best = full;
+			memcpy(e0, f0, sizeof(e0));
+			memcpy(e1, f1, sizeof(e1));
+		}
+
+		float weights[16];
+		for (int i = 0; i < 16; ++i) {
+			weights[i] = BC7Weights4[i] / 64.0f;
+		}
+
+		for (int iteration = 0; iteration < 2 && best.Error > 0.0f; ++iteration) {
+			if (!RefineEndpoints(block, 4, nullptr, best.Indices, weights, e0, e1))
+				break;
+			Mode6Block candidate = EncodeMode6(block, e0, e1);
+			if (candidate.Error >= best.Error)
+				break;
+			best = candidate;
+		}
+
+		// The anchor texel's index is stored with an implicit leading zero; flip the endpoints if needed.
+		if (best.Indices[0] & 8) {
+			std::swap(best.E0, best.E1);
+			for (int i = 0; i < 16; ++i) {
+				best.Indices[i] = (uint8_t)(15 - best.Indices[i]);
+			}
+		}
+
+		return best;
+	}
+
+	// True if the block's alpha decodes without error, which the shared p-bits cannot always allow.
+	bool Mode6AlphaExact(const Block& block, const Mode6Block& mode6) {
+		float palette[16][4];
+		Mode6Palette(mode6.E0, mode6.E1, palette);
+		for (int i = 0; i < 16; ++i) {
+			if (palette[mode6.Indices[i]][3] != block.C[3][i])
+				return false;
+		}
+		return true;
+	}
+
+	void WriteMode6(const Mode6Block& mode6, uint8_t* block) {
+		memset(block, 0, 16);
+		BitWriter writer{block};
+		writer.Write(1u << 6, 7);
+		for (int c = 0; c < 4; ++c) {
+			writer.Write(mode6.E0.Q[c], 7);
+			writer.Write(mode6.E1.Q[c], 7);
+		}
+		writer.Write(mode6.E0.P, 1);
+		writer.Write(mode6.E1.P, 1);
+		writer.Write(mode6.Indices[0], 3);
+		for (int i = 1; i < 16; ++i) {
+			writer.Write(mode6.Indices[i], 4);
+		}
+	}
+
+	const int BC7Weights2[4] = {0, 21, 43, 64};
+
+	int Interpolate(int a, int b, int weight) {
+		return ((64 - weight) * a + weight * b + 32) >> 6;
+	}
+
+	// Mode 5 (rotation 0): an RGB line with 7 bit endpoints and an independent 8 bit alpha line,
+	// 2 bit indices each. Cutout alpha does not fit on the same line as the color, so this is
+	// what keeps foliage edges intact.
+	struct Mode5Block {
+		uint8_t Color0[3] = {};
+		uint8_t Color1[3] = {};
+		uint8_t Alpha0 = 0;
+		uint8_t Alpha1 = 0;
+		uint8_t ColorIndices[16] = {};
+		uint8_t AlphaIndices[16] = {};
+		float Error = FLT_MAX;
+	};
+
+	void Mode5ColorPalette(const uint8_t q0[3], const uint8_t q1[3], float palette[4][4]) {
+		for (int c = 0; c < 3; ++c) {
+			int a = (q0[c] << 1) | (q0[c] >> 6);
+			int b = (q1[c] << 1) | (q1[c] >> 6);
+			for (int i = 0; i < 4; ++i) {
+				palette[i][c] = (float)Interpolate(a, b, BC7Weights2[i]);
+			}
+		}
+		for (int i = 0; i < 4; ++i) {
+			palette[i][3] = 0.0f;
+		}
+	}
+
+	float EncodeMode5Color(const Block& block, const float e0[4], const float e1[4], Mode5Block& out) {
+		static const float rgbWeight[4] = {1.0f, 1.0f, 1.0f, 0.0f};
+		for (int c = 0; c < 3; ++c) {
+			out.Color0[c] = (uint8_t)std::min(127.0f, std::floor(e0[c] * 127.0f / 255.0f + 0.5f));
+			out.Color1[c] = (uint8_t)std::min(127.0f, std::floor(e1[c] * 127.0f / 255.0f + 0.5f));
+		}
+
+		float palette[4][4];
+		Mode5ColorPalette(out.Color0, out.Color1, palette);
+		return FindIndices(block, palette, 4, rgbWeight, nullptr, out.ColorIndices);
+	}
+
+	Mode5Block SearchMode5(const Block& block) {
+		static const float weights[4] = {0.0f, 21.0f / 64.0f, 43.0f / 64.0f, 1.0f};
+
+		Mode5Block best;
+		float e0[4], e1[4];
+		FitEndpoints(block, 3, nullptr, true, e0, e1);
+		float colorError = EncodeMode5Color(block, e0, e1, best);
+
+		for (int iteration = 0; iteration < 2 && colorError > 0.0f; ++iteration) {
+			Mode5Block candidate;
+			if (!RefineEndpoints(block, 3, nullptr, best.ColorIndices, weights, e0, e1))
+				break;
+			float candidateError = EncodeMode5Color(block, e0, e1, candidate);
+			if (candidateError >= colorError)
+				break;
+			best = candidate;
+			colorError = candidateError;
+		}
+
+		// Alpha endpoints at the exact extremes; 0 and 255 survive untouched.
+		float minA = 255.0f, maxA = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			minA = std::min(minA, block.C[3][i]);
+			maxA = std::max(maxA, block.C[3][i]);
+		}
+		best.Alpha0 = (uint8_t)minA;
+		best.Alpha1 = (uint8_t)maxA;
+
+		float alphaError = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			float nearest = FLT_MAX;
+			for (int p = 0; p < 4; ++p) {
+				float d = block.C[3][i] - (float)Interpolate(best.Alpha0, best.Alpha1, BC7Weights2[p]);
+				if (d * d < nearest) {
+					nearest = d * d;
+					best.AlphaIndices[i] = (uint8_t)p;
+				}
+			}
+			alphaError += nearest;
+		}
+
+		// Each index set has its own anchor bit.
+		if (best.ColorIndices[0] & 2) {
+			std::swap(best.Color0, best.Color1);
+			for (int i = 0; i < 16; ++i) {
+				best.ColorIndices[i] = (uint8_t)(3 - best.ColorIndices[i]);
+			}
+		}
+		if (best.AlphaIndices[0] & 2) {
+			std::swap(best.Alpha0, best.Alpha1);
+			for (int i = 0; i < 16; ++i) {
+				best.AlphaIndices[i] = (uint8_t)(3 - best.AlphaIndices[i]);
+			}
+		}
+
+		best.Error = colorError + alphaError;
+		return best;
+	}
+
+	void WriteMode5(const Mode5Block& mode5, uint8_t* block) {
+		memset(block, 0, 16);
+		BitWriter writer{block};
+		writer.Write(1u << 5, 6);
+		writer.Write(0, 2);
+		for (int c = 0; c < 3; ++c) {
+			writer.Write(mode5.Color0[c], 7);
+			writer.Write(mode5.Color1[c], 7);
+		}
+		writer.Write(mode5.Alpha0, 8);
+		writer.Write(mode5.Alpha1, 8);
+		writer.Write(mode5.ColorIndices[0], 1);
+		for (int i = 1; i < 16; ++i) {
+			writer.Write(mode5.ColorIndices[i], 2);
+		}
+		writer.Write(mode5.AlphaIndices[0], 1);
+		for (int i = 1; i < 16; ++i) {
+			writer.Write(mode5.AlphaIndices[i], 2);
+		}
+	}
+
+	// Shared helpers -------------------------------------------------------------------------------
+
+	// At most two alpha values in the block: opaque, or a cutout.
+	bool TwoLevelAlpha(const Block& block) {
+		float a = block.C[3][0];
+		float b = a;
+		for (int i = 1; i < 16; ++i) {
+			float value = block.C[3][i];
+			if (value == a || value == b)
+				continue;
+			if (a != b)
+				return false;
+			b = value;
+		}
+		return true;
+	}
+
+	void ReadBlock(const Image& image, uint32_t bx, uint32_t by, uint8_t rgba[64]) {
+		for (uint32_t y = 0; y < 4; ++y) {
+			uint32_t sy = std::min(by * 4 + y, image.Height - 1);
+			for (uint32_t x = 0; x < 4; ++x) {
+				uint32_t sx = std::min(bx * 4 + x, image.Width - 1);
+				memcpy(&rgba[(y * 4 + x) * 4], &image.Pixels[sy * image.RowPitch() + sx * 4], 4);
+			}
+		}
+	}
+
+	void WriteBlock(Image& image, uint32_t bx, uint32_t by, const uint8_t rgba[64]) {
+		for (uint32_t y = 0; y < 4 && by * 4 + y < image.Height; ++y) {
+			for (uint32_t x = 0; x < 4 && bx * 4 + x < image.Width; ++x) {
+				memcpy(&image.Pixels[(by * 4 + y) * image.RowPitch() + (bx * 4 + x) * 4], &rgba[(y * 4 + x) * 4], 4);
+			}
+		}
+	}
+}
+
+std::vector<uint8_t> BlockCompressor::Compress(const Image& image, BlockFormat format, unsigned threadCount) {
+	uint32_t blocksWide = std::max(1u, (image.Width + 3) / 4);
+	uint32_t blocksHigh = std::max(1u, (image.Height + 3) / 4);
+	uint32_t blockBytes = BlockBytes(format);
+
+	std::vector<uint8_t> result((size_t)blocksWide * blocksHigh * blockBytes);
+
+	// Rows of blocks are independent, so they are handed out to the workers in contiguous bands.
+	Parallel::For(blocksHigh, threadCount, [&](uint32_t begin, uint32_t end) {
+		uint8_t rgba[64];
+		for (uint32_t by = begin; by < end; ++by) {
+			for (uint32_t bx = 0; bx < blocksWide; ++bx) {
+				ReadBlock(image, bx, by, rgba);
+				uint8_t* out = &result[((size_t)by * blocksWide + bx) * blockBytes];
+				switch (format) {
+					case BlockFormat::BC1:
+						EncodeBC1(rgba, out, true);
+						break;
+					case BlockFormat::BC2:
+						EncodeBC2(rgba, out);
+						break;
+					case BlockFormat::BC3:
+						EncodeBC3(rgba, out);
+						break;
+					case BlockFormat::BC7:
+						EncodeBC7(rgba, out);
+						break;
+				}
+			}
+		}
+	});
+
+	return result;
+}
+
+Image BlockCompressor::Decompress(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format) {
+	Image image;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(image.SlicePitch());
+
+	uint32_t blocksWide = std::max(1u, (width + 3) / 4);
+	uint32_t blocksHigh = std::max(1u, (height + 3) / 4);
+	uint32_t blockBytes = BlockBytes(format);
+
+	uint8_t rgba[64];
+	for (uint32_t by = 0; by < blocksHigh; ++by) {
+		for (uint32_t bx = 0; bx < blocksWide; ++bx) {
+			const uint8_t* in = &blocks[((size_t)by * blocksWide + bx) * blockBytes];
+			switch (format) {
+				case BlockFormat::BC1:
+					DecodeBC1(in, rgba, true);
+					break;
+				case BlockFormat::BC2:
+					DecodeBC2(in, rgba);
+					break;
+				case BlockFormat::BC3:
+					DecodeBC3(in, rgba);
+					break;
+				case BlockFormat::BC7:
+					DecodeBC7(in, rgba);
+					break;
+			}
+			WriteBlock(image, bx, by, rgba);
+		}
+	}
+
+	return image;
+}
+
+void BlockCompressor::EncodeBC1(const uint8_t* rgba, uint8_t* block, bool allowTransparent) {
+	Block source;
+	ToBlock(rgba, source);
+
+	bool transparent[16];
+	bool anyTransparent = false;
+	for (int i = 0; i < 16; ++i) {
+		transparent[i] = allowTransparent && rgba[i * 4 + 3] < 128;
+		anyTransparent |= transparent[i];
+	}
+
+	if (anyTransparent && std::all_of(transparent, transparent + 16, [](bool t) { return t; })) {
+		// Fully clear block: three color mode with every index on transparent black.
+		memset(block, 0, 4);
+		memset(block + 4, 0xff, 4);
+		return;
+	}
+
+	WriteColorBlock(EncodeColor(source, transparent, anyTransparent), block);
+}
+
+void BlockCompressor::EncodeBC2(const uint8_t* rgba, uint8_t* block) {
+	uint64_t bits = 0;
+	for (int i = 0; i < 16; ++i) {
+		bits |= (uint64_t)((rgba[i * 4 + 3] * 15 + 127) / 255) << (i * 4);
+	}
+	memcpy(block, &bits, 8);
+
+	Block source;
+	ToBlock(rgba, source);
+	bool transparent[16] = {};
+	WriteColorBlock(EncodeColor(source, transparent, false), block + 8);
+}
+
+void BlockCompressor::EncodeBC3(const uint8_t* rgba, uint8_t* block) {
+	uint8_t alpha[16];
+	for (int i = 0; i < 16; ++i) {
+		alpha[i] = rgba[i * 4 + 3];
+	}
+	EncodeAlpha(alpha, block);
+
+	Block source;
+	ToBlock(rgba, source);
+	bool transparent[16] = {};
+	WriteColorBlock(EncodeColor(source, transparent, false), block + 8);
+}
+
+void BlockCompressor::EncodeBC7(const uint8_t* rgba, uint8_t* block) {
+	Block source;
+	ToBlock(rgba, source);
+
+	Mode6Block mode6 = SearchMode6(source);
+	if (mode6.Error == 0.0f) {
+		WriteMode6(mode6, block);
+		return;
+	}
+
+	// Opaque and cutout alpha is kept exact. Mode 5's separate alpha line always can; mode 6 only
+	// when its p-bits allowed it.
+	Mode5Block mode5 = SearchMode5(source);
+	bool exactAlpha = TwoLevelAlpha(source) && !Mode6AlphaExact(source, mode6);
+	if (exactAlpha || mode5.Error < mode6.Error) {
+		WriteMode5(mode5, block);
+	} else {
+		WriteMode6(mode6, block);
+	}
+}
+
+void BlockCompressor::DecodeBC1(const uint8_t* block, uint8_t* rgba, bool allowTransparent) {
+	uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+	uint32_t bits;
+	memcpy(&bits, block + 4, 4);
+
+	// BC2/BC3 color blocks always use four color mode.
+	float palette[4][4];
+	if (allowTransparent) {
+		BC1Palette(c0, c1, palette);
+	} else {
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+	}
+	bool transparentIndex3 = allowTransparent && c0 <= c1;
+
+	for (int i = 0; i < 16; ++i) {
+		uint32_t index = (bits >> (i * 2)) & 3;
+		for (int c = 0; c < 3; ++c) {
+			rgba[i * 4 + c] = (uint8_t)(palette[index][c] + 0.5f);
+		}
+		rgba[i * 4 + 3] = (transparentIndex3 && index == 3) ? 0 : 255;
+	}
+}
+
+void BlockCompressor::DecodeBC2(const uint8_t* block, uint8_t* rgba) {
+	DecodeBC1(block + 8, rgba, false);
+
+	uint64_t bits;
+	memcpy(&bits, block, 8);
+	for (int i = 0; i < 16; ++i) {
+		rgba[i * 4 + 3] = (uint8_t)(((bits >> (i * 4)) & 15) * 17);
+	}
+}
+
+void BlockCompressor::DecodeBC3(const uint8_t* block, uint8_t* rgba) {
+	DecodeBC1(block + 8, rgba, false);
+
+	int palette[8];
+	AlphaPalette(block[0], block[1], palette);
+
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; ++i) {
+		bits |= (uint64_t)block[2 + i] << (i * 8);
+	}
+	for (int i = 0; i < 16; ++i) {
+		rgba[i * 4 + 3] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+	}
+}
+
+void BlockCompressor::DecodeBC7(const uint8_t* block, uint8_t* rgba) {
+	BitReader reader{block};
+	int mode = 0;
+	while (mode < 8 && reader.Read(1) == 0) {
+		++mode;
+	}
+
+	if (mode == 6) {
+		Mode6Endpoint e0, e1;
+		for (int c = 0; c < 4; ++c) {
+			e0.Q[c] = (uint8_t)reader.Read(7);
+			e1.Q[c] = (uint8_t)reader.Read(7);
+		}
+		e0.P = (uint8_t)reader.Read(1);
+		e1.P = (uint8_t)reader.Read(1);
+
+		float palette[16][4];
+		Mode6Palette(e0, e1, palette);
+
+		for (int i = 0; i < 16; ++i) {
+			uint32_t index = reader.Read(i == 0 ? 3 : 4);
+			for (int c = 0; c < 4; ++c) {
+				rgba[i * 4 + c] = (uint8_t)palette[index][c];
+			}
+		}
+		return;
+	}
+
+	if (mode == 5 && reader.Read(2) == 0) {
+		Mode5Block decoded;
+		for (int c = 0; c < 3; ++c) {
+			decoded.Color0[c] = (uint8_t)reader.Read(7);
+			decoded.Color1[c] = (uint8_t)reader.Read(7);
+		}
+		decoded.Alpha0 = (uint8_t)reader.Read(8);
+		decoded.Alpha1 = (uint8_t)reader.Read(8);
+
+		float palette[4][4];
+		Mode5ColorPalette(decoded.Color0, decoded.Color1, palette);
+
+		for (int i = 0; i < 16; ++i) {
+			uint32_t index = reader.Read(i == 0 ? 1 : 2);
+			for (int c = 0; c < 3; ++c) {
+				rgba[i * 4 + c] = (uint8_t)palette[index][c];
+			}
+		}
+		for (int i = 0; i < 16; ++i) {
+			uint32_t index = reader.Read(i == 0 ? 1 : 2);
+			rgba[i * 4 + 3] = (uint8_t)Interpolate(decoded.Alpha0, decoded.Alpha1, BC7Weights2[index]);
+		}
+		return;
+	}
+
+	// Only modes 5 (without rotation) and 6 are produced by the encoder; anything else decodes as
+	// opaque magenta so it stands out.
+	for (int i = 0; i < 16; ++i) {
+		rgba[i * 4 + 0] = 255;
+		rgba[i * 4 + 1] = 0;
+		rgba[i * 4 + 2] = 255;
+		rgba[i * 4 + 3] = 255;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Image.h"
+
+enum class BlockFormat {
+	BC1,	// RGB + 1 bit alpha, 8 bytes per 4x4 block
+	BC2,	// RGB + explicit 4 bit alpha, 16 bytes per 4x4 block
+	BC3,	// RGBA, 16 bytes per 4x4 block
+	BC7,	// RGBA, 16 bytes per 4x4 block (modes 5 and 6)
+};
+
+class BlockCompressor {
+public:
+	static uint32_t BlockBytes(BlockFormat format) {
+		return format == BlockFormat::BC1 ? 8 : 16;
+	}
+
+	// Compresses one surface. Sizes that are not a multiple of 4 are padded by clamping to the
+	// edge texels, which is what the hardware ignores anyway.
+	static std::vector<uint8_t> Compress(const Image& image, BlockFormat format, unsigned threadCount);
+
+	// Reference decoder, used for the quality report.
+	static Image Decompress(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format);
+
+private:
+	static void EncodeBC1(const uint8_t* rgba, uint8_t* block, bool allowTransparent);
+	static void EncodeBC2(const uint8_t* rgba, uint8_t* block);
+	static void EncodeBC3(const uint8_t* rgba, uint8_t* block);
+	static void EncodeBC7(const uint8_t* rgba, uint8_t* block);
+
+	static void DecodeBC1(const uint8_t* block, uint8_t* rgba, bool allowTransparent);
+	static void DecodeBC2(const uint8_t* block, uint8_t* rgba);
+	static void DecodeBC3(const uint8_t* block, uint8_t* rgba);
+	static void DecodeBC7(const uint8_t* block, uint8_t* rgba);
+};
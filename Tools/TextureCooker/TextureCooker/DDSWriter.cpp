@@ -0,0 +1,200 @@
+#include "DDSWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace {
+	// See DDS.h in the 'DirectXTex' library. Only the fields the DX10 path needs are filled in.
+	const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+	const uint32_t DDS_FOURCC = 0x00000004;
+
+	const uint32_t DDSD_CAPS = 0x00000001;
+	const uint32_t DDSD_HEIGHT = 0x00000002;
+	const uint32_t DDSD_WIDTH = 0x00000004;
+	const uint32_t DDSD_PITCH = 0x00000008;
+	const uint32_t DDSD_PIXELFORMAT = 0x00001000;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x00020000;
+	const uint32_t DDSD_LINEARSIZE = 0x00080000;
+
+	const uint32_t DDSCAPS_COMPLEX = 0x00000008;
+	const uint32_t DDSCAPS_TEXTURE = 0x00001000;
+	const uint32_t DDSCAPS_MIPMAP = 0x00400000;
+
+	const uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+#pragma pack(push, 1)
+	struct DDSPixelFormat {
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct DDSHeader {
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		DDSPixelFormat PixelFormat;
+		uint32_t Caps;
+		uint32_t Caps2;
+		uint32_t Caps3;
+		uint32_t Caps4;
+		uint32_t Reserved2;
+	};
+
+	struct DDSHeaderDXT10 {
+		uint32_t DxgiFormat;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(DDSHeader) == 124, "DDS header size mismatch");
+	static_assert(sizeof(DDSHeaderDXT10) == 20, "DDS DX10 header size mismatch");
+
+	struct FileCloser {
+		void operator()(FILE* file) const {
+			if (file)
+				fclose(file);
+		}
+	};
+}
+
+bool DDSWriter::IsBlockCompressed(DDSFormat format) {
+	switch (format) {
+		case DDSFormat::BC1_UNORM:
+		case DDSFormat::BC1_UNORM_SRGB:
+		case DDSFormat::BC2_UNORM:
+		case DDSFormat::BC2_UNORM_SRGB:
+		case DDSFormat::BC3_UNORM:
+		case DDSFormat::BC3_UNORM_SRGB:
+		case DDSFormat::BC7_UNORM:
+		case DDSFormat::BC7_UNORM_SRGB:
+			return true;
+		default:
+			return false;
+	}
+}
+
+size_t DDSWriter::RowPitch(DDSFormat format, uint32_t width) {
+	switch (format) {
+		case DDSFormat::BC1_UNORM:
+		case DDSFormat::BC1_UNORM_SRGB:
+			return (size_t)std::max(1u, (width + 3) / 4) * 8;
+		case DDSFormat::BC2_UNORM:
+		case DDSFormat::BC2_UNORM_SRGB:
+		case DDSFormat::BC3_UNORM:
+		case DDSFormat::BC3_UNORM_SRGB:
+		case DDSFormat::BC7_UNORM:
+		case DDSFormat::BC7_UNORM_SRGB:
+			return (size_t)std::max(1u, (width + 3) / 4) * 16;
+		case DDSFormat::R8G8B8A8_UNORM:
+		case DDSFormat::R8G8B8A8_UNORM_SRGB:
+		default:
+			return (size_t)width * 4;
+	}
+}
+
+size_t DDSWriter::SurfaceSize(DDSFormat format, uint32_t width, uint32_t height) {
+	uint32_t rows = IsBlockCompressed(format) ? std::max(1u, (height + 3) / 4) : height;
+	return RowPitch(format, width) * rows;
+}
+
+bool DDSWriter::Write(const std::string& filename, const DDSTexture& texture, std::string& error) {
+	if (texture.Width == 0 || texture.Height == 0 || texture.ArraySize == 0 || texture.MipLevels == 0) {
+		error = filename + ": empty texture";
+		return false;
+	}
+
+	if (texture.Subresources.size() != (size_t)texture.ArraySize * texture.MipLevels) {
+		error = filename + ": subresource count does not match array size and mip levels";
+		return false;
+	}
+
+	// Validate every surface before touching the file so a bad input never leaves a partial DDS behind.
+	for (uint32_t slice = 0; slice < texture.ArraySize; ++slice) {
+		uint32_t w = texture.Width;
+		uint32_t h = texture.Height;
+		for (uint32_t mip = 0; mip < texture.MipLevels; ++mip) {
+			const auto& data = texture.Subresources[slice * texture.MipLevels + mip];
+			if (data.size() != SurfaceSize(texture.Format, w, h)) {
+				error = filename + ": subresource " + std::to_string(slice * texture.MipLevels + mip) + " has the wrong size";
+				return false;
+			}
+
+			w = std::max(w >> 1, 1u);
+			h = std::max(h >> 1, 1u);
+		}
+	}
+
+	DDSHeader header;
+	memset(&header, 0, sizeof(header));
+	header.Size = sizeof(DDSHeader);
+	header.Flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT;
+	header.Height = texture.Height;
+	header.Width = texture.Width;
+	if (IsBlockCompressed(texture.Format)) {
+		header.Flags |= DDSD_LINEARSIZE;
+		header.PitchOrLinearSize = (uint32_t)SurfaceSize(texture.Format, texture.Width, texture.Height);
+	} else {
+		header.Flags |= DDSD_PITCH;
+		header.PitchOrLinearSize = (uint32_t)RowPitch(texture.Format, texture.Width);
+	}
+	header.Depth = 1;
+	header.MipMapCount = texture.MipLevels;
+	header.PixelFormat.Size = sizeof(DDSPixelFormat);
+	header.PixelFormat.Flags = DDS_FOURCC;
+	header.PixelFormat.FourCC = 'D' | ('X' << 8) | ('1' << 16) | ('0' << 24);
+	header.Caps = DDSCAPS_TEXTURE;
+
+	if (texture.MipLevels > 1) {
+		header.Flags |= DDSD_MIPMAPCOUNT;
+		header.Caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	}
+
+	if (texture.ArraySize > 1) {
+		header.Caps |= DDSCAPS_COMPLEX;
+	}
+
+	DDSHeaderDXT10 dx10;
+	memset(&dx10, 0, sizeof(dx10));
+	dx10.DxgiFormat = (uint32_t)texture.Format;
+	dx10.ResourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+	dx10.ArraySize = texture.ArraySize;
+
+	std::unique_ptr<FILE, FileCloser> file(fopen(filename.c_str(), "wb"));
+	if (!file) {
+		error = filename + ": cannot open file for writing";
+		return false;
+	}
+
+	bool ok = fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, file.get()) == 1 &&
+		fwrite(&header, sizeof(header), 1, file.get()) == 1 &&
+		fwrite(&dx10, sizeof(dx10), 1, file.get()) == 1;
+
+	for (size_t i = 0; ok && i < texture.Subresources.size(); ++i) {
+		const auto& data = texture.Subresources[i];
+		ok = fwrite(data.data(), 1, data.size(), file.get()) == data.size();
+	}
+
+	if (!ok) {
+		error = filename + ": write failed";
+		return false;
+	}
+
+	return true;
+}
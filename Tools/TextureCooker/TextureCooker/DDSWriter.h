@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Values match DXGI_FORMAT so they can be written straight into the DX10 header.
+enum class DDSFormat : uint32_t {
+	R8G8B8A8_UNORM = 28,
+	R8G8B8A8_UNORM_SRGB = 29,
+	BC1_UNORM = 71,
+	BC1_UNORM_SRGB = 72,
+	BC2_UNORM = 74,
+	BC2_UNORM_SRGB = 75,
+	BC3_UNORM = 77,
+	BC3_UNORM_SRGB = 78,
+	BC7_UNORM = 98,
+	BC7_UNORM_SRGB = 99,
+};
+
+struct DDSTexture {
+	DDSFormat Format = DDSFormat::R8G8B8A8_UNORM;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t ArraySize = 1;
+	uint32_t MipLevels = 1;
+
+	// One entry per subresource in D3D order: Subresources[slice * MipLevels + mip].
+	std::vector<std::vector<uint8_t>> Subresources;
+};
+
+class DDSWriter {
+public:
+	// Writes a 2D texture (or texture array) with a DX10 extended header.
+	static bool Write(const std::string& filename, const DDSTexture& texture, std::string& error);
+
+	static bool IsBlockCompressed(DDSFormat format);
+
+	// For block compressed formats a "row" is one row of 4x4 blocks.
+	static size_t RowPitch(DDSFormat format, uint32_t width);
+	static size_t SurfaceSize(DDSFormat format, uint32_t width, uint32_t height);
+};
@@ -0,0 +1,216 @@
+#include "Image.h"
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace {
+	struct FileCloser {
+		void operator()(FILE* file) const {
+			if (file)
+				fclose(file);
+		}
+	};
+
+	uint16_t ReadU16(const uint8_t* p) {
+		return (uint16_t)(p[0] | (p[1] << 8));
+	}
+
+	uint32_t ReadU32(const uint8_t* p) {
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	uint32_t FourCC(char a, char b, char c, char d) {
+		return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+	}
+
+	// DXGI_FORMAT values the loader understands.
+	const uint32_t DXGI_R8G8B8A8_UNORM = 28;
+	const uint32_t DXGI_R8G8B8A8_UNORM_SRGB = 29;
+	const uint32_t DXGI_BC1_UNORM = 71;
+	const uint32_t DXGI_BC1_UNORM_SRGB = 72;
+	const uint32_t DXGI_BC2_UNORM = 74;
+	const uint32_t DXGI_BC2_UNORM_SRGB = 75;
+	const uint32_t DXGI_BC3_UNORM = 77;
+	const uint32_t DXGI_BC3_UNORM_SRGB = 78;
+	const uint32_t DXGI_B8G8R8A8_UNORM = 87;
+	const uint32_t DXGI_B8G8R8A8_UNORM_SRGB = 91;
+}
+
+bool ImageIO::LoadBmp(const std::string& filename, Image& image, std::string& error) {
+	std::unique_ptr<FILE, FileCloser> file(fopen(filename.c_str(), "rb"));
+	if (!file) {
+		error = filename + ": cannot open file";
+		return false;
+	}
+
+	// BITMAPFILEHEADER (14 bytes) followed by BITMAPINFOHEADER (40 bytes).
+	uint8_t header[54];
+	if (fread(header, 1, sizeof(header), file.get()) != sizeof(header) || header[0] != 'B' || header[1] != 'M') {
+		error = filename + ": not a BMP file";
+		return false;
+	}
+
+	uint32_t bitsOffset = ReadU32(header + 10);
+	uint32_t infoSize = ReadU32(header + 14);
+	int32_t width = (int32_t)ReadU32(header + 18);
+	int32_t height = (int32_t)ReadU32(header + 22);
+	uint16_t bitCount = ReadU16(header + 28);
+	uint32_t compression = ReadU32(header + 30);
+
+	if (infoSize < 40 || width <= 0 || height == 0) {
+		error = filename + ": unsupported BMP header";
+		return false;
+	}
+
+	if (compression != 0 || (bitCount != 24 && bitCount != 32)) {
+		error = filename + ": only uncompressed 24 and 32 bit BMPs are supported";
+		return false;
+	}
+
+	// Positive heights are stored bottom-up.
+	bool bottomUp = height > 0;
+	uint32_t rows = (uint32_t)(bottomUp ? height : -height);
+	uint32_t bytesPerPixel = bitCount / 8;
+	size_t srcPitch = ((size_t)width * bytesPerPixel + 3) & ~(size_t)3;
+
+	std::vector<uint8_t> bits(srcPitch * rows);
+	if (fseek(file.get(), (long)bitsOffset, SEEK_SET) != 0 || fread(bits.data(), 1, bits.size(), file.get()) != bits.size()) {
+		error = filename + ": truncated pixel data";
+		return false;
+	}
+
+	image.Width = (uint32_t)width;
+	image.Height = rows;
+	image.Pixels.resize(image.SlicePitch());
+
+	for (uint32_t y = 0; y < rows; ++y) {
+		const uint8_t* src = &bits[(bottomUp ? rows - 1 - y : y) * srcPitch];
+		uint8_t* dst = &image.Pixels[y * image.RowPitch()];
+
+		for (int32_t x = 0; x < width; ++x, src += bytesPerPixel, dst += 4) {
+			// BMP stores BGR(A).
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = bytesPerPixel == 4 ? src[3] : 255;
+		}
+	}
+
+	return true;
+}
+
+bool ImageIO::LoadDds(const std::string& filename, Image& image, std::string& error, CompressedSurface* top) {
+	std::unique_ptr<FILE, FileCloser> file(fopen(filename.c_str(), "rb"));
+	if (!file) {
+		error = filename + ": cannot open file";
+		return false;
+	}
+
+	// Magic (4 bytes), DDS_HEADER (124 bytes), optionally DDS_HEADER_DXT10 (20 bytes).
+	uint8_t header[128];
+	if (fread(header, 1, sizeof(header), file.get()) != sizeof(header) || ReadU32(header) != FourCC('D', 'D', 'S', ' ')) {
+		error = filename + ": not a DDS file";
+		return false;
+	}
+
+	uint32_t height = ReadU32(header + 12);
+	uint32_t width = ReadU32(header + 16);
+	uint32_t pfFlags = ReadU32(header + 80);
+	uint32_t fourCC = ReadU32(header + 84);
+	uint32_t bitCount = ReadU32(header + 88);
+	uint32_t rMask = ReadU32(header + 92);
+
+	uint32_t format = 0;
+	if ((pfFlags & 0x4) && fourCC == FourCC('D', 'X', '1', '0')) {
+		uint8_t dx10[20];
+		if (fread(dx10, 1, sizeof(dx10), file.get()) != sizeof(dx10)) {
+			error = filename + ": truncated DX10 header";
+			return false;
+		}
+		format = ReadU32(dx10);
+	} else if (pfFlags & 0x4) {
+		if (fourCC == FourCC('D', 'X', 'T', '1'))
+			format = DXGI_BC1_UNORM;
+		else if (fourCC == FourCC('D', 'X', 'T', '2') || fourCC == FourCC('D', 'X', 'T', '3'))
+			format = DXGI_BC2_UNORM;
+		else if (fourCC == FourCC('D', 'X', 'T', '4') || fourCC == FourCC('D', 'X', 'T', '5'))
+			format = DXGI_BC3_UNORM;
+	} else if ((pfFlags & 0x40) && bitCount == 32) {
+		format = rMask == 0x000000ff ? DXGI_R8G8B8A8_UNORM : DXGI_B8G8R8A8_UNORM;
+	}
+
+	BlockFormat blockFormat = BlockFormat::BC1;
+	bool compressed = true;
+	switch (format) {
+		case DXGI_BC1_UNORM:
+		case DXGI_BC1_UNORM_SRGB:
+			blockFormat = BlockFormat::BC1;
+			break;
+		case DXGI_BC2_UNORM:
+		case DXGI_BC2_UNORM_SRGB:
+			blockFormat = BlockFormat::BC2;
+			break;
+		case DXGI_BC3_UNORM:
+		case DXGI_BC3_UNORM_SRGB:
+			blockFormat = BlockFormat::BC3;
+			break;
+		case DXGI_R8G8B8A8_UNORM:
+		case DXGI_R8G8B8A8_UNORM_SRGB:
+		case DXGI_B8G8R8A8_UNORM:
+		case DXGI_B8G8R8A8_UNORM_SRGB:
+			compressed = false;
+			break;
+		default:
+			error = filename + ": unsupported DDS pixel format";
+			return false;
+	}
+
+	if (width == 0 || height == 0) {
+		error = filename + ": empty DDS";
+		return false;
+	}
+
+	size_t size = compressed
+		? (size_t)std::max(1u, (width + 3) / 4) * std::max(1u, (height + 3) / 4) * BlockCompressor::BlockBytes(blockFormat)
+		: (size_t)width * height * 4;
+
+	std::vector<uint8_t> bits(size);
+	if (fread(bits.data(), 1, bits.size(), file.get()) != bits.size()) {
+		error = filename + ": truncated pixel data";
+		return false;
+	}
+
+	if (compressed) {
+		image = BlockCompressor::Decompress(bits.data(), width, height, blockFormat);
+		if (top != nullptr) {
+			top->DxgiFormat = format;
+			top->Blocks = std::move(bits);
+		}
+		return true;
+	}
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels = std::move(bits);
+
+	if (format == DXGI_B8G8R8A8_UNORM || format == DXGI_B8G8R8A8_UNORM_SRGB) {
+		for (size_t i = 0; i < image.Pixels.size(); i += 4) {
+			std::swap(image.Pixels[i], image.Pixels[i + 2]);
+		}
+	}
+
+	return true;
+}
+
+bool ImageIO::Load(const std::string& filename, Image& image, std::string& error, CompressedSurface* top) {
+	std::string extension = filename.substr(std::min(filename.size(), filename.find_last_of('.')));
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+
+	if (extension == ".dds")
+		return LoadDds(filename, image, error, top);
+	return LoadBmp(filename, image, error);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 8-bit RGBA image. Rows are tightly packed and stored top row first.
+struct Image {
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<uint8_t> Pixels;
+
+	size_t RowPitch() const {
+		return (size_t)Width * 4;
+	}
+
+	size_t SlicePitch() const {
+		return RowPitch() * Height;
+	}
+};
+
+// The top mip of a block compressed DDS as stored in the file, so it can be written out again
+// without a decode and encode round trip.
+struct CompressedSurface {
+	uint32_t DxgiFormat = 0;	// 0 if the file was not block compressed.
+	std::vector<uint8_t> Blocks;
+};
+
+class ImageIO {
+public:
+	// Loads an uncompressed (BI_RGB) 24 or 32 bit BMP. 24 bit images get an opaque alpha channel.
+	static bool LoadBmp(const std::string& filename, Image& image, std::string& error);
+
+	// Loads the top mip of the first slice of a DDS file. Handles BC1-3 (DXT1-5) and 32 bit RGBA/BGRA,
+	// so shipped textures without a mip chain can be cooked again. top, if given, receives the
+	// blocks as stored.
+	static bool LoadDds(const std::string& filename, Image& image, std::string& error, CompressedSurface* top = nullptr);
+
+	// Picks the loader from the file extension. top is only filled for block compressed DDS files.
+	static bool Load(const std::string& filename, Image& image, std::string& error, CompressedSurface* top = nullptr);
+};
@@ -0,0 +1,256 @@
+#include "MipGenerator.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COOKER_SSE2 1
+#include <emmintrin.h>
+#else
+#define COOKER_SSE2 0
+#endif
+
+namespace {
+	// RGBA float image, one float4 per texel so a texel maps onto one SSE register.
+	struct FloatImage {
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		std::vector<float> Texels;
+
+		float* Row(uint32_t y) {
+			return &Texels[(size_t)y * Width * 4];
+		}
+
+		const float* Row(uint32_t y) const {
+			return &Texels[(size_t)y * Width * 4];
+		}
+	};
+
+	// Texel = sum(weight * source[First + i]) for the filter footprint of one output texel.
+	struct Taps {
+		std::vector<uint32_t> First;
+		std::vector<uint32_t> Count;
+		std::vector<float> Weights;
+		std::vector<uint32_t> Offset;
+	};
+
+	struct Conversion {
+		float ToLinear[256];
+		uint8_t ToSRGB[16384];
+
+		Conversion() {
+			for (int i = 0; i < 256; ++i) {
+				float c = i / 255.0f;
+				ToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < 16384; ++i) {
+				float c = (i + 0.5f) / 16384.0f;
+				float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+				ToSRGB[i] = (uint8_t)std::min(255.0f, s * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	const Conversion& GetConversion() {
+		static const Conversion conversion;
+		return conversion;
+	}
+
+	FloatImage ToFloat(const Image& image, bool gammaCorrect) {
+		const Conversion& conversion = GetConversion();
+
+		FloatImage result;
+		result.Width = image.Width;
+		result.Height = image.Height;
+		result.Texels.resize(image.Pixels.size());
+
+		for (size_t i = 0; i < image.Pixels.size(); i += 4) {
+			for (int c = 0; c < 3; ++c) {
+				result.Texels[i + c] = gammaCorrect ? conversion.ToLinear[image.Pixels[i + c]] : image.Pixels[i + c] / 255.0f;
+			}
+			result.Texels[i + 3] = image.Pixels[i + 3] / 255.0f;
+		}
+
+		return result;
+	}
+
+	Image ToImage(const FloatImage& image, bool gammaCorrect) {
+		const Conversion& conversion = GetConversion();
+
+		Image result;
+		result.Width = image.Width;
+		result.Height = image.Height;
+		result.Pixels.resize(result.SlicePitch());
+
+		for (size_t i = 0; i < image.Texels.size(); i += 4) {
+			for (int c = 0; c < 4; ++c) {
+				float v = std::min(1.0f, std::max(0.0f, image.Texels[i + c]));
+				if (gammaCorrect && c < 3) {
+					result.Pixels[i + c] = conversion.ToSRGB[std::min(16383, (int)(v * 16384.0f))];
+				} else {
+					result.Pixels[i + c] = (uint8_t)(v * 255.0f + 0.5f);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	double BesselI0(double x) {
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; ++k) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	// Kaiser windowed sinc. t is measured in destination texels.
+	double Kaiser(double t) {
+		const double radius = 2.0;
+		const double alpha = 4.0;
+		const double pi = 3.14159265358979323846;
+
+		if (std::fabs(t) >= radius)
+			return 0.0;
+
+		double sinc = t == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+		double r = t / radius;
+		return sinc * BesselI0(alpha * std::sqrt(1.0 - r * r)) / BesselI0(alpha);
+	}
+
+	// Precomputes the footprint of every destination texel along one axis. Source addressing
+	// clamps at the edges, so edge weights pile onto the border texel.
+	Taps BuildTaps(uint32_t sourceSize, uint32_t destSize, MipFilter filter) {
+		Taps taps;
+		double scale = (double)sourceSize / destSize;
+
+		for (uint32_t x = 0; x < destSize; ++x) {
+			int first;
+			int last;
+			double center = (x + 0.5) * scale;
+			bool box = filter == MipFilter::Box || scale == 1.0;
+			if (box) {
+				first = (int)(x * scale);
+				last = (int)std::ceil((x + 1) * scale) - 1;
+			} else {
+				first = (int)std::floor(center - 2.0 * scale);
+				last = (int)std::ceil(center + 2.0 * scale);
+			}
+
+			uint32_t clampedFirst = (uint32_t)std::max(0, first);
+			uint32_t clampedLast = (uint32_t)std::min((int)sourceSize - 1, last);
+			std::vector<double> weights(clampedLast - clampedFirst + 1, 0.0);
+			double sum = 0.0;
+
+			for (int s = first; s <= last; ++s) {
+				double w = box ? 1.0 : Kaiser(((s + 0.5) - center) / scale);
+				int clamped = std::min((int)clampedLast, std::max((int)clampedFirst, s));
+				weights[clamped - clampedFirst] += w;
+				sum += w;
+			}
+
+			taps.First.push_back(clampedFirst);
+			taps.Count.push_back((uint32_t)weights.size());
+			taps.Offset.push_back((uint32_t)taps.Weights.size());
+			for (double w : weights) {
+				taps.Weights.push_back((float)(w / sum));
+			}
+		}
+
+		return taps;
+	}
+
+	// dst[i] = sum(weights[k] * src[k * stride + i]) for one float4 texel.
+	inline void Accumulate(const float* src, size_t stride, const float* weights, uint32_t count, float* dst) {
+#if COOKER_SSE2
+		__m128 sum = _mm_setzero_ps();
+		for (uint32_t k = 0; k < count; ++k) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src + k * stride), _mm_set1_ps(weights[k])));
+		}
+		_mm_storeu_ps(dst, sum);
+#else
+		float sum[4] = {};
+		for (uint32_t k = 0; k < count; ++k) {
+			for (int c = 0; c < 4; ++c) {
+				sum[c] += src[k * stride + c] * weights[k];
+			}
+		}
+		for (int c = 0; c < 4; ++c) {
+			dst[c] = sum[c];
+		}
+#endif
+	}
+
+	// Separable resample: horizontal into a scratch image, then vertical. Rows are independent in
+	// both passes and are split across threads.
+	FloatImage Downsample(const FloatImage& source, MipFilter filter, unsigned threads) {
+		uint32_t width = std::max(source.Width >> 1, 1u);
+		uint32_t height = std::max(source.Height >> 1, 1u);
+
+		Taps horizontal = BuildTaps(source.Width, width, filter);
+		Taps vertical = BuildTaps(source.Height, height, filter);
+
+		FloatImage scratch;
+		scratch.Width = width;
+		scratch.Height = source.Height;
+		scratch.Texels.resize((size_t)width * source.Height * 4);
+
+		Parallel::For(source.Height, threads, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t y = begin; y < end; ++y) {
+				const float* src = source.Row(y);
+				float* dst = scratch.Row(y);
+				for (uint32_t x = 0; x < width; ++x) {
+					Accumulate(src + horizontal.First[x] * 4, 4, &horizontal.Weights[horizontal.Offset[x]],
+							   horizontal.Count[x], dst + x * 4);
+				}
+			}
+		});
+
+		FloatImage result;
+		result.Width = width;
+		result.Height = height;
+		result.Texels.resize((size_t)width * height * 4);
+
+		Parallel::For(height, threads, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t y = begin; y < end; ++y) {
+				const float* src = scratch.Row(vertical.First[y]);
+				const float* weights = &vertical.Weights[vertical.Offset[y]];
+				float* dst = result.Row(y);
+				for (uint32_t x = 0; x < width; ++x) {
+					Accumulate(src + x * 4, (size_t)width * 4, weights, vertical.Count[y], dst + x * 4);
+				}
+			}
+		});
+
+		return result;
+	}
+}
+
+uint32_t MipGenerator::MipCount(uint32_t width, uint32_t height) {
+	uint32_t count = 1;
+	while (width > 1 || height > 1) {
+		width = std::max(width >> 1, 1u);
+		height = std::max(height >> 1, 1u);
+		++count;
+	}
+	return count;
+}
+
+std::vector<Image> MipGenerator::Generate(const Image& source, const MipOptions& options) {
+	std::vector<Image> chain;
+	chain.reserve(MipCount(source.Width, source.Height));
+	chain.push_back(source);
+
+	FloatImage level = ToFloat(source, options.GammaCorrect);
+	while (level.Width > 1 || level.Height > 1) {
+		level = Downsample(level, options.Filter, options.Threads);
+		chain.push_back(ToImage(level, options.GammaCorrect));
+	}
+
+	return chain;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Image.h"
+
+enum class MipFilter {
+	Box,	// 2x2 average
+	Kaiser,	// Kaiser windowed sinc, sharper minification with less aliasing than the box
+};
+
+struct MipOptions {
+	MipFilter Filter = MipFilter::Kaiser;
+
+	// Filter RGB in linear space, treating the source as sRGB encoded. Turn off for data textures
+	// such as normal maps. Alpha is always filtered as stored.
+	bool GammaCorrect = true;
+
+	unsigned Threads = 1;
+};
+
+class MipGenerator {
+public:
+	// Number of levels in a full chain down to 1x1.
+	static uint32_t MipCount(uint32_t width, uint32_t height);
+
+	// Returns the full mip chain, level 0 being a copy of the source. Every level is filtered from
+	// the previous one at float precision and only quantized to 8 bits on output.
+	static std::vector<Image> Generate(const Image& source, const MipOptions& options = MipOptions());
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+class Parallel {
+public:
+	static unsigned DefaultThreadCount() {
+		unsigned count = std::thread::hardware_concurrency();
+		return count == 0 ? 1 : count;
+	}
+
+	// Splits [0, count) into contiguous ranges and runs fn(begin, end) on up to threadCount threads.
+	// The calling thread takes the first range.
+	template<typename Fn>
+	static void For(uint32_t count, unsigned threadCount, Fn&& fn) {
+		if (count == 0)
+			return;
+
+		threadCount = std::max(1u, std::min<unsigned>(threadCount, count));
+		uint32_t chunk = (count + threadCount - 1) / threadCount;
+
+		std::vector<std::thread> workers;
+		for (unsigned t = 1; t < threadCount; ++t) {
+			uint32_t begin = t * chunk;
+			uint32_t end = std::min(count, begin + chunk);
+			if (begin < end)
+				workers.emplace_back([&fn, begin, end]() { fn(begin, end); });
+		}
+
+		fn(0u, std::min(count, chunk));
+
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+};
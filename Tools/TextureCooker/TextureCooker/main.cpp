@@ -0,0 +1,327 @@
+// Offline texture cooker. Converts source images into DDS files the samples load with
+// CreateDDSTextureFromFile12. Plain C++17, no Windows dependencies, so it also runs headless
+// on build machines.
+//
+//   TextureCooker cook <output.dds> <input.bmp|input.dds> [options]
+//   TextureCooker flipbook <output.dds> <frame pattern> --first <n> --count <n> [options]
+//   TextureCooker flipbook <output.dds> <frame0.bmp> <frame1.bmp> ... [options]
+//
+// Options:
+//   --format rgba|bc1|bc2|bc3|bc7   output format (default rgba)
+//   --srgb                          tag the texture as sRGB
+//   --filter box|kaiser             mip filter (default kaiser)
+//   --linear                        filter mips without sRGB decoding (normal maps, masks)
+//   --no-mips                       write the top level only
+//   --keep-top                      copy the top mip of a DDS input already in the output format
+//                                   unchanged and only generate the levels below it
+//   --threads <n>                   encoder and mip threads (default: all cores)
+//
+// The frame pattern is a printf-style file name, e.g. BoltAnim/Bolt%03d.bmp.
+// DDS inputs are decoded from their top mip, which is how shipped textures without a mip chain
+// get one. Every run reports mip generation throughput and the output size; block compressed
+// output also reports PSNR of the top mip and encoder throughput.
+
+#include "BlockCompressor.h"
+#include "DDSWriter.h"
+#include "Image.h"
+#include "MipGenerator.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+	struct Options {
+		std::string Command;
+		std::string Output;
+		std::vector<std::string> Inputs;
+		int First = 0;
+		int Count = 0;
+		bool SRGB = false;
+		std::string Format = "rgba";
+		MipFilter Filter = MipFilter::Kaiser;
+		bool GammaCorrect = true;
+		bool Mips = true;
+		bool KeepTop = false;
+		unsigned Threads = Parallel::DefaultThreadCount();
+	};
+
+	void PrintUsage() {
+		fprintf(stderr,
+				"usage:\n"
+				"  TextureCooker cook <output.dds> <input.bmp|input.dds> [options]\n"
+				"  TextureCooker flipbook <output.dds> <frame pattern> --first <n> --count <n> [options]\n"
+				"  TextureCooker flipbook <output.dds> <frame0.bmp> <frame1.bmp> ... [options]\n"
+				"options:\n"
+				"  --format rgba|bc1|bc2|bc3|bc7  --srgb  --filter box|kaiser  --linear  --no-mips  --keep-top\n"
+				"  --threads <n>\n");
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options) {
+		if (argc < 4)
+			return false;
+
+		options.Command = argv[1];
+		options.Output = argv[2];
+
+		for (int i = 3; i < argc; ++i) {
+			if (strcmp(argv[i], "--first") == 0 && i + 1 < argc) {
+				options.First = atoi(argv[++i]);
+			} else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+				options.Count = atoi(argv[++i]);
+			} else if (strcmp(argv[i], "--srgb") == 0) {
+				options.SRGB = true;
+			} else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+				options.Format = argv[++i];
+			} else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+				++i;
+				if (strcmp(argv[i], "box") == 0) {
+					options.Filter = MipFilter::Box;
+				} else if (strcmp(argv[i], "kaiser") == 0) {
+					options.Filter = MipFilter::Kaiser;
+				} else {
+					return false;
+				}
+			} else if (strcmp(argv[i], "--linear") == 0) {
+				options.GammaCorrect = false;
+			} else if (strcmp(argv[i], "--no-mips") == 0) {
+				options.Mips = false;
+			} else if (strcmp(argv[i], "--keep-top") == 0) {
+				options.KeepTop = true;
+			} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+				options.Threads = (unsigned)std::max(1, atoi(argv[++i]));
+			} else {
+				options.Inputs.push_back(argv[i]);
+			}
+		}
+
+		return !options.Inputs.empty();
+	}
+
+	// Expands a printf-style pattern into Count file names, or returns the inputs as given.
+	std::vector<std::string> ExpandFrames(const Options& options) {
+		if (options.Inputs.size() != 1 || options.Inputs[0].find('%') == std::string::npos)
+			return options.Inputs;
+
+		std::vector<std::string> frames;
+		for (int i = 0; i < options.Count; ++i) {
+			char name[1024];
+			snprintf(name, sizeof(name), options.Inputs[0].c_str(), options.First + i);
+			frames.push_back(name);
+		}
+		return frames;
+	}
+
+	bool SelectFormat(const Options& options, DDSFormat& format, bool& compressed, BlockFormat& blockFormat) {
+		compressed = true;
+		if (options.Format == "rgba") {
+			format = options.SRGB ? DDSFormat::R8G8B8A8_UNORM_SRGB : DDSFormat::R8G8B8A8_UNORM;
+			compressed = false;
+		} else if (options.Format == "bc1") {
+			format = options.SRGB ? DDSFormat::BC1_UNORM_SRGB : DDSFormat::BC1_UNORM;
+			blockFormat = BlockFormat::BC1;
+		} else if (options.Format == "bc2") {
+			format = options.SRGB ? DDSFormat::BC2_UNORM_SRGB : DDSFormat::BC2_UNORM;
+			blockFormat = BlockFormat::BC2;
+		} else if (options.Format == "bc3") {
+			format = options.SRGB ? DDSFormat::BC3_UNORM_SRGB : DDSFormat::BC3_UNORM;
+			blockFormat = BlockFormat::BC3;
+		} else if (options.Format == "bc7") {
+			format = options.SRGB ? DDSFormat::BC7_UNORM_SRGB : DDSFormat::BC7_UNORM;
+			blockFormat = BlockFormat::BC7;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	// Builds the mip chain of every slice, encodes it and writes the DDS. All slices must have
+	// the same size.
+	int CookSlices(const Options& options, const std::vector<std::string>& inputs) {
+		DDSTexture texture;
+		bool compressed;
+		BlockFormat blockFormat = BlockFormat::BC1;
+		if (!SelectFormat(options, texture.Format, compressed, blockFormat)) {
+			fprintf(stderr, "%s: unknown format '%s'\n", options.Command.c_str(), options.Format.c_str());
+			return 1;
+		}
+
+		texture.ArraySize = (uint32_t)inputs.size();
+
+		MipOptions mipOptions;
+		mipOptions.Filter = options.Filter;
+		mipOptions.GammaCorrect = options.GammaCorrect;
+		mipOptions.Threads = options.Threads;
+
+		uint64_t mipPixels = 0;
+		double mipSeconds = 0.0;
+		uint64_t encodedPixels = 0;
+		double encodeSeconds = 0.0;
+		double squaredErrorRGB = 0.0;
+		double squaredErrorA = 0.0;
+		uint64_t topPixels = 0;
+
+		for (size_t i = 0; i < inputs.size(); ++i) {
+			Image source;
+			CompressedSurface top;
+			std::string error;
+			if (!ImageIO::Load(inputs[i], source, error, &top)) {
+				fprintf(stderr, "%s: %s\n", options.Command.c_str(), error.c_str());
+				return 1;
+			}
+
+			if (options.KeepTop && (!compressed || top.DxgiFormat != (uint32_t)texture.Format)) {
+				fprintf(stderr, "%s: --keep-top needs a DDS input already in %s%s\n", options.Command.c_str(),
+						options.Format.c_str(), options.SRGB ? " (sRGB)" : "");
+				return 1;
+			}
+
+			if (i == 0) {
+				texture.Width = source.Width;
+				texture.Height = source.Height;
+				texture.MipLevels = options.Mips ? MipGenerator::MipCount(source.Width, source.Height) : 1;
+			} else if (source.Width != texture.Width || source.Height != texture.Height) {
+				fprintf(stderr, "%s: %s is %ux%u, expected %ux%u\n", options.Command.c_str(),
+						inputs[i].c_str(), source.Width, source.Height, texture.Width, texture.Height);
+				return 1;
+			}
+
+			std::vector<Image> chain;
+			if (options.Mips) {
+				auto start = std::chrono::steady_clock::now();
+				chain = MipGenerator::Generate(source, mipOptions);
+				mipSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				// Throughput counts source texels filtered, i.e. every level but the last.
+				for (size_t mip = 0; mip + 1 < chain.size(); ++mip) {
+					mipPixels += (uint64_t)chain[mip].Width * chain[mip].Height;
+				}
+			} else {
+				chain.push_back(std::move(source));
+			}
+			for (size_t mip = 0; mip < chain.size(); ++mip) {
+				Image& level = chain[mip];
+				if (!compressed) {
+					texture.Subresources.push_back(std::move(level.Pixels));
+					continue;
+				}
+
+				std::vector<uint8_t> blocks;
+				if (mip == 0 && options.KeepTop) {
+					// Already encoded in the output format, so the top mip is stored as it was.
+					blocks = std::move(top.Blocks);
+				} else {
+					auto start = std::chrono::steady_clock::now();
+					blocks = BlockCompressor::Compress(level, blockFormat, options.Threads);
+					encodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					encodedPixels += (uint64_t)level.Width * level.Height;
+				}
+
+				if (mip == 0) {
+					// Accumulate squared error rather than averaging per-slice PSNR values.
+					Image decoded = BlockCompressor::Decompress(blocks.data(), level.Width, level.Height, blockFormat);
+					bool opaque = true;
+					bool decodedOpaque = true;
+					for (size_t p = 0; p < level.Pixels.size(); p += 4) {
+						for (int c = 0; c < 4; ++c) {
+							double d = (double)level.Pixels[p + c] - (double)decoded.Pixels[p + c];
+							(c < 3 ? squaredErrorRGB : squaredErrorA) += d * d;
+						}
+						opaque = opaque && level.Pixels[p + 3] == 255;
+						decodedOpaque = decodedOpaque && decoded.Pixels[p + 3] == 255;
+					}
+					topPixels += (uint64_t)level.Width * level.Height;
+
+					// Every format stores alpha 255 exactly, so opaque input has to come back opaque.
+					if (opaque && !decodedOpaque) {
+						fprintf(stderr, "%s: %s is opaque but decodes with alpha below 255\n", options.Command.c_str(),
+								inputs[i].c_str());
+						return 1;
+					}
+				}
+
+				texture.Subresources.push_back(std::move(blocks));
+			}
+		}
+
+		std::string error;
+		if (!DDSWriter::Write(options.Output, texture, error)) {
+			fprintf(stderr, "%s: %s\n", options.Command.c_str(), error.c_str());
+			return 1;
+		}
+
+		size_t totalBytes = 0;
+		size_t uncompressedBytes = 0;
+		for (uint32_t slice = 0; slice < texture.ArraySize; ++slice) {
+			for (uint32_t mip = 0; mip < texture.MipLevels; ++mip) {
+				totalBytes += texture.Subresources[slice * texture.MipLevels + mip].size();
+				uncompressedBytes += DDSWriter::SurfaceSize(DDSFormat::R8G8B8A8_UNORM,
+															std::max(texture.Width >> mip, 1u),
+															std::max(texture.Height >> mip, 1u));
+			}
+		}
+
+		printf("%s: %s, %u slice(s), %ux%u, %u mips, %.2f MiB (%.1f:1 vs RGBA8)\n",
+			   options.Output.c_str(), options.Format.c_str(), texture.ArraySize, texture.Width, texture.Height,
+			   texture.MipLevels, totalBytes / (1024.0 * 1024.0), (double)uncompressedBytes / totalBytes);
+
+		if (options.Mips) {
+			printf("  mips: %s%s, %.3f s on %u thread(s), %.1f MPix/s\n",
+				   options.Filter == MipFilter::Kaiser ? "kaiser" : "box", options.GammaCorrect ? " (gamma correct)" : "",
+				   mipSeconds, options.Threads, mipPixels / 1e6 / std::max(mipSeconds, 1e-9));
+		}
+
+		if (compressed) {
+			auto psnr = [](double squaredError, double samples) {
+				double mse = squaredError / samples;
+				return mse == 0.0 ? 99.99 : 10.0 * log10(255.0 * 255.0 / mse);
+			};
+			printf("  PSNR mip 0: RGB %.2f dB, alpha %.2f dB\n",
+				   psnr(squaredErrorRGB, topPixels * 3.0), psnr(squaredErrorA, (double)topPixels));
+			printf("  encode: %.3f s on %u thread(s), %.1f MPix/s\n",
+				   encodeSeconds, options.Threads, encodedPixels / 1e6 / std::max(encodeSeconds, 1e-9));
+		}
+
+		return 0;
+	}
+
+	int CookSingle(const Options& options) {
+		if (options.Inputs.size() != 1) {
+			fprintf(stderr, "cook: expected exactly one input image\n");
+			return 1;
+		}
+		return CookSlices(options, options.Inputs);
+	}
+
+	// Packs every frame, with its full mip chain, into one slice of a 2D texture array so an
+	// animated material only has to change the slice index instead of the bound texture.
+	int CookFlipbook(const Options& options) {
+		std::vector<std::string> frames = ExpandFrames(options);
+		if (frames.empty()) {
+			fprintf(stderr, "flipbook: no frames (did you pass --count?)\n");
+			return 1;
+		}
+		return CookSlices(options, frames);
+	}
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 1;
+	}
+
+	if (options.Command == "cook")
+		return CookSingle(options);
+	if (options.Command == "flipbook")
+		return CookFlipbook(options);
+
+	PrintUsage();
+	return 1;
+}